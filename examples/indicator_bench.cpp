@@ -0,0 +1,152 @@
+// Times the technical indicators on each instruction set the CPU offers
+// and checks them against the scalar kernels.
+//
+//   indicator_bench [bars]
+
+#include <mt5bridge/mt5bridge.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Indicator {
+    const char *name;
+    size_t outputs;
+    std::function<int(const std::vector<mt5bridge_bar> &, std::vector<double> *)> run;
+};
+
+double best_ns(const std::function<void()> &fn) {
+    double best = 1e300;
+    for (int i = 0; i < 5; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    return best;
+}
+
+double max_diff(const std::vector<double> &a, const std::vector<double> &b) {
+    double diff = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::isnan(a[i]) != std::isnan(b[i]))
+            return INFINITY;
+        if (!std::isnan(a[i]))
+            diff = std::max(diff, std::fabs(a[i] - b[i]));
+    }
+    return diff;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (n == 0) {
+        std::fprintf(stderr, "usage: indicator_bench [bars]\n");
+        return 1;
+    }
+
+    // Indicators need no terminal; the simulator keeps initialization
+    // from starting Python.
+    if (mt5bridge_config_set("backend", "sim") != 0 || mt5bridge_initialize(nullptr) != 0) {
+        std::fprintf(stderr, "initialization failed: %s\n", mt5bridge_last_error());
+        return 1;
+    }
+
+    std::vector<mt5bridge_bar> bars(n);
+    std::mt19937_64 rng(1);
+    std::normal_distribution<double> step(0.0, 0.0002);
+    double price = 1.1;
+    for (size_t i = 0; i < n; ++i) {
+        mt5bridge_bar &b = bars[i];
+        b.time = static_cast<int64_t>(i) * 60;
+        b.open = price;
+        price += step(rng);
+        b.close = price;
+        b.high = std::max(b.open, b.close) + std::fabs(step(rng));
+        b.low = std::min(b.open, b.close) - std::fabs(step(rng));
+    }
+    const size_t stride = sizeof(mt5bridge_bar);
+
+    const Indicator indicators[] = {
+        {"sma(20)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_sma(&b[0].close, stride, n, 20, o[0].data());
+         }},
+        {"ema(20)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_ema(&b[0].close, stride, n, 20, o[0].data());
+         }},
+        {"stddev(20)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_stddev(&b[0].close, stride, n, 20, o[0].data());
+         }},
+        {"zscore(20)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_zscore(&b[0].close, stride, n, 20, o[0].data());
+         }},
+        {"bollinger(20,2)", 3,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_bollinger(&b[0].close, stride, n, 20, 2.0, o[0].data(),
+                                        o[1].data(), o[2].data());
+         }},
+        {"rsi(14)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_rsi(&b[0].close, stride, n, 14, o[0].data());
+         }},
+        {"atr(14)", 1,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_atr(&b[0].high, &b[0].low, &b[0].close, stride, n, 14, o[0].data());
+         }},
+        {"macd(12,26,9)", 3,
+         [&](const std::vector<mt5bridge_bar> &b, std::vector<double> *o) {
+             return mt5bridge_macd(&b[0].close, stride, n, 12, 26, 9, o[0].data(), o[1].data(),
+                                   o[2].data());
+         }},
+    };
+
+    std::printf("%zu bars\n%-16s %-8s %10s %8s %10s\n", n, "indicator", "isa", "ns/bar",
+                "speedup", "max diff");
+    for (const Indicator &ind : indicators) {
+        std::vector<double> scalar[3], out[3];
+        double scalar_ns = 0.0;
+        std::string seen;
+        for (const char *isa : {"scalar", "avx2", "avx512"}) {
+            mt5bridge_config_set("indicators.isa", isa);
+            const std::string used = mt5bridge_indicator_isa();
+            if (seen.find(used + ",") != std::string::npos)
+                continue; // Not supported here; fell back to one already timed.
+            seen += used + ",";
+
+            for (size_t k = 0; k < ind.outputs; ++k)
+                out[k].assign(n, 0.0);
+            if (ind.run(bars, out) != 0) {
+                std::fprintf(stderr, "%s: %s\n", ind.name, mt5bridge_last_error());
+                return 1;
+            }
+            const double ns = best_ns([&] { ind.run(bars, out); });
+            double diff = 0.0;
+            if (used == "scalar") {
+                scalar_ns = ns;
+                for (size_t k = 0; k < ind.outputs; ++k)
+                    scalar[k] = out[k];
+            } else {
+                for (size_t k = 0; k < ind.outputs; ++k)
+                    diff = std::max(diff, max_diff(out[k], scalar[k]));
+            }
+            std::printf("%-16s %-8s %10.2f %7.2fx %10.2g\n", ind.name, used.c_str(), ns / n,
+                        scalar_ns / ns, diff);
+        }
+    }
+
+    mt5bridge_shutdown();
+    return 0;
+}
@@ -24,24 +24,30 @@
 
 #pragma once
 
-#if !defined(_WIN32)
-#error "mt5bridge is only supported on Windows"
-#endif
-
 #include <jansson.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Live trading needs the Windows-only MetaTrader5 package; the offline
+ * backends (see "backend" in the configuration) also build elsewhere.
+ */
+#if defined(_WIN32)
 #ifdef MT5BRIDGE_BUILD
 #define MT5BRIDGE_API extern "C" __declspec(dllexport)
 #else
 #define MT5BRIDGE_API extern "C" __declspec(dllimport)
 #endif
+#else
+#define MT5BRIDGE_API extern "C" __attribute__((visibility("default")))
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Initializes the bridge runtime.
+ * Resolves the configuration first (see mt5bridge_config_set); a non-null
+ * python_home overrides the configured one.
  * Returns 0 on success, non-zero on error.
  */
 MT5BRIDGE_API int mt5bridge_initialize(const wchar_t *python_home);
@@ -54,7 +60,519 @@ MT5BRIDGE_API void mt5bridge_shutdown();
  */
 MT5BRIDGE_API json_t *mt5bridge_eval(json_t *request);
 
-/* Returns last error message or nullptr if no error. */
+/* mt5bridge_eval over JSON text, for callers without jansson (the Python
+ * bindings). Returns the result as compact JSON in a buffer owned by the
+ * calling thread, valid until its next call, or nullptr on error.
+ */
+MT5BRIDGE_API const char *mt5bridge_eval_json(const char *request);
+
+/* Evaluates a JSON array of requests in one call and returns the array
+ * of their results, in order; a failed request's entry is
+ * {"error": message}. Requests served by the embedded interpreter each
+ * take the GIL; native methods run without it. Returns nullptr only if
+ * requests is not an array.
+ */
+MT5BRIDGE_API json_t *mt5bridge_eval_batch(json_t *requests);
+
+/* mt5bridge_eval_batch over JSON text, answered like mt5bridge_eval_json. */
+MT5BRIDGE_API const char *mt5bridge_eval_batch_json(const char *requests);
+
+/* Returns the current UTC time in nanoseconds from the clock used for
+ * the recv_ns stamps on ticks, bars and trade results, so consumers can
+ * measure bridge-to-strategy latency against the same time base.
+ */
+MT5BRIDGE_API int64_t mt5bridge_now_ns();
+
+/* Converts count broker server timestamps to UTC nanoseconds.
+ * unit_ns is the unit of the input: 1000000000 for bar times (seconds),
+ * 1000000 for tick time_msc. Uses the estimated server offset and the
+ * configured DST rule, so times on both sides of a DST change convert
+ * correctly. Returns 0 on success, non-zero if the offset is unknown.
+ */
+MT5BRIDGE_API int mt5bridge_server_to_utc_ns(const int64_t *times, size_t count,
+                                            int64_t unit_ns, int64_t *out);
+
+/* Loads configuration from an INI file instead of $MT5BRIDGE_CONFIG or
+ * ./bridge.ini. Must be called before mt5bridge_initialize.
+ * Returns 0 on success, non-zero on error.
+ */
+MT5BRIDGE_API int mt5bridge_config_load(const char *path);
+
+/* Overrides a configuration key, e.g. ("poll.ticks_ms", "50").
+ * Overrides take precedence over the file and MT5BRIDGE_* environment
+ * variables. While initialized, only keys reported as live may change.
+ * Returns 0 on success, non-zero on error.
+ */
+MT5BRIDGE_API int mt5bridge_config_set(const char *key, const char *value);
+
+/* Returns the effective configuration with the source of every value.
+ * The result must be freed with json_decref().
+ */
+MT5BRIDGE_API json_t *mt5bridge_config_get();
+
+/* Sets the placement/scheduling policy for one class of bridge threads.
+ * role is one of "python_executor", "quote_poller", "disk_writer",
+ * "timer" or "worker"; policy is an object such as
+ *   {"cpus":[2,3], "sched":"fifo", "priority":80,
+ *    "wait":"spin_then_park", "spin_us":50}
+ * Members left out keep their current value. Applies to threads started
+ * after the call; "python_executor" applies to the thread that calls
+ * mt5bridge_initialize with the Python backend, which owns the
+ * interpreter. Returns 0 on success, non-zero on error.
+ */
+MT5BRIDGE_API int mt5bridge_set_thread_policy(const char *role, json_t *policy);
+
+/* Typed request API.
+ *
+ * The same calls as the JSON methods of the same name, with results in
+ * native records instead of JSON. They are served by whichever backend is
+ * configured, so a strategy written against them runs unchanged live, on
+ * the simulator and in backtests. Inside a backtest "now" is the time of
+ * the event being processed, and no call returns data from after it.
+ */
+
+/* Field layout matches the copy_ticks_* record arrays. */
+typedef struct mt5bridge_tick {
+    int64_t time_msc;
+    double bid;
+    double ask;
+    double last;
+    uint64_t volume;
+    uint32_t flags;
+    double volume_real;
+    int64_t recv_ns;
+    uint64_t seq;
+    uint32_t integrity;
+} mt5bridge_tick;
+
+/* Field layout matches the copy_rates_* record arrays. */
+typedef struct mt5bridge_bar {
+    int64_t time;
+    double open;
+    double high;
+    double low;
+    double close;
+    uint64_t tick_volume;
+    int32_t spread;
+    uint64_t real_volume;
+    int64_t recv_ns;
+} mt5bridge_bar;
+
+/* Market order; action and type take the TRADE_ACTION_* and ORDER_TYPE_*
+ * values. A non-zero position closes (part of) that position.
+ */
+typedef struct mt5bridge_trade_request {
+    int32_t action;
+    int32_t type;
+    const char *symbol;
+    double volume;
+    double price;
+    double sl;
+    double tp;
+    int32_t deviation;
+    uint64_t position;
+    uint64_t magic;
+    const char *comment;
+} mt5bridge_trade_request;
+
+typedef struct mt5bridge_trade_result {
+    uint32_t retcode;
+    uint64_t deal;
+    uint64_t order;
+    double volume;
+    double price;
+    double bid;
+    double ask;
+    int64_t recv_ns;
+    char comment[64];
+} mt5bridge_trade_result;
+
+typedef struct mt5bridge_position {
+    uint64_t ticket;
+    char symbol[32];
+    int32_t type;
+    double volume;
+    double price_open;
+    double price_current;
+    double sl;
+    double tp;
+    double profit;
+    int64_t time_msc;
+    uint64_t magic;
+} mt5bridge_position;
+
+/* Latest quote of symbol. Returns 0 on success. */
+MT5BRIDGE_API int mt5bridge_symbol_info_tick(const char *symbol, mt5bridge_tick *out);
+
+/* Copies up to count ticks from date_from (server seconds) into out.
+ * flags is a COPY_TICKS_* value. Returns the number copied, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copy_ticks_from(const char *symbol, int64_t date_from,
+                                               size_t count, int flags,
+                                               mt5bridge_tick *out);
+
+/* Copies up to count bars, start bars back from the current one, oldest
+ * first. Returns the number copied, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copy_rates_from_pos(const char *symbol, int timeframe,
+                                                   int64_t start, size_t count,
+                                                   mt5bridge_bar *out);
+
+/* Sends a market order. Returns 0 when the server answered (check
+ * result->retcode), non-zero on error.
+ */
+MT5BRIDGE_API int mt5bridge_order_send(const mt5bridge_trade_request *request,
+                                      mt5bridge_trade_result *result);
+
+/* mt5bridge_copy_ticks_from for symbol_count symbols at once. out holds
+ * symbol_count rows of count ticks: symbol i's ticks start at
+ * out + i * count and counts[i] receives how many were copied, or -1 if
+ * that symbol failed (mt5bridge_last_error names the last failure).
+ * Returns the total copied, -1 on invalid arguments.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copy_ticks_batch(const char *const *symbols, size_t symbol_count,
+                                                int64_t date_from, size_t count, int flags,
+                                                mt5bridge_tick *out, int64_t *counts);
+
+/* mt5bridge_copy_rates_from_pos for symbol_count symbols at once, laid
+ * out like mt5bridge_copy_ticks_batch.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copy_rates_batch(const char *const *symbols, size_t symbol_count,
+                                                int timeframe, int64_t start, size_t count,
+                                                mt5bridge_bar *out, int64_t *counts);
+
+/* Snapshots of symbol_count symbols from the history store: out is a
+ * symbol_count x time_count matrix whose cell (i, j) at
+ * out + i * time_count + j receives the last stored tick of symbols[i]
+ * with time_msc <= times_msc[j], zeroed when there is none. times_msc
+ * must be ascending. A symbol without history gets a zeroed row and is
+ * named by mt5bridge_last_error. Returns the cells filled, -1 on invalid
+ * arguments.
+ */
+MT5BRIDGE_API int64_t mt5bridge_asof_ticks(const char *const *symbols, size_t symbol_count,
+                                          const int64_t *times_msc, size_t time_count,
+                                          mt5bridge_tick *out);
+
+/* mt5bridge_asof_ticks for bars of timeframe: cell (i, j) is the last
+ * bar that had closed by times[j] (open time + timeframe length <=
+ * times[j], in seconds; MN1 bars close at the start of the next month).
+ */
+MT5BRIDGE_API int64_t mt5bridge_asof_bars(const char *const *symbols, size_t symbol_count,
+                                         int timeframe, const int64_t *times, size_t time_count,
+                                         mt5bridge_bar *out);
+
+/* Copies up to capacity open positions into out. Returns the total number
+ * of open positions, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_positions_get(mt5bridge_position *out, size_t capacity);
+
+/* Called for every new tick of a run; returning non-zero stops the run. */
+typedef int (*mt5bridge_tick_handler)(const char *symbol, const mt5bridge_tick *tick,
+                                      void *user);
+
+/* Delivers the ticks of the given symbols to handler in time order until
+ * it returns non-zero. Live backends poll every poll.ticks_ms; a backtest
+ * replays its history as fast as possible and returns at its end (pass no
+ * symbols to run all of backtest.symbols). Returns 0 on success.
+ */
+MT5BRIDGE_API int mt5bridge_run(const char *const *symbols, size_t count,
+                               mt5bridge_tick_handler handler, void *user);
+
+/* One instance of a parallel backtest: the symbols to run (none runs all
+ * of backtest.symbols) and the handler's user pointer, which typically
+ * holds the job's parameters and strategy state.
+ */
+typedef struct mt5bridge_backtest_job {
+    const char *const *symbols;
+    size_t symbol_count;
+    void *user;
+} mt5bridge_backtest_job;
+
+/* Runs every job as an independent backtest on threads.workers threads
+ * (backend=backtest only). All jobs share the mapped history; each has
+ * its own account, and typed API calls made from the handler are served
+ * by the job's own instance. The handler must therefore be safe to call
+ * from several threads at once for different jobs. Returns
+ * {"jobs": [backtest_report per job], "best_job", "ticks", "wall_ns", ...}
+ * or nullptr on error; the caller owns the result.
+ */
+MT5BRIDGE_API json_t *mt5bridge_backtest_parallel(const mt5bridge_backtest_job *jobs,
+                                                 size_t count,
+                                                 mt5bridge_tick_handler handler);
+
+/* Technical indicators over n doubles spaced stride bytes apart, e.g.
+ * &bars[0].close with stride sizeof(mt5bridge_bar). Each output array
+ * holds n values; positions before the first full window are NaN. They
+ * need no initialized bridge. Return 0 on success, -1 on invalid
+ * arguments.
+ */
+MT5BRIDGE_API int mt5bridge_sma(const double *in, size_t stride, size_t n, size_t period,
+                               double *out);
+MT5BRIDGE_API int mt5bridge_ema(const double *in, size_t stride, size_t n, size_t period,
+                               double *out);
+/* Population standard deviation over the window. */
+MT5BRIDGE_API int mt5bridge_stddev(const double *in, size_t stride, size_t n, size_t period,
+                                  double *out);
+MT5BRIDGE_API int mt5bridge_zscore(const double *in, size_t stride, size_t n, size_t period,
+                                  double *out);
+MT5BRIDGE_API int mt5bridge_bollinger(const double *in, size_t stride, size_t n, size_t period,
+                                     double k, double *mid, double *upper, double *lower);
+/* Wilder's RSI and ATR; the first value is at index period. */
+MT5BRIDGE_API int mt5bridge_rsi(const double *close, size_t stride, size_t n, size_t period,
+                               double *out);
+MT5BRIDGE_API int mt5bridge_atr(const double *high, const double *low, const double *close,
+                               size_t stride, size_t n, size_t period, double *out);
+/* Requires 0 < fast < slow; macd starts at slow - 1, signal and hist at
+ * slow + signal - 2.
+ */
+MT5BRIDGE_API int mt5bridge_macd(const double *close, size_t stride, size_t n, size_t fast,
+                                size_t slow, size_t signal, double *macd, double *signal_line,
+                                double *hist);
+
+/* Instruction set the indicators run on: "scalar", "avx2" or "avx512"
+ * (chosen by indicators.isa and the CPU).
+ */
+MT5BRIDGE_API const char *mt5bridge_indicator_isa();
+
+/* Latest value of a stream indicator. */
+typedef struct mt5bridge_stream_value {
+    double value;           /* NaN until the first full window. */
+    int64_t time_msc;       /* Time of the last sample consumed. */
+    uint64_t samples;       /* Samples consumed so far. */
+    int32_t ready;
+} mt5bridge_stream_value;
+
+/* Registers an indicator updated in O(1) from every live bar or tick
+ * answer of symbol: kind is "ema", "variance", "stddev", "min", "max" or
+ * "vwap"; timeframe 0 follows ticks, any other the closed bars of that
+ * timeframe. field names the price read (bars: open, high, low, close;
+ * ticks: bid, ask, last, mid; null for close or bid). period 0 makes a
+ * vwap cumulative. Returns the indicator id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_stream_indicator_add(const char *symbol, const char *kind,
+                                                    int timeframe, const char *field,
+                                                    size_t period);
+MT5BRIDGE_API int mt5bridge_stream_indicator_remove(int64_t id);
+
+/* Copies the indicator's latest value without taking a lock, so it may
+ * be polled from any thread while updates run. Returns 0, or -1 for an
+ * unknown or removed id.
+ */
+MT5BRIDGE_API int mt5bridge_stream_indicator_read(int64_t id, mt5bridge_stream_value *out);
+
+/* Dense id the market cache gave symbol (ids count up from 0 in order
+ * of first sight), or -1 if the bridge has not seen it.
+ */
+MT5BRIDGE_API int32_t mt5bridge_symbol_id(const char *symbol);
+/* Symbol of a cache id, or nullptr; the string stays valid. */
+MT5BRIDGE_API const char *mt5bridge_symbol_name(int32_t id);
+
+/* Runs filter, e.g. "spread < 0.0002 and range(20) > 0.0015", over every
+ * symbol in the market cache, reading cached bars of timeframe, and
+ * writes up to capacity matching ids to ids in ascending order. Returns
+ * the number of matches (which may exceed capacity), -1 if filter does
+ * not compile. See the README for the names a filter may use.
+ */
+MT5BRIDGE_API int64_t mt5bridge_screen(const char *filter, int timeframe, int32_t *ids,
+                                      size_t capacity);
+
+/* Event of a signal rule turning true for a symbol. */
+typedef struct mt5bridge_rule_event {
+    int64_t rule;
+    int64_t time_msc;       /* Time of the symbol's cached quote, 0 if none. */
+    int32_t symbol;         /* Cache id, see mt5bridge_symbol_name. */
+} mt5bridge_rule_event;
+
+/* Registers a signal rule: a filter expression as for mt5bridge_screen
+ * that may also use crosses_above(a, b) and crosses_below(a, b), over
+ * symbol_count symbols (none = every cached symbol), reading cached bars
+ * of timeframe, e.g. "crosses_above(ema(12), ema(26)) and spread <
+ * 0.0003". Returns the rule id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_rule_add(const char *rule, const char *const *symbols,
+                                         size_t symbol_count, int timeframe);
+MT5BRIDGE_API int mt5bridge_rule_remove(int64_t id);
+
+/* Evaluates every rule once over the market cache, typically once per
+ * polling cycle, and queues an event for each (rule, symbol) that turned
+ * true. Returns the events queued.
+ */
+MT5BRIDGE_API int64_t mt5bridge_rules_evaluate();
+
+/* Moves up to capacity queued events, oldest first, into out. Returns
+ * the number moved, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_rule_events(mt5bridge_rule_event *out, size_t capacity);
+
+/* Registers a rolling covariance/correlation matrix of the log close
+ * returns of symbol_count symbols over the last window bars of
+ * timeframe. It warms up from the history store and is updated by every
+ * live bar answer of its symbols. Returns the matrix id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_rolling_matrix_add(const char *const *symbols, size_t symbol_count,
+                                                  int timeframe, size_t window);
+MT5BRIDGE_API int mt5bridge_rolling_matrix_remove(int64_t id);
+
+/* Copies the symbol_count x symbol_count matrix (row-major, NaN where
+ * undefined) into out, which holds capacity doubles: the correlation if
+ * correlation is non-zero, else the sample covariance. time, if not
+ * null, receives the open time of the newest row. Returns the rows in
+ * the window, -1 for an unknown id or a short buffer.
+ */
+MT5BRIDGE_API int64_t mt5bridge_rolling_matrix_read(int64_t id, int correlation, double *out,
+                                                   size_t capacity, int64_t *time);
+
+/* Trade copier (copier.* settings). On the master bridge, deals of
+ * orders sent through it are published to the copy channel as their
+ * answers arrive; mt5bridge_copier_poll also publishes deals found in
+ * the recent deal history that were made elsewhere, and returns their
+ * number (the first call only records the existing ones). -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copier_poll();
+
+/* On a follower bridge: waits up to timeout_ms for master deals and
+ * copies every one published since the last call through this bridge's
+ * account. Returns the deals handled (copied, skipped or failed), 0 on
+ * timeout, -1 on error. Call it in a loop from the follower process.
+ */
+MT5BRIDGE_API int64_t mt5bridge_copier_follow(int timeout_ms);
+
+/* Portfolio totals in the account currency (portfolio.currency). */
+typedef struct mt5bridge_portfolio_totals {
+    double pnl;
+    double exposure_gross;  /* Sum of |exposure| in currencies other than the account's. */
+    int64_t positions;
+    int64_t unpriced;       /* Positions whose symbol_info has not been seen. */
+    int64_t unconverted;    /* Currencies with no conversion path; left out of the sums. */
+    int64_t ticks;          /* Quotes applied. */
+    int64_t updated_ns;     /* Last re-mark or position set, bridge clock. */
+} mt5bridge_portfolio_totals;
+
+/* The portfolio engine marks the open positions to market on every live
+ * quote answer the bridge sees. Its position set is replaced by every
+ * positions_get answer, and symbol_info answers give it the contract
+ * size and currencies it prices with. mt5bridge_portfolio_sync loads the
+ * positions, the specs and quotes of their symbols and of the pairs
+ * converting their currencies. Returns the positions, -1 on error or
+ * inside a backtest.
+ */
+MT5BRIDGE_API int64_t mt5bridge_portfolio_sync();
+
+/* Reads the current totals without calling the backend. Returns 0, -1
+ * if out is null.
+ */
+MT5BRIDGE_API int mt5bridge_portfolio_read(mt5bridge_portfolio_totals *out);
+
+/* Parent order worked by an execution algorithm: "twap" and "vwap"
+ * split volume over duration_ms in slices children (vwap shares follow
+ * curve, or the symbol's M1 tick volume at the same time of day over the
+ * last lookback_days days of the history store); "iceberg" sends at most
+ * visible lots every interval_ms until filled (or until duration_ms if
+ * set). With limit non-zero, children wait while the cached quote is
+ * worse than it. Zero members take the defaults: slices 10, interval_ms
+ * 1000, volume_step and volume_min 0.01, lookback_days 5, deviation 20.
+ */
+typedef struct mt5bridge_algo_spec {
+    const char *algo;
+    const char *symbol;
+    int32_t type;           /* 0 buy, 1 sell. */
+    double volume;
+    int64_t duration_ms;
+    int64_t slices;
+    int64_t interval_ms;
+    double visible;
+    double limit;
+    double volume_step;
+    double volume_min;
+    const double *curve;
+    size_t curve_count;
+    int64_t lookback_days;
+    int32_t deviation;
+    uint64_t magic;
+    const char *comment;
+} mt5bridge_algo_spec;
+
+/* Starts working a parent order on the bridge's timer thread. Returns
+ * its id, -1 on error. Progress is reported by {"method": "algos"}.
+ */
+MT5BRIDGE_API int64_t mt5bridge_algo_start(const mt5bridge_algo_spec *spec);
+
+/* Stops sending children of a running algorithm. Returns 0, -1 if it
+ * is unknown or finished.
+ */
+MT5BRIDGE_API int mt5bridge_algo_cancel(int64_t id);
+
+/* Called on the timer thread after each run of a scheduled request with
+ * its compact JSON answer, or a null result and the error.
+ */
+typedef void (*mt5bridge_request_handler)(int64_t id, const char *result, const char *error,
+                                          void *user);
+
+/* Runs the JSON request through mt5bridge_eval offset_ms from now (with
+ * align, offset_ms after the next multiple of period_ms of UTC time),
+ * then every period_ms; period_ms 0 runs it once. Runs missed by a slow
+ * request are skipped. The last answer is also kept for
+ * {"method": "scheduled_result", "id"}; handler may be null. Returns the
+ * schedule id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_schedule(const char *request, int64_t period_ms,
+                                        int64_t offset_ms, int align,
+                                        mt5bridge_request_handler handler, void *user);
+
+/* Stops a schedule, waiting for a run in progress on another thread, so
+ * once this returns its handler is neither running nor called again and
+ * user may be freed. Returns 0, -1 if it is unknown.
+ */
+MT5BRIDGE_API int mt5bridge_unschedule(int64_t id);
+
+/* Called with each change of a bar window: bars that have closed since
+ * the last refresh (closed 1), then the forming bar when it changed
+ * (closed 0).
+ */
+typedef void (*mt5bridge_bar_handler)(int64_t window, const mt5bridge_bar *bar, int closed,
+                                      void *user);
+
+/* Keeps the last count bars of symbol in memory. The window is loaded
+ * once, then each refresh fetches only the forming bar and the bars
+ * closed since the previous one. refresh_ms above zero refreshes it on
+ * the timer thread; 0 leaves it to mt5bridge_bar_window_refresh. Returns
+ * the window id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_bar_window_open(const char *symbol, int timeframe, size_t count,
+                                               int64_t refresh_ms);
+
+/* Closes the window. A handler running on another thread is waited for,
+ * so none runs once this returns. Returns 0 on success.
+ */
+MT5BRIDGE_API int mt5bridge_bar_window_close(int64_t id);
+
+/* Returns the number of bars appended or replaced, -1 on error. */
+MT5BRIDGE_API int64_t mt5bridge_bar_window_refresh(int64_t id);
+
+/* Copies the newest capacity bars of the window into out, oldest first,
+ * and its version into *version unless null; the version changes with
+ * every refresh that changes a bar. Returns the bars copied, -1 for an
+ * unknown window.
+ */
+MT5BRIDGE_API int64_t mt5bridge_bar_window_read(int64_t id, mt5bridge_bar *out, size_t capacity,
+                                               uint64_t *version);
+
+/* Calls handler with every change of the window, on the thread that
+ * refreshes it; the handler must not refresh that window. Returns the
+ * subscription id, -1 on error.
+ */
+MT5BRIDGE_API int64_t mt5bridge_bar_window_subscribe(int64_t id, mt5bridge_bar_handler handler,
+                                                    void *user);
+
+/* Stops the subscription, waiting for its handler if it is running on
+ * another thread, so user may be freed once this returns. Returns 0 on
+ * success.
+ */
+MT5BRIDGE_API int mt5bridge_bar_window_unsubscribe(int64_t subscription);
+
+/* Returns the last error message of the calling thread or nullptr if no
+ * error.
+ */
 MT5BRIDGE_API const char *mt5bridge_last_error();
 
 #ifdef __cplusplus
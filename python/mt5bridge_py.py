@@ -20,13 +20,29 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 
-"""Python bindings to the mt5bridge C++ library."""
+"""Python bindings to the mt5bridge C++ library.
+
+Bars and ticks can be had as numpy structured arrays instead of JSON:
+``copy_rates_from_pos`` and ``copy_ticks_from`` have the bridge write its
+records straight into the array's buffer, and ``history_bars`` and
+``history_ticks`` map files of the local history store read-only, so
+gigabytes of stored bars cost no copy and no parsing. Columns are views:
+``bars["close"]`` shares memory with ``bars``. A mapped array keeps its
+file mapping alive for as long as it or any view of it is referenced.
+
+The indicator functions (``sma``, ``ema``, ``rsi``, ...) read such column
+views in place, strides included, and return float64 arrays with NaN
+before the first full window.
+"""
 
 from __future__ import annotations
 
 import ctypes
 import json
-from ctypes import c_char_p, c_int, c_wchar_p
+from collections.abc import Iterable, Sequence
+from ctypes import POINTER, c_char_p, c_double, c_int, c_int64, c_size_t, c_void_p, c_wchar_p
+
+import numpy as np
 
 # Load the mt5bridge shared library.
 _lib = ctypes.WinDLL("mt5bridge.dll")
@@ -40,14 +56,139 @@ _lib.mt5bridge_eval_json.argtypes = [c_char_p]
 _lib.mt5bridge_eval_json.restype = c_char_p
 _lib.mt5bridge_last_error.argtypes = []
 _lib.mt5bridge_last_error.restype = c_char_p
+_lib.mt5bridge_copy_rates_from_pos.argtypes = [c_char_p, c_int, c_int64, c_size_t, c_void_p]
+_lib.mt5bridge_copy_rates_from_pos.restype = c_int64
+_lib.mt5bridge_copy_ticks_from.argtypes = [c_char_p, c_int64, c_size_t, c_int, c_void_p]
+_lib.mt5bridge_copy_ticks_from.restype = c_int64
+_lib.mt5bridge_eval_batch_json.argtypes = [c_char_p]
+_lib.mt5bridge_eval_batch_json.restype = c_char_p
+_lib.mt5bridge_copy_rates_batch.argtypes = [
+    POINTER(c_char_p), c_size_t, c_int, c_int64, c_size_t, c_void_p, c_void_p
+]
+_lib.mt5bridge_copy_rates_batch.restype = c_int64
+_lib.mt5bridge_copy_ticks_batch.argtypes = [
+    POINTER(c_char_p), c_size_t, c_int64, c_size_t, c_int, c_void_p, c_void_p
+]
+_lib.mt5bridge_copy_ticks_batch.restype = c_int64
+_lib.mt5bridge_asof_ticks.argtypes = [POINTER(c_char_p), c_size_t, c_void_p, c_size_t, c_void_p]
+_lib.mt5bridge_asof_ticks.restype = c_int64
+_lib.mt5bridge_asof_bars.argtypes = [
+    POINTER(c_char_p), c_size_t, c_int, c_void_p, c_size_t, c_void_p
+]
+_lib.mt5bridge_asof_bars.restype = c_int64
+for _name in ("sma", "ema", "stddev", "zscore", "rsi"):
+    getattr(_lib, "mt5bridge_" + _name).argtypes = [c_void_p, c_size_t, c_size_t, c_size_t, c_void_p]
+    getattr(_lib, "mt5bridge_" + _name).restype = c_int
+_lib.mt5bridge_bollinger.argtypes = [
+    c_void_p, c_size_t, c_size_t, c_size_t, c_double, c_void_p, c_void_p, c_void_p
+]
+_lib.mt5bridge_bollinger.restype = c_int
+_lib.mt5bridge_atr.argtypes = [
+    c_void_p, c_void_p, c_void_p, c_size_t, c_size_t, c_size_t, c_void_p
+]
+_lib.mt5bridge_atr.restype = c_int
+_lib.mt5bridge_macd.argtypes = [
+    c_void_p, c_size_t, c_size_t, c_size_t, c_size_t, c_size_t, c_void_p, c_void_p, c_void_p
+]
+_lib.mt5bridge_macd.restype = c_int
+_lib.mt5bridge_indicator_isa.argtypes = []
+_lib.mt5bridge_indicator_isa.restype = c_char_p
+_lib.mt5bridge_stream_indicator_add.argtypes = [c_char_p, c_char_p, c_int, c_char_p, c_size_t]
+_lib.mt5bridge_stream_indicator_add.restype = c_int64
+_lib.mt5bridge_stream_indicator_remove.argtypes = [c_int64]
+_lib.mt5bridge_stream_indicator_remove.restype = c_int
+_lib.mt5bridge_stream_indicator_read.argtypes = [c_int64, c_void_p]
+_lib.mt5bridge_stream_indicator_read.restype = c_int
+_lib.mt5bridge_symbol_id.argtypes = [c_char_p]
+_lib.mt5bridge_symbol_id.restype = ctypes.c_int32
+_lib.mt5bridge_symbol_name.argtypes = [ctypes.c_int32]
+_lib.mt5bridge_symbol_name.restype = c_char_p
+_lib.mt5bridge_screen.argtypes = [c_char_p, c_int, c_void_p, c_size_t]
+_lib.mt5bridge_screen.restype = c_int64
+_lib.mt5bridge_rule_add.argtypes = [c_char_p, POINTER(c_char_p), c_size_t, c_int]
+_lib.mt5bridge_rule_add.restype = c_int64
+_lib.mt5bridge_rule_remove.argtypes = [c_int64]
+_lib.mt5bridge_rule_remove.restype = c_int
+_lib.mt5bridge_rules_evaluate.argtypes = []
+_lib.mt5bridge_rules_evaluate.restype = c_int64
+_lib.mt5bridge_rule_events.argtypes = [c_void_p, c_size_t]
+_lib.mt5bridge_rule_events.restype = c_int64
+_lib.mt5bridge_copier_poll.argtypes = []
+_lib.mt5bridge_copier_poll.restype = c_int64
+_lib.mt5bridge_copier_follow.argtypes = [c_int]
+_lib.mt5bridge_copier_follow.restype = c_int64
+_lib.mt5bridge_portfolio_sync.argtypes = []
+_lib.mt5bridge_portfolio_sync.restype = c_int64
+_lib.mt5bridge_portfolio_read.argtypes = [c_void_p]
+_lib.mt5bridge_portfolio_read.restype = c_int
+_RequestHandler = ctypes.CFUNCTYPE(None, c_int64, c_char_p, c_char_p, c_void_p)
+_lib.mt5bridge_schedule.argtypes = [c_char_p, c_int64, c_int64, c_int, _RequestHandler, c_void_p]
+_lib.mt5bridge_schedule.restype = c_int64
+_lib.mt5bridge_unschedule.argtypes = [c_int64]
+_lib.mt5bridge_unschedule.restype = c_int
+_BarHandler = ctypes.CFUNCTYPE(None, c_int64, c_void_p, c_int, c_void_p)
+_lib.mt5bridge_bar_window_open.argtypes = [c_char_p, c_int, c_size_t, c_int64]
+_lib.mt5bridge_bar_window_open.restype = c_int64
+_lib.mt5bridge_bar_window_close.argtypes = [c_int64]
+_lib.mt5bridge_bar_window_close.restype = c_int
+_lib.mt5bridge_bar_window_refresh.argtypes = [c_int64]
+_lib.mt5bridge_bar_window_refresh.restype = c_int64
+_lib.mt5bridge_bar_window_read.argtypes = [c_int64, c_void_p, c_size_t, POINTER(ctypes.c_uint64)]
+_lib.mt5bridge_bar_window_read.restype = c_int64
+_lib.mt5bridge_bar_window_subscribe.argtypes = [c_int64, _BarHandler, c_void_p]
+_lib.mt5bridge_bar_window_subscribe.restype = c_int64
+_lib.mt5bridge_bar_window_unsubscribe.argtypes = [c_int64]
+_lib.mt5bridge_bar_window_unsubscribe.restype = c_int
+_lib.mt5bridge_rolling_matrix_add.argtypes = [POINTER(c_char_p), c_size_t, c_int, c_size_t]
+_lib.mt5bridge_rolling_matrix_add.restype = c_int64
+_lib.mt5bridge_rolling_matrix_remove.argtypes = [c_int64]
+_lib.mt5bridge_rolling_matrix_remove.restype = c_int
+_lib.mt5bridge_rolling_matrix_read.argtypes = [c_int64, c_int, c_void_p, c_size_t, c_void_p]
+_lib.mt5bridge_rolling_matrix_read.restype = c_int64
+
+# Record layouts of mt5bridge_bar and mt5bridge_tick (and of the history
+# store files); align=True reproduces the C struct padding.
+BAR_DTYPE = np.dtype(
+    [
+        ("time", "<i8"),
+        ("open", "<f8"),
+        ("high", "<f8"),
+        ("low", "<f8"),
+        ("close", "<f8"),
+        ("tick_volume", "<u8"),
+        ("spread", "<i4"),
+        ("real_volume", "<u8"),
+        ("recv_ns", "<i8"),
+    ],
+    align=True,
+)
+TICK_DTYPE = np.dtype(
+    [
+        ("time_msc", "<i8"),
+        ("bid", "<f8"),
+        ("ask", "<f8"),
+        ("last", "<f8"),
+        ("volume", "<u8"),
+        ("flags", "<u4"),
+        ("volume_real", "<f8"),
+        ("recv_ns", "<i8"),
+        ("seq", "<u8"),
+        ("integrity", "<u4"),
+    ],
+    align=True,
+)
+
+
+def _raise_last_error() -> None:
+    err = _lib.mt5bridge_last_error()
+    msg = err.decode("utf-8") if err else "unknown error"
+    raise RuntimeError(msg)
 
 
 def _check_error(code: int) -> None:
     """Raise RuntimeError if ``code`` indicates failure."""
     if code != 0:
-        err = _lib.mt5bridge_last_error()
-        msg = err.decode("utf-8") if err else "unknown error"
-        raise RuntimeError(msg)
+        _raise_last_error()
 
 
 def init(python_home: str) -> None:
@@ -65,10 +206,21 @@ def _eval(request: dict) -> str:
     request_json = json.dumps(request).encode("utf-8")
     response = _lib.mt5bridge_eval_json(request_json)
     if not response:
-        err = _lib.mt5bridge_last_error()
-        msg = err.decode("utf-8") if err else "unknown error"
-        raise RuntimeError(msg)
-    return ctypes.cast(response, c_char_p).value.decode("utf-8")
+        _raise_last_error()
+    return response.decode("utf-8")
+
+
+def eval_many(requests: Iterable[dict]) -> list:
+    """Evaluate *requests* in one call and return their decoded results, in order.
+
+    A request that failed yields ``{"error": message}`` instead of raising,
+    so one bad symbol does not cost the rest of the batch.
+    """
+    payload = json.dumps(list(requests)).encode("utf-8")
+    response = _lib.mt5bridge_eval_batch_json(payload)
+    if not response:
+        _raise_last_error()
+    return json.loads(response)
 
 
 def get_m1_bars_json(symbol: str, count: int) -> str:
@@ -79,3 +231,584 @@ def get_m1_bars_json(symbol: str, count: int) -> str:
 def open_market_buy(symbol: str, volume: float) -> str:
     """Open a market buy order for *symbol* with *volume* lots."""
     return _eval({"method": "open_market_buy", "symbol": symbol, "volume": volume})
+
+
+def get_m1_bars_many(symbols: Iterable[str], count: int) -> list:
+    """Return the latest *count* M1 bars of each of *symbols*, in one call."""
+    return eval_many({"method": "get_m1_bars", "symbol": s, "count": count} for s in symbols)
+
+
+def open_market_buy_many(orders: Iterable[tuple[str, float]]) -> list:
+    """Open one market buy per (symbol, volume) pair, in one call."""
+    return eval_many(
+        {"method": "open_market_buy", "symbol": s, "volume": v} for s, v in orders
+    )
+
+
+def copy_rates_from_pos(symbol: str, timeframe: int, start: int, count: int) -> np.ndarray:
+    """Return up to *count* bars of *symbol*, oldest first, as a BAR_DTYPE array.
+
+    The bridge fills the array's own buffer; nothing is copied on the way.
+    """
+    out = np.empty(count, dtype=BAR_DTYPE)
+    n = _lib.mt5bridge_copy_rates_from_pos(
+        symbol.encode("utf-8"), timeframe, start, count, out.ctypes.data
+    )
+    if n < 0:
+        _raise_last_error()
+    return out[:n]
+
+
+def copy_ticks_from(symbol: str, date_from: int, count: int, flags: int) -> np.ndarray:
+    """Return up to *count* ticks of *symbol* from *date_from* as a TICK_DTYPE array."""
+    out = np.empty(count, dtype=TICK_DTYPE)
+    n = _lib.mt5bridge_copy_ticks_from(
+        symbol.encode("utf-8"), date_from, count, flags, out.ctypes.data
+    )
+    if n < 0:
+        _raise_last_error()
+    return out[:n]
+
+
+def _map_history(request: dict, dtype: np.dtype) -> np.ndarray:
+    info = json.loads(_eval(request))
+    if info["record_size"] != dtype.itemsize:
+        raise RuntimeError(
+            f"{info['path']}: record size {info['record_size']} does not match "
+            f"this binding ({dtype.itemsize})"
+        )
+    if info["count"] == 0:
+        return np.empty(0, dtype=dtype)
+    return np.memmap(
+        info["path"], dtype=dtype, mode="r", offset=info["offset"], shape=(info["count"],)
+    )
+
+
+def history_bars(symbol: str, timeframe: int) -> np.ndarray:
+    """Map the stored *timeframe* bars of *symbol* as a read-only BAR_DTYPE array."""
+    return _map_history(
+        {"method": "history_file", "symbol": symbol, "timeframe": timeframe}, BAR_DTYPE
+    )
+
+
+def history_ticks(symbol: str) -> np.ndarray:
+    """Map the stored ticks of *symbol* as a read-only TICK_DTYPE array."""
+    return _map_history({"method": "history_file", "symbol": symbol}, TICK_DTYPE)
+
+
+def columns(records: np.ndarray) -> dict[str, np.ndarray]:
+    """Return the fields of a structured array as named column views (no copy)."""
+    return {name: records[name] for name in records.dtype.names}
+
+
+def _symbol_array(symbols: Sequence[str]) -> ctypes.Array:
+    return (c_char_p * len(symbols))(*(s.encode("utf-8") for s in symbols))
+
+
+def _check_batch(total: int) -> None:
+    if total < 0:
+        _raise_last_error()
+
+
+def copy_rates_batch(
+    symbols: Sequence[str], timeframe: int, start: int, count: int
+) -> tuple[np.ndarray, np.ndarray]:
+    """Fetch bars of many symbols in one call.
+
+    Returns ``(bars, counts)``: *bars* is a (len(symbols), count) BAR_DTYPE
+    array whose row i holds ``counts[i]`` bars of ``symbols[i]``; a count
+    of -1 marks a symbol that failed.
+    """
+    out = np.empty((len(symbols), count), dtype=BAR_DTYPE)
+    counts = np.empty(len(symbols), dtype=np.int64)
+    _check_batch(
+        _lib.mt5bridge_copy_rates_batch(
+            _symbol_array(symbols), len(symbols), timeframe, start, count,
+            out.ctypes.data, counts.ctypes.data,
+        )
+    )
+    return out, counts
+
+
+def copy_ticks_batch(
+    symbols: Sequence[str], date_from: int, count: int, flags: int
+) -> tuple[np.ndarray, np.ndarray]:
+    """Fetch ticks of many symbols in one call, laid out like copy_rates_batch."""
+    out = np.empty((len(symbols), count), dtype=TICK_DTYPE)
+    counts = np.empty(len(symbols), dtype=np.int64)
+    _check_batch(
+        _lib.mt5bridge_copy_ticks_batch(
+            _symbol_array(symbols), len(symbols), date_from, count, flags,
+            out.ctypes.data, counts.ctypes.data,
+        )
+    )
+    return out, counts
+
+
+def _grid(times) -> np.ndarray:
+    return np.ascontiguousarray(times, dtype=np.int64).reshape(-1)
+
+
+def asof_ticks(symbols: Sequence[str], times_msc) -> np.ndarray:
+    """Last stored tick of every symbol as of every time.
+
+    Returns a (len(symbols), len(times_msc)) TICK_DTYPE array; cells
+    before a symbol's first tick, and rows of symbols without history, are
+    zeroed (time_msc 0). *times_msc* must be ascending.
+    """
+    grid = _grid(times_msc)
+    out = np.empty((len(symbols), len(grid)), dtype=TICK_DTYPE)
+    _check_batch(
+        _lib.mt5bridge_asof_ticks(
+            _symbol_array(symbols), len(symbols), grid.ctypes.data, len(grid), out.ctypes.data
+        )
+    )
+    return out
+
+
+def asof_bars(symbols: Sequence[str], timeframe: int, times) -> np.ndarray:
+    """Last closed bar of every symbol as of every time (seconds), laid
+    out like asof_ticks.
+    """
+    grid = _grid(times)
+    out = np.empty((len(symbols), len(grid)), dtype=BAR_DTYPE)
+    _check_batch(
+        _lib.mt5bridge_asof_bars(
+            _symbol_array(symbols), len(symbols), timeframe, grid.ctypes.data, len(grid),
+            out.ctypes.data,
+        )
+    )
+    return out
+
+
+def _column(values) -> np.ndarray:
+    """*values* as a 1-D float64 array the bridge can read in place."""
+    col = np.asarray(values)
+    if col.ndim != 1 or col.dtype != np.float64 or col.strides[0] < col.itemsize:
+        col = np.ascontiguousarray(col, dtype=np.float64).reshape(-1)
+    return col
+
+
+def _indicator(name: str, values, period: int) -> np.ndarray:
+    col = _column(values)
+    out = np.empty(len(col), dtype=np.float64)
+    _check_error(
+        getattr(_lib, "mt5bridge_" + name)(
+            col.ctypes.data, col.strides[0], len(col), period, out.ctypes.data
+        )
+    )
+    return out
+
+
+def sma(values, period: int) -> np.ndarray:
+    """Simple moving average of *values*, e.g. ``sma(bars["close"], 20)``."""
+    return _indicator("sma", values, period)
+
+
+def ema(values, period: int) -> np.ndarray:
+    """Exponential moving average seeded with the first window's mean."""
+    return _indicator("ema", values, period)
+
+
+def stddev(values, period: int) -> np.ndarray:
+    """Population standard deviation over each window."""
+    return _indicator("stddev", values, period)
+
+
+def zscore(values, period: int) -> np.ndarray:
+    """Distance from the window mean in window standard deviations."""
+    return _indicator("zscore", values, period)
+
+
+def rsi(close, period: int = 14) -> np.ndarray:
+    """Wilder's relative strength index; the first value is at index *period*."""
+    return _indicator("rsi", close, period)
+
+
+def bollinger(
+    values, period: int = 20, k: float = 2.0
+) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """Return ``(mid, upper, lower)`` Bollinger bands."""
+    col = _column(values)
+    mid, upper, lower = (np.empty(len(col), dtype=np.float64) for _ in range(3))
+    _check_error(
+        _lib.mt5bridge_bollinger(
+            col.ctypes.data, col.strides[0], len(col), period, k,
+            mid.ctypes.data, upper.ctypes.data, lower.ctypes.data,
+        )
+    )
+    return mid, upper, lower
+
+
+def atr(high, low, close, period: int = 14) -> np.ndarray:
+    """Wilder's average true range; the first value is at index *period*."""
+    cols = [_column(v) for v in (high, low, close)]
+    if len({len(c) for c in cols}) != 1:
+        raise ValueError("high, low and close differ in length")
+    if len({c.strides[0] for c in cols}) != 1:
+        cols = [np.ascontiguousarray(c) for c in cols]
+    out = np.empty(len(cols[0]), dtype=np.float64)
+    _check_error(
+        _lib.mt5bridge_atr(
+            cols[0].ctypes.data, cols[1].ctypes.data, cols[2].ctypes.data,
+            cols[0].strides[0], len(out), period, out.ctypes.data,
+        )
+    )
+    return out
+
+
+def macd(
+    close, fast: int = 12, slow: int = 26, signal: int = 9
+) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """Return ``(macd, signal, histogram)``."""
+    col = _column(close)
+    lines = [np.empty(len(col), dtype=np.float64) for _ in range(3)]
+    _check_error(
+        _lib.mt5bridge_macd(
+            col.ctypes.data, col.strides[0], len(col), fast, slow, signal,
+            *(line.ctypes.data for line in lines),
+        )
+    )
+    return tuple(lines)
+
+
+def indicator_isa() -> str:
+    """Instruction set the indicators run on: scalar, avx2 or avx512."""
+    return _lib.mt5bridge_indicator_isa().decode("utf-8")
+
+
+class _StreamValue(ctypes.Structure):
+    _fields_ = [
+        ("value", c_double),
+        ("time_msc", c_int64),
+        ("samples", ctypes.c_uint64),
+        ("ready", ctypes.c_int32),
+    ]
+
+
+def stream_indicator_add(
+    symbol: str, kind: str, period: int, timeframe: int = 0, field: str | None = None
+) -> int:
+    """Register an indicator the bridge updates from live bars or ticks.
+
+    *timeframe* 0 follows ticks. Returns the id for stream_indicator_read.
+    """
+    ident = _lib.mt5bridge_stream_indicator_add(
+        symbol.encode("utf-8"), kind.encode("utf-8"), timeframe,
+        field.encode("utf-8") if field else None, period,
+    )
+    if ident < 0:
+        _raise_last_error()
+    return ident
+
+
+def stream_indicator_remove(ident: int) -> None:
+    _check_error(_lib.mt5bridge_stream_indicator_remove(ident))
+
+
+def stream_indicator_read(ident: int) -> dict:
+    """Return the indicator's latest value, time_msc, samples and ready flag."""
+    out = _StreamValue()
+    _check_error(_lib.mt5bridge_stream_indicator_read(ident, ctypes.byref(out)))
+    return {
+        "value": out.value,
+        "time_msc": out.time_msc,
+        "samples": out.samples,
+        "ready": bool(out.ready),
+    }
+
+
+def symbol_id(symbol: str) -> int:
+    """Market cache id of symbol, -1 if the bridge has not seen it."""
+    return _lib.mt5bridge_symbol_id(symbol.encode("utf-8"))
+
+
+def symbol_name(ident: int) -> str | None:
+    name = _lib.mt5bridge_symbol_name(ident)
+    return name.decode("utf-8") if name is not None else None
+
+
+def screen(expression: str, timeframe: int = 1) -> np.ndarray:
+    """Ids of the cached symbols for which the filter *expression* holds,
+    e.g. ``"spread < 0.0002 and range(20) > 0.0015"``; see symbol_name.
+    """
+    text = expression.encode("utf-8")
+    ids = np.empty(0, dtype=np.int32)
+    while True:
+        found = _lib.mt5bridge_screen(text, timeframe, ids.ctypes.data, len(ids))
+        if found < 0:
+            _raise_last_error()
+        if found <= len(ids):
+            return ids[:found]
+        ids = np.empty(found, dtype=np.int32)
+
+
+RULE_EVENT_DTYPE = np.dtype(
+    [("rule", "<i8"), ("time_msc", "<i8"), ("symbol", "<i4")], align=True
+)
+
+
+def rule_add(rule: str, symbols: Sequence[str] = (), timeframe: int = 1) -> int:
+    """Register a signal rule, e.g. ``"crosses_above(ema(12), ema(26))"``,
+    over *symbols* (default every cached symbol). Returns its id.
+    """
+    ident = _lib.mt5bridge_rule_add(
+        rule.encode("utf-8"), _symbol_array(symbols), len(symbols), timeframe
+    )
+    if ident < 0:
+        _raise_last_error()
+    return ident
+
+
+def rule_remove(ident: int) -> None:
+    _check_error(_lib.mt5bridge_rule_remove(ident))
+
+
+def rules_evaluate() -> np.ndarray:
+    """Evaluate every rule once and return the events queued so far as a
+    RULE_EVENT_DTYPE array; ``symbol`` is a cache id (symbol_name).
+    """
+    _lib.mt5bridge_rules_evaluate()
+    chunks = []
+    while True:
+        out = np.empty(4096, dtype=RULE_EVENT_DTYPE)
+        n = _lib.mt5bridge_rule_events(out.ctypes.data, len(out))
+        if n < 0:
+            _raise_last_error()
+        chunks.append(out[:n])
+        if n < len(out):
+            return np.concatenate(chunks)
+
+
+def copier_poll() -> int:
+    """Master: publish deals made outside the bridge; returns their count."""
+    n = _lib.mt5bridge_copier_poll()
+    if n < 0:
+        _raise_last_error()
+    return n
+
+
+def copier_follow(timeout_ms: int = 1000) -> int:
+    """Follower: copy the master deals published since the last call,
+    waiting up to *timeout_ms* for one. Returns the deals handled.
+    """
+    n = _lib.mt5bridge_copier_follow(timeout_ms)
+    if n < 0:
+        _raise_last_error()
+    return n
+
+
+def copier_status() -> dict:
+    """Channel state with per-follower counters and copy latencies."""
+    return json.loads(_eval({"method": "copier"}))
+
+
+def algo_start(algo: str, symbol: str, type: int, volume: float, **params) -> int:
+    """Start a twap, vwap or iceberg parent order worked inside the bridge.
+
+    *params* are the other algo_start members (duration_ms, slices,
+    interval_ms, visible, limit, curve, ...). Returns the algo id.
+    """
+    req = {"method": "algo_start", "algo": algo, "symbol": symbol, "type": type,
+           "volume": volume, **params}
+    return json.loads(_eval(req))["id"]
+
+
+def algo_cancel(ident: int) -> None:
+    _eval({"method": "algo_cancel", "id": ident})
+
+
+def algos() -> list:
+    """Progress of every algo: state, filled, avg_price, children, ..."""
+    return json.loads(_eval({"method": "algos"}))
+
+
+# Handlers of the schedules made with a callback, kept alive while the
+# schedule exists.
+_schedule_handlers: dict[int, _RequestHandler] = {}
+
+
+def schedule(request: dict, period_ms: int, offset_ms: int = 0, align: bool = False,
+             callback=None) -> int:
+    """Run *request* on the bridge's timer thread offset_ms from now (with
+    *align*, offset_ms past the next multiple of period_ms of UTC time),
+    then every *period_ms*; 0 runs it once.
+
+    ``callback(id, result, error)`` is called on the timer thread after
+    each run with the decoded answer or the error message; the last
+    answer is also kept for ``scheduled_result``. Returns the schedule id.
+    """
+    handler = _RequestHandler()
+    if callback is not None:
+        def handler_fn(ident, result, error, _user):
+            callback(ident, json.loads(result) if result else None,
+                     error.decode("utf-8") if error else None)
+        handler = _RequestHandler(handler_fn)
+    ident = _lib.mt5bridge_schedule(
+        json.dumps(request).encode("utf-8"), period_ms, offset_ms, int(align), handler, None
+    )
+    if ident < 0:
+        _raise_last_error()
+    if callback is not None:
+        _schedule_handlers[ident] = handler
+    return ident
+
+
+def unschedule(ident: int) -> None:
+    _check_error(_lib.mt5bridge_unschedule(ident))
+    _schedule_handlers.pop(ident, None)
+
+
+def scheduled_result(ident: int) -> dict:
+    """Last answer of a schedule in "result", with runs, errors, error,
+    fetched_ns, latency_us and next_ns.
+    """
+    return json.loads(_eval({"method": "scheduled_result", "id": ident}))
+
+
+def schedules() -> list:
+    return json.loads(_eval({"method": "schedules"}))
+
+
+# Bar count of each window opened here, and the subscription handlers,
+# kept alive while subscribed.
+_bar_window_counts: dict[int, int] = {}
+_bar_handlers: dict[int, _BarHandler] = {}
+
+
+def bar_window_open(symbol: str, timeframe: int, count: int, refresh_ms: int = 0) -> int:
+    """Keep the last *count* bars of *symbol* in the bridge. After the first
+    load, each refresh fetches only the forming bar and the bars closed
+    since; *refresh_ms* above zero refreshes on the bridge's timer thread.
+    Returns the window id.
+    """
+    ident = _lib.mt5bridge_bar_window_open(symbol.encode("utf-8"), timeframe, count, refresh_ms)
+    if ident < 0:
+        _raise_last_error()
+    _bar_window_counts[ident] = count
+    return ident
+
+
+def bar_window_close(ident: int) -> None:
+    _check_error(_lib.mt5bridge_bar_window_close(ident))
+    _bar_window_counts.pop(ident, None)
+
+
+def bar_window_refresh(ident: int) -> int:
+    """Refresh now; returns the number of bars appended or replaced."""
+    n = _lib.mt5bridge_bar_window_refresh(ident)
+    if n < 0:
+        _raise_last_error()
+    return n
+
+
+def bar_window_read(ident: int, count: int | None = None) -> tuple[np.ndarray, int]:
+    """Return ``(bars, version)``: the newest *count* bars of the window
+    (all by default) as a BAR_DTYPE array, oldest first, and the version,
+    which changes whenever a refresh changes a bar.
+    """
+    out = np.empty(count if count is not None else _bar_window_counts.get(ident, 0),
+                   dtype=BAR_DTYPE)
+    version = ctypes.c_uint64()
+    n = _lib.mt5bridge_bar_window_read(ident, out.ctypes.data, len(out), ctypes.byref(version))
+    if n < 0:
+        _raise_last_error()
+    return out[:n], version.value
+
+
+def bar_window_subscribe(ident: int, callback) -> int:
+    """Call ``callback(window, bar, closed)`` with each closed bar and each
+    change of the forming bar; *bar* is a BAR_DTYPE record. The callback
+    runs on the thread that refreshes the window. Returns the
+    subscription id.
+    """
+    def handler_fn(window, bar, closed, _user):
+        record = np.frombuffer(
+            (ctypes.c_char * BAR_DTYPE.itemsize).from_address(bar), dtype=BAR_DTYPE
+        ).copy()[0]
+        callback(window, record, bool(closed))
+    handler = _BarHandler(handler_fn)
+    subscription = _lib.mt5bridge_bar_window_subscribe(ident, handler, None)
+    if subscription < 0:
+        _raise_last_error()
+    _bar_handlers[subscription] = handler
+    return subscription
+
+
+def bar_window_unsubscribe(subscription: int) -> None:
+    _check_error(_lib.mt5bridge_bar_window_unsubscribe(subscription))
+    _bar_handlers.pop(subscription, None)
+
+
+def bar_windows() -> list:
+    """Every window with its version, refresh and error counts, and the
+    number of bars fetched so far.
+    """
+    return json.loads(_eval({"method": "bar_windows"}))
+
+
+class _PortfolioTotals(ctypes.Structure):
+    _fields_ = [
+        ("pnl", c_double),
+        ("exposure_gross", c_double),
+        ("positions", c_int64),
+        ("unpriced", c_int64),
+        ("unconverted", c_int64),
+        ("ticks", c_int64),
+        ("updated_ns", c_int64),
+    ]
+
+
+def portfolio_sync() -> int:
+    """Reload the positions plus the symbol specs and quotes pricing them;
+    returns the number of positions.
+    """
+    n = _lib.mt5bridge_portfolio_sync()
+    if n < 0:
+        _raise_last_error()
+    return n
+
+
+def portfolio_totals() -> dict:
+    """Account currency PnL and gross exposure as of the last quote seen."""
+    out = _PortfolioTotals()
+    _check_error(_lib.mt5bridge_portfolio_read(ctypes.byref(out)))
+    return {name: getattr(out, name) for name, _ in _PortfolioTotals._fields_}
+
+
+def portfolio() -> dict:
+    """Totals with per-currency, per-symbol and per-magic breakdowns."""
+    return json.loads(_eval({"method": "portfolio"}))
+
+
+def rolling_matrix_add(symbols: Sequence[str], timeframe: int, window: int) -> int:
+    """Register a rolling covariance/correlation matrix of the symbols'
+    bar returns. Returns the id for rolling_matrix_read.
+    """
+    ident = _lib.mt5bridge_rolling_matrix_add(
+        _symbol_array(symbols), len(symbols), timeframe, window
+    )
+    if ident < 0:
+        _raise_last_error()
+    return ident
+
+
+def rolling_matrix_remove(ident: int) -> None:
+    _check_error(_lib.mt5bridge_rolling_matrix_remove(ident))
+
+
+def rolling_matrix_read(
+    ident: int, symbol_count: int, correlation: bool = True
+) -> tuple[np.ndarray, int, int]:
+    """Return ``(matrix, rows, time)``: the (symbol_count, symbol_count)
+    correlation (or covariance) matrix, the rows in its window and the
+    open time of the newest row.
+    """
+    out = np.empty((symbol_count, symbol_count), dtype=np.float64)
+    time = c_int64()
+    rows = _lib.mt5bridge_rolling_matrix_read(
+        ident, 1 if correlation else 0, out.ctypes.data, out.size, ctypes.byref(time)
+    )
+    if rows < 0:
+        _raise_last_error()
+    return out, rows, time.value
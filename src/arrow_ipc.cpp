@@ -0,0 +1,530 @@
+/*
+ * arrow_ipc.cpp
+ *
+ * Arrow IPC encapsulated messages, file footer and the flatbuffer
+ * encoding of their metadata (Schema.fbs, Message.fbs, File.fbs).
+ */
+
+#include "arrow_ipc.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int16_t kMetadataV5 = 4;          // MetadataVersion.V5
+constexpr uint8_t kHeaderSchema = 1;        // MessageHeader union
+constexpr uint8_t kHeaderRecordBatch = 3;
+constexpr uint8_t kTypeInt = 2;             // Type union
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeUtf8 = 5;
+constexpr uint8_t kTypeBool = 6;
+constexpr uint8_t kTypeTimestamp = 10;
+constexpr int16_t kPrecisionDouble = 2;
+constexpr uint32_t kContinuation = 0xFFFFFFFFu;
+constexpr char kFileMagic[8] = {'A', 'R', 'R', 'O', 'W', '1', '\0', '\0'};
+
+/* Minimal flatbuffer builder. Like the reference implementation it fills
+ * the buffer back to front, so an object is built before the tables that
+ * refer to it and every reference points forward. Objects are identified
+ * by their offset from the end of the buffer.
+ */
+class FlatBuilder {
+public:
+    using Ref = uint32_t;
+
+    uint32_t size() const { return static_cast<uint32_t>(buf_.size() - head_); }
+
+    /* Pads so that size() + additional becomes a multiple of alignment. */
+    void align(size_t alignment, size_t additional = 0) {
+        minalign_ = std::max(minalign_, alignment);
+        const size_t pad = (alignment - (size() + additional) % alignment) % alignment;
+        if (pad)
+            std::memset(grow(pad), 0, pad);
+    }
+
+    template <typename T> void push(T v) { std::memcpy(grow(sizeof v), &v, sizeof v); }
+
+    template <typename T> void scalar(T v) {
+        align(sizeof v);
+        push(v);
+    }
+
+    void ref(Ref target) {
+        align(4);
+        push<uint32_t>(size() + 4 - target);
+    }
+
+    Ref string(const char *s) {
+        const size_t n = std::strlen(s);
+        align(4, n + 1);
+        push<uint8_t>(0);
+        if (n)
+            std::memcpy(grow(n), s, n);
+        push<uint32_t>(static_cast<uint32_t>(n));
+        return size();
+    }
+
+    Ref structs(const void *items, size_t count, size_t item_size, size_t alignment) {
+        const size_t bytes = count * item_size;
+        align(4, bytes);
+        align(alignment, bytes);
+        if (bytes)
+            std::memcpy(grow(bytes), items, bytes);
+        push<uint32_t>(static_cast<uint32_t>(count));
+        return size();
+    }
+
+    Ref refs(const std::vector<Ref> &items) {
+        align(4, items.size() * 4);
+        for (size_t i = items.size(); i-- > 0;)
+            ref(items[i]);
+        push<uint32_t>(static_cast<uint32_t>(items.size()));
+        return size();
+    }
+
+    void start_table() {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T> void field(uint16_t slot, T v) {
+        scalar(v);
+        fields_.push_back({slot, size()});
+    }
+
+    void field_ref(uint16_t slot, Ref target) {
+        ref(target);
+        fields_.push_back({slot, size()});
+    }
+
+    Ref end_table() {
+        align(4);
+        push<int32_t>(0); // Offset to the vtable, patched below.
+        const Ref table = size();
+        uint16_t slots = 0;
+        for (const Slot &f : fields_)
+            slots = std::max<uint16_t>(slots, static_cast<uint16_t>(f.slot + 1));
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const Slot &f : fields_)
+            vtable[f.slot] = static_cast<uint16_t>(table - f.at);
+        for (size_t i = slots; i-- > 0;)
+            push<uint16_t>(vtable[i]);
+        push<uint16_t>(static_cast<uint16_t>(table - table_start_));
+        push<uint16_t>(static_cast<uint16_t>(4 + 2 * slots));
+        const int32_t to_vtable = static_cast<int32_t>(size() - table);
+        std::memcpy(&buf_[buf_.size() - table], &to_vtable, sizeof to_vtable);
+        return table;
+    }
+
+    std::vector<uint8_t> finish(Ref root) {
+        align(minalign_, 4);
+        ref(root);
+        return std::vector<uint8_t>(buf_.begin() + static_cast<std::ptrdiff_t>(head_), buf_.end());
+    }
+
+private:
+    struct Slot {
+        uint16_t slot;
+        Ref at;
+    };
+
+    uint8_t *grow(size_t n) {
+        if (head_ < n) {
+            const size_t used = size();
+            const size_t capacity = std::max({buf_.size() * 2, used + n, size_t{256}});
+            std::vector<uint8_t> bigger(capacity);
+            if (used)
+                std::memcpy(bigger.data() + capacity - used, buf_.data() + head_, used);
+            buf_.swap(bigger);
+            head_ = capacity - used;
+        }
+        head_ -= n;
+        return buf_.data() + head_;
+    }
+
+    std::vector<uint8_t> buf_;
+    size_t head_ = 0;
+    size_t minalign_ = 1;
+    std::vector<Slot> fields_;
+    Ref table_start_ = 0;
+};
+
+enum class Kind { I32, U32, I64, U64, F64, Bool, Utf8, TimeS, TimeMs, TimeNsUtc };
+
+struct ColumnData {
+    std::vector<uint8_t> values;    // Fixed-width values or packed bits; utf8 bytes.
+    std::vector<int32_t> offsets;   // utf8 only: rows + 1 offsets into values.
+};
+
+template <typename R>
+struct ColumnSpec {
+    const char *name;
+    Kind kind;
+    void (*fill)(const R *records, size_t n, ColumnData &out);
+};
+
+struct FieldNode {
+    int64_t length;
+    int64_t null_count;
+};
+
+struct BufferSpec {
+    int64_t offset;
+    int64_t length;
+};
+
+struct Block {
+    int64_t offset;
+    int32_t metadata_length;
+    int32_t padding;
+    int64_t body_length;
+};
+static_assert(sizeof(Block) == 24, "Block must match the Arrow File.fbs struct");
+
+size_t padded(size_t n) { return (n + 7) & ~size_t{7}; }
+
+FlatBuilder::Ref build_type(FlatBuilder &b, Kind kind, uint8_t &type) {
+    switch (kind) {
+    case Kind::I32:
+    case Kind::U32:
+    case Kind::I64:
+    case Kind::U64:
+        type = kTypeInt;
+        b.start_table();
+        b.field<int32_t>(0, kind == Kind::I32 || kind == Kind::U32 ? 32 : 64);
+        b.field<uint8_t>(1, kind == Kind::I32 || kind == Kind::I64);
+        return b.end_table();
+    case Kind::F64:
+        type = kTypeFloatingPoint;
+        b.start_table();
+        b.field<int16_t>(0, kPrecisionDouble);
+        return b.end_table();
+    case Kind::Bool:
+    case Kind::Utf8:
+        type = kind == Kind::Bool ? kTypeBool : kTypeUtf8;
+        b.start_table();
+        return b.end_table();
+    default: {
+        type = kTypeTimestamp;
+        const FlatBuilder::Ref tz = kind == Kind::TimeNsUtc ? b.string("UTC") : 0;
+        b.start_table();
+        b.field<int16_t>(0, kind == Kind::TimeS ? 0 : kind == Kind::TimeMs ? 1 : 3);
+        if (tz)
+            b.field_ref(1, tz);
+        return b.end_table();
+    }
+    }
+}
+
+struct FieldDef {
+    const char *name;
+    Kind kind;
+};
+
+FlatBuilder::Ref build_schema(FlatBuilder &b, const std::vector<FieldDef> &schema) {
+    std::vector<FlatBuilder::Ref> fields;
+    for (const FieldDef &f : schema) {
+        const FlatBuilder::Ref name = b.string(f.name);
+        uint8_t type_type = 0;
+        const FlatBuilder::Ref type = build_type(b, f.kind, type_type);
+        const FlatBuilder::Ref children = b.refs({});
+        b.start_table();
+        b.field_ref(0, name);
+        b.field<uint8_t>(1, 0); // nullable
+        b.field<uint8_t>(2, type_type);
+        b.field_ref(3, type);
+        b.field_ref(5, children);
+        fields.push_back(b.end_table());
+    }
+    const FlatBuilder::Ref list = b.refs(fields);
+    b.start_table();
+    b.field<int16_t>(0, 0); // Little endian.
+    b.field_ref(1, list);
+    return b.end_table();
+}
+
+std::vector<uint8_t> message(FlatBuilder &b, uint8_t header_type, FlatBuilder::Ref header,
+                             int64_t body_length) {
+    b.start_table();
+    b.field<int16_t>(0, kMetadataV5);
+    b.field<uint8_t>(1, header_type);
+    b.field_ref(2, header);
+    b.field<int64_t>(3, body_length);
+    return b.finish(b.end_table());
+}
+
+class Writer {
+public:
+    ~Writer() {
+        if (f_) {
+            std::fclose(f_);
+            std::remove(path_.c_str());
+        }
+    }
+
+    bool open(const std::string &path, bool stream, std::vector<FieldDef> schema,
+              std::string &error) {
+        path_ = path;
+        stream_ = stream;
+        schema_ = std::move(schema);
+        f_ = std::fopen(path.c_str(), "wb");
+        if (!f_) {
+            error = "cannot create " + path;
+            return false;
+        }
+        if (!stream_ && !write(kFileMagic, sizeof kFileMagic))
+            return fail(error);
+        FlatBuilder b;
+        const std::vector<uint8_t> meta = message(b, kHeaderSchema, build_schema(b, schema_), 0);
+        return write_message(meta, {}, nullptr) || fail(error);
+    }
+
+    bool batch(const std::vector<ColumnData> &columns, size_t rows, std::string &error) {
+        std::vector<FieldNode> nodes;
+        std::vector<BufferSpec> buffers;
+        std::vector<std::pair<const void *, size_t>> body;
+        int64_t offset = 0;
+        auto add = [&](const void *data, size_t length) {
+            buffers.push_back({offset, static_cast<int64_t>(length)});
+            body.emplace_back(data, length);
+            offset += static_cast<int64_t>(padded(length));
+        };
+        for (size_t i = 0; i < columns.size(); ++i) {
+            nodes.push_back({static_cast<int64_t>(rows), 0});
+            add(nullptr, 0); // No validity bitmap: nothing is null.
+            if (schema_[i].kind == Kind::Utf8)
+                add(columns[i].offsets.data(), columns[i].offsets.size() * sizeof(int32_t));
+            add(columns[i].values.data(), columns[i].values.size());
+        }
+
+        FlatBuilder b;
+        const FlatBuilder::Ref node_list =
+            b.structs(nodes.data(), nodes.size(), sizeof(FieldNode), 8);
+        const FlatBuilder::Ref buffer_list =
+            b.structs(buffers.data(), buffers.size(), sizeof(BufferSpec), 8);
+        b.start_table();
+        b.field<int64_t>(0, static_cast<int64_t>(rows));
+        b.field_ref(1, node_list);
+        b.field_ref(2, buffer_list);
+        const FlatBuilder::Ref header = b.end_table();
+        const std::vector<uint8_t> meta = message(b, kHeaderRecordBatch, header, offset);
+
+        Block block{static_cast<int64_t>(written_), 0, 0, offset};
+        if (!write_message(meta, body, &block))
+            return fail(error);
+        blocks_.push_back(block);
+        return true;
+    }
+
+    bool close(uint64_t &bytes, std::string &error) {
+        const uint32_t eos[2] = {kContinuation, 0};
+        bool ok = write(eos, sizeof eos);
+        if (ok && !stream_) {
+            FlatBuilder b;
+            const FlatBuilder::Ref schema = build_schema(b, schema_);
+            const FlatBuilder::Ref dictionaries = b.structs(nullptr, 0, sizeof(Block), 8);
+            const FlatBuilder::Ref batches =
+                b.structs(blocks_.data(), blocks_.size(), sizeof(Block), 8);
+            b.start_table();
+            b.field<int16_t>(0, kMetadataV5);
+            b.field_ref(1, schema);
+            b.field_ref(2, dictionaries);
+            b.field_ref(3, batches);
+            const std::vector<uint8_t> footer = b.finish(b.end_table());
+            const int32_t footer_size = static_cast<int32_t>(footer.size());
+            ok = write(footer.data(), footer.size()) && write(&footer_size, sizeof footer_size) &&
+                 write(kFileMagic, 6);
+        }
+        ok = std::fclose(f_) == 0 && ok;
+        f_ = nullptr;
+        if (!ok) {
+            std::remove(path_.c_str());
+            error = "cannot write " + path_;
+            return false;
+        }
+        bytes = written_;
+        return true;
+    }
+
+private:
+    bool write(const void *data, size_t n) {
+        if (n && std::fwrite(data, 1, n, f_) != n)
+            return false;
+        written_ += n;
+        return true;
+    }
+
+    bool pad_to(size_t n, size_t target) {
+        static const uint8_t zeros[8] = {};
+        return write(zeros, target - n);
+    }
+
+    /* Continuation marker, metadata length, metadata padded to 8 bytes,
+     * then the body buffers, each padded to 8 bytes.
+     */
+    bool write_message(const std::vector<uint8_t> &meta,
+                       const std::vector<std::pair<const void *, size_t>> &body, Block *block) {
+        const int32_t meta_length = static_cast<int32_t>(padded(meta.size()));
+        if (!write(&kContinuation, sizeof kContinuation) ||
+            !write(&meta_length, sizeof meta_length) || !write(meta.data(), meta.size()) ||
+            !pad_to(meta.size(), static_cast<size_t>(meta_length)))
+            return false;
+        for (const auto &buffer : body)
+            if (!write(buffer.first, buffer.second) || !pad_to(buffer.second, padded(buffer.second)))
+                return false;
+        if (block)
+            block->metadata_length = meta_length + 8;
+        return true;
+    }
+
+    bool fail(std::string &error) {
+        error = "cannot write " + path_;
+        return false;
+    }
+
+    std::string path_;
+    bool stream_ = false;
+    std::FILE *f_ = nullptr;
+    uint64_t written_ = 0;
+    std::vector<FieldDef> schema_;
+    std::vector<Block> blocks_;
+};
+
+template <typename T, typename R, typename Get>
+void fixed(const R *records, size_t n, ColumnData &out, Get get) {
+    out.values.resize(n * sizeof(T));
+    uint8_t *dst = out.values.data();
+    for (size_t i = 0; i < n; ++i) {
+        const T v = static_cast<T>(get(records[i]));
+        std::memcpy(dst + i * sizeof(T), &v, sizeof v);
+    }
+}
+
+template <typename R, typename Get>
+void bits(const R *records, size_t n, ColumnData &out, Get get) {
+    out.values.assign((n + 7) / 8, 0);
+    for (size_t i = 0; i < n; ++i)
+        if (get(records[i]))
+            out.values[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+}
+
+template <size_t N, typename R, typename Get>
+void utf8(const R *records, size_t n, ColumnData &out, Get get) {
+    out.values.clear();
+    out.offsets.assign(1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        const char *s = get(records[i]);
+        out.values.insert(out.values.end(), s, s + strnlen(s, N));
+        out.offsets.push_back(static_cast<int32_t>(out.values.size()));
+    }
+}
+
+#define ARROW_FIXED(R, T, expr) \
+    [](const R *r, size_t n, ColumnData &out) { fixed<T>(r, n, out, [](const R &x) { return expr; }); }
+
+const ColumnSpec<Bar> kBarColumns[] = {
+    {"time", Kind::TimeS, ARROW_FIXED(Bar, int64_t, x.time)},
+    {"open", Kind::F64, ARROW_FIXED(Bar, double, x.open)},
+    {"high", Kind::F64, ARROW_FIXED(Bar, double, x.high)},
+    {"low", Kind::F64, ARROW_FIXED(Bar, double, x.low)},
+    {"close", Kind::F64, ARROW_FIXED(Bar, double, x.close)},
+    {"tick_volume", Kind::U64, ARROW_FIXED(Bar, uint64_t, x.tick_volume)},
+    {"spread", Kind::I32, ARROW_FIXED(Bar, int32_t, x.spread)},
+    {"real_volume", Kind::U64, ARROW_FIXED(Bar, uint64_t, x.real_volume)},
+    {"recv_ns", Kind::TimeNsUtc, ARROW_FIXED(Bar, int64_t, x.recv_ns)},
+};
+
+const ColumnSpec<Tick> kTickColumns[] = {
+    {"time_msc", Kind::TimeMs, ARROW_FIXED(Tick, int64_t, x.time_msc)},
+    {"bid", Kind::F64, ARROW_FIXED(Tick, double, x.bid)},
+    {"ask", Kind::F64, ARROW_FIXED(Tick, double, x.ask)},
+    {"last", Kind::F64, ARROW_FIXED(Tick, double, x.last)},
+    {"volume", Kind::U64, ARROW_FIXED(Tick, uint64_t, x.volume)},
+    {"flags", Kind::U32, ARROW_FIXED(Tick, uint32_t, x.flags)},
+    {"volume_real", Kind::F64, ARROW_FIXED(Tick, double, x.volume_real)},
+    {"recv_ns", Kind::TimeNsUtc, ARROW_FIXED(Tick, int64_t, x.recv_ns)},
+    {"seq", Kind::U64, ARROW_FIXED(Tick, uint64_t, x.seq)},
+    {"gap", Kind::Bool,
+     [](const Tick *r, size_t n, ColumnData &out) {
+         bits(r, n, out, [](const Tick &x) { return x.integrity != 0; });
+     }},
+};
+
+const ColumnSpec<Deal> kDealColumns[] = {
+    {"ticket", Kind::U64, ARROW_FIXED(Deal, uint64_t, x.ticket)},
+    {"order", Kind::U64, ARROW_FIXED(Deal, uint64_t, x.order)},
+    {"time_msc", Kind::TimeMs, ARROW_FIXED(Deal, int64_t, x.time_msc)},
+    {"type", Kind::I32, ARROW_FIXED(Deal, int32_t, x.type)},
+    {"entry", Kind::I32, ARROW_FIXED(Deal, int32_t, x.entry)},
+    {"reason", Kind::I32, ARROW_FIXED(Deal, int32_t, x.reason)},
+    {"magic", Kind::U64, ARROW_FIXED(Deal, uint64_t, x.magic)},
+    {"position_id", Kind::U64, ARROW_FIXED(Deal, uint64_t, x.position_id)},
+    {"volume", Kind::F64, ARROW_FIXED(Deal, double, x.volume)},
+    {"price", Kind::F64, ARROW_FIXED(Deal, double, x.price)},
+    {"commission", Kind::F64, ARROW_FIXED(Deal, double, x.commission)},
+    {"swap", Kind::F64, ARROW_FIXED(Deal, double, x.swap)},
+    {"profit", Kind::F64, ARROW_FIXED(Deal, double, x.profit)},
+    {"fee", Kind::F64, ARROW_FIXED(Deal, double, x.fee)},
+    {"symbol", Kind::Utf8,
+     [](const Deal *r, size_t n, ColumnData &out) {
+         utf8<sizeof(Deal::symbol)>(r, n, out, [](const Deal &x) { return x.symbol; });
+     }},
+    {"comment", Kind::Utf8,
+     [](const Deal *r, size_t n, ColumnData &out) {
+         utf8<sizeof(Deal::comment)>(r, n, out, [](const Deal &x) { return x.comment; });
+     }},
+};
+
+#undef ARROW_FIXED
+
+template <typename R, size_t N>
+bool export_records(const std::string &path, bool stream, const ColumnSpec<R> (&specs)[N],
+                    const std::vector<R> &records, const std::vector<int64_t> &utc,
+                    ArrowExport &out, std::string &error) {
+    std::vector<FieldDef> schema;
+    for (const auto &spec : specs)
+        schema.push_back({spec.name, spec.kind});
+    if (!utc.empty())
+        schema.push_back({"time_utc_ns", Kind::TimeNsUtc});
+
+    Writer writer;
+    if (!writer.open(path, stream, schema, error))
+        return false;
+    std::vector<ColumnData> columns(schema.size());
+    for (size_t from = 0; from < records.size(); from += kArrowBatchRows) {
+        const size_t n = std::min(kArrowBatchRows, records.size() - from);
+        for (size_t c = 0; c < N; ++c)
+            specs[c].fill(records.data() + from, n, columns[c]);
+        if (!utc.empty()) {
+            ColumnData &col = columns.back();
+            col.values.resize(n * sizeof(int64_t));
+            std::memcpy(col.values.data(), utc.data() + from, n * sizeof(int64_t));
+        }
+        if (!writer.batch(columns, n, error))
+            return false;
+    }
+    out.rows = records.size();
+    return writer.close(out.bytes, error);
+}
+
+} // namespace
+
+bool write_arrow(const std::string &path, bool stream, const std::vector<Bar> &bars,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error) {
+    return export_records(path, stream, kBarColumns, bars, utc, out, error);
+}
+
+bool write_arrow(const std::string &path, bool stream, const std::vector<Tick> &ticks,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error) {
+    return export_records(path, stream, kTickColumns, ticks, utc, out, error);
+}
+
+bool write_arrow(const std::string &path, bool stream, const std::vector<Deal> &deals,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error) {
+    return export_records(path, stream, kDealColumns, deals, utc, out, error);
+}
+
+} // namespace mt5bridge
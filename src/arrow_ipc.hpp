@@ -0,0 +1,57 @@
+/*
+ * arrow_ipc.hpp
+ *
+ * Columnar export of bars, ticks and deals as Apache Arrow IPC.
+ *
+ * Requests for copy_ticks_*, copy_rates_*, get_m1_bars and
+ * history_deals_get with "arrow": "<path>" write their records to path
+ * instead of answering them as JSON. The default is the IPC file format
+ * (Feather v2), which pandas, polars and DuckDB can memory-map;
+ * "arrow_stream": true writes the IPC stream format instead, for pipes.
+ *
+ * Records are transposed into columns in batches of kArrowBatchRows, so
+ * exporting a large answer needs one batch of extra memory, not a JSON
+ * document. The writer is self-contained: it encodes the flatbuffer
+ * metadata itself and needs no Arrow library. Columns are never null.
+ *
+ * Column types:
+ *   time              timestamp[s]            (bars; server time)
+ *   time_msc          timestamp[ms]           (ticks, deals; server time)
+ *   recv_ns           timestamp[ns, UTC]
+ *   time_utc_ns       timestamp[ns, UTC]      (with "utc": true)
+ *   prices, volumes   float64
+ *   counters, ids     int32 / uint32 / uint64 as in the native records
+ *   gap               bool                    (ticks)
+ *   symbol, comment   utf8                    (deals)
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+constexpr size_t kArrowBatchRows = 65536;
+
+struct ArrowExport {
+    uint64_t rows = 0;
+    uint64_t bytes = 0;     // Size of the written file.
+};
+
+/* Writes records to path; utc, when not empty, holds one UTC time per
+ * record for a time_utc_ns column. Returns false with error on failure,
+ * leaving no partial file behind.
+ */
+bool write_arrow(const std::string &path, bool stream, const std::vector<Bar> &bars,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error);
+bool write_arrow(const std::string &path, bool stream, const std::vector<Tick> &ticks,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error);
+bool write_arrow(const std::string &path, bool stream, const std::vector<Deal> &deals,
+                 const std::vector<int64_t> &utc, ArrowExport &out, std::string &error);
+
+} // namespace mt5bridge
@@ -0,0 +1,142 @@
+/*
+ * asof.cpp
+ *
+ * Galloping merge of history records against a time grid.
+ */
+
+#include "asof.hpp"
+#include "history.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace mt5bridge {
+namespace {
+
+/* Number of records in [from, n) whose key is <= t, plus from: probes
+ * from, from + 1, from + 3, ... until a key exceeds t, then bisects the
+ * last step.
+ */
+template <typename T, typename Key>
+size_t gallop(const T *records, size_t n, size_t from, int64_t t, Key key) {
+    size_t lo = from, step = 1;
+    while (lo < n && key(records[lo]) <= t) {
+        const size_t probe = std::min(n, lo + step);
+        if (key(records[probe - 1]) > t) {
+            n = probe - 1;
+            break;
+        }
+        lo = probe;
+        step *= 2;
+    }
+    return static_cast<size_t>(
+        std::upper_bound(records + lo, records + n, t,
+                         [&](int64_t v, const T &r) { return v < key(r); }) -
+        records);
+}
+
+template <typename T, typename Key>
+size_t merge_row(const Series<T> &series, const int64_t *times, size_t time_count, T *row,
+                 Key key) {
+    size_t cursor = 0, filled = 0;
+    for (size_t j = 0; j < time_count; ++j) {
+        cursor = gallop(series.records, series.count, cursor, times[j], key);
+        if (cursor) {
+            row[j] = series.records[cursor - 1];
+            ++filled;
+        } else {
+            std::memset(&row[j], 0, sizeof(T));
+        }
+    }
+    return filled;
+}
+
+bool ascending(const int64_t *times, size_t count, std::string &error) {
+    if (!times && count) {
+        error = "times must not be null";
+        return false;
+    }
+    for (size_t j = 1; j < count; ++j) {
+        if (times[j] < times[j - 1]) {
+            error = "times must be ascending (times[" + std::to_string(j) + "] < times[" +
+                    std::to_string(j - 1) + "])";
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Runs fill(symbol, row, filled, error) for every row in parallel; a
+ * false fill zeroes the row and counts the symbol as missing.
+ */
+template <typename T, typename Fill>
+bool fill_rows(const char *const *symbols, size_t symbol_count, size_t time_count, T *out,
+               AsofStats &stats, std::string &error, Fill fill) {
+    if ((!symbols || (!out && time_count)) && symbol_count) {
+        error = "symbols and out must not be null";
+        return false;
+    }
+    stats = AsofStats();
+    std::mutex mutex;
+    std::vector<size_t> filled(symbol_count, 0);
+    stats.workers = worker_count(symbol_count);
+    parallel_for(symbol_count, stats.workers, [&](size_t i, unsigned) {
+        T *row = out + i * time_count;
+        std::string err;
+        if (symbols[i] && fill(symbols[i], row, filled[i], err))
+            return;
+        std::memset(static_cast<void *>(row), 0, time_count * sizeof(T));
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.missing;
+        stats.missing_error = std::string(symbols[i] ? symbols[i] : "(null)") + ": " +
+                              (symbols[i] ? err : "symbol is null");
+    });
+    for (size_t n : filled)
+        stats.filled += n;
+    return true;
+}
+
+} // namespace
+
+bool asof_ticks(const std::string &dir, const char *const *symbols, size_t symbol_count,
+                const int64_t *times, size_t time_count, Tick *out, AsofStats &stats,
+                std::string &error) {
+    if (!ascending(times, time_count, error))
+        return false;
+    return fill_rows(symbols, symbol_count, time_count, out, stats, error,
+                     [&](const char *symbol, Tick *row, size_t &filled, std::string &err) {
+                         TickSeries series;
+                         if (!open_ticks(ticks_path(dir, symbol), series, err))
+                             return false;
+                         filled = merge_row(series, times, time_count, row,
+                                            [](const Tick &t) { return t.time_msc; });
+                         return true;
+                     });
+}
+
+bool asof_bars(const std::string &dir, const char *const *symbols, size_t symbol_count,
+               int64_t timeframe, const int64_t *times, size_t time_count, Bar *out,
+               AsofStats &stats, std::string &error) {
+    if (timeframe_name(timeframe).empty()) {
+        error = "unknown timeframe " + std::to_string(timeframe);
+        return false;
+    }
+    if (!ascending(times, time_count, error))
+        return false;
+    return fill_rows(symbols, symbol_count, time_count, out, stats, error,
+                     [&](const char *symbol, Bar *row, size_t &filled, std::string &err) {
+                         BarSeries series;
+                         if (!open_bars(bars_path(dir, symbol, timeframe), series, err))
+                             return false;
+                         filled = merge_row(series, times, time_count, row,
+                                            [timeframe](const Bar &b) {
+                                                return bar_close_time(b.time, timeframe);
+                                            });
+                         return true;
+                     });
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,55 @@
+/*
+ * asof.hpp
+ *
+ * Cross-symbol snapshots from the history store (history.hpp).
+ *
+ * For a set of symbols and an ascending grid of times, each cell of the
+ * symbol x time matrix holds the symbol's last record as of that time:
+ *
+ *   ticks  the last stored tick with time_msc <= t (t in milliseconds)
+ *   bars   the last bar of the timeframe that had closed by t, i.e. with
+ *          bar_close_time(time, timeframe) <= t (t in seconds), so a
+ *          snapshot never sees a bar's final values before its end; an
+ *          MN1 bar closes at the start of the next calendar month
+ *
+ * Cells before a symbol's first record are zeroed (time 0).
+ *
+ * Every row is the merge of one symbol's sorted records with the sorted
+ * grid: a cursor moves forward through the records, galloping past runs
+ * of records between two grid times, so a row costs O(T log(N / T)) for
+ * T times over N records and dense grids cost O(N + T). All cells of a
+ * column come from the same instant on every symbol. Rows are
+ * independent and are filled on threads.workers threads.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mt5bridge {
+
+struct AsofStats {
+    size_t filled = 0;      // Cells holding a record.
+    size_t missing = 0;     // Symbols without a history file; their rows are zeroed.
+    std::string missing_error; // Error of the last of them.
+    unsigned workers = 0;
+};
+
+/* Fills out[i * time_count + j] with symbols[i]'s tick as of times[j]
+ * from the files under dir. False with error if times are not
+ * ascending; a symbol without history is counted in stats instead.
+ */
+bool asof_ticks(const std::string &dir, const char *const *symbols, size_t symbol_count,
+                const int64_t *times, size_t time_count, Tick *out, AsofStats &stats,
+                std::string &error);
+
+/* asof_ticks for the closed bars of timeframe; times in seconds. */
+bool asof_bars(const std::string &dir, const char *const *symbols, size_t symbol_count,
+               int64_t timeframe, const int64_t *times, size_t time_count, Bar *out,
+               AsofStats &stats, std::string &error);
+
+} // namespace mt5bridge
@@ -0,0 +1,269 @@
+/*
+ * backend.cpp
+ *
+ * Backend selection, JSON-based typed calls and the polling run loop.
+ */
+
+#include "backend.hpp"
+#include "backtest_backend.hpp"
+#include "replay_backend.hpp"
+#include "responses.hpp"
+#include "sim_backend.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+// The typed API hands internal records out as the public structs.
+static_assert(sizeof(Tick) == sizeof(mt5bridge_tick) &&
+              offsetof(Tick, flags) == offsetof(mt5bridge_tick, flags) &&
+              offsetof(Tick, integrity) == offsetof(mt5bridge_tick, integrity),
+              "Tick and mt5bridge_tick must share a layout");
+static_assert(sizeof(Bar) == sizeof(mt5bridge_bar) &&
+              offsetof(Bar, spread) == offsetof(mt5bridge_bar, spread) &&
+              offsetof(Bar, recv_ns) == offsetof(mt5bridge_bar, recv_ns),
+              "Bar and mt5bridge_bar must share a layout");
+
+constexpr int64_t kCopyTicksAll = -1;   // COPY_TICKS_ALL
+constexpr int64_t kPollBatch = 100000;  // Ticks fetched per symbol and poll.
+
+thread_local Backend *t_backend = nullptr;
+
+void copy_string(char *dst, size_t size, const char *src) {
+    std::snprintf(dst, size, "%s", src ? src : "");
+}
+
+} // namespace
+
+json_t *Backend::call(const char *method, json_t *request, std::string &error) {
+    error.clear();
+    json_t *result = eval(method, request, error);
+    json_decref(request);
+    if (!result || json_is_null(result)) {
+        json_decref(result);
+        if (error.empty())
+            error = std::string(method) + " failed";
+        return nullptr;
+    }
+    error.clear();
+    return result;
+}
+
+json_t *symbol_info_tick_request(const char *symbol) {
+    return json_pack("{s:s, s:s}", "method", "symbol_info_tick", "symbol", symbol);
+}
+
+json_t *copy_ticks_request(const char *symbol, int64_t date_from, int64_t count, int64_t flags) {
+    return json_pack("{s:s, s:s, s:I, s:I, s:I}", "method", "copy_ticks_from", "symbol", symbol,
+                     "date_from", date_from, "count", count, "flags", flags);
+}
+
+json_t *copy_rates_request(const char *symbol, int64_t timeframe, int64_t start, int64_t count) {
+    return json_pack("{s:s, s:s, s:I, s:I, s:I}", "method", "copy_rates_from_pos", "symbol",
+                     symbol, "timeframe", timeframe, "start", start, "count", count);
+}
+
+json_t *order_send_request(const mt5bridge_trade_request &request) {
+    json_t *trade = json_pack("{s:i, s:i, s:s, s:f, s:f, s:f, s:f, s:i, s:I}",
+                              "action", request.action, "type", request.type,
+                              "symbol", request.symbol ? request.symbol : "",
+                              "volume", request.volume, "price", request.price,
+                              "sl", request.sl, "tp", request.tp,
+                              "deviation", request.deviation,
+                              "magic", static_cast<json_int_t>(request.magic));
+    if (request.position)
+        json_object_set_new(trade, "position", json_integer(static_cast<json_int_t>(request.position)));
+    if (request.comment)
+        json_object_set_new(trade, "comment", json_string(request.comment));
+    return json_pack("{s:s, s:o}", "method", "order_send", "request", trade);
+}
+
+json_t *trade_result_to_json(const mt5bridge_trade_result &result) {
+    return json_pack("{s:I, s:I, s:I, s:f, s:f, s:f, s:f, s:I, s:s}",
+                     "retcode", static_cast<json_int_t>(result.retcode),
+                     "deal", static_cast<json_int_t>(result.deal),
+                     "order", static_cast<json_int_t>(result.order), "volume", result.volume,
+                     "price", result.price, "bid", result.bid, "ask", result.ask,
+                     "recv_ns", static_cast<json_int_t>(result.recv_ns), "comment",
+                     result.comment);
+}
+
+json_t *position_to_json(const mt5bridge_position &pos) {
+    return json_pack("{s:I, s:s, s:i, s:f, s:f, s:f, s:f, s:f, s:f, s:I, s:I}",
+                     "ticket", static_cast<json_int_t>(pos.ticket), "symbol", pos.symbol,
+                     "type", pos.type, "volume", pos.volume, "price_open", pos.price_open,
+                     "price_current", pos.price_current, "sl", pos.sl, "tp", pos.tp,
+                     "profit", pos.profit, "time_msc", static_cast<json_int_t>(pos.time_msc),
+                     "magic", static_cast<json_int_t>(pos.magic));
+}
+
+bool Backend::symbol_info_tick(const char *symbol, Tick &out, std::string &error) {
+    json_t *result = call("symbol_info_tick", symbol_info_tick_request(symbol), error);
+    if (!result)
+        return false;
+    out = Tick{};
+    const bool ok = json_to_tick(result, out);
+    json_decref(result);
+    if (!ok)
+        error = "symbol_info_tick: unexpected answer";
+    return ok;
+}
+
+bool Backend::copy_ticks_from(const char *symbol, int64_t date_from, int64_t count,
+                              int64_t flags, std::vector<Tick> &out, std::string &error) {
+    json_t *result =
+        call("copy_ticks_from", copy_ticks_request(symbol, date_from, count, flags), error);
+    if (!result)
+        return false;
+    out.clear();
+    out.reserve(json_array_size(result));
+    for (size_t i = 0; i < json_array_size(result); ++i) {
+        Tick tick{};
+        json_to_tick(json_array_get(result, i), tick);
+        out.push_back(tick);
+    }
+    json_decref(result);
+    return true;
+}
+
+bool Backend::copy_rates_from_pos(const char *symbol, int64_t timeframe, int64_t start,
+                                  int64_t count, std::vector<Bar> &out, std::string &error) {
+    json_t *result =
+        call("copy_rates_from_pos", copy_rates_request(symbol, timeframe, start, count), error);
+    if (!result)
+        return false;
+    out.clear();
+    out.reserve(json_array_size(result));
+    for (size_t i = 0; i < json_array_size(result); ++i) {
+        Bar bar{};
+        json_to_bar(json_array_get(result, i), bar);
+        out.push_back(bar);
+    }
+    json_decref(result);
+    return true;
+}
+
+bool Backend::order_send(const mt5bridge_trade_request &request, mt5bridge_trade_result &result,
+                         std::string &error) {
+    json_t *answer = call("order_send", order_send_request(request), error);
+    if (!answer)
+        return false;
+    result = mt5bridge_trade_result{};
+    result.retcode = static_cast<uint32_t>(json_integer_value(json_object_get(answer, "retcode")));
+    result.deal = static_cast<uint64_t>(json_integer_value(json_object_get(answer, "deal")));
+    result.order = static_cast<uint64_t>(json_integer_value(json_object_get(answer, "order")));
+    result.volume = json_number_value(json_object_get(answer, "volume"));
+    result.price = json_number_value(json_object_get(answer, "price"));
+    result.bid = json_number_value(json_object_get(answer, "bid"));
+    result.ask = json_number_value(json_object_get(answer, "ask"));
+    result.recv_ns = json_integer_value(json_object_get(answer, "recv_ns"));
+    copy_string(result.comment, sizeof result.comment,
+                json_string_value(json_object_get(answer, "comment")));
+    json_decref(answer);
+    return true;
+}
+
+void positions_from_json(const json_t *answer, std::vector<mt5bridge_position> &out) {
+    out.clear();
+    for (size_t i = 0; i < json_array_size(answer); ++i) {
+        const json_t *p = json_array_get(answer, i);
+        mt5bridge_position pos{};
+        pos.ticket = static_cast<uint64_t>(json_integer_value(json_object_get(p, "ticket")));
+        copy_string(pos.symbol, sizeof pos.symbol, json_string_value(json_object_get(p, "symbol")));
+        pos.type = static_cast<int32_t>(json_integer_value(json_object_get(p, "type")));
+        pos.volume = json_number_value(json_object_get(p, "volume"));
+        pos.price_open = json_number_value(json_object_get(p, "price_open"));
+        pos.price_current = json_number_value(json_object_get(p, "price_current"));
+        pos.sl = json_number_value(json_object_get(p, "sl"));
+        pos.tp = json_number_value(json_object_get(p, "tp"));
+        pos.profit = json_number_value(json_object_get(p, "profit"));
+        pos.time_msc = json_integer_value(json_object_get(p, "time_msc"));
+        pos.magic = static_cast<uint64_t>(json_integer_value(json_object_get(p, "magic")));
+        out.push_back(pos);
+    }
+}
+
+bool Backend::positions_get(std::vector<mt5bridge_position> &out, std::string &error) {
+    json_t *result = call("positions_get", json_pack("{s:s}", "method", "positions_get"), error);
+    if (!result)
+        return false;
+    positions_from_json(result, out);
+    json_decref(result);
+    return true;
+}
+
+bool Backend::run(const std::vector<std::string> &symbols, mt5bridge_tick_handler handler,
+                  void *user, std::string &error) {
+    if (symbols.empty()) {
+        error = "run requires at least one symbol";
+        return false;
+    }
+
+    // Delivery starts after each symbol's current quote. Ticks sharing the
+    // last delivered millisecond are only taken when the integrity stage
+    // has sequenced them as new.
+    std::vector<int64_t> last_msc(symbols.size());
+    std::vector<bool> polled(symbols.size(), false);
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        Tick tick;
+        if (!symbol_info_tick(symbols[i].c_str(), tick, error))
+            return false;
+        last_msc[i] = tick.time_msc;
+    }
+
+    struct Event {
+        size_t symbol;
+        Tick tick;
+    };
+    std::vector<Event> batch;
+    std::vector<Tick> ticks;
+    for (;;) {
+        batch.clear();
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            if (!copy_ticks_from(symbols[i].c_str(), last_msc[i] / 1000, kPollBatch, kCopyTicksAll,
+                                 ticks, error))
+                return false;
+            for (const Tick &t : ticks) {
+                const bool fresh = t.time_msc > last_msc[i] ||
+                                   (polled[i] && t.seq != 0 && t.time_msc == last_msc[i]);
+                if (fresh)
+                    batch.push_back({i, t});
+            }
+            for (const Tick &t : ticks)
+                last_msc[i] = std::max(last_msc[i], t.time_msc);
+            polled[i] = true;
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const Event &a, const Event &b) {
+            return a.tick.time_msc < b.tick.time_msc;
+        });
+        for (const Event &e : batch) {
+            if (handler(symbols[e.symbol].c_str(), reinterpret_cast<const mt5bridge_tick *>(&e.tick),
+                        user) != 0)
+                return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(config().poll_ticks_ms));
+    }
+}
+
+void bind_thread_backend(Backend *backend) { t_backend = backend; }
+
+Backend *thread_backend() { return t_backend; }
+
+std::unique_ptr<Backend> make_backend(const Config &cfg, std::string &error) {
+    if (cfg.backend == "replay")
+        return ReplayBackend::open(cfg.journal_replay, cfg.replay_speed, error);
+    if (cfg.backend == "sim")
+        return SimBackend::create(cfg, error);
+    if (cfg.backend == "backtest")
+        return BacktestBackend::open(cfg, error);
+    if (cfg.backend != "python")
+        error = "unknown backend: " + cfg.backend;
+    return nullptr;
+}
+
+} // namespace mt5bridge
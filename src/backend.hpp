@@ -0,0 +1,107 @@
+/*
+ * backend.hpp
+ *
+ * Implementations of the bridge request API.
+ *
+ * The "backend" setting selects what serves requests: the embedded
+ * MetaTrader5 Python module (see mt5_bridge.cpp) or a native
+ * implementation, which needs neither Python nor a terminal.
+ *
+ * Every backend answers JSON requests through eval(). The typed calls
+ * behind the mt5bridge_* typed API default to going through eval() and
+ * converting the JSON; backends with native records override them.
+ */
+
+#pragma once
+
+#include "mt5bridge/mt5bridge.hpp"
+#include "config.hpp"
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    virtual const char *name() const = 0;
+
+    /* True when orders reach a real account; simulated fills (sim,
+     * backtest, replay) must not be published to copy followers.
+     */
+    virtual bool live() const { return false; }
+
+    /* Serves one mt5bridge_eval request. Returns nullptr and fills error
+     * on failure. A result may also come with a non-empty error, mirroring
+     * MetaTrader5 calls that answer None and leave last_error() set.
+     */
+    virtual json_t *eval(const char *method, const json_t *request,
+                         std::string &error) = 0;
+
+    /* True if eval() serves method; a backend answering whatever it
+     * recorded keeps the default.
+     */
+    virtual bool serves(const char *method) const {
+        (void)method;
+        return true;
+    }
+
+    /* Typed calls; each returns false with error on failure. */
+    virtual bool symbol_info_tick(const char *symbol, Tick &out, std::string &error);
+    virtual bool copy_ticks_from(const char *symbol, int64_t date_from, int64_t count,
+                                 int64_t flags, std::vector<Tick> &out, std::string &error);
+    virtual bool copy_rates_from_pos(const char *symbol, int64_t timeframe, int64_t start,
+                                     int64_t count, std::vector<Bar> &out, std::string &error);
+    virtual bool order_send(const mt5bridge_trade_request &request,
+                            mt5bridge_trade_result &result, std::string &error);
+    virtual bool positions_get(std::vector<mt5bridge_position> &out, std::string &error);
+
+    /* Delivers new ticks of symbols to handler in time order until it
+     * returns non-zero. The default polls copy_ticks_from every
+     * poll.ticks_ms.
+     */
+    virtual bool run(const std::vector<std::string> &symbols, mt5bridge_tick_handler handler,
+                     void *user, std::string &error);
+
+private:
+    /* eval() that turns a null answer into an error. */
+    json_t *call(const char *method, json_t *request, std::string &error);
+};
+
+/* Converts a positions_get answer (an array of position objects) into
+ * out; missing members read as zero.
+ */
+void positions_from_json(const json_t *answer, std::vector<mt5bridge_position> &out);
+
+/* The eval requests the typed calls stand for. The default typed calls
+ * send them, and the journal records typed calls as them so a replay
+ * can serve either form.
+ */
+json_t *symbol_info_tick_request(const char *symbol);
+json_t *copy_ticks_request(const char *symbol, int64_t date_from, int64_t count, int64_t flags);
+json_t *copy_rates_request(const char *symbol, int64_t timeframe, int64_t start, int64_t count);
+json_t *order_send_request(const mt5bridge_trade_request &request);
+
+/* Typed answers in the JSON form eval returns them. */
+json_t *trade_result_to_json(const mt5bridge_trade_result &result);
+json_t *position_to_json(const mt5bridge_position &pos);
+
+/* Makes backend serve the typed API and mt5bridge_eval on the calling
+ * thread in place of the configured one; null restores it. Used to give
+ * each parallel backtest its own instance.
+ */
+void bind_thread_backend(Backend *backend);
+Backend *thread_backend();
+
+/* Creates the backend named by cfg.backend; returns nullptr for
+ * "python", which is served in-process by the embedded interpreter.
+ */
+std::unique_ptr<Backend> make_backend(const Config &cfg, std::string &error);
+
+} // namespace mt5bridge
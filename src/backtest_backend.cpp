@@ -0,0 +1,805 @@
+/*
+ * backtest_backend.cpp
+ *
+ * Event loop, fill models, position accounting and look-ahead-free
+ * history access for backtests.
+ */
+
+#include "backtest_backend.hpp"
+#include "responses.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace mt5bridge {
+namespace {
+
+// MetaTrader5 trade constants.
+constexpr int32_t kActionDeal = 1;          // TRADE_ACTION_DEAL
+constexpr int32_t kOrderBuy = 0;            // ORDER_TYPE_BUY
+constexpr int32_t kOrderSell = 1;           // ORDER_TYPE_SELL
+constexpr uint32_t kRetcodeRequote = 10004;
+constexpr uint32_t kRetcodeDone = 10009;
+constexpr uint32_t kRetcodeInvalid = 10013;
+constexpr uint32_t kRetcodeInvalidVolume = 10014;
+constexpr uint32_t kRetcodeMarketClosed = 10018;
+constexpr uint32_t kRetcodePositionClosed = 10036;
+constexpr int32_t kDealEntryIn = 0;         // DEAL_ENTRY_IN
+constexpr int32_t kDealEntryOut = 1;        // DEAL_ENTRY_OUT
+constexpr int32_t kDealReasonExpert = 3;    // DEAL_REASON_EXPERT
+constexpr int32_t kDealReasonSl = 4;        // DEAL_REASON_SL
+constexpr int32_t kDealReasonTp = 5;        // DEAL_REASON_TP
+constexpr int64_t kCopyTicksInfo = 1;       // COPY_TICKS_INFO
+constexpr int64_t kCopyTicksTrade = 2;      // COPY_TICKS_TRADE
+
+constexpr double kVolumeEpsilon = 1e-9;
+
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t");
+    size_t e = s.find_last_not_of(" \t");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+/* Symbols named in a comma list, or every symbol with ticks or M1 bars
+ * in dir.
+ */
+std::vector<std::string> list_symbols(const std::string &list, const std::string &dir) {
+    std::vector<std::string> out;
+    if (!list.empty()) {
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            size_t comma = list.find(',', pos);
+            if (comma == std::string::npos)
+                comma = list.size();
+            std::string name = trim(list.substr(pos, comma - pos));
+            if (!name.empty())
+                out.push_back(name);
+            pos = comma + 1;
+        }
+        return out;
+    }
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        const std::string file = entry.path().filename().string();
+        for (const char *suffix : {".ticks", ".M1.bars"}) {
+            const size_t n = std::strlen(suffix);
+            if (file.size() > n && file.compare(file.size() - n, n, suffix) == 0) {
+                out.push_back(file.substr(0, file.size() - n));
+                break;
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+/* Four ticks per M1 bar: open, the extreme nearer the open in the bar's
+ * direction, the other extreme, close.
+ */
+void ticks_from_bars(const BarSeries &bars, std::vector<Tick> &out) {
+    out.reserve(bars.count * 4);
+    for (const Bar &b : bars) {
+        const int64_t t = b.time * 1000;
+        const bool up = b.close >= b.open;
+        const double prices[4] = {b.open, up ? b.low : b.high, up ? b.high : b.low, b.close};
+        const int64_t offsets[4] = {0, 20000, 40000, 59999};
+        for (int i = 0; i < 4; ++i) {
+            Tick tick{};
+            tick.time_msc = t + offsets[i];
+            tick.bid = prices[i];
+            tick.ask = prices[i];
+            tick.flags = kTickFlagBid | kTickFlagAsk;
+            tick.volume = static_cast<uint64_t>(b.spread); // Ask is set once point is known.
+            out.push_back(tick);
+        }
+    }
+}
+
+bool copy_filter(int64_t flags, const Tick &t) {
+    if (flags == kCopyTicksInfo)
+        return (t.flags & (kTickFlagBid | kTickFlagAsk)) != 0;
+    if (flags == kCopyTicksTrade)
+        return (t.flags & (kTickFlagLast | kTickFlagVolume)) != 0;
+    return true;
+}
+
+void set_comment(mt5bridge_trade_result &r, const char *comment) {
+    std::snprintf(r.comment, sizeof r.comment, "%s", comment);
+}
+
+json_t *position_to_json(const mt5bridge_position &p) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "ticket", json_integer(static_cast<json_int_t>(p.ticket)));
+    json_object_set_new(obj, "symbol", json_string(p.symbol));
+    json_object_set_new(obj, "type", json_integer(p.type));
+    json_object_set_new(obj, "volume", json_real(p.volume));
+    json_object_set_new(obj, "price_open", json_real(p.price_open));
+    json_object_set_new(obj, "price_current", json_real(p.price_current));
+    json_object_set_new(obj, "sl", json_real(p.sl));
+    json_object_set_new(obj, "tp", json_real(p.tp));
+    json_object_set_new(obj, "profit", json_real(p.profit));
+    json_object_set_new(obj, "time_msc", json_integer(p.time_msc));
+    json_object_set_new(obj, "magic", json_integer(static_cast<json_int_t>(p.magic)));
+    return obj;
+}
+
+json_t *trade_result_to_json(const mt5bridge_trade_result &r, const json_t *request) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "retcode", json_integer(r.retcode));
+    json_object_set_new(obj, "deal", json_integer(static_cast<json_int_t>(r.deal)));
+    json_object_set_new(obj, "order", json_integer(static_cast<json_int_t>(r.order)));
+    json_object_set_new(obj, "volume", json_real(r.volume));
+    json_object_set_new(obj, "price", json_real(r.price));
+    json_object_set_new(obj, "bid", json_real(r.bid));
+    json_object_set_new(obj, "ask", json_real(r.ask));
+    json_object_set_new(obj, "comment", json_string(r.comment));
+    json_object_set_new(obj, "request", json_deep_copy(request));
+    json_object_set_new(obj, "recv_ns", json_integer(r.recv_ns));
+    return obj;
+}
+
+/* JSON methods, answered through the typed calls. A failed call answers
+ * null with the error set, like a MetaTrader5 call returning None.
+ */
+json_t *json_symbol_info_tick(BacktestBackend &b, const json_t *req, std::string &error) {
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol) {
+        error = "symbol_info_tick requires symbol";
+        return nullptr;
+    }
+    Tick tick;
+    return b.symbol_info_tick(symbol, tick, error) ? tick_to_json(tick) : json_null();
+}
+
+json_t *json_copy_ticks_from(BacktestBackend &b, const json_t *req, std::string &error) {
+    const char *symbol = req_string(req, "symbol");
+    long long date_from = 0, count = 0, flags = -1;
+    if (!symbol || !req_int(req, "date_from", date_from) || !req_int(req, "count", count)) {
+        error = "copy_ticks_from requires symbol, date_from and count";
+        return nullptr;
+    }
+    req_int(req, "flags", flags);
+    std::vector<Tick> ticks;
+    if (!b.copy_ticks_from(symbol, date_from, count, flags, ticks, error))
+        return json_null();
+    return ticks_response(ticks, req, error, false);
+}
+
+json_t *rates_json(BacktestBackend &b, const json_t *req, const char *symbol, long long timeframe,
+                   long long start, long long count, std::string &error) {
+    std::vector<Bar> bars;
+    if (!b.copy_rates_from_pos(symbol, timeframe, start, count, bars, error))
+        return json_null();
+    return bars_response(bars, req, error, false);
+}
+
+json_t *json_copy_rates_from_pos(BacktestBackend &b, const json_t *req, std::string &error) {
+    const char *symbol = req_string(req, "symbol");
+    long long timeframe = 0, start = 0, count = 0;
+    if (!symbol || !req_int(req, "timeframe", timeframe) || !req_int(req, "count", count)) {
+        error = "copy_rates_from_pos requires symbol, timeframe and count";
+        return nullptr;
+    }
+    req_int(req, "start", start);
+    return rates_json(b, req, symbol, timeframe, start, count, error);
+}
+
+json_t *json_get_m1_bars(BacktestBackend &b, const json_t *req, std::string &error) {
+    const char *symbol = req_string(req, "symbol");
+    long long count = 0;
+    if (!symbol || !req_int(req, "count", count)) {
+        error = "get_m1_bars requires symbol and count";
+        return nullptr;
+    }
+    return rates_json(b, req, symbol, kTimeframeM1, 0, count, error);
+}
+
+json_t *send(BacktestBackend &b, const json_t *trade, std::string &error) {
+    long long action = 0, type = -1, deviation = -1, position = 0, magic = 0;
+    req_int(trade, "action", action);
+    req_int(trade, "type", type);
+    req_int(trade, "deviation", deviation);
+    req_int(trade, "position", position);
+    req_int(trade, "magic", magic);
+    mt5bridge_trade_request r{};
+    r.action = static_cast<int32_t>(action);
+    r.type = static_cast<int32_t>(type);
+    r.symbol = req_string(trade, "symbol");
+    req_number(trade, "volume", r.volume);
+    req_number(trade, "price", r.price);
+    req_number(trade, "sl", r.sl);
+    req_number(trade, "tp", r.tp);
+    r.deviation = static_cast<int32_t>(deviation);
+    r.position = static_cast<uint64_t>(position);
+    r.magic = static_cast<uint64_t>(magic);
+    r.comment = req_string(trade, "comment");
+    if (!r.symbol) {
+        error = "order_send requires request.symbol";
+        return nullptr;
+    }
+    mt5bridge_trade_result result;
+    if (!b.order_send(r, result, error))
+        return json_null();
+    return trade_result_to_json(result, trade);
+}
+
+json_t *json_order_send(BacktestBackend &b, const json_t *req, std::string &error) {
+    json_t *trade = json_object_get(req, "request");
+    if (!json_is_object(trade)) {
+        error = "order_send requires a request object";
+        return nullptr;
+    }
+    return send(b, trade, error);
+}
+
+json_t *json_open_market_buy(BacktestBackend &b, const json_t *req, std::string &error) {
+    const char *symbol = req_string(req, "symbol");
+    double volume = 0;
+    if (!symbol || !req_number(req, "volume", volume)) {
+        error = "open_market_buy requires symbol and volume";
+        return nullptr;
+    }
+    json_t *trade = json_pack("{s:i, s:s, s:f, s:i}", "action", kActionDeal, "symbol", symbol,
+                              "volume", volume, "type", kOrderBuy);
+    json_t *out = send(b, trade, error);
+    json_decref(trade);
+    return out;
+}
+
+json_t *json_positions_get(BacktestBackend &b, const json_t *, std::string &error) {
+    std::vector<mt5bridge_position> positions;
+    if (!b.positions_get(positions, error))
+        return json_null();
+    json_t *out = json_array();
+    for (const auto &p : positions)
+        json_array_append_new(out, position_to_json(p));
+    return out;
+}
+
+json_t *json_history_deals_get(BacktestBackend &b, const json_t *req, std::string &error) {
+    long long date_from = 0, date_to = 0;
+    if (!req_int(req, "date_from", date_from) || !req_int(req, "date_to", date_to)) {
+        error = "history_deals_get requires date_from and date_to";
+        return nullptr;
+    }
+    std::vector<Deal> deals;
+    for (const Deal &d : b.deals())
+        if (d.time_msc >= date_from * 1000 && d.time_msc < (date_to + 1) * 1000)
+            deals.push_back(d);
+    return deals_response(deals, req, error);
+}
+
+json_t *json_report(BacktestBackend &b, const json_t *, std::string &) { return b.report(); }
+
+struct JsonMethod {
+    const char *name;
+    json_t *(*fn)(BacktestBackend &backend, const json_t *request, std::string &error);
+};
+
+const JsonMethod kJsonMethods[] = {
+    {"get_m1_bars", json_get_m1_bars},
+    {"copy_rates_from_pos", json_copy_rates_from_pos},
+    {"copy_ticks_from", json_copy_ticks_from},
+    {"symbol_info_tick", json_symbol_info_tick},
+    {"open_market_buy", json_open_market_buy},
+    {"order_send", json_order_send},
+    {"positions_get", json_positions_get},
+    {"history_deals_get", json_history_deals_get},
+    {"backtest_report", json_report},
+};
+
+} // namespace
+
+std::unique_ptr<BacktestBackend> BacktestBackend::open(const Config &cfg, std::string &error) {
+    if (cfg.backtest_to != 0 && cfg.backtest_to < cfg.backtest_from) {
+        error = "backtest.to is before backtest.from";
+        return nullptr;
+    }
+    std::unique_ptr<BacktestBackend> b(new BacktestBackend(cfg));
+    for (const std::string &symbol : list_symbols(cfg.backtest_symbols, b->dir_))
+        if (!b->add_stream(symbol, error))
+            return nullptr;
+    if (b->streams_.empty()) {
+        error = "backtest: no history in " + b->dir_;
+        return nullptr;
+    }
+    return b;
+}
+
+std::unique_ptr<BacktestBackend> BacktestBackend::fork() const {
+    return std::unique_ptr<BacktestBackend>(new BacktestBackend(*this));
+}
+
+BacktestBackend::BacktestBackend(const Config &cfg)
+    : dir_(cfg.history_dir),
+      from_msc_(static_cast<int64_t>(cfg.backtest_from) * 1000),
+      to_msc_(cfg.backtest_to ? static_cast<int64_t>(cfg.backtest_to) * 1000 + 999 : INT64_MAX),
+      spread_points_(static_cast<int>(cfg.backtest_spread_points)),
+      slippage_points_(static_cast<int64_t>(cfg.backtest_slippage_points)),
+      seed_(cfg.backtest_seed),
+      commission_per_lot_(cfg.backtest_commission_per_lot),
+      commission_rate_(cfg.backtest_commission_rate),
+      contract_size_(cfg.backtest_contract_size),
+      initial_balance_(cfg.backtest_balance),
+      balance_(cfg.backtest_balance),
+      peak_equity_(cfg.backtest_balance) {}
+
+bool BacktestBackend::add_stream(const std::string &symbol, std::string &error) {
+    Stream s;
+    s.name = symbol;
+    std::string tick_error;
+    if (open_ticks(ticks_path(dir_, symbol), s.ticks, tick_error)) {
+        s.point = infer_point(s.ticks.records, s.ticks.count);
+    } else {
+        BarSeries m1;
+        std::string bar_error;
+        if (!open_bars(bars_path(dir_, symbol, kTimeframeM1), m1, bar_error)) {
+            error = "backtest: " + tick_error;
+            return false;
+        }
+        auto ticks = std::make_shared<std::vector<Tick>>();
+        ticks_from_bars(m1, *ticks);
+        s.point = infer_point(ticks->data(), ticks->size());
+        for (Tick &t : *ticks) {
+            t.ask = t.bid + static_cast<double>(t.volume) * s.point;
+            t.volume = 0;
+        }
+        s.ticks.records = ticks->data();
+        s.ticks.count = ticks->size();
+        s.ticks.owned = std::move(ticks);
+        s.bars.emplace(kTimeframeM1, std::move(m1));
+    }
+
+    auto by_time = [](const Tick &t, int64_t msc) { return t.time_msc < msc; };
+    s.begin = static_cast<size_t>(
+        std::lower_bound(s.ticks.begin(), s.ticks.end(), from_msc_, by_time) - s.ticks.begin());
+    s.end = to_msc_ == INT64_MAX
+        ? s.ticks.count
+        : static_cast<size_t>(std::lower_bound(s.ticks.begin(), s.ticks.end(), to_msc_ + 1, by_time) -
+                              s.ticks.begin());
+    s.cursor = s.begin;
+    by_name_.emplace(symbol, streams_.size());
+    streams_.push_back(std::move(s));
+    return true;
+}
+
+BacktestBackend::Stream *BacktestBackend::find(const char *symbol, std::string &error) {
+    auto it = by_name_.find(symbol ? symbol : "");
+    if (it != by_name_.end())
+        return &streams_[it->second];
+    error = std::string("unknown symbol ") + (symbol ? symbol : "");
+    return nullptr;
+}
+
+Tick BacktestBackend::quote(const Stream &s, const Tick &recorded) const {
+    Tick q = recorded;
+    if (spread_points_ > 0)
+        q.ask = q.bid + spread_points_ * s.point;
+    return q;
+}
+
+size_t BacktestBackend::visible_end(const Stream &s) const {
+    if (s.active)
+        return s.cursor;
+    return static_cast<size_t>(
+        std::upper_bound(s.ticks.begin(), s.ticks.end(), now_msc_,
+                         [](int64_t msc, const Tick &t) { return msc < t.time_msc; }) -
+        s.ticks.begin());
+}
+
+json_t *BacktestBackend::eval(const char *method, const json_t *request, std::string &error) {
+    for (const auto &m : kJsonMethods)
+        if (std::strcmp(m.name, method) == 0)
+            return m.fn(*this, request, error);
+    error = "unknown method";
+    return nullptr;
+}
+
+bool BacktestBackend::serves(const char *method) const {
+    for (const auto &m : kJsonMethods)
+        if (std::strcmp(m.name, method) == 0)
+            return true;
+    return false;
+}
+
+bool BacktestBackend::symbol_info_tick(const char *symbol, Tick &out, std::string &error) {
+    Stream *s = find(symbol, error);
+    if (!s)
+        return false;
+    const size_t end = visible_end(*s);
+    if (end == 0) {
+        error = std::string("no quote for ") + symbol + " yet";
+        return false;
+    }
+    out = quote(*s, s->ticks.records[end - 1]);
+    return true;
+}
+
+bool BacktestBackend::copy_ticks_from(const char *symbol, int64_t date_from, int64_t count,
+                                      int64_t flags, std::vector<Tick> &out, std::string &error) {
+    Stream *s = find(symbol, error);
+    if (!s)
+        return false;
+    out.clear();
+    const Tick *end = s->ticks.records + visible_end(*s);
+    const Tick *it = std::lower_bound(s->ticks.begin(), end, date_from * 1000,
+                                      [](const Tick &t, int64_t msc) { return t.time_msc < msc; });
+    for (; it != end && static_cast<int64_t>(out.size()) < count; ++it)
+        if (copy_filter(flags, *it))
+            out.push_back(quote(*s, *it));
+    return true;
+}
+
+void BacktestBackend::aggregate(const Stream &s, size_t from, size_t to, int64_t period_s,
+                                std::vector<Bar> &out) const {
+    for (size_t i = from; i < to; ++i) {
+        const Tick q = quote(s, s.ticks.records[i]);
+        const int64_t open = bar_open_time(floor_div(q.time_msc, 1000), period_s);
+        if (out.empty() || out.back().time != open) {
+            Bar bar{};
+            bar.time = open;
+            bar.open = bar.high = bar.low = q.bid;
+            bar.spread = static_cast<int32_t>(std::lround((q.ask - q.bid) / s.point));
+            out.push_back(bar);
+        }
+        Bar &bar = out.back();
+        bar.high = std::max(bar.high, q.bid);
+        bar.low = std::min(bar.low, q.bid);
+        bar.close = q.bid;
+        bar.tick_volume += 1;
+        bar.real_volume += q.volume;
+        bar.recv_ns = q.recv_ns;
+    }
+}
+
+bool BacktestBackend::copy_rates_from_pos(const char *symbol, int64_t timeframe, int64_t start,
+                                          int64_t count, std::vector<Bar> &out,
+                                          std::string &error) {
+    Stream *s = find(symbol, error);
+    if (!s)
+        return false;
+    const int64_t period = timeframe_seconds(timeframe);
+    if (period == 0) {
+        error = "unsupported timeframe " + std::to_string(timeframe);
+        return false;
+    }
+    out.clear();
+    if (count <= 0 || start < 0)
+        return true;
+
+    // Positions count back from the forming bar, which is built from the
+    // ticks seen so far; completed bars come from a stored bar file when
+    // there is one and are otherwise aggregated from ticks.
+    const int64_t current = bar_open_time(floor_div(now_msc_, 1000), period);
+    const size_t end = visible_end(*s);
+    const Tick *ticks = s->ticks.records;
+    const size_t forming_from = static_cast<size_t>(
+        std::lower_bound(ticks, ticks + end, current * 1000,
+                         [](const Tick &t, int64_t msc) { return t.time_msc < msc; }) - ticks);
+    const size_t needed = static_cast<size_t>(start + count);
+
+    std::vector<Bar> bars; // Oldest first; the forming bar, if any, last.
+    aggregate(*s, forming_from, end, period, bars);
+    const size_t completed = needed > bars.size() ? needed - bars.size() : 0;
+
+    std::vector<Bar> older;
+    auto stored = s->bars.find(timeframe);
+    if (stored == s->bars.end()) {
+        BarSeries series;
+        std::string ignored;
+        if (open_bars(bars_path(dir_, s->name, timeframe), series, ignored))
+            stored = s->bars.emplace(timeframe, std::move(series)).first;
+    }
+    if (stored != s->bars.end()) {
+        const BarSeries &series = stored->second;
+        const Bar *stop = std::lower_bound(series.begin(), series.end(), current,
+                                           [](const Bar &b, int64_t t) { return b.time < t; });
+        const size_t available = static_cast<size_t>(stop - series.begin());
+        const size_t n = std::min(completed, available);
+        older.assign(stop - n, stop);
+    } else if (completed > 0 && forming_from > 0) {
+        // Walk back over just enough ticks to make the completed bars.
+        size_t from = forming_from;
+        size_t seen = 0;
+        int64_t open = INT64_MIN;
+        while (from > 0) {
+            const int64_t t = bar_open_time(floor_div(ticks[from - 1].time_msc, 1000), period);
+            if (t != open) {
+                if (seen == completed)
+                    break;
+                ++seen;
+                open = t;
+            }
+            --from;
+        }
+        aggregate(*s, from, forming_from, period, older);
+    }
+    older.insert(older.end(), bars.begin(), bars.end());
+
+    const size_t total = older.size();
+    const size_t skip = std::min(total, static_cast<size_t>(start));
+    const size_t take = std::min(total - skip, static_cast<size_t>(count));
+    out.assign(older.end() - static_cast<std::ptrdiff_t>(skip + take),
+               older.end() - static_cast<std::ptrdiff_t>(skip));
+    return true;
+}
+
+double BacktestBackend::commission(double volume, double price) const {
+    return volume * commission_per_lot_ + volume * contract_size_ * price * commission_rate_;
+}
+
+void BacktestBackend::update_drawdown() {
+    const double equity = balance_ + floating_;
+    peak_equity_ = std::max(peak_equity_, equity);
+    max_drawdown_ = std::max(max_drawdown_, peak_equity_ - equity);
+}
+
+void BacktestBackend::record_deal(const mt5bridge_position &p, uint64_t ticket, int32_t entry,
+                                  int32_t reason, double volume, double price, double fee,
+                                  double profit) {
+    Deal d{};
+    d.ticket = ticket;
+    d.order = ticket;
+    d.time_msc = now_msc_;
+    d.type = entry == kDealEntryIn ? p.type : (p.type == kOrderBuy ? kOrderSell : kOrderBuy);
+    d.entry = entry;
+    d.reason = reason;
+    d.magic = p.magic;
+    d.position_id = p.ticket;
+    d.volume = volume;
+    d.price = price;
+    d.commission = -fee;
+    d.profit = profit;
+    std::snprintf(d.symbol, sizeof d.symbol, "%s", p.symbol);
+    std::snprintf(d.comment, sizeof d.comment, "%s",
+                  reason == kDealReasonSl ? "sl" : reason == kDealReasonTp ? "tp" : "");
+    history_.push_back(d);
+}
+
+void BacktestBackend::close(size_t index, double volume, double price, int32_t reason,
+                            mt5bridge_trade_result *result) {
+    mt5bridge_position &p = positions_[index].pos;
+    const double sign = p.type == kOrderBuy ? 1.0 : -1.0;
+    const double fee = commission(volume, price);
+    const double profit = (price - p.price_open) * sign * volume * contract_size_;
+    balance_ += profit - fee;
+    commission_total_ += fee;
+    floating_ -= p.profit;
+    const uint64_t ticket = next_ticket_++;
+    record_deal(p, ticket, kDealEntryOut, reason, volume, price, fee, profit);
+    if (result) {
+        result->retcode = kRetcodeDone;
+        result->deal = ticket;
+        result->order = ticket;
+        result->volume = volume;
+        result->price = price;
+        set_comment(*result, "Request executed");
+    }
+    if (p.volume - volume > kVolumeEpsilon) {
+        p.volume -= volume;
+        p.profit = (p.price_current - p.price_open) * sign * p.volume * contract_size_;
+        floating_ += p.profit;
+    } else {
+        positions_.erase(positions_.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+}
+
+void BacktestBackend::on_quote(size_t stream, const Tick &q) {
+    for (size_t i = positions_.size(); i-- > 0;) {
+        if (positions_[i].stream != stream)
+            continue;
+        mt5bridge_position &p = positions_[i].pos;
+        const bool buy = p.type == kOrderBuy;
+        const double price = buy ? q.bid : q.ask;
+        const double profit = (price - p.price_open) * (buy ? 1.0 : -1.0) * p.volume * contract_size_;
+        floating_ += profit - p.profit;
+        p.price_current = price;
+        p.profit = profit;
+        const bool stop = p.sl > 0 && (buy ? price <= p.sl : price >= p.sl);
+        const bool take = p.tp > 0 && (buy ? price >= p.tp : price <= p.tp);
+        if (stop || take)
+            close(i, p.volume, price, stop ? kDealReasonSl : kDealReasonTp, nullptr);
+    }
+    update_drawdown();
+}
+
+bool BacktestBackend::order_send(const mt5bridge_trade_request &request,
+                                 mt5bridge_trade_result &result, std::string &error) {
+    Stream *s = find(request.symbol, error);
+    if (!s)
+        return false;
+    const size_t stream = static_cast<size_t>(s - streams_.data());
+    result = mt5bridge_trade_result{};
+    result.recv_ns = now_msc_ * 1000000; // Simulated time keeps runs reproducible.
+
+    const size_t end = visible_end(*s);
+    if (end == 0) {
+        result.retcode = kRetcodeMarketClosed;
+        set_comment(result, "Market closed");
+        return true;
+    }
+    const Tick q = quote(*s, s->ticks.records[end - 1]);
+    result.bid = q.bid;
+    result.ask = q.ask;
+    if (request.action != kActionDeal || (request.type != kOrderBuy && request.type != kOrderSell)) {
+        result.retcode = kRetcodeInvalid;
+        set_comment(result, "Invalid request");
+        return true;
+    }
+    if (!(request.volume > 0)) {
+        result.retcode = kRetcodeInvalidVolume;
+        set_comment(result, "Invalid volume");
+        return true;
+    }
+
+    const bool buy = request.type == kOrderBuy;
+    const int64_t slip = slippage_points_ > 0
+        ? static_cast<int64_t>(mix(seed_ ^ mix(history_.size() + 1)) % static_cast<uint64_t>(slippage_points_ + 1))
+        : 0;
+    const double price = buy ? q.ask + slip * s->point : q.bid - slip * s->point;
+    if (request.price > 0 && request.deviation >= 0 &&
+        std::fabs(price - request.price) > (request.deviation + 0.5) * s->point) {
+        result.retcode = kRetcodeRequote;
+        set_comment(result, "Requote");
+        return true;
+    }
+
+    if (request.position != 0) {
+        auto it = std::find_if(positions_.begin(), positions_.end(), [&](const Position &p) {
+            return p.pos.ticket == request.position;
+        });
+        if (it == positions_.end()) {
+            result.retcode = kRetcodePositionClosed;
+            set_comment(result, "Position closed");
+            return true;
+        }
+        if (it->pos.type == request.type || request.volume > it->pos.volume + kVolumeEpsilon) {
+            result.retcode = it->pos.type == request.type ? kRetcodeInvalid : kRetcodeInvalidVolume;
+            set_comment(result, it->pos.type == request.type ? "Invalid request" : "Invalid volume");
+            return true;
+        }
+        close(static_cast<size_t>(it - positions_.begin()), request.volume, price,
+              kDealReasonExpert, &result);
+        update_drawdown();
+        return true;
+    }
+
+    Position p{};
+    p.stream = stream;
+    p.pos.ticket = next_ticket_++;
+    std::snprintf(p.pos.symbol, sizeof p.pos.symbol, "%s", s->name.c_str());
+    p.pos.type = request.type;
+    p.pos.volume = request.volume;
+    p.pos.price_open = price;
+    p.pos.price_current = buy ? q.bid : q.ask;
+    p.pos.sl = request.sl;
+    p.pos.tp = request.tp;
+    p.pos.profit = (p.pos.price_current - price) * (buy ? 1.0 : -1.0) * request.volume * contract_size_;
+    p.pos.time_msc = now_msc_;
+    p.pos.magic = request.magic;
+    const double fee = commission(request.volume, price);
+    balance_ -= fee;
+    commission_total_ += fee;
+    floating_ += p.pos.profit;
+    record_deal(p.pos, p.pos.ticket, kDealEntryIn, kDealReasonExpert, request.volume, price, fee, 0.0);
+    positions_.push_back(p);
+    update_drawdown();
+
+    result.retcode = kRetcodeDone;
+    result.deal = p.pos.ticket;
+    result.order = p.pos.ticket;
+    result.volume = request.volume;
+    result.price = price;
+    set_comment(result, "Request executed");
+    return true;
+}
+
+bool BacktestBackend::positions_get(std::vector<mt5bridge_position> &out, std::string &) {
+    out.clear();
+    for (const Position &p : positions_)
+        out.push_back(p.pos);
+    return true;
+}
+
+bool BacktestBackend::run(const std::vector<std::string> &symbols, mt5bridge_tick_handler handler,
+                          void *user, std::string &error) {
+    std::vector<size_t> active;
+    if (symbols.empty()) {
+        for (size_t i = 0; i < streams_.size(); ++i)
+            active.push_back(i);
+    } else {
+        for (const std::string &name : symbols) {
+            if (!by_name_.count(name) && !add_stream(name, error))
+                return false;
+            active.push_back(by_name_[name]);
+        }
+    }
+
+    // Every run starts from a fresh account.
+    positions_.clear();
+    balance_ = initial_balance_;
+    peak_equity_ = initial_balance_;
+    for (Stream &s : streams_) {
+        s.active = false;
+        s.cursor = s.begin;
+    }
+    for (size_t i : active)
+        streams_[i].active = true;
+    floating_ = 0.0;
+    max_drawdown_ = 0.0;
+    commission_total_ = 0.0;
+    history_.clear();
+    events_ = 0;
+    next_ticket_ = 1;
+    now_msc_ = 0;
+
+    // Min-heap of streams keyed by their next tick; ties go to the stream
+    // listed first so the order of events never depends on timing.
+    auto later = [this](size_t a, size_t b) {
+        const int64_t ta = streams_[a].ticks.records[streams_[a].cursor].time_msc;
+        const int64_t tb = streams_[b].ticks.records[streams_[b].cursor].time_msc;
+        return ta != tb ? ta > tb : a > b;
+    };
+    std::vector<size_t> heap;
+    for (size_t i : active)
+        if (streams_[i].cursor < streams_[i].end)
+            heap.push_back(i);
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    bool stopped = false;
+    while (!heap.empty() && !stopped) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const size_t i = heap.back();
+        Stream &s = streams_[i];
+        const Tick q = quote(s, s.ticks.records[s.cursor++]);
+        now_msc_ = q.time_msc;
+        if (!positions_.empty())
+            on_quote(i, q);
+        ++events_;
+        stopped = handler(s.name.c_str(), reinterpret_cast<const mt5bridge_tick *>(&q), user) != 0;
+        if (s.cursor < s.end)
+            std::push_heap(heap.begin(), heap.end(), later);
+        else
+            heap.pop_back();
+    }
+    wall_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - t0).count();
+    for (Stream &s : streams_)
+        s.active = false;
+    return true;
+}
+
+json_t *BacktestBackend::report() const {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "ticks", json_integer(static_cast<json_int_t>(events_)));
+    json_object_set_new(obj, "deals", json_integer(static_cast<json_int_t>(history_.size())));
+    json_object_set_new(obj, "balance", json_real(balance_));
+    json_object_set_new(obj, "equity", json_real(balance_ + floating_));
+    json_object_set_new(obj, "commission", json_real(commission_total_));
+    json_object_set_new(obj, "max_drawdown", json_real(max_drawdown_));
+    json_object_set_new(obj, "open_positions", json_integer(static_cast<json_int_t>(positions_.size())));
+    json_object_set_new(obj, "wall_ns", json_integer(wall_ns_));
+    json_object_set_new(obj, "ticks_per_s",
+                        json_real(wall_ns_ > 0 ? static_cast<double>(events_) * 1e9 / wall_ns_ : 0.0));
+    return obj;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,138 @@
+/*
+ * backtest_backend.hpp
+ *
+ * Deterministic backtests over the local history store.
+ *
+ * run() merges the tick files of the selected symbols into one stream
+ * ordered by (time_msc, symbol order) and hands each tick to the
+ * strategy's handler. Everything the strategy asks from inside the
+ * handler is answered as of that tick: quotes, tick and bar history never
+ * reach past it, and orders fill against it. Symbols with M1 bars but no
+ * ticks are replayed from four ticks per bar (open, the nearer extreme,
+ * the other extreme, close).
+ *
+ * Fill models (backtest.*):
+ *   spread      recorded bid/ask, or bid + spread_points
+ *   slippage    adverse, uniform in [0, slippage_points], seeded per deal
+ *   commission  commission_per_lot per lot plus commission_rate of the
+ *               notional, charged on entry and on exit
+ *
+ * Accounting is hedging-style: every deal opens a position unless the
+ * request names one to close, which may be closed in part. Profit is
+ * (exit - entry) * volume * contract_size in the quote currency, which is
+ * taken to be the account currency.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "history.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+class BacktestBackend : public Backend {
+public:
+    static std::unique_ptr<BacktestBackend> open(const Config &cfg, std::string &error);
+
+    const char *name() const override { return "backtest"; }
+    json_t *eval(const char *method, const json_t *request, std::string &error) override;
+    bool serves(const char *method) const override;
+
+    bool symbol_info_tick(const char *symbol, Tick &out, std::string &error) override;
+    bool copy_ticks_from(const char *symbol, int64_t date_from, int64_t count, int64_t flags,
+                         std::vector<Tick> &out, std::string &error) override;
+    bool copy_rates_from_pos(const char *symbol, int64_t timeframe, int64_t start, int64_t count,
+                             std::vector<Bar> &out, std::string &error) override;
+    bool order_send(const mt5bridge_trade_request &request, mt5bridge_trade_result &result,
+                    std::string &error) override;
+    bool positions_get(std::vector<mt5bridge_position> &out, std::string &error) override;
+    bool run(const std::vector<std::string> &symbols, mt5bridge_tick_handler handler, void *user,
+             std::string &error) override;
+
+    /* A fresh instance over the same history. Mapped and synthesized
+     * records are shared with this one; positions and results are not.
+     */
+    std::unique_ptr<BacktestBackend> fork() const;
+
+    /* Deals of the current or last run, oldest first. */
+    const std::vector<Deal> &deals() const { return history_; }
+
+    /* {"ticks", "deals", "balance", "equity", "commission", "max_drawdown",
+     *  "open_positions", "wall_ns", "ticks_per_s"}.
+     */
+    json_t *report() const;
+
+private:
+    struct Stream {
+        std::string name;
+        TickSeries ticks;
+        double point;
+        size_t begin = 0;       // First tick inside [backtest.from, backtest.to].
+        size_t end = 0;         // One past the last one.
+        size_t cursor = 0;      // Ticks before it have been delivered.
+        bool active = false;    // Part of the current run.
+        std::unordered_map<int64_t, BarSeries> bars; // Timeframe -> stored bars.
+    };
+
+    struct Position {
+        mt5bridge_position pos;
+        size_t stream;
+    };
+
+    explicit BacktestBackend(const Config &cfg);
+
+    bool add_stream(const std::string &symbol, std::string &error);
+    Stream *find(const char *symbol, std::string &error);
+
+    /* Applies the spread model to a recorded tick. */
+    Tick quote(const Stream &s, const Tick &recorded) const;
+
+    /* Index one past the last tick the strategy may see. */
+    size_t visible_end(const Stream &s) const;
+
+    /* Marks positions of stream s to the quote and fires stops. */
+    void on_quote(size_t stream, const Tick &q);
+    void close(size_t index, double volume, double price, int32_t reason,
+               mt5bridge_trade_result *result);
+    void record_deal(const mt5bridge_position &p, uint64_t ticket, int32_t entry, int32_t reason,
+                     double volume, double price, double fee, double profit);
+    double commission(double volume, double price) const;
+    void update_drawdown();
+
+    /* Aggregates visible ticks [from, to) of s into bars of period_s,
+     * oldest first.
+     */
+    void aggregate(const Stream &s, size_t from, size_t to, int64_t period_s,
+                   std::vector<Bar> &out) const;
+
+    std::string dir_;
+    std::vector<Stream> streams_;
+    std::unordered_map<std::string, size_t> by_name_;
+    std::vector<Position> positions_;
+    std::vector<Deal> history_;
+
+    int64_t from_msc_;
+    int64_t to_msc_;
+    int spread_points_;
+    int64_t slippage_points_;
+    uint64_t seed_;
+    double commission_per_lot_;
+    double commission_rate_;
+    double contract_size_;
+    double initial_balance_;
+
+    int64_t now_msc_ = 0;       // Time of the event being processed.
+    double balance_;
+    double floating_ = 0.0;     // Sum of open position profit.
+    double peak_equity_;
+    double max_drawdown_ = 0.0;
+    double commission_total_ = 0.0;
+    uint64_t next_ticket_ = 1;
+    uint64_t events_ = 0;
+    int64_t wall_ns_ = 0;
+};
+
+} // namespace mt5bridge
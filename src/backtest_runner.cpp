@@ -0,0 +1,81 @@
+/*
+ * backtest_runner.cpp
+ *
+ * Fork-per-job backtests on worker threads.
+ */
+
+#include "backtest_runner.hpp"
+#include "parallel.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace mt5bridge {
+
+json_t *run_backtests(const BacktestBackend &base, const mt5bridge_backtest_job *jobs,
+                      size_t count, mt5bridge_tick_handler handler, std::string &error) {
+    if (!handler || (!jobs && count)) {
+        error = "handler and jobs must not be null";
+        return nullptr;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!jobs[i].symbols && jobs[i].symbol_count) {
+            error = "job " + std::to_string(i) + ": symbols must not be null";
+            return nullptr;
+        }
+    }
+
+    // Slots are written by one worker each and read after the join.
+    std::vector<json_t *> reports(count, nullptr);
+    const auto t0 = std::chrono::steady_clock::now();
+    const ParallelStats stats = parallel_for(count, worker_count(count), [&](size_t i, unsigned) {
+        const mt5bridge_backtest_job &job = jobs[i];
+        std::vector<std::string> symbols(job.symbols, job.symbols + job.symbol_count);
+        std::unique_ptr<BacktestBackend> backtest = base.fork();
+        std::string err;
+        bind_thread_backend(backtest.get());
+        const bool ok = backtest->run(symbols, handler, job.user, err);
+        bind_thread_backend(nullptr);
+        json_t *report = ok ? backtest->report() : json_object();
+        if (!ok)
+            json_object_set_new(report, "error", json_string(err.c_str()));
+        json_object_set_new(report, "job", json_integer(static_cast<json_int_t>(i)));
+        reports[i] = report;
+    });
+    const int64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - t0).count();
+
+    json_t *list = json_array();
+    json_int_t ticks = 0, deals = 0, failed = 0, best = -1;
+    double best_equity = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        json_t *r = reports[i];
+        if (json_object_get(r, "error")) {
+            ++failed;
+        } else {
+            ticks += json_integer_value(json_object_get(r, "ticks"));
+            deals += json_integer_value(json_object_get(r, "deals"));
+            const double equity = json_number_value(json_object_get(r, "equity"));
+            if (best < 0 || equity > best_equity) {
+                best = static_cast<json_int_t>(i);
+                best_equity = equity;
+            }
+        }
+        json_array_append_new(list, r);
+    }
+
+    json_t *out = json_object();
+    json_object_set_new(out, "jobs", list);
+    json_object_set_new(out, "workers", json_integer(stats.workers));
+    json_object_set_new(out, "steals", json_integer(static_cast<json_int_t>(stats.steals)));
+    json_object_set_new(out, "ticks", json_integer(ticks));
+    json_object_set_new(out, "deals", json_integer(deals));
+    json_object_set_new(out, "failed", json_integer(failed));
+    json_object_set_new(out, "best_job", json_integer(best));
+    json_object_set_new(out, "wall_ns", json_integer(wall_ns));
+    json_object_set_new(out, "ticks_per_s",
+                        json_real(wall_ns > 0 ? static_cast<double>(ticks) * 1e9 / wall_ns : 0.0));
+    return out;
+}
+
+} // namespace mt5bridge
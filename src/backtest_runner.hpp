@@ -0,0 +1,33 @@
+/*
+ * backtest_runner.hpp
+ *
+ * Parallel sweeps of independent backtests.
+ *
+ * Each job (a symbol set plus the caller's parameters and state behind
+ * its user pointer) runs on its own fork of the configured backtest, so
+ * all workers read the same mapped history and only accounts are per job.
+ * While a job runs, its fork is bound to the worker thread: the
+ * strategy's typed API calls reach that fork, unchanged from a single
+ * run. Jobs are spread with parallel_for's work stealing.
+ */
+
+#pragma once
+
+#include "backtest_backend.hpp"
+
+#include <jansson.h>
+
+#include <string>
+
+namespace mt5bridge {
+
+/* Runs jobs[0..count) and returns
+ *   {"jobs": [report per job, in job order], "workers", "steals",
+ *    "ticks", "deals", "failed", "best_job", "wall_ns", "ticks_per_s"}
+ * where a failed job's entry is {"job", "error"} and best_job is the job
+ * with the highest final equity (-1 if none succeeded).
+ */
+json_t *run_backtests(const BacktestBackend &base, const mt5bridge_backtest_job *jobs,
+                      size_t count, mt5bridge_tick_handler handler, std::string &error);
+
+} // namespace mt5bridge
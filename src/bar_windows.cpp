@@ -0,0 +1,333 @@
+/*
+ * bar_windows.cpp
+ *
+ * Rolling bar windows refreshed from their newest bars.
+ */
+
+#include "bar_windows.hpp"
+
+#include "clock.hpp"
+#include "responses.hpp"
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int64_t kNsPerMs = 1000000;
+constexpr int64_t kRefreshBars = 2;         // The forming bar and the one before it.
+
+/* Same bar, ignoring when it was received. */
+bool same_bar(const Bar &a, const Bar &b) {
+    return a.time == b.time && a.open == b.open && a.high == b.high && a.low == b.low &&
+           a.close == b.close && a.tick_volume == b.tick_volume && a.spread == b.spread &&
+           a.real_volume == b.real_volume;
+}
+
+} // namespace
+
+struct BarWindows::Window {
+    struct Subscriber {
+        int64_t id;
+        mt5bridge_bar_handler handler;
+        void *user;
+    };
+
+    explicit Window(size_t count) : ring(count) {}
+
+    int64_t id = 0;
+    std::string symbol;
+    int64_t timeframe = 0;
+    int64_t count = 0;
+    int64_t refresh_ms = 0;
+    Backend *backend = nullptr;
+    uint64_t timer = 0;
+    std::mutex refresh_mutex;       // One refresh at a time, publishing in order.
+
+    // The rest is guarded by BarWindows::mutex_.
+    BarRing ring;
+    uint64_t version = 0;
+    Bar forming{};                  // Forming bar as last published.
+    int64_t refreshes = 0;
+    int64_t fetched = 0;
+    int64_t errors = 0;
+    std::string last_error;
+    std::vector<Subscriber> subscribers;
+    bool closed = false;            // A refresh in flight must not dispatch.
+    bool dispatching = false;       // Subscribers being called by dispatcher.
+    std::thread::id dispatcher;
+};
+
+BarWindows &BarWindows::instance() {
+    static BarWindows windows;
+    return windows;
+}
+
+BarWindows::~BarWindows() = default;
+
+std::shared_ptr<BarWindows::Window> BarWindows::find(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = windows_.find(id);
+    return it == windows_.end() ? nullptr : it->second;
+}
+
+bool BarWindows::open(const char *symbol, int64_t timeframe, int64_t count, int64_t refresh_ms,
+                      Backend &backend, int64_t &id, std::string &error) {
+    if (!symbol || !*symbol) {
+        error = "symbol is required";
+        return false;
+    }
+    if (count < 1 || count > kMaxBars || refresh_ms < 0) {
+        error = "count must be 1.." + std::to_string(kMaxBars) +
+                " and refresh_ms must not be negative";
+        return false;
+    }
+    auto window = std::make_shared<Window>(static_cast<size_t>(count));
+    window->symbol = symbol;
+    window->timeframe = timeframe;
+    window->count = count;
+    window->refresh_ms = refresh_ms;
+    window->backend = &backend;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (windows_.size() >= kMaxWindows) {
+            error = "too many bar windows (" + std::to_string(kMaxWindows) + ")";
+            return false;
+        }
+        window->id = id = next_id_++;
+        windows_.emplace(id, window);
+    }
+    // The first refresh loads the whole window.
+    if (refresh(id, error) < 0) {
+        close(id);
+        return false;
+    }
+    if (refresh_ms > 0) {
+        const int64_t window_id = id;
+        const uint64_t timer = TimerWheel::instance().schedule(
+            now_ns() + refresh_ms * kNsPerMs, refresh_ms * kNsPerMs, [this, window_id] {
+                std::string err;
+                refresh(window_id, err);
+            });
+        std::lock_guard<std::mutex> lock(mutex_);
+        window->timer = timer;
+        if (!windows_.count(id)) // Closed meanwhile.
+            TimerWheel::instance().cancel(timer);
+    }
+    return true;
+}
+
+bool BarWindows::close(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = windows_.find(id);
+    if (it == windows_.end())
+        return false;
+    const std::shared_ptr<Window> w = it->second;
+    if (w->timer)
+        TimerWheel::instance().cancel(w->timer);
+    for (const auto &s : w->subscribers)
+        subscriptions_.erase(s.id);
+    w->subscribers.clear();
+    w->closed = true;
+    windows_.erase(it);
+    wait_dispatch(lock, *w);
+    return true;
+}
+
+void BarWindows::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::map<int64_t, std::shared_ptr<Window>> windows;
+    windows.swap(windows_);
+    subscriptions_.clear();
+    for (const auto &entry : windows) {
+        if (entry.second->timer)
+            TimerWheel::instance().cancel(entry.second->timer);
+        entry.second->subscribers.clear();
+        entry.second->closed = true;
+        wait_dispatch(lock, *entry.second);
+    }
+}
+
+void BarWindows::wait_dispatch(std::unique_lock<std::mutex> &lock, const Window &w) {
+    const std::thread::id self = std::this_thread::get_id();
+    dispatched_.wait(lock, [&] { return !w.dispatching || w.dispatcher == self; });
+}
+
+int64_t BarWindows::refresh(int64_t id, std::string &error) {
+    std::shared_ptr<Window> w = find(id);
+    if (!w) {
+        error = "no bar window " + std::to_string(id);
+        return -1;
+    }
+    std::lock_guard<std::mutex> refresh_lock(w->refresh_mutex);
+    size_t held = 0;
+    int64_t newest = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held = w->ring.size();
+        if (held)
+            newest = w->ring.back(0).time;
+    }
+
+    // Widen the request until it overlaps the newest bar held.
+    int64_t want = held ? std::min(kRefreshBars, w->count) : w->count;
+    std::vector<Bar> bars;
+    int64_t fetched = 0;
+    for (;;) {
+        std::string err;
+        if (!w->backend->copy_rates_from_pos(w->symbol.c_str(), w->timeframe, 0, want, bars,
+                                             err)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++w->errors;
+            w->last_error = err;
+            error = err;
+            return -1;
+        }
+        fetched += static_cast<int64_t>(bars.size());
+        if (!held || bars.empty() || bars.front().time <= newest || want >= w->count)
+            break;
+        want = std::min(want * 4, w->count);
+    }
+
+    std::vector<Window::Subscriber> subscribers;
+    std::vector<std::pair<Bar, int>> events;    // Bar and closed flag.
+    size_t changed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Closed while fetching: its subscribers are gone.
+        if (w->closed) {
+            error = "no bar window " + std::to_string(id);
+            return -1;
+        }
+        ++w->refreshes;
+        w->fetched += fetched;
+        auto first = std::lower_bound(bars.begin(), bars.end(), newest,
+                                      [](const Bar &b, int64_t t) { return b.time < t; });
+        if (first == bars.end())
+            return 0;
+        // Nothing new when only the held forming bar came back unchanged.
+        if (held && first->time == newest && first + 1 == bars.end() &&
+            same_bar(*first, w->ring.back(0)))
+            return 0;
+        // Only the newest capacity bars can stay.
+        const size_t n = static_cast<size_t>(bars.end() - first);
+        const size_t cap = w->ring.capacity();
+        const size_t skip = n > cap ? n - cap : 0;
+        changed = w->ring.merge(&*first + skip, n - skip);
+        ++w->version;
+        if (held) {
+            // Bars before the newest fetched one have closed.
+            for (auto it = first; it + 1 != bars.end(); ++it)
+                events.emplace_back(*it, 1);
+            if (!same_bar(bars.back(), w->forming))
+                events.emplace_back(bars.back(), 0);
+        }
+        w->forming = bars.back();
+        if (events.empty() || w->subscribers.empty())
+            return static_cast<int64_t>(changed);
+        subscribers = w->subscribers;
+        w->dispatching = true;
+        w->dispatcher = std::this_thread::get_id();
+    }
+
+    for (const auto &event : events) {
+        mt5bridge_bar bar;
+        std::memcpy(&bar, &event.first, sizeof bar);
+        for (const auto &s : subscribers)
+            s.handler(id, &bar, event.second, s.user);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        w->dispatching = false;
+    }
+    dispatched_.notify_all();
+    return static_cast<int64_t>(changed);
+}
+
+int64_t BarWindows::subscribe(int64_t id, mt5bridge_bar_handler handler, void *user) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = windows_.find(id);
+    if (it == windows_.end() || !handler)
+        return -1;
+    const int64_t subscription = next_subscription_++;
+    it->second->subscribers.push_back({subscription, handler, user});
+    subscriptions_.emplace(subscription, id);
+    return subscription;
+}
+
+bool BarWindows::unsubscribe(int64_t subscription) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = subscriptions_.find(subscription);
+    if (it == subscriptions_.end())
+        return false;
+    const std::shared_ptr<Window> w = windows_.at(it->second);
+    auto &subscribers = w->subscribers;
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [&](const Window::Subscriber &s) {
+                                         return s.id == subscription;
+                                     }),
+                      subscribers.end());
+    subscriptions_.erase(it);
+    wait_dispatch(lock, *w);
+    return true;
+}
+
+bool BarWindows::read(int64_t id, size_t max, std::vector<Bar> &out, uint64_t &version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = windows_.find(id);
+    if (it == windows_.end())
+        return false;
+    const BarRing &ring = it->second->ring;
+    const size_t n = std::min(max, ring.size());
+    out.clear();
+    out.reserve(n);
+    for (size_t i = ring.size() - n; i < ring.size(); ++i)
+        out.push_back(ring.at(i));
+    version = it->second->version;
+    return true;
+}
+
+json_t *BarWindows::bars_json(int64_t id, int64_t from_time, int64_t version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = windows_.find(id);
+    if (it == windows_.end())
+        return nullptr;
+    const Window &w = *it->second;
+    json_t *bars = json_array();
+    if (version != static_cast<int64_t>(w.version)) {
+        for (size_t i = 0; i < w.ring.size(); ++i) {
+            if (w.ring.at(i).time >= from_time)
+                json_array_append_new(bars, bar_to_json(w.ring.at(i)));
+        }
+    }
+    return json_pack("{s:I, s:s, s:I, s:I, s:o}", "id", static_cast<json_int_t>(w.id), "symbol",
+                     w.symbol.c_str(), "timeframe", static_cast<json_int_t>(w.timeframe),
+                     "version", static_cast<json_int_t>(w.version), "bars", bars);
+}
+
+json_t *BarWindows::to_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &entry : windows_) {
+        const Window &w = *entry.second;
+        json_array_append_new(
+            out, json_pack("{s:I, s:s, s:I, s:I, s:I, s:I, s:I, s:I, s:I, s:I, s:s?, s:I}", "id",
+                           static_cast<json_int_t>(w.id), "symbol", w.symbol.c_str(),
+                           "timeframe", static_cast<json_int_t>(w.timeframe), "count",
+                           static_cast<json_int_t>(w.count), "size",
+                           static_cast<json_int_t>(w.ring.size()), "version",
+                           static_cast<json_int_t>(w.version), "refresh_ms",
+                           static_cast<json_int_t>(w.refresh_ms), "refreshes",
+                           static_cast<json_int_t>(w.refreshes), "fetched",
+                           static_cast<json_int_t>(w.fetched), "errors",
+                           static_cast<json_int_t>(w.errors), "last_error",
+                           w.last_error.empty() ? nullptr : w.last_error.c_str(), "subscribers",
+                           static_cast<json_int_t>(w.subscribers.size())));
+    }
+    return out;
+}
+
+} // namespace mt5bridge
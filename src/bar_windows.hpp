@@ -0,0 +1,126 @@
+/*
+ * bar_windows.hpp
+ *
+ * Rolling windows of the last count bars of a (symbol, timeframe), kept
+ * current without fetching the whole window again.
+ *
+ * A window is loaded once with copy_rates_from_pos(symbol, timeframe, 0,
+ * count). Each refresh then asks the backend for the newest two bars only
+ * (the forming bar and the one before it), and for four times as many
+ * again, up to count, while the answer does not reach back to the newest
+ * bar held, e.g. after the bridge missed several closes. The answer is
+ * merged into the window's BarRing (market_cache.hpp) by open time.
+ *
+ * Every change is published to the window's subscribers in order: the
+ * bar that was forming and any bars after it that have since closed, as
+ * closed, then the forming bar whenever it differs from the last one
+ * published. Each change also bumps the window's version, so a reader can
+ * tell that nothing changed without copying any bars.
+ *
+ * Windows with refresh_ms above zero refresh themselves on the timer
+ * wheel (timer_wheel.hpp); subscribers are then called on the timer
+ * thread. A subscriber must not refresh its own window.
+ *
+ * Subscribers are called without the lock. unsubscribe(), close() and
+ * stop() wait for a dispatch in progress on another thread to finish, and
+ * a refresh still fetching when its window closes publishes nothing, so
+ * once they return no handler of theirs runs and its user data may be
+ * freed. Called from a handler of the same dispatch, they return at
+ * once; a handler must not wait for another thread that is closing or
+ * unsubscribing from a window.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "market_cache.hpp"
+
+#include <jansson.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+class BarWindows {
+public:
+    static constexpr size_t kMaxWindows = 1024;
+    static constexpr int64_t kMaxBars = 100000;
+
+    static BarWindows &instance();
+
+    /* Loads the last count bars of symbol through backend, which must
+     * outlive the window, and refreshes them every refresh_ms (0 = only
+     * on refresh()). Returns false with error.
+     */
+    bool open(const char *symbol, int64_t timeframe, int64_t count, int64_t refresh_ms,
+              Backend &backend, int64_t &id, std::string &error);
+
+    /* Stops refreshing and forgets the window and its subscribers,
+     * waiting for a dispatch in progress on another thread. False for an
+     * unknown id.
+     */
+    bool close(int64_t id);
+
+    /* Drops every window (bridge shutdown). */
+    void stop();
+
+    /* Fetches the bars changed since the last refresh and publishes them.
+     * Returns the bars appended or replaced, -1 with error.
+     */
+    int64_t refresh(int64_t id, std::string &error);
+
+    /* Calls handler with every change of window id. Returns the
+     * subscription id, -1 for an unknown window.
+     */
+    int64_t subscribe(int64_t id, mt5bridge_bar_handler handler, void *user);
+
+    /* Stops calling the subscription's handler, waiting for a dispatch in
+     * progress on another thread. False for an unknown subscription.
+     */
+    bool unsubscribe(int64_t subscription);
+
+    /* Copies the newest bars of window id into out, oldest first, at most
+     * max of them. False for an unknown id.
+     */
+    bool read(int64_t id, size_t max, std::vector<Bar> &out, uint64_t &version);
+
+    /* Returns {"id", "symbol", "timeframe", "version", "bars"} with the
+     * bars opened at or after from_time, or no bars when version equals
+     * the window's version; nullptr for an unknown id.
+     */
+    json_t *bars_json(int64_t id, int64_t from_time, int64_t version);
+
+    /* Returns [{"id", "symbol", "timeframe", "count", "size", "version",
+     * "refresh_ms", "refreshes", "fetched", "errors", "last_error",
+     * "subscribers"}, ...]; fetched counts the bars transferred.
+     */
+    json_t *to_json();
+
+private:
+    struct Window;
+
+    BarWindows() = default;
+    ~BarWindows();
+
+    std::shared_ptr<Window> find(int64_t id);
+
+    /* Waits until w is not calling subscribers on another thread; lock
+     * holds mutex_.
+     */
+    void wait_dispatch(std::unique_lock<std::mutex> &lock, const Window &w);
+
+    std::mutex mutex_;
+    std::condition_variable dispatched_;
+    std::map<int64_t, std::shared_ptr<Window>> windows_;
+    std::map<int64_t, int64_t> subscriptions_;     // Subscription id -> window id.
+    int64_t next_id_ = 1;
+    int64_t next_subscription_ = 1;
+};
+
+} // namespace mt5bridge
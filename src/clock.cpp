@@ -0,0 +1,208 @@
+/*
+ * clock.cpp
+ *
+ * TSC detection, calibration and conversion.
+ */
+
+#include "clock.hpp"
+
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define MT5BRIDGE_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define MT5BRIDGE_X86 1
+#endif
+
+namespace mt5bridge {
+namespace {
+
+bool detect_invariant_tsc() {
+#if defined(MT5BRIDGE_X86)
+    // CPUID.80000007H:EDX[8] reports an invariant (constant-rate,
+    // non-stopping) TSC.
+#if defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u)
+        return false;
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#else
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007u)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+constexpr int64_t kMinRefitNs = 100000000;    // Shorter spans keep the rate.
+
+std::mutex g_calibrate_mutex;
+
+/* Brackets an OS clock read between two TSC reads and attributes it to
+ * the midpoint, which removes most of the read latency.
+ */
+int64_t bracket(int64_t (*os_clock)(), uint64_t &tsc) {
+    const uint64_t a = TscClock::read_tsc();
+    const int64_t ns = os_clock();
+    const uint64_t b = TscClock::read_tsc();
+    tsc = a + (b - a) / 2;
+    return ns;
+}
+
+} // namespace
+
+uint64_t TscClock::read_tsc() {
+#if defined(MT5BRIDGE_X86)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(os_monotonic_ns());
+#endif
+}
+
+int64_t TscClock::os_realtime_ns() {
+#if defined(_WIN32)
+    FILETIME ft;
+    GetSystemTimePreciseAsFileTime(&ft);
+    ULARGE_INTEGER t;
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    // FILETIME counts 100 ns intervals since 1601-01-01.
+    return (static_cast<int64_t>(t.QuadPart) - 116444736000000000LL) * 100;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+int64_t TscClock::os_monotonic_ns() {
+#if defined(_WIN32)
+    static const int64_t freq = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<int64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    int64_t sec = c.QuadPart / freq;
+    int64_t rem = c.QuadPart % freq;
+    return sec * 1000000000LL + rem * 1000000000LL / freq;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+TscClock &TscClock::instance() {
+    static TscClock clock;
+    return clock;
+}
+
+TscClock::TscClock() : invariant_(detect_invariant_tsc()) {
+    use_tsc_.store(invariant_, std::memory_order_relaxed);
+    calibrate(std::chrono::milliseconds(2));
+}
+
+void TscClock::use_tsc(bool enable) {
+    use_tsc_.store(enable && invariant_, std::memory_order_relaxed);
+}
+
+void TscClock::calibrate(std::chrono::microseconds window) {
+    std::lock_guard<std::mutex> lock(g_calibrate_mutex);
+
+    uint64_t tsc0 = 0, tsc1 = 0;
+    int64_t mono0 = bracket(&os_monotonic_ns, tsc0);
+    const int64_t deadline = mono0 + window.count() * 1000;
+    while (os_monotonic_ns() < deadline)
+        std::this_thread::yield();
+    int64_t mono1 = bracket(&os_monotonic_ns, tsc1);
+
+    store_anchor(anchor_at(tsc1, mono1,
+                           tsc1 > tsc0 ? static_cast<double>(mono1 - mono0) /
+                                             static_cast<double>(tsc1 - tsc0)
+                                       : 1.0));
+}
+
+void TscClock::reanchor() {
+    std::lock_guard<std::mutex> lock(g_calibrate_mutex);
+
+    const Anchor prev = load_anchor();
+    uint64_t tsc = 0;
+    const int64_t mono = bracket(&os_monotonic_ns, tsc);
+    // The span since the previous anchor refits the rate far more
+    // precisely than the short calibration window.
+    double ns_per_tick = prev.ns_per_tick;
+    if (tsc > prev.tsc && mono - prev.mono_ns >= kMinRefitNs)
+        ns_per_tick = static_cast<double>(mono - prev.mono_ns) / static_cast<double>(tsc - prev.tsc);
+    store_anchor(anchor_at(tsc, mono, ns_per_tick));
+}
+
+TscClock::Anchor TscClock::anchor_at(uint64_t tsc, int64_t mono_ns, double ns_per_tick) {
+    Anchor a;
+    a.ns_per_tick = ns_per_tick;
+    a.mono_ns = mono_ns;
+    a.tsc = tsc;
+    // Realtime is anchored to the same TSC value via its own bracketed
+    // read, extrapolated back to tsc.
+    uint64_t tsc_real = 0;
+    int64_t real = bracket(&os_realtime_ns, tsc_real);
+    a.real_ns = real - static_cast<int64_t>(static_cast<double>(tsc_real - tsc) * ns_per_tick);
+    return a;
+}
+
+void TscClock::store_anchor(const Anchor &a) {
+    seq_.fetch_add(1, std::memory_order_acq_rel);
+    anchor_ = a;
+    seq_.fetch_add(1, std::memory_order_release);
+}
+
+TscClock::Anchor TscClock::load_anchor() const {
+    Anchor a;
+    uint32_t s0, s1;
+    do {
+        s0 = seq_.load(std::memory_order_acquire);
+        a = anchor_;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s1 = seq_.load(std::memory_order_relaxed);
+    } while ((s0 & 1) != 0 || s0 != s1);
+    return a;
+}
+
+double TscClock::ns_per_tick() const { return load_anchor().ns_per_tick; }
+
+int64_t TscClock::now_ns() const {
+    if (!using_tsc())
+        return os_realtime_ns();
+    const uint64_t tsc = read_tsc();
+    const Anchor a = load_anchor();
+    return a.real_ns + static_cast<int64_t>(static_cast<double>(
+                           static_cast<int64_t>(tsc - a.tsc)) * a.ns_per_tick);
+}
+
+int64_t TscClock::mono_ns() const {
+    if (!using_tsc())
+        return os_monotonic_ns();
+    const uint64_t tsc = read_tsc();
+    const Anchor a = load_anchor();
+    return a.mono_ns + static_cast<int64_t>(static_cast<double>(
+                           static_cast<int64_t>(tsc - a.tsc)) * a.ns_per_tick);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,83 @@
+/*
+ * clock.hpp
+ *
+ * Low-overhead timestamps for events entering the bridge.
+ *
+ * TscClock converts the CPU time-stamp counter into UTC and monotonic
+ * nanoseconds using a linear fit calibrated against the OS clocks
+ * (CLOCK_MONOTONIC/CLOCK_REALTIME or QueryPerformanceCounter and
+ * GetSystemTimePreciseAsFileTime). Reading it costs one RDTSC and a few
+ * multiplications, so every tick can be stamped without a syscall. When
+ * the CPU lacks an invariant TSC, or the TSC is disabled through the
+ * "clock.tsc" setting, the OS clocks are read directly instead.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mt5bridge {
+
+class TscClock {
+public:
+    /* Returns the process-wide clock, calibrated on first use. */
+    static TscClock &instance();
+
+    /* Re-fits the TSC rate over window and re-anchors both time bases.
+     * Safe to call while other threads read the clock.
+     */
+    void calibrate(std::chrono::microseconds window = std::chrono::milliseconds(20));
+
+    /* Re-anchors both time bases to the OS clocks now, refitting the TSC
+     * rate over the span since the previous anchor, without waiting. The
+     * bridge calls it every clock.reanchor_ms on the timer wheel, so the
+     * fit follows NTP adjustments of the realtime clock and the drift of
+     * the initial rate stays bounded.
+     */
+    void reanchor();
+
+    /* Switches between TSC and OS clock reads. Ignored (stays on the OS
+     * clock) when the TSC is not invariant.
+     */
+    void use_tsc(bool enable);
+
+    bool invariant_tsc() const { return invariant_; }
+    bool using_tsc() const { return use_tsc_.load(std::memory_order_relaxed); }
+    double ns_per_tick() const;
+
+    /* Nanoseconds since the Unix epoch (UTC). */
+    int64_t now_ns() const;
+
+    /* Nanoseconds on the monotonic time base. */
+    int64_t mono_ns() const;
+
+    static uint64_t read_tsc();
+    static int64_t os_realtime_ns();
+    static int64_t os_monotonic_ns();
+
+private:
+    struct Anchor {
+        uint64_t tsc;
+        int64_t real_ns;
+        int64_t mono_ns;
+        double ns_per_tick;
+    };
+
+    TscClock();
+    Anchor load_anchor() const;
+    static Anchor anchor_at(uint64_t tsc, int64_t mono_ns, double ns_per_tick);
+    void store_anchor(const Anchor &a);
+
+    bool invariant_ = false;
+    std::atomic<bool> use_tsc_{false};
+    // Seqlock around anchor_: odd while a writer updates it.
+    mutable std::atomic<uint32_t> seq_{0};
+    Anchor anchor_{};
+};
+
+/* Shorthand for the receive timestamp stamped on inbound events. */
+inline int64_t now_ns() { return TscClock::instance().now_ns(); }
+
+} // namespace mt5bridge
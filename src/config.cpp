@@ -0,0 +1,574 @@
+/*
+ * config.cpp
+ *
+ * Option registry, INI/environment parsing and layer resolution for the
+ * bridge configuration.
+ */
+
+#include "config.hpp"
+#include "thread_config.hpp"
+
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace mt5bridge {
+namespace {
+
+enum class OptType { String, UInt, Bool, Double };
+
+struct Option {
+    const char *key;
+    OptType type;
+    bool live;                      // May change after initialization.
+    const char *const *choices;     // Allowed strings, nullptr-terminated.
+    std::string Config::*str;
+    uint64_t Config::*num;
+    bool Config::*flag;
+    double Config::*real;
+    uint64_t min;
+    uint64_t max;
+};
+
+Option str_opt(const char *key, bool live, std::string Config::*member,
+               const char *const *choices = nullptr) {
+    return {key, OptType::String, live, choices, member, nullptr, nullptr, nullptr, 0, 0};
+}
+
+Option num_opt(const char *key, bool live, uint64_t Config::*member,
+               uint64_t min, uint64_t max) {
+    return {key, OptType::UInt, live, nullptr, nullptr, member, nullptr, nullptr, min, max};
+}
+
+Option bool_opt(const char *key, bool live, bool Config::*member) {
+    return {key, OptType::Bool, live, nullptr, nullptr, nullptr, member, nullptr, 0, 1};
+}
+
+/* Non-negative real; min/max are whole-number bounds. */
+Option real_opt(const char *key, bool live, double Config::*member, uint64_t min,
+                uint64_t max) {
+    return {key, OptType::Double, live, nullptr, nullptr, nullptr, nullptr, member, min, max};
+}
+
+const char *const kBackends[] = {"python", "replay", "sim", "backtest", nullptr};
+
+const char *const kDstRules[] = {"none", "eu", "us", nullptr};
+
+const char *const kIsas[] = {"auto", "scalar", "avx2", "avx512", nullptr};
+
+const char *const kCopierRoles[] = {"off", "master", "follower", nullptr};
+
+const char *const kCopierVolumeModes[] = {"multiplier", "fixed", nullptr};
+
+const Option kOptions[] = {
+    str_opt("terminal_path", false, &Config::terminal_path),
+    str_opt("python_home", false, &Config::python_home),
+    num_opt("cache.max_symbols", false, &Config::cache_max_symbols, 1, 1u << 20),
+    num_opt("cache.bars", false, &Config::cache_bars, 1, 1u << 24),
+    num_opt("cache.quote_ttl_ms", true, &Config::cache_quote_ttl_ms, 0, 86400000),
+    num_opt("threads.workers", false, &Config::threads_workers, 0, 1024),
+    num_opt("queue.capacity", false, &Config::queue_capacity, 2, 1u << 30),
+    num_opt("poll.ticks_ms", true, &Config::poll_ticks_ms, 1, 3600000),
+    bool_opt("clock.tsc", false, &Config::clock_tsc),
+    num_opt("clock.reanchor_ms", false, &Config::clock_reanchor_ms, 0, 3600000),
+    str_opt("time.dst_rule", false, &Config::time_dst_rule, kDstRules),
+    str_opt("time.base_offset_s", false, &Config::time_base_offset_s),
+    num_opt("time.offset_window_s", false, &Config::time_offset_window_s, 10, 86400),
+    str_opt("backend", false, &Config::backend, kBackends),
+    str_opt("journal.record", false, &Config::journal_record),
+    str_opt("journal.replay", false, &Config::journal_replay),
+    real_opt("replay.speed", false, &Config::replay_speed, 0, 1000000),
+    num_opt("sim.symbols", false, &Config::sim_symbols, 1, 100000),
+    num_opt("sim.tick_rate", false, &Config::sim_tick_rate, 1, 1000000000),
+    num_opt("sim.seed", false, &Config::sim_seed, 0, 0xFFFFFFFFu),
+    real_opt("sim.volatility", false, &Config::sim_volatility, 0, 10),
+    num_opt("sim.spread_points", false, &Config::sim_spread_points, 0, 1000000),
+    num_opt("sim.slippage_points", false, &Config::sim_slippage_points, 0, 1000000),
+    num_opt("sim.fill_latency_us", false, &Config::sim_fill_latency_us, 0, 60000000),
+    str_opt("history.dir", false, &Config::history_dir),
+    str_opt("backtest.symbols", false, &Config::backtest_symbols),
+    num_opt("backtest.from", false, &Config::backtest_from, 0, 1ull << 40),
+    num_opt("backtest.to", false, &Config::backtest_to, 0, 1ull << 40),
+    num_opt("backtest.spread_points", false, &Config::backtest_spread_points, 0, 1000000),
+    num_opt("backtest.slippage_points", false, &Config::backtest_slippage_points, 0, 1000000),
+    num_opt("backtest.seed", false, &Config::backtest_seed, 0, 0xFFFFFFFFu),
+    real_opt("backtest.commission_per_lot", false, &Config::backtest_commission_per_lot, 0, 1000000),
+    real_opt("backtest.commission_rate", false, &Config::backtest_commission_rate, 0, 1),
+    real_opt("backtest.balance", false, &Config::backtest_balance, 0, 1000000000000ull),
+    real_opt("backtest.contract_size", false, &Config::backtest_contract_size, 0, 1000000000),
+    bool_opt("integrity.enabled", true, &Config::integrity_enabled),
+    num_opt("integrity.gap_ms", true, &Config::integrity_gap_ms, 0, 86400000),
+    str_opt("indicators.isa", true, &Config::indicators_isa, kIsas),
+    str_opt("copier.role", false, &Config::copier_role, kCopierRoles),
+    str_opt("copier.channel", false, &Config::copier_channel),
+    num_opt("copier.slots", false, &Config::copier_slots, 16, 1u << 20),
+    str_opt("copier.name", false, &Config::copier_name),
+    str_opt("copier.volume_mode", false, &Config::copier_volume_mode, kCopierVolumeModes),
+    real_opt("copier.volume", false, &Config::copier_volume, 0, 1000000),
+    real_opt("copier.volume_step", false, &Config::copier_volume_step, 0, 1000000),
+    real_opt("copier.volume_min", false, &Config::copier_volume_min, 0, 1000000),
+    real_opt("copier.volume_max", false, &Config::copier_volume_max, 0, 1000000),
+    str_opt("copier.symbol_suffix", false, &Config::copier_symbol_suffix),
+    num_opt("copier.deviation", false, &Config::copier_deviation, 0, 1000000),
+    num_opt("copier.magic", false, &Config::copier_magic, 0, 1ull << 62),
+    str_opt("portfolio.currency", true, &Config::portfolio_currency),
+};
+
+const char *const kThreadFields[] = {"cpus", "sched", "priority", "wait", "spin_us"};
+
+enum Layer { kFile, kEnv, kApi, kLayerCount };
+const char *const kLayerNames[kLayerCount] = {"file", "env", "api"};
+
+using ThreadPolicies = std::array<ThreadPolicy, static_cast<size_t>(ThreadRole::Count)>;
+
+std::mutex g_mutex;
+std::map<std::string, std::string> g_layers[kLayerCount];
+bool g_file_loaded = false;         // Set by an explicit config_load_file().
+bool g_frozen = false;
+Config g_config;
+std::map<std::string, std::string> g_sources; // key -> layer name
+
+const Option *find_option(const std::string &key) {
+    for (const auto &opt : kOptions)
+        if (key == opt.key)
+            return &opt;
+    return nullptr;
+}
+
+std::string trim(const std::string &s) {
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b])))
+        ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1])))
+        --e;
+    return s.substr(b, e - b);
+}
+
+/* Value of an ini line: a ';' or '#' at its start or after whitespace
+ * begins a comment unless inside double quotes, which are removed.
+ */
+std::string ini_value(const std::string &raw) {
+    bool quoted = false;
+    size_t end = raw.size();
+    for (size_t i = 0; i < raw.size(); ++i) {
+        const char c = raw[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (!quoted && (c == ';' || c == '#') &&
+                   (i == 0 || std::isspace(static_cast<unsigned char>(raw[i - 1])))) {
+            end = i;
+            break;
+        }
+    }
+    std::string value = trim(raw.substr(0, end));
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        value = value.substr(1, value.size() - 2);
+    return value;
+}
+
+std::string env_name(const std::string &key) {
+    std::string name = "MT5BRIDGE_";
+    for (char c : key)
+        name += c == '.' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return name;
+}
+
+bool parse_uint(const std::string &value, uint64_t &out) {
+    if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])))
+        return false;
+    errno = 0;
+    char *end = nullptr;
+    unsigned long long v = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0')
+        return false;
+    out = v;
+    return true;
+}
+
+bool parse_bool(const std::string &value, bool &out) {
+    static const char *const kTrue[] = {"1", "true", "on", "yes"};
+    static const char *const kFalse[] = {"0", "false", "off", "no"};
+    for (const char *t : kTrue)
+        if (value == t)
+            return out = true, true;
+    for (const char *f : kFalse)
+        if (value == f)
+            return out = false, true;
+    return false;
+}
+
+/* Applies "thread.<role>.<field>" by converting it to the JSON form
+ * accepted by thread_policy_from_json, so both paths share validation.
+ */
+bool apply_thread_key(ThreadPolicies &policies, const std::string &key,
+                      const std::string &value, std::string &error) {
+    size_t dot = key.find('.', 7);
+    if (dot == std::string::npos) {
+        error = "unknown configuration key: " + key;
+        return false;
+    }
+    std::string role_name = key.substr(7, dot - 7);
+    std::string field = key.substr(dot + 1);
+
+    ThreadRole role;
+    if (!parse_thread_role(role_name.c_str(), role)) {
+        error = "unknown thread role in " + key;
+        return false;
+    }
+
+    json_t *obj = json_object();
+    if (field == "cpus") {
+        json_t *cpus = json_array();
+        size_t pos = 0;
+        while (pos <= value.size() && !value.empty()) {
+            size_t comma = value.find(',', pos);
+            std::string item = trim(value.substr(pos, comma - pos));
+            uint64_t cpu = 0;
+            if (!parse_uint(item, cpu)) {
+                json_decref(cpus);
+                json_decref(obj);
+                error = key + ": expected comma-separated CPU indices";
+                return false;
+            }
+            json_array_append_new(cpus, json_integer(static_cast<json_int_t>(cpu)));
+            if (comma == std::string::npos)
+                break;
+            pos = comma + 1;
+        }
+        json_object_set_new(obj, "cpus", cpus);
+    } else if (field == "sched" || field == "wait") {
+        json_object_set_new(obj, field.c_str(), json_string(value.c_str()));
+    } else if (field == "priority") {
+        char *end = nullptr;
+        long v = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            json_decref(obj);
+            error = key + ": expected an integer";
+            return false;
+        }
+        json_object_set_new(obj, "priority", json_integer(v));
+    } else if (field == "spin_us") {
+        uint64_t v = 0;
+        if (!parse_uint(value, v)) {
+            json_decref(obj);
+            error = key + ": expected a non-negative integer";
+            return false;
+        }
+        json_object_set_new(obj, "spin_us", json_integer(static_cast<json_int_t>(v)));
+    } else {
+        json_decref(obj);
+        error = "unknown configuration key: " + key;
+        return false;
+    }
+
+    std::string perr;
+    bool ok = thread_policy_from_json(obj, policies[static_cast<size_t>(role)], perr);
+    json_decref(obj);
+    if (!ok)
+        error = key + ": " + perr;
+    return ok;
+}
+
+bool apply_value(Config &cfg, ThreadPolicies &policies, const std::string &key,
+                 const std::string &value, std::string &error) {
+    if (key.compare(0, 7, "thread.") == 0)
+        return apply_thread_key(policies, key, value, error);
+
+    const Option *opt = find_option(key);
+    if (!opt) {
+        error = "unknown configuration key: " + key;
+        return false;
+    }
+
+    switch (opt->type) {
+    case OptType::String:
+        if (opt->choices) {
+            bool found = false;
+            std::string allowed;
+            for (const char *const *c = opt->choices; *c; ++c) {
+                found = found || value == *c;
+                allowed += (allowed.empty() ? "" : ", ") + std::string(*c);
+            }
+            if (!found) {
+                error = key + ": expected one of " + allowed;
+                return false;
+            }
+        }
+        cfg.*(opt->str) = value;
+        return true;
+    case OptType::UInt: {
+        uint64_t v = 0;
+        if (!parse_uint(value, v)) {
+            error = key + ": expected a non-negative integer";
+            return false;
+        }
+        if (v < opt->min || v > opt->max) {
+            error = key + ": value out of range [" + std::to_string(opt->min) +
+                    ", " + std::to_string(opt->max) + "]";
+            return false;
+        }
+        cfg.*(opt->num) = v;
+        return true;
+    }
+    case OptType::Bool: {
+        bool v = false;
+        if (!parse_bool(value, v)) {
+            error = key + ": expected true/false";
+            return false;
+        }
+        cfg.*(opt->flag) = v;
+        return true;
+    }
+    case OptType::Double: {
+        char *end = nullptr;
+        errno = 0;
+        double v = std::strtod(value.c_str(), &end);
+        if (value.empty() || errno != 0 || *end != '\0') {
+            error = key + ": expected a number";
+            return false;
+        }
+        if (!(v >= static_cast<double>(opt->min) && v <= static_cast<double>(opt->max))) {
+            error = key + ": value out of range [" + std::to_string(opt->min) +
+                    ", " + std::to_string(opt->max) + "]";
+            return false;
+        }
+        cfg.*(opt->real) = v;
+        return true;
+    }
+    }
+    return false;
+}
+
+/* Cross-field checks that cannot be expressed as per-key ranges. */
+bool validate(const Config &cfg, std::string &error) {
+    if ((cfg.queue_capacity & (cfg.queue_capacity - 1)) != 0) {
+        error = "queue.capacity must be a power of two";
+        return false;
+    }
+    return true;
+}
+
+bool load_file_locked(const std::string &path, std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open configuration file: " + path;
+        return false;
+    }
+
+    std::map<std::string, std::string> values;
+    std::string line, section;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';')
+            continue;
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                error = path + ":" + std::to_string(lineno) + ": malformed section";
+                return false;
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = path + ":" + std::to_string(lineno) + ": expected key=value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, eq));
+        if (!section.empty())
+            key = section + "." + key;
+        values[key] = ini_value(line.substr(eq + 1));
+    }
+
+    // Validate against a scratch configuration so a bad file is rejected
+    // as a whole with the offending line's key in the message.
+    Config scratch;
+    ThreadPolicies policies;
+    for (const auto &kv : values) {
+        if (!apply_value(scratch, policies, kv.first, kv.second, error)) {
+            error = path + ": " + error;
+            return false;
+        }
+    }
+
+    g_layers[kFile] = std::move(values);
+    return true;
+}
+
+void load_env_locked() {
+    g_layers[kEnv].clear();
+    auto probe = [](const std::string &key) {
+        if (const char *v = std::getenv(env_name(key).c_str()))
+            g_layers[kEnv][key] = v;
+    };
+    for (const auto &opt : kOptions)
+        probe(opt.key);
+    for (size_t r = 0; r < static_cast<size_t>(ThreadRole::Count); ++r)
+        for (const char *field : kThreadFields)
+            probe(std::string("thread.") + to_string(static_cast<ThreadRole>(r)) +
+                  "." + field);
+}
+
+} // namespace
+
+bool config_load_file(const std::string &path, std::string &error) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!load_file_locked(path, error))
+        return false;
+    g_file_loaded = true;
+    return true;
+}
+
+bool config_set(const std::string &key, const std::string &value,
+                std::string &error) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    bool thread_key = key.compare(0, 7, "thread.") == 0;
+    const Option *opt = thread_key ? nullptr : find_option(key);
+    if (g_frozen && opt && !opt->live) {
+        error = key + " cannot be changed while the bridge is initialized";
+        return false;
+    }
+
+    Config cfg = g_config;
+    ThreadPolicies policies;
+    for (size_t r = 0; r < policies.size(); ++r)
+        policies[r] = thread_policy(static_cast<ThreadRole>(r));
+    if (!apply_value(cfg, policies, key, value, error) || !validate(cfg, error))
+        return false;
+
+    g_layers[kApi][key] = value;
+    if (thread_key) {
+        for (size_t r = 0; r < policies.size(); ++r)
+            set_thread_policy(static_cast<ThreadRole>(r), policies[r]);
+    }
+    if (g_frozen) {
+        g_config = cfg;
+        g_sources[key] = kLayerNames[kApi];
+    }
+    return true;
+}
+
+bool config_set_thread_policy(ThreadRole role, const ThreadPolicy &policy,
+                              std::string &error) {
+    json_t *obj = thread_policy_to_json(policy);
+    ThreadPolicy checked;
+    bool ok = thread_policy_from_json(obj, checked, error);
+    if (ok) {
+        // Stored field by field so the file/env layers and config_to_json
+        // see the same keys; validated above as a whole because individual
+        // fields (sched vs. priority) depend on each other.
+        std::string cpus;
+        for (int cpu : policy.cpus)
+            cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+        std::string prefix = std::string("thread.") + to_string(role) + ".";
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto &api = g_layers[kApi];
+        api[prefix + "cpus"] = cpus;
+        api[prefix + "sched"] = json_string_value(json_object_get(obj, "sched"));
+        api[prefix + "priority"] = std::to_string(policy.priority);
+        api[prefix + "wait"] = json_string_value(json_object_get(obj, "wait"));
+        api[prefix + "spin_us"] = std::to_string(policy.spin_us);
+        set_thread_policy(role, checked);
+    }
+    json_decref(obj);
+    return ok;
+}
+
+bool config_resolve(std::string &error) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    if (!g_file_loaded) {
+        if (const char *path = std::getenv("MT5BRIDGE_CONFIG")) {
+            if (!load_file_locked(path, error))
+                return false;
+        } else if (std::ifstream("bridge.ini")) {
+            if (!load_file_locked("bridge.ini", error))
+                return false;
+        }
+    }
+    load_env_locked();
+
+    Config cfg;
+    ThreadPolicies policies;
+    std::map<std::string, std::string> sources;
+    for (int layer = 0; layer < kLayerCount; ++layer) {
+        for (const auto &kv : g_layers[layer]) {
+            if (!apply_value(cfg, policies, kv.first, kv.second, error)) {
+                error = std::string(kLayerNames[layer]) + ": " + error;
+                return false;
+            }
+            sources[kv.first] = kLayerNames[layer];
+        }
+    }
+    if (!validate(cfg, error))
+        return false;
+
+    g_config = cfg;
+    g_sources = std::move(sources);
+    for (size_t r = 0; r < policies.size(); ++r)
+        set_thread_policy(static_cast<ThreadRole>(r), policies[r]);
+    return true;
+}
+
+void config_freeze(bool frozen) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_frozen = frozen;
+}
+
+Config config() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_config;
+}
+
+json_t *config_to_json() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    auto source_of = [](const std::string &key) {
+        auto it = g_sources.find(key);
+        return it == g_sources.end() ? "default" : it->second.c_str();
+    };
+
+    json_t *root = json_object();
+    for (const auto &opt : kOptions) {
+        json_t *value = nullptr;
+        switch (opt.type) {
+        case OptType::String:
+            value = json_string((g_config.*(opt.str)).c_str());
+            break;
+        case OptType::UInt:
+            value = json_integer(static_cast<json_int_t>(g_config.*(opt.num)));
+            break;
+        case OptType::Bool:
+            value = json_boolean(g_config.*(opt.flag));
+            break;
+        case OptType::Double:
+            value = json_real(g_config.*(opt.real));
+            break;
+        }
+        json_t *entry = json_object();
+        json_object_set_new(entry, "value", value);
+        json_object_set_new(entry, "source", json_string(source_of(opt.key)));
+        json_object_set_new(entry, "live", json_boolean(opt.live));
+        json_object_set_new(root, opt.key, entry);
+    }
+
+    json_t *threads = json_object();
+    for (size_t r = 0; r < static_cast<size_t>(ThreadRole::Count); ++r) {
+        ThreadRole role = static_cast<ThreadRole>(r);
+        json_object_set_new(threads, to_string(role),
+                            thread_policy_to_json(thread_policy(role)));
+    }
+    json_object_set_new(root, "thread", threads);
+    return root;
+}
+
+} // namespace mt5bridge
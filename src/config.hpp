@@ -0,0 +1,126 @@
+/*
+ * config.hpp
+ *
+ * Bridge configuration resolved from layered sources.
+ *
+ * Every tunable is registered under a dotted key (e.g. "poll.ticks_ms").
+ * Values are taken, in increasing precedence, from built-in defaults, an
+ * INI file (bridge.ini), MT5BRIDGE_* environment variables and
+ * programmatic overrides. The effective configuration is validated when
+ * the bridge initializes; afterwards only keys marked live may change.
+ *
+ * Thread policies are configured through "thread.<role>.<field>" keys,
+ * e.g. "thread.quote_poller.cpus=2,3" (see thread_config.hpp).
+ */
+
+#pragma once
+
+#include "thread_config.hpp"
+
+#include <jansson.h>
+
+#include <cstdint>
+#include <string>
+
+namespace mt5bridge {
+
+struct Config {
+    std::string terminal_path;          // terminal64.exe or its folder.
+    std::string python_home;            // Embedded runtime location.
+
+    uint64_t cache_max_symbols = 4096;  // Per-symbol native state capacity.
+    uint64_t cache_bars = 1000;         // Bars kept per (symbol, timeframe).
+    uint64_t cache_quote_ttl_ms = 250;  // Age after which a cached quote is stale; 0 = never.
+
+    uint64_t threads_workers = 0;       // Compute workers; 0 = one per core.
+
+    uint64_t queue_capacity = 65536;    // Event queue slots; power of two.
+
+    uint64_t poll_ticks_ms = 100;       // Tick polling interval.
+
+    bool clock_tsc = true;              // Stamp events from the TSC when invariant.
+    uint64_t clock_reanchor_ms = 1000;  // TSC re-anchoring period; 0 = never.
+
+    std::string time_dst_rule = "none"; // Server DST calendar: none, eu, us.
+    std::string time_base_offset_s;     // Fixed server offset; empty = estimate.
+    uint64_t time_offset_window_s = 600; // Offset estimation window.
+
+    std::string backend = "python";     // python, replay, sim or backtest.
+    std::string journal_record;         // Journal written while running; empty = off.
+    std::string journal_replay;         // Journal served by backend=replay.
+    double replay_speed = 0.0;          // Recorded latency divisor; 0 = no delay.
+
+    uint64_t sim_symbols = 16;          // Synthetic symbols SIM0000, SIM0001, ...
+    uint64_t sim_tick_rate = 10000;     // Ticks per second across all symbols.
+    uint64_t sim_seed = 1;              // Same seed, same prices.
+    double sim_volatility = 0.01;       // Daily standard deviation of log price.
+    uint64_t sim_spread_points = 10;    // Typical spread.
+    uint64_t sim_slippage_points = 0;   // Largest adverse fill slippage.
+    uint64_t sim_fill_latency_us = 0;   // Delay before an order is filled.
+
+    std::string history_dir = "history"; // Files written by "save": true requests.
+
+    std::string backtest_symbols;       // Comma list; empty = every *.ticks file.
+    uint64_t backtest_from = 0;         // First server second replayed; 0 = start.
+    uint64_t backtest_to = 0;           // Last server second replayed; 0 = end.
+    uint64_t backtest_spread_points = 0; // Fixed spread; 0 = recorded quotes.
+    uint64_t backtest_slippage_points = 0; // Largest adverse fill slippage.
+    uint64_t backtest_seed = 1;         // Slippage draws.
+    double backtest_commission_per_lot = 0.0; // Per lot and side.
+    double backtest_commission_rate = 0.0;    // Fraction of notional per side.
+    double backtest_balance = 10000.0;  // Starting balance.
+    double backtest_contract_size = 100000.0; // Units per lot.
+
+    bool integrity_enabled = true;      // Dedup/sequence polled tick streams.
+    uint64_t integrity_gap_ms = 60000;  // Silence flagged as a gap; 0 = off.
+
+    std::string indicators_isa = "auto"; // Indicator kernels: auto, scalar, avx2, avx512.
+
+    std::string copier_role = "off";    // Trade copier side: off, master, follower.
+    std::string copier_channel;         // File shared by master and followers.
+    uint64_t copier_slots = 4096;       // Deal signals the channel holds.
+    std::string copier_name;            // Follower name, unique per channel.
+    std::string copier_volume_mode = "multiplier"; // multiplier or fixed.
+    double copier_volume = 1.0;         // Multiplier, or fixed lots.
+    double copier_volume_step = 0.01;   // Follower lot step.
+    double copier_volume_min = 0.01;    // Smaller copies are skipped.
+    double copier_volume_max = 100.0;   // Larger copies are capped.
+    std::string copier_symbol_suffix;   // Appended to master symbols.
+    uint64_t copier_deviation = 20;     // Follower order deviation, points.
+    uint64_t copier_magic = 0;          // Magic of follower orders.
+
+    std::string portfolio_currency = "USD"; // Account currency of the portfolio engine.
+};
+
+/* Loads an INI file into the file layer, replacing a previously loaded
+ * one. Lines are "key=value"; "[section]" prefixes following keys with
+ * "section."; '#' and ';' start comments.
+ */
+bool config_load_file(const std::string &path, std::string &error);
+
+/* Sets a programmatic override. The value is validated immediately. */
+bool config_set(const std::string &key, const std::string &value,
+                std::string &error);
+
+/* Stores a whole thread policy as programmatic "thread.<role>.*" overrides
+ * and applies it to threads started from now on.
+ */
+bool config_set_thread_policy(ThreadRole role, const ThreadPolicy &policy,
+                              std::string &error);
+
+/* Resolves all layers into the effective configuration and applies the
+ * configured thread policies. Called by mt5bridge_initialize; loads
+ * $MT5BRIDGE_CONFIG or ./bridge.ini unless a file was loaded explicitly.
+ */
+bool config_resolve(std::string &error);
+
+/* Marks the configuration as in use; non-live keys become read-only. */
+void config_freeze(bool frozen);
+
+/* Returns a copy of the effective configuration. */
+Config config();
+
+/* Returns {"key": {"value": ..., "source": "default|file|env|api"}, ...}. */
+json_t *config_to_json();
+
+} // namespace mt5bridge
@@ -0,0 +1,638 @@
+/*
+ * copier.cpp
+ *
+ * Shared copy channel, master publishing and follower copying.
+ */
+
+#include "copier.hpp"
+
+#include "clock.hpp"
+#include "responses.hpp"
+#include "thread_config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mt5bridge {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'T', '5', 'B', 'C', 'P', 'Y', '\0'};
+constexpr uint32_t kVersion = 2;
+constexpr size_t kMaxPublished = 1 << 16;   // Deal tickets remembered by the master.
+constexpr uint32_t kMaxCopies = 64;         // Open copies a follower row tracks.
+constexpr int64_t kHistoryWindowS = 2 * 86400;
+constexpr auto kSleepStep = std::chrono::microseconds(100);
+
+constexpr int32_t kActionDeal = 1;      // TRADE_ACTION_DEAL
+constexpr uint32_t kRetcodeDone = 10009;
+constexpr uint32_t kRetcodeDonePartial = 10010;
+constexpr int32_t kEntryOut = 1;
+constexpr int32_t kEntryOutBy = 3;
+
+struct alignas(64) ChannelHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint32_t followers;
+    uint32_t reserved;
+    std::atomic<uint64_t> published;    // Signals published so far.
+};
+
+/* Follower position opened for a master position; written only by the
+ * follower owning the row. */
+struct PositionCopy {
+    uint64_t master;            // Master position; 0 if the entry is free.
+    uint64_t ticket;
+    double volume;
+    double master_volume;       // Of the master position, to spot full closes.
+};
+
+struct alignas(64) FollowerRow {
+    std::atomic<uint32_t> used;
+    char name[32];
+    std::atomic<uint64_t> next;         // Next signal to copy.
+    std::atomic<uint64_t> copied;
+    std::atomic<uint64_t> skipped;
+    std::atomic<uint64_t> failed;
+    std::atomic<uint64_t> missed;
+    std::atomic<int64_t> latency_last_ns;
+    std::atomic<int64_t> latency_sum_ns;
+    std::atomic<int64_t> latency_max_ns;
+    std::atomic<int64_t> seen_ns;       // Last time the follower looked.
+    PositionCopy copies[kMaxCopies];    // Open copies, kept across restarts.
+};
+
+struct alignas(64) SignalSlot {
+    std::atomic<uint64_t> seq;  // 2n + 1 while signal n is written, 2n + 2 after.
+    CopySignal signal;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the channel needs address-free 64-bit atomics");
+
+size_t channel_size(uint32_t slots) {
+    return sizeof(ChannelHeader) + Copier::kMaxFollowers * sizeof(FollowerRow) +
+           static_cast<size_t>(slots) * sizeof(SignalSlot);
+}
+
+void copy_name(char (&out)[32], const char *name) {
+    std::memset(out, 0, sizeof out);
+    if (name)
+        std::strncpy(out, name, sizeof out - 1);
+}
+
+json_t *us(int64_t ns) { return json_real(static_cast<double>(ns) / 1e3); }
+
+} // namespace
+
+/* Read-write mapping of the channel file. */
+struct Copier::Channel {
+    unsigned char *data = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    ~Channel() {
+#if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap(data, size);
+#endif
+    }
+
+    /* Maps path, growing the file to at least size bytes if create. */
+    bool map(const std::string &path, size_t bytes, bool create, std::string &error) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            error = "cannot open copy channel " + path;
+            return false;
+        }
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(file, &current)) {
+            error = "cannot stat copy channel " + path;
+            return false;
+        }
+        size = std::max(bytes, static_cast<size_t>(current.QuadPart));
+        if (size == 0 || (!create && static_cast<size_t>(current.QuadPart) < bytes)) {
+            error = "copy channel " + path + " is not set up by a master";
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                                     static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                     static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+        if (!mapping) {
+            error = "cannot map copy channel " + path;
+            return false;
+        }
+        data = static_cast<unsigned char *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+#else
+        const int fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+        if (fd < 0) {
+            error = "cannot open copy channel " + path;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            error = "cannot stat copy channel " + path;
+            return false;
+        }
+        const size_t current = static_cast<size_t>(st.st_size);
+        if (!create && current < bytes) {
+            ::close(fd);
+            error = "copy channel " + path + " is not set up by a master";
+            return false;
+        }
+        if (current < bytes && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            error = "cannot size copy channel " + path;
+            return false;
+        }
+        size = std::max(bytes, current);
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        data = p == MAP_FAILED ? nullptr : static_cast<unsigned char *>(p);
+#endif
+        if (!data) {
+            error = "cannot map copy channel " + path;
+            return false;
+        }
+        return true;
+    }
+
+    /* Laid out by a master of this bridge version. */
+    bool valid() {
+        const ChannelHeader &h = header();
+        return std::memcmp(h.magic, kMagic, sizeof kMagic) == 0 && h.version == kVersion &&
+               h.followers == kMaxFollowers && size >= channel_size(h.slots);
+    }
+
+    ChannelHeader &header() { return *reinterpret_cast<ChannelHeader *>(data); }
+    FollowerRow &row(uint32_t i) {
+        return reinterpret_cast<FollowerRow *>(data + sizeof(ChannelHeader))[i];
+    }
+    SignalSlot &slot(uint64_t n) {
+        auto *slots = reinterpret_cast<SignalSlot *>(data + sizeof(ChannelHeader) +
+                                                     kMaxFollowers * sizeof(FollowerRow));
+        return slots[n % header().slots];
+    }
+};
+
+Copier::Copier() = default;
+Copier::~Copier() = default;
+
+Copier &Copier::instance() {
+    static Copier copier;
+    return copier;
+}
+
+bool Copier::open(std::string &error) {
+    if (channel_)
+        return true;
+    config_ = config();
+    if (config_.copier_role == "off") {
+        error = "copier.role is off";
+        return false;
+    }
+    if (config_.copier_channel.empty()) {
+        error = "copier.channel is not set";
+        return false;
+    }
+    const bool master = config_.copier_role == "master";
+    if (!master && config_.copier_name.empty()) {
+        error = "copier.name is not set";
+        return false;
+    }
+    auto channel = std::make_shared<Channel>();
+    const uint32_t slots = static_cast<uint32_t>(config_.copier_slots);
+    if (!channel->map(config_.copier_channel, master ? channel_size(slots) : sizeof(ChannelHeader),
+                      master, error))
+        return false;
+    ChannelHeader &h = channel->header();
+    const bool valid = channel->valid();
+    if (master) {
+        if (!valid || h.slots != slots) {
+            // New or incompatible channel: lay it out afresh.
+            std::memset(channel->data, 0, channel_size(slots));
+            h.version = kVersion;
+            h.slots = slots;
+            h.followers = kMaxFollowers;
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(h.magic, kMagic, sizeof kMagic);
+        }
+        channel_ = std::move(channel);
+        return true;
+    }
+    if (!valid) {
+        error = "copy channel " + config_.copier_channel + " is not set up by a master";
+        return false;
+    }
+    // Resume our row, or claim a free one starting at the next signal.
+    for (uint32_t i = 0; i < kMaxFollowers; ++i) {
+        FollowerRow &r = channel->row(i);
+        if (r.used.load(std::memory_order_acquire) &&
+            std::strncmp(r.name, config_.copier_name.c_str(), sizeof r.name - 1) == 0) {
+            follower_ = i;
+            channel_ = std::move(channel);
+            return true;
+        }
+    }
+    for (uint32_t i = 0; i < kMaxFollowers; ++i) {
+        FollowerRow &r = channel->row(i);
+        uint32_t expected = 0;
+        if (r.used.load(std::memory_order_relaxed) ||
+            !r.used.compare_exchange_strong(expected, 2, std::memory_order_acq_rel))
+            continue;
+        copy_name(r.name, config_.copier_name.c_str());
+        r.next.store(h.published.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::memset(r.copies, 0, sizeof r.copies);
+        r.used.store(1, std::memory_order_release);
+        follower_ = i;
+        channel_ = std::move(channel);
+        return true;
+    }
+    error = "copy channel has no free follower row (" + std::to_string(kMaxFollowers) + ")";
+    return false;
+}
+
+void Copier::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channel_.reset();
+    published_.clear();
+    published_order_.clear();
+    history_seen_ = false;
+}
+
+void Copier::publish(const CopySignal &signal) {
+    if (signal.deal && !published_.insert(signal.deal).second)
+        return;
+    if (signal.deal) {
+        published_order_.push_back(signal.deal);
+        if (published_order_.size() > kMaxPublished) {
+            published_.erase(published_order_.front());
+            published_order_.pop_front();
+        }
+    }
+    ChannelHeader &h = channel_->header();
+    const uint64_t n = h.published.load(std::memory_order_relaxed);
+    SignalSlot &s = channel_->slot(n);
+    s.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.signal = signal;
+    s.seq.store(2 * n + 2, std::memory_order_release);
+    h.published.store(n + 1, std::memory_order_release);
+}
+
+void Copier::on_order(const json_t *request, const json_t *answer) {
+    if (!json_is_object(request) || !json_is_object(answer))
+        return;
+    long long retcode = 0, deal = 0, order = 0, type = -1, position = 0;
+    req_int(answer, "retcode", retcode);
+    req_int(answer, "deal", deal);
+    if ((retcode != kRetcodeDone && retcode != kRetcodeDonePartial) || deal == 0)
+        return;
+    req_int(answer, "order", order);
+    req_int(request, "type", type);
+    req_int(request, "position", position);
+    const char *symbol = req_string(request, "symbol");
+    if ((type != 0 && type != 1) || !symbol)
+        return;
+    CopySignal signal;
+    signal.deal = static_cast<uint64_t>(deal);
+    signal.position = static_cast<uint64_t>(position ? position : order);
+    signal.type = static_cast<int32_t>(type);
+    signal.entry = position ? kEntryOut : 0;
+    req_number(answer, "volume", signal.volume);
+    req_number(answer, "price", signal.price);
+    long long recv_ns = 0;
+    signal.seen_ns = req_int(answer, "recv_ns", recv_ns) && recv_ns ? recv_ns : now_ns();
+    copy_name(signal.symbol, symbol);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!channel_ && config().copier_role != "master")
+        return;
+    std::string err;
+    if (open(err) && config_.copier_role == "master")
+        publish(signal);
+}
+
+void Copier::on_order(const mt5bridge_trade_request &request,
+                      const mt5bridge_trade_result &result) {
+    if ((result.retcode != kRetcodeDone && result.retcode != kRetcodeDonePartial) ||
+        !result.deal || (request.type != 0 && request.type != 1) || !request.symbol)
+        return;
+    CopySignal signal;
+    signal.deal = result.deal;
+    signal.position = request.position ? request.position : result.order;
+    signal.type = request.type;
+    signal.entry = request.position ? kEntryOut : 0;
+    signal.volume = result.volume;
+    signal.price = result.price;
+    signal.seen_ns = result.recv_ns ? result.recv_ns : now_ns();
+    copy_name(signal.symbol, request.symbol);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!channel_ && config().copier_role != "master")
+        return;
+    std::string err;
+    if (open(err) && config_.copier_role == "master")
+        publish(signal);
+}
+
+int64_t Copier::poll(Backend &backend, std::string &error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open(error))
+        return -1;
+    if (config_.copier_role != "master") {
+        error = "copier poll needs copier.role=master";
+        return -1;
+    }
+    // Server time is within a day of UTC, so two days either side cover
+    // every recent deal.
+    const int64_t now_s = now_ns() / 1000000000;
+    json_t *req = json_pack("{s:s, s:I, s:I}", "method", "history_deals_get", "date_from",
+                            static_cast<json_int_t>(now_s - kHistoryWindowS), "date_to",
+                            static_cast<json_int_t>(now_s + kHistoryWindowS));
+    json_t *deals = backend.eval("history_deals_get", req, error);
+    json_decref(req);
+    if (!deals)
+        return -1;
+    error.clear();
+    const int64_t seen = now_ns();
+    int64_t count = 0;
+    size_t i;
+    json_t *d;
+    json_array_foreach(deals, i, d) {
+        long long ticket = 0, type = -1, entry = 0, position = 0, time_msc = 0;
+        req_int(d, "ticket", ticket);
+        req_int(d, "type", type);
+        const char *symbol = req_string(d, "symbol");
+        if (!ticket || (type != 0 && type != 1) || !symbol || !*symbol)
+            continue;
+        if (!history_seen_) {
+            // The first scan only learns what predates the copier.
+            published_.insert(static_cast<uint64_t>(ticket));
+            published_order_.push_back(static_cast<uint64_t>(ticket));
+            continue;
+        }
+        if (published_.count(static_cast<uint64_t>(ticket)))
+            continue;
+        req_int(d, "entry", entry);
+        req_int(d, "position_id", position);
+        req_int(d, "time_msc", time_msc);
+        CopySignal signal;
+        signal.deal = static_cast<uint64_t>(ticket);
+        signal.position = static_cast<uint64_t>(position);
+        signal.type = static_cast<int32_t>(type);
+        signal.entry = static_cast<int32_t>(entry);
+        req_number(d, "volume", signal.volume);
+        req_number(d, "price", signal.price);
+        signal.time_msc = time_msc;
+        signal.seen_ns = seen;
+        copy_name(signal.symbol, symbol);
+        publish(signal);
+        ++count;
+    }
+    json_decref(deals);
+    history_seen_ = true;
+    return count;
+}
+
+bool Copier::copy(Backend &backend, const CopySignal &signal, int64_t &latency_ns,
+                  bool &skipped) {
+    skipped = false;
+    if (signal.type != 0 && signal.type != 1) {
+        skipped = true;
+        return true;
+    }
+    const Config &c = config_;
+    const bool closing = signal.entry == kEntryOut || signal.entry == kEntryOutBy;
+    PositionCopy *copies = channel_->row(follower_).copies;
+    PositionCopy *it = nullptr;
+    for (uint32_t i = 0; signal.position && i < kMaxCopies; ++i) {
+        if (copies[i].master == signal.position) {
+            it = &copies[i];
+            break;
+        }
+    }
+    if (closing && !it) {
+        // Nothing of ours to close; sending the deal would open a position.
+        skipped = true;
+        return true;
+    }
+    PositionCopy *slot = it;
+    for (uint32_t i = 0; !slot && signal.position && i < kMaxCopies; ++i) {
+        if (!copies[i].master)
+            slot = &copies[i];
+    }
+    if (signal.position && !slot) {
+        // No room to remember the copy, and so to close it later.
+        skipped = true;
+        return true;
+    }
+    double volume = c.copier_volume_mode == "fixed" ? c.copier_volume
+                                                    : signal.volume * c.copier_volume;
+    if (c.copier_volume_step > 0)
+        volume = std::floor(volume / c.copier_volume_step + 1e-9) * c.copier_volume_step;
+    volume = std::min(volume, c.copier_volume_max);
+    if (closing) {
+        // A full close of the master position closes all of ours.
+        volume = signal.volume >= it->master_volume - 1e-9 ? it->volume
+                                                           : std::min(volume, it->volume);
+    }
+    if (volume < c.copier_volume_min - 1e-9 || volume <= 0) {
+        skipped = true;
+        return true;
+    }
+
+    const std::string symbol = std::string(signal.symbol) + c.copier_symbol_suffix;
+    const std::string comment = "copy " + std::to_string(signal.deal);
+    mt5bridge_trade_request req{};
+    req.action = kActionDeal;
+    req.type = signal.type;
+    req.symbol = symbol.c_str();
+    req.volume = volume;
+    req.deviation = static_cast<int32_t>(c.copier_deviation);
+    req.position = closing ? it->ticket : 0;
+    req.magic = c.copier_magic;
+    req.comment = comment.c_str();
+    mt5bridge_trade_result result{};
+    std::string err;
+    const bool sent = backend.order_send(req, result, err);
+    latency_ns = (result.recv_ns ? result.recv_ns : now_ns()) - signal.seen_ns;
+    if (!sent || (result.retcode != kRetcodeDone && result.retcode != kRetcodeDonePartial))
+        return false;
+
+    const double filled = result.volume > 0 ? result.volume : volume;
+    if (closing) {
+        it->volume -= filled;
+        it->master_volume -= signal.volume;
+        if (it->volume <= 1e-9 || it->master_volume <= 1e-9)
+            *it = PositionCopy{};
+    } else if (it) {
+        it->volume += filled;
+        it->master_volume += signal.volume;
+    } else if (slot) {
+        *slot = {signal.position, result.order, filled, signal.volume};
+    }
+    return true;
+}
+
+int64_t Copier::follow(Backend &backend, int64_t timeout_ms, std::string &error) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!open(error))
+        return -1;
+    if (config_.copier_role != "follower") {
+        error = "copier follow needs copier.role=follower";
+        return -1;
+    }
+    // Wait for the next signal without holding the lock; our copy of the
+    // channel keeps it mapped if close() runs meanwhile.
+    const std::shared_ptr<Channel> channel = channel_;
+    const ChannelHeader &waiting = channel->header();
+    const FollowerRow &waiting_row = channel->row(follower_);
+    channel->row(follower_).seen_ns.store(now_ns(), std::memory_order_relaxed);
+    lock.unlock();
+    const ThreadPolicy policy = thread_policy(ThreadRole::QuotePoller);
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0));
+    const auto spin_end =
+        policy.wait == WaitMode::Block ? start : start + std::chrono::microseconds(policy.spin_us);
+    while (waiting_row.next.load(std::memory_order_relaxed) >=
+           waiting.published.load(std::memory_order_acquire)) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return 0;
+        if (policy.wait == WaitMode::Spin || now < spin_end)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(kSleepStep);
+    }
+    lock.lock();
+    if (channel_ != channel) { // Closed, and perhaps opened again.
+        error = "copy channel closed";
+        return -1;
+    }
+    ChannelHeader &h = channel_->header();
+    FollowerRow &row = channel_->row(follower_);
+
+    int64_t handled = 0;
+    const uint64_t slots = h.slots;
+    for (;;) {
+        const uint64_t published = h.published.load(std::memory_order_acquire);
+        uint64_t n = row.next.load(std::memory_order_relaxed);
+        if (n >= published)
+            break;
+        if (published - n > slots) {
+            row.missed.fetch_add(published - slots - n, std::memory_order_relaxed);
+            n = published - slots;
+        }
+        SignalSlot &s = channel_->slot(n);
+        const uint64_t before = s.seq.load(std::memory_order_acquire);
+        CopySignal signal = s.signal;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const bool intact = before == 2 * n + 2 && s.seq.load(std::memory_order_relaxed) == before;
+        // Advance first: a copy is sent at most once, even if we crash.
+        row.next.store(n + 1, std::memory_order_release);
+        ++handled;
+        if (!intact) {
+            row.missed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        int64_t latency = 0;
+        bool skipped = false;
+        if (!copy(backend, signal, latency, skipped)) {
+            row.failed.fetch_add(1, std::memory_order_relaxed);
+        } else if (skipped) {
+            row.skipped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            row.copied.fetch_add(1, std::memory_order_relaxed);
+            row.latency_last_ns.store(latency, std::memory_order_relaxed);
+            row.latency_sum_ns.fetch_add(latency, std::memory_order_relaxed);
+            if (latency > row.latency_max_ns.load(std::memory_order_relaxed))
+                row.latency_max_ns.store(latency, std::memory_order_relaxed);
+        }
+    }
+    row.seen_ns.store(now_ns(), std::memory_order_relaxed);
+    return handled;
+}
+
+json_t *Copier::to_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Without our own mapping, look at the channel as it is.
+    std::shared_ptr<Channel> channel = channel_;
+    const Config c = channel ? config_ : config();
+    std::string err;
+    if (!channel) {
+        channel = std::make_shared<Channel>();
+        if (c.copier_role == "off")
+            err = "copier.role is off";
+        else if (c.copier_channel.empty())
+            err = "copier.channel is not set";
+        else if (channel->map(c.copier_channel, sizeof(ChannelHeader), false, err) &&
+                 !channel->valid())
+            err = "copy channel " + c.copier_channel + " is not set up by a master";
+    }
+    if (!err.empty())
+        return json_pack("{s:s, s:s}", "role", c.copier_role.c_str(), "error", err.c_str());
+    ChannelHeader &h = channel->header();
+    const uint64_t published = h.published.load(std::memory_order_acquire);
+    json_t *followers = json_array();
+    for (uint32_t i = 0; i < kMaxFollowers; ++i) {
+        FollowerRow &r = channel->row(i);
+        if (r.used.load(std::memory_order_acquire) != 1)
+            continue;
+        const uint64_t next = r.next.load(std::memory_order_relaxed);
+        const uint64_t copied = r.copied.load(std::memory_order_relaxed);
+        const int64_t sum = r.latency_sum_ns.load(std::memory_order_relaxed);
+        json_t *f = json_object();
+        json_object_set_new(f, "name", json_stringn(r.name, strnlen(r.name, sizeof r.name)));
+        json_object_set_new(f, "next", json_integer(static_cast<json_int_t>(next)));
+        json_object_set_new(f, "lag", json_integer(static_cast<json_int_t>(
+                                          published > next ? published - next : 0)));
+        json_object_set_new(f, "copied", json_integer(static_cast<json_int_t>(copied)));
+        json_object_set_new(f, "skipped", json_integer(static_cast<json_int_t>(
+                                              r.skipped.load(std::memory_order_relaxed))));
+        json_object_set_new(f, "failed", json_integer(static_cast<json_int_t>(
+                                             r.failed.load(std::memory_order_relaxed))));
+        json_object_set_new(f, "missed", json_integer(static_cast<json_int_t>(
+                                             r.missed.load(std::memory_order_relaxed))));
+        json_object_set_new(f, "latency_last_us",
+                            us(r.latency_last_ns.load(std::memory_order_relaxed)));
+        json_object_set_new(f, "latency_avg_us",
+                            copied ? us(sum / static_cast<int64_t>(copied)) : json_null());
+        json_object_set_new(f, "latency_max_us",
+                            us(r.latency_max_ns.load(std::memory_order_relaxed)));
+        json_object_set_new(f, "seen_ns", json_integer(r.seen_ns.load(std::memory_order_relaxed)));
+        json_array_append_new(followers, f);
+    }
+    return json_pack("{s:s, s:s, s:I, s:I, s:o}", "role", c.copier_role.c_str(), "channel",
+                     c.copier_channel.c_str(), "slots", static_cast<json_int_t>(h.slots),
+                     "published", static_cast<json_int_t>(published), "followers", followers);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,140 @@
+/*
+ * copier.hpp
+ *
+ * Trade copier from one master account to follower accounts, each served
+ * by its own bridge in its own process (one terminal per process).
+ *
+ * The bridges share a copy channel: the file copier.channel, mapped by
+ * every process. It holds a ring of copier.slots deal signals written by
+ * the master and a table of follower states:
+ *
+ *   header      magic "MT5BCPY\0", version, slot and follower counts,
+ *               signals published so far
+ *   followers   kMaxFollowers states: name, next signal, counters, copy
+ *               latencies and the follower's open copies
+ *   slots       deal signals; signal n lives in slot n % slots
+ *
+ * The master (copier.role=master) publishes a deal as soon as the answer
+ * to an order it sent through the bridge comes back (order_send,
+ * open_market_buy or the typed order_send), and poll() scans the deal
+ * history for deals made elsewhere (the terminal, an EA). Deals are
+ * published once, by ticket. Publishing is one slot write however many
+ * followers there are: every follower reads the same slot.
+ *
+ * A follower (copier.role=follower) attaches under copier.name and copies
+ * the signals published after its first attach; after a restart it
+ * resumes at the signal it had reached. follow() waits for signals,
+ * spinning for the quote_poller thread policy's spin budget and then
+ * sleeping in short steps, and sends each copy through the follower's
+ * own backend. Followers run in parallel since each is its own process.
+ * A follower that falls copier.slots signals behind loses the overwritten
+ * ones, which are counted as missed.
+ *
+ * Copies keep the deal's direction. Volume is the master volume times
+ * copier.volume, or copier.volume lots with volume_mode=fixed, rounded
+ * down to copier.volume_step; below copier.volume_min the deal is skipped
+ * and above copier.volume_max it is capped. A deal closing a master
+ * position closes the follower position opened for it and is skipped if
+ * there is none. The follower row keeps which follower position copies
+ * which master position (up to 64 open at once; further opens are
+ * skipped), so a follower resuming under its name after a restart still
+ * closes what it opened before. Copy latency runs from the master bridge seeing the
+ * deal to the follower's order answer, both read from the bridge clock
+ * (UTC nanoseconds), so it is meaningful between processes of one host.
+ *
+ * Slots are written under a sequence number, so a reader never acts on a
+ * slot that is being rewritten.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "config.hpp"
+
+#include <jansson.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace mt5bridge {
+
+/* One master deal, as published to the channel. */
+struct CopySignal {
+    uint64_t deal = 0;
+    uint64_t position = 0;  // Master position the deal opened or closed.
+    int32_t type = 0;       // 0 buy, 1 sell.
+    int32_t entry = 0;      // DEAL_ENTRY_*: 0 in, 1 out, 2 in/out, 3 out by.
+    double volume = 0.0;
+    double price = 0.0;
+    int64_t time_msc = 0;   // Deal time, server milliseconds; 0 if unknown.
+    int64_t seen_ns = 0;    // Master bridge saw the deal (bridge clock).
+    char symbol[32] = {};
+};
+
+class Copier {
+public:
+    static constexpr uint32_t kMaxFollowers = 64;
+
+    static Copier &instance();
+
+    /* Publishes the deal of an order answer when this bridge is the
+     * master; request holds the trade request fields, answer the result.
+     * Callers pass only orders that reached the live account
+     * (Backend::live()).
+     */
+    void on_order(const json_t *request, const json_t *answer);
+    void on_order(const mt5bridge_trade_request &request, const mt5bridge_trade_result &result);
+
+    /* Master: publishes the deals of the last two days of history not
+     * published yet (the first call only records them). Returns the
+     * deals published, -1 with error.
+     */
+    int64_t poll(Backend &backend, std::string &error);
+
+    /* Follower: waits up to timeout_ms for signals and copies every one
+     * available. Returns the signals handled, -1 with error.
+     */
+    int64_t follow(Backend &backend, int64_t timeout_ms, std::string &error);
+
+    /* Returns {"role", "channel", "slots", "published", "followers":
+     * [{"name", "next", "lag", "copied", "skipped", "failed", "missed",
+     * "latency_last_us", "latency_avg_us", "latency_max_us", "seen_ns"},
+     * ...]}; {"role", "error"} if the channel cannot be mapped. Reading
+     * a channel this bridge has not opened neither lays it out nor claims
+     * a follower row.
+     */
+    json_t *to_json();
+
+    /* Unmaps the channel once no follow() still waits on it; the next
+     * call maps it again.
+     */
+    void close();
+
+private:
+    struct Channel;
+
+    Copier();
+    ~Copier();
+
+    /* Maps the channel for the configured role; called with mutex_ held. */
+    bool open(std::string &error);
+
+    void publish(const CopySignal &signal);
+
+    /* Sends the follower order for signal; false if it failed. */
+    bool copy(Backend &backend, const CopySignal &signal, int64_t &latency_ns, bool &skipped);
+
+    std::mutex mutex_;
+    Config config_;
+    std::shared_ptr<Channel> channel_;     // follow() holds a copy while it waits.
+    uint32_t follower_ = 0;                 // Our row of the follower table.
+    std::unordered_set<uint64_t> published_; // Deal tickets, master side.
+    std::deque<uint64_t> published_order_;   // Same, oldest first, to bound the set.
+    bool history_seen_ = false;
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,543 @@
+/*
+ * csv_io.cpp
+ *
+ * Chunked CSV formatting and parsing of bars and ticks.
+ */
+
+#include "csv_io.hpp"
+#include "history.hpp"
+#include "parallel.hpp"
+#include "server_time.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace mt5bridge {
+namespace {
+
+constexpr size_t kRowsPerChunk = 16384;         // Rows formatted per task.
+constexpr size_t kChunksPerWorker = 4;          // Tasks per worker, for stealing.
+constexpr size_t kMinChunkBytes = size_t{1} << 20; // Smaller files are not split further.
+constexpr int64_t kDayMs = 86400 * 1000;
+
+/* ---- Writing ---- */
+
+void put(std::string &out, int64_t v) {
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+void put(std::string &out, uint64_t v) {
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+void put(std::string &out, double v) {
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+template <typename V, typename... Rest>
+void put_row(std::string &out, V first, Rest... rest) {
+    put(out, first);
+    ((out += ',', put(out, rest)), ...);
+}
+
+void format(const Bar &b, std::string &out) {
+    put_row(out, b.time, b.open, b.high, b.low, b.close, b.tick_volume, int64_t{b.spread},
+            b.real_volume, b.recv_ns);
+}
+
+void format(const Tick &t, std::string &out) {
+    put_row(out, t.time_msc, t.bid, t.ask, t.last, t.volume, uint64_t{t.flags}, t.volume_real,
+            t.recv_ns);
+}
+
+/* Formats waves of workers * kChunksPerWorker chunks in parallel and
+ * writes each wave in order, so memory stays bounded by one wave.
+ */
+template <typename R>
+bool write_records(const std::string &path, const char *header, const std::vector<R> &records,
+                   const std::vector<int64_t> &utc, CsvStats &stats, std::string &error) {
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        error = "cannot create " + path;
+        return false;
+    }
+    std::string head = header;
+    if (!utc.empty())
+        head += ",time_utc_ns";
+    head += '\n';
+    bool ok = std::fwrite(head.data(), 1, head.size(), f) == head.size();
+    uint64_t bytes = head.size();
+
+    const size_t chunks = (records.size() + kRowsPerChunk - 1) / kRowsPerChunk;
+    const unsigned workers = worker_count(chunks);
+    const size_t wave = workers * kChunksPerWorker;
+    std::vector<std::string> text(std::min(wave, chunks));
+    for (size_t first = 0; ok && first < chunks; first += wave) {
+        const size_t n = std::min(wave, chunks - first);
+        parallel_for(n, workers, [&](size_t i, unsigned) {
+            std::string &out = text[i];
+            out.clear();
+            const size_t begin = (first + i) * kRowsPerChunk;
+            const size_t end = std::min(begin + kRowsPerChunk, records.size());
+            for (size_t r = begin; r < end; ++r) {
+                format(records[r], out);
+                if (!utc.empty()) {
+                    out += ',';
+                    put(out, utc[r]);
+                }
+                out += '\n';
+            }
+        });
+        for (size_t i = 0; ok && i < n; ++i) {
+            ok = std::fwrite(text[i].data(), 1, text[i].size(), f) == text[i].size();
+            bytes += text[i].size();
+        }
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        std::remove(path.c_str());
+        error = "cannot write " + path;
+        return false;
+    }
+    stats.rows = records.size();
+    stats.bytes = bytes;
+    stats.workers = workers;
+    return true;
+}
+
+/* ---- Reading ---- */
+
+enum class Col {
+    Skip, Date, Time, TimeMsc, RecvNs,
+    Open, High, Low, Close, TickVolume, Spread, RealVolume,
+    Bid, Ask, Last, Volume, Flags, VolumeReal
+};
+
+struct ColumnName {
+    const char *name;
+    Col col;
+};
+
+const ColumnName kBarNames[] = {
+    {"date", Col::Date},         {"time", Col::Time},         {"open", Col::Open},
+    {"high", Col::High},         {"low", Col::Low},           {"close", Col::Close},
+    {"tick_volume", Col::TickVolume}, {"tickvol", Col::TickVolume},
+    {"spread", Col::Spread},     {"real_volume", Col::RealVolume}, {"vol", Col::RealVolume},
+    {"volume", Col::RealVolume}, {"recv_ns", Col::RecvNs},
+};
+
+const ColumnName kTickNames[] = {
+    {"date", Col::Date},     {"time", Col::Time},   {"time_msc", Col::TimeMsc},
+    {"bid", Col::Bid},       {"ask", Col::Ask},     {"last", Col::Last},
+    {"volume", Col::Volume}, {"flags", Col::Flags}, {"volume_real", Col::VolumeReal},
+    {"recv_ns", Col::RecvNs},
+};
+
+struct Layout {
+    char delim = ',';
+    std::vector<Col> cols;
+    std::vector<std::string> names;     // As written in the header, for errors.
+
+    bool has(Col c) const { return std::find(cols.begin(), cols.end(), c) != cols.end(); }
+};
+
+void trim(const char *&f, const char *&e) {
+    while (f < e && (*f == ' ' || *f == '"'))
+        ++f;
+    while (e > f && (e[-1] == ' ' || e[-1] == '"' || e[-1] == '\r'))
+        --e;
+}
+
+/* Calls fn(column, f, e) for each field of the line [p, eol) that has a
+ * header column; stops at the first call returning false.
+ */
+template <typename Fn>
+bool for_each_field(const Layout &layout, const char *p, const char *eol, Fn fn) {
+    size_t i = 0;
+    for (const char *f = p;; ++i) {
+        const char *e = static_cast<const char *>(std::memchr(f, layout.delim, eol - f));
+        if (!e)
+            e = eol;
+        const char *next = e;
+        trim(f, e);
+        if (i < layout.cols.size() && layout.cols[i] != Col::Skip && !fn(i, f, e))
+            return false;
+        if (next == eol)
+            return true;
+        f = next + 1;
+    }
+}
+
+template <size_t N>
+bool parse_header(const char *p, const char *eol, const ColumnName (&known)[N], Layout &layout,
+                  std::string &error) {
+    for (const char *c = p; c < eol; ++c) {
+        if (*c == '\t' || *c == ';' || *c == ',') {
+            layout.delim = *c;
+            break;
+        }
+    }
+    for (const char *f = p;;) {
+        const char *e = static_cast<const char *>(std::memchr(f, layout.delim, eol - f));
+        if (!e)
+            e = eol;
+        const char *next = e;
+        trim(f, e);
+        std::string name;
+        for (const char *c = f; c < e; ++c)
+            if (*c != '<' && *c != '>')
+                name += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+        Col col = Col::Skip;
+        for (const ColumnName &k : known)
+            if (name == k.name)
+                col = k.col;
+        layout.cols.push_back(col);
+        layout.names.emplace_back(f, e);
+        if (next == eol)
+            break;
+        f = next + 1;
+    }
+    if (!layout.has(Col::Date) && !layout.has(Col::Time) && !layout.has(Col::TimeMsc)) {
+        error = "no time, time_msc or date column in the header";
+        return false;
+    }
+    return true;
+}
+
+bool parse_int(const char *f, const char *e, int64_t &v) {
+    if (f < e && *f == '+')
+        ++f;
+    const auto r = std::from_chars(f, e, v);
+    return r.ec == std::errc() && r.ptr == e;
+}
+
+bool parse_real(const char *f, const char *e, double &v) {
+    if (f < e && *f == '+')
+        ++f;
+    const auto r = std::from_chars(f, e, v);
+    return r.ec == std::errc() && r.ptr == e;
+}
+
+/* Counts may be written with decimals ("1.00"). */
+bool parse_count(const char *f, const char *e, uint64_t &v) {
+    double d;
+    if (!parse_real(f, e, d) || d < 0)
+        return false;
+    v = static_cast<uint64_t>(d);
+    return true;
+}
+
+/* Reads up to max_digits digits. */
+bool digits(const char *&p, const char *e, size_t max_digits, int64_t &v) {
+    const char *start = p;
+    v = 0;
+    while (p < e && static_cast<size_t>(p - start) < max_digits && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    return p > start;
+}
+
+/* YYYY.MM.DD, YYYY-MM-DD or YYYY/MM/DD as milliseconds since the epoch. */
+bool parse_date(const char *&p, const char *e, int64_t &ms) {
+    int64_t y, m, d;
+    if (!digits(p, e, 4, y) || p == e || (*p != '.' && *p != '-' && *p != '/'))
+        return false;
+    const char sep = *p++;
+    if (!digits(p, e, 2, m) || p == e || *p++ != sep || !digits(p, e, 2, d) || m < 1 || m > 12 ||
+        d < 1 || d > 31)
+        return false;
+    ms = days_from_civil(y, static_cast<unsigned>(m), static_cast<unsigned>(d)) * kDayMs;
+    return true;
+}
+
+/* HH:MM[:SS[.mmm]] as milliseconds since midnight. */
+bool parse_clock(const char *&p, const char *e, int64_t &ms) {
+    int64_t h, m, s = 0, frac = 0;
+    if (!digits(p, e, 2, h) || p == e || *p++ != ':' || !digits(p, e, 2, m))
+        return false;
+    if (p < e && *p == ':') {
+        ++p;
+        if (!digits(p, e, 2, s))
+            return false;
+        if (p < e && *p == '.') {
+            const char *start = ++p;
+            if (!digits(p, e, 3, frac))
+                return false;
+            for (ptrdiff_t n = p - start; n < 3; ++n)
+                frac *= 10;
+            while (p < e && *p >= '0' && *p <= '9')
+                ++p; // Below a millisecond.
+        }
+    }
+    if (h > 23 || m > 59 || s > 60)
+        return false;
+    ms = ((h * 60 + m) * 60 + s) * 1000 + frac;
+    return true;
+}
+
+/* Time of one line, from whichever time columns the file has. */
+struct LineTime {
+    int64_t epoch_ms = 0;
+    int64_t date_ms = 0;
+    int64_t clock_ms = 0;
+    bool epoch = false;
+
+    int64_t ms() const { return epoch ? epoch_ms : date_ms + clock_ms; }
+};
+
+/* time and time_msc hold epoch integers, or (time only) a date and a
+ * clock; with a date column, time holds the clock alone.
+ */
+bool parse_time(Col col, bool date_column, const char *f, const char *e, LineTime &t) {
+    if (col == Col::Date)
+        return parse_date(f, e, t.date_ms) && f == e;
+    int64_t v;
+    if (parse_int(f, e, v)) {
+        t.epoch = true;
+        t.epoch_ms = col == Col::TimeMsc ? v : v * 1000;
+        return true;
+    }
+    if (col == Col::TimeMsc)
+        return false;
+    if (date_column)
+        return parse_clock(f, e, t.clock_ms) && f == e;
+    if (!parse_date(f, e, t.epoch_ms))
+        return false;
+    t.epoch = true;
+    if (f == e)
+        return true;
+    if (*f != ' ' && *f != 'T')
+        return false;
+    ++f;
+    int64_t clock;
+    if (!parse_clock(f, e, clock) || f != e)
+        return false;
+    t.epoch_ms += clock;
+    return true;
+}
+
+bool parse_line(const Layout &layout, const char *p, const char *eol, Bar &b, size_t &bad) {
+    b = Bar{};
+    LineTime t;
+    const bool date_column = layout.has(Col::Date);
+    const bool ok = for_each_field(layout, p, eol, [&](size_t i, const char *f, const char *e) {
+        bad = i;
+        const Col col = layout.cols[i];
+        if (f == e)
+            return col != Col::Date && col != Col::Time;
+        int64_t v;
+        switch (col) {
+        case Col::Open: return parse_real(f, e, b.open);
+        case Col::High: return parse_real(f, e, b.high);
+        case Col::Low: return parse_real(f, e, b.low);
+        case Col::Close: return parse_real(f, e, b.close);
+        case Col::TickVolume: return parse_count(f, e, b.tick_volume);
+        case Col::RealVolume: return parse_count(f, e, b.real_volume);
+        case Col::Spread:
+            if (!parse_int(f, e, v))
+                return false;
+            b.spread = static_cast<int32_t>(v);
+            return true;
+        case Col::RecvNs: return parse_int(f, e, b.recv_ns);
+        default: return parse_time(col, date_column, f, e, t);
+        }
+    });
+    const int64_t ms = t.ms();
+    b.time = ms / 1000 - (ms % 1000 < 0);
+    return ok;
+}
+
+/* Empty prices become NaN here and are carried forward once all chunks
+ * are joined.
+ */
+bool parse_line(const Layout &layout, const char *p, const char *eol, Tick &t, size_t &bad) {
+    constexpr double kMissing = std::numeric_limits<double>::quiet_NaN();
+    t = Tick{};
+    t.bid = t.ask = t.last = kMissing;
+    LineTime lt;
+    const bool date_column = layout.has(Col::Date);
+    const bool volume_real = layout.has(Col::VolumeReal);
+    const bool msc = layout.has(Col::TimeMsc); // Wins over a time column in seconds.
+    const bool ok = for_each_field(layout, p, eol, [&](size_t i, const char *f, const char *e) {
+        bad = i;
+        const Col col = layout.cols[i];
+        if (f == e)
+            return col != Col::Date && col != Col::Time && col != Col::TimeMsc;
+        int64_t v;
+        double d;
+        switch (col) {
+        case Col::Bid: return parse_real(f, e, t.bid);
+        case Col::Ask: return parse_real(f, e, t.ask);
+        case Col::Last: return parse_real(f, e, t.last);
+        case Col::Volume:
+            if (!parse_real(f, e, d) || d < 0)
+                return false;
+            t.volume = static_cast<uint64_t>(d);
+            if (!volume_real)
+                t.volume_real = d;
+            return true;
+        case Col::VolumeReal: return parse_real(f, e, t.volume_real);
+        case Col::Flags:
+            if (!parse_int(f, e, v))
+                return false;
+            t.flags = static_cast<uint32_t>(v);
+            return true;
+        case Col::RecvNs: return parse_int(f, e, t.recv_ns);
+        case Col::Time:
+            if (msc)
+                return true;
+            return parse_time(col, date_column, f, e, lt);
+        default: return parse_time(col, date_column, f, e, lt);
+        }
+    });
+    t.time_msc = lt.ms();
+    return ok;
+}
+
+int64_t time_of(const Bar &b) { return b.time; }
+int64_t time_of(const Tick &t) { return t.time_msc; }
+
+void fill_missing(std::vector<Bar> &) {}
+
+void fill_missing(std::vector<Tick> &ticks) {
+    double bid = 0.0, ask = 0.0, last = 0.0;
+    for (Tick &t : ticks) {
+        bid = std::isnan(t.bid) ? (t.bid = bid) : t.bid;
+        ask = std::isnan(t.ask) ? (t.ask = ask) : t.ask;
+        last = std::isnan(t.last) ? (t.last = last) : t.last;
+    }
+}
+
+template <typename R>
+struct Chunk {
+    const char *begin;
+    const char *end;
+    std::vector<R> records;
+    size_t lines = 0;           // Lines read, up to and including a bad one.
+    std::string error;
+};
+
+template <typename R, size_t N>
+bool read_records(const std::string &path, const ColumnName (&known)[N], std::vector<R> &out,
+                  CsvStats &stats, std::string &error) {
+    auto file = MappedFile::open(path, error);
+    if (!file)
+        return false;
+    const char *p = reinterpret_cast<const char *>(file->data());
+    const char *end = p + file->size();
+    if (end - p >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+        p += 3; // UTF-8 byte order mark.
+    if (p == end) {
+        error = path + ": empty file";
+        return false;
+    }
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    if (!eol)
+        eol = end;
+    Layout layout;
+    if (!parse_header(p, eol, known, layout, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    p = eol < end ? eol + 1 : end;
+
+    // Cut the body at line breaks into about kChunksPerWorker chunks per
+    // worker, none below kMinChunkBytes unless the body is.
+    const size_t body = static_cast<size_t>(end - p);
+    const unsigned workers = worker_count(body / kMinChunkBytes);
+    const size_t step = body / (workers == 1 ? 1 : workers * kChunksPerWorker) + 1;
+    std::vector<Chunk<R>> chunks;
+    while (p < end) {
+        const char *cut = static_cast<size_t>(end - p) > step ? p + step : end;
+        if (cut < end) {
+            const char *nl = static_cast<const char *>(std::memchr(cut, '\n', end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        chunks.push_back({p, cut, {}, 0, {}});
+        p = cut;
+    }
+
+    parallel_for(chunks.size(), workers, [&](size_t i, unsigned) {
+        Chunk<R> &c = chunks[i];
+        c.records.reserve(static_cast<size_t>(c.end - c.begin) / 48);
+        for (const char *line = c.begin; line < c.end;) {
+            const char *next = static_cast<const char *>(std::memchr(line, '\n', c.end - line));
+            const char *stop = next ? next : c.end;
+            ++c.lines;
+            const char *last = stop;
+            while (last > line && (last[-1] == '\r' || last[-1] == ' '))
+                --last;
+            if (last > line) {
+                R record;
+                size_t bad = 0;
+                if (!parse_line(layout, line, last, record, bad)) {
+                    const char *f = line;
+                    for (size_t k = 0; k < bad; ++k)
+                        f = static_cast<const char *>(std::memchr(f, layout.delim, last - f)) + 1;
+                    const char *e = static_cast<const char *>(std::memchr(f, layout.delim, last - f));
+                    const std::string value(f, std::min<size_t>((e ? e : last) - f, 40));
+                    c.error = "bad " + layout.names[bad] + " '" + value + "'";
+                    return;
+                }
+                c.records.push_back(record);
+            }
+            line = stop + 1;
+        }
+    });
+
+    size_t lines = 1, total = 0;
+    for (const Chunk<R> &c : chunks) {
+        lines += c.lines;
+        if (!c.error.empty()) {
+            error = path + ":" + std::to_string(lines) + ": " + c.error;
+            return false;
+        }
+        total += c.records.size();
+    }
+    out.clear();
+    out.reserve(total);
+    for (const Chunk<R> &c : chunks)
+        out.insert(out.end(), c.records.begin(), c.records.end());
+    fill_missing(out);
+    const auto earlier = [](const R &a, const R &b) { return time_of(a) < time_of(b); };
+    if (!std::is_sorted(out.begin(), out.end(), earlier))
+        std::stable_sort(out.begin(), out.end(), earlier);
+
+    stats.rows = out.size();
+    stats.bytes = file->size();
+    stats.workers = workers;
+    return true;
+}
+
+} // namespace
+
+bool write_csv(const std::string &path, const std::vector<Bar> &bars,
+               const std::vector<int64_t> &utc, CsvStats &stats, std::string &error) {
+    return write_records(path, "time,open,high,low,close,tick_volume,spread,real_volume,recv_ns",
+                         bars, utc, stats, error);
+}
+
+bool write_csv(const std::string &path, const std::vector<Tick> &ticks,
+               const std::vector<int64_t> &utc, CsvStats &stats, std::string &error) {
+    return write_records(path, "time_msc,bid,ask,last,volume,flags,volume_real,recv_ns", ticks,
+                         utc, stats, error);
+}
+
+bool read_csv(const std::string &path, std::vector<Bar> &out, CsvStats &stats,
+              std::string &error) {
+    return read_records(path, kBarNames, out, stats, error);
+}
+
+bool read_csv(const std::string &path, std::vector<Tick> &out, CsvStats &stats,
+              std::string &error) {
+    return read_records(path, kTickNames, out, stats, error);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,66 @@
+/*
+ * csv_io.hpp
+ *
+ * CSV export and import of bar and tick history.
+ *
+ * Requests for copy_ticks_*, copy_rates_* and get_m1_bars with
+ * "csv": "<path>" write their records to path instead of answering them
+ * as JSON: a header line, then one line per record.
+ *
+ *   bars   time,open,high,low,close,tick_volume,spread,real_volume,recv_ns
+ *   ticks  time_msc,bid,ask,last,volume,flags,volume_real,recv_ns
+ *
+ * "utc": true appends a time_utc_ns column. Prices are written in their
+ * shortest round-trip form.
+ *
+ * The reader matches columns by header name, ignoring case and <>, so it
+ * takes both the files above and MetaTrader's history exports
+ * (<DATE> <TIME> <OPEN> ... <TICKVOL> <VOL> <SPREAD>, tab separated).
+ * The delimiter is the first tab, semicolon or comma of the header.
+ * Times are either epoch integers (time in seconds, time_msc in
+ * milliseconds) or a date (YYYY.MM.DD, YYYY-MM-DD) and a clock
+ * (HH:MM[:SS[.mmm]]), in one column or split into date and time. Unknown
+ * columns are ignored. An empty tick price repeats the previous tick's,
+ * as in MetaTrader's tick exports.
+ *
+ * Both directions run in chunks on threads.workers threads. The reader
+ * cuts the mapped file at line breaks and parses the chunks in parallel.
+ * The writer formats groups of rows in parallel and writes them in
+ * order. Numbers go through std::from_chars and std::to_chars, which
+ * neither allocate nor depend on the locale.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+struct CsvStats {
+    uint64_t rows = 0;
+    uint64_t bytes = 0;     // Size of the file.
+    unsigned workers = 0;
+};
+
+/* Writes records to path; utc, when not empty, holds one UTC time per
+ * record for a time_utc_ns column. Returns false with error on failure,
+ * leaving no partial file behind.
+ */
+bool write_csv(const std::string &path, const std::vector<Bar> &bars,
+               const std::vector<int64_t> &utc, CsvStats &stats, std::string &error);
+bool write_csv(const std::string &path, const std::vector<Tick> &ticks,
+               const std::vector<int64_t> &utc, CsvStats &stats, std::string &error);
+
+/* Reads path into out, ordered by time. The error names the file line of
+ * the first malformed field.
+ */
+bool read_csv(const std::string &path, std::vector<Bar> &out, CsvStats &stats,
+              std::string &error);
+bool read_csv(const std::string &path, std::vector<Tick> &out, CsvStats &stats,
+              std::string &error);
+
+} // namespace mt5bridge
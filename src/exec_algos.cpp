@@ -0,0 +1,382 @@
+/*
+ * exec_algos.cpp
+ *
+ * TWAP, VWAP and iceberg parent orders sliced on the timer wheel.
+ */
+
+#include "exec_algos.hpp"
+
+#include "clock.hpp"
+#include "config.hpp"
+#include "copier.hpp"
+#include "history.hpp"
+#include "market_cache.hpp"
+#include "server_time.hpp"
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int32_t kActionDeal = 1;          // TRADE_ACTION_DEAL
+constexpr uint32_t kRetcodePlaced = 10008;  // TRADE_RETCODE_PLACED
+constexpr uint32_t kRetcodeDone = 10009;    // TRADE_RETCODE_DONE
+constexpr uint32_t kRetcodeDonePartial = 10010;
+constexpr int64_t kMaxSlices = 100000;
+constexpr int64_t kMaxErrors = 3;           // Failed children in a row.
+constexpr double kEpsilon = 1e-9;
+
+double round_down(double volume, double step) {
+    return step > 0 ? std::floor(volume / step + kEpsilon) * step : volume;
+}
+
+/* Share of each slice in the M1 tick volume of the same server time of
+ * day on the previous days; empty without history.
+ */
+std::vector<double> history_curve(const AlgoSpec &spec, int64_t start_ns) {
+    BarSeries bars;
+    std::string err;
+    if (!open_bars(bars_path(config().history_dir, spec.symbol, kTimeframeM1), bars, err) ||
+        bars.count == 0)
+        return {};
+    const int64_t utc_s = start_ns / 1000000000;
+    const int64_t start_s = utc_s + ServerClock::instance().offset_at_utc(utc_s);
+    const double width_s = spec.duration_ms / 1e3 / static_cast<double>(spec.slices);
+    std::vector<double> curve(static_cast<size_t>(spec.slices), 0.0);
+    double total = 0.0;
+    for (int64_t day = 1; day <= spec.lookback_days; ++day) {
+        for (size_t i = 0; i < curve.size(); ++i) {
+            const int64_t from = start_s - day * 86400 + static_cast<int64_t>(i * width_s);
+            const int64_t to = start_s - day * 86400 + static_cast<int64_t>((i + 1) * width_s);
+            const Bar *lo = std::lower_bound(bars.begin(), bars.end(), from,
+                                             [](const Bar &b, int64_t t) { return b.time < t; });
+            for (const Bar *b = lo; b != bars.end() && b->time < to; ++b) {
+                curve[i] += static_cast<double>(b->tick_volume);
+                total += static_cast<double>(b->tick_volume);
+            }
+        }
+    }
+    return total > 0 ? curve : std::vector<double>{};
+}
+
+bool read_int(const json_t *obj, const char *key, int64_t &out, std::string &error) {
+    const json_t *v = json_object_get(obj, key);
+    if (!v)
+        return true;
+    if (!json_is_integer(v)) {
+        error = std::string(key) + " must be an integer";
+        return false;
+    }
+    out = json_integer_value(v);
+    return true;
+}
+
+bool read_number(const json_t *obj, const char *key, double &out, std::string &error) {
+    const json_t *v = json_object_get(obj, key);
+    if (!v)
+        return true;
+    if (!json_is_number(v)) {
+        error = std::string(key) + " must be a number";
+        return false;
+    }
+    out = json_number_value(v);
+    return true;
+}
+
+} // namespace
+
+bool algo_spec_from_json(const json_t *obj, AlgoSpec &spec, std::string &error) {
+    const char *algo = json_string_value(json_object_get(obj, "algo"));
+    const char *symbol = json_string_value(json_object_get(obj, "symbol"));
+    if (!algo || !symbol) {
+        error = "algo and symbol are required";
+        return false;
+    }
+    spec.algo = algo;
+    spec.symbol = symbol;
+    int64_t type = spec.type, deviation = spec.deviation, magic = 0;
+    if (!read_int(obj, "type", type, error) || !read_number(obj, "volume", spec.volume, error) ||
+        !read_int(obj, "duration_ms", spec.duration_ms, error) ||
+        !read_int(obj, "slices", spec.slices, error) ||
+        !read_int(obj, "interval_ms", spec.interval_ms, error) ||
+        !read_number(obj, "visible", spec.visible, error) ||
+        !read_number(obj, "limit", spec.limit, error) ||
+        !read_number(obj, "volume_step", spec.volume_step, error) ||
+        !read_number(obj, "volume_min", spec.volume_min, error) ||
+        !read_int(obj, "lookback_days", spec.lookback_days, error) ||
+        !read_int(obj, "deviation", deviation, error) || !read_int(obj, "magic", magic, error))
+        return false;
+    spec.type = static_cast<int32_t>(type);
+    spec.deviation = static_cast<int32_t>(deviation);
+    spec.magic = static_cast<uint64_t>(magic);
+    if (const json_t *curve = json_object_get(obj, "curve")) {
+        if (!json_is_array(curve)) {
+            error = "curve must be an array of numbers";
+            return false;
+        }
+        spec.curve.clear();
+        for (size_t i = 0; i < json_array_size(curve); ++i) {
+            const json_t *w = json_array_get(curve, i);
+            if (!json_is_number(w)) {
+                error = "curve must be an array of numbers";
+                return false;
+            }
+            spec.curve.push_back(json_number_value(w));
+        }
+    }
+    if (const char *comment = json_string_value(json_object_get(obj, "comment")))
+        spec.comment = comment;
+    return true;
+}
+
+struct ExecAlgos::Algo {
+    int64_t id = 0;
+    AlgoSpec spec;
+    Backend *backend = nullptr;
+    std::vector<double> targets;    // twap/vwap: cumulative share after each slice.
+    size_t slice = 0;
+    std::string state = "running";
+    double filled = 0.0;
+    double notional = 0.0;          // Sum of fill price * volume.
+    int64_t children = 0;
+    int64_t held = 0;
+    int64_t errors = 0;
+    int64_t failures = 0;           // In a row.
+    std::string last_error;
+    uint64_t timer = 0;
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+};
+
+ExecAlgos &ExecAlgos::instance() {
+    static ExecAlgos algos;
+    return algos;
+}
+
+ExecAlgos::~ExecAlgos() = default;
+
+bool ExecAlgos::start(const AlgoSpec &spec, Backend &backend, int64_t &id, std::string &error) {
+    const bool sliced = spec.algo == "twap" || spec.algo == "vwap";
+    if (!sliced && spec.algo != "iceberg") {
+        error = "unknown algo " + spec.algo + " (twap, vwap, iceberg)";
+        return false;
+    }
+    if (spec.symbol.empty() || spec.symbol.size() >= 32) {
+        error = "algo needs a symbol of 1 to 31 characters";
+        return false;
+    }
+    if (spec.type != 0 && spec.type != 1) {
+        error = "type must be 0 (buy) or 1 (sell)";
+        return false;
+    }
+    if (!(spec.volume > 0) || spec.volume_step < 0 || spec.volume_min < 0 || spec.limit < 0 ||
+        spec.duration_ms < 0) {
+        error = "volume must be positive; volume_step, volume_min, limit and duration_ms not negative";
+        return false;
+    }
+
+    auto algo = std::make_shared<Algo>();
+    algo->spec = spec;
+    algo->backend = &backend;
+    algo->start_ns = now_ns();
+    int64_t period_ns = spec.interval_ms * 1000000;
+    if (sliced) {
+        if (spec.algo == "vwap" && !spec.curve.empty())
+            algo->spec.slices = static_cast<int64_t>(spec.curve.size());
+        const int64_t slices = algo->spec.slices;
+        if (spec.duration_ms <= 0 || slices < 1 || slices > kMaxSlices ||
+            spec.duration_ms < slices) {
+            error = spec.algo + " needs duration_ms > 0 and 1.." + std::to_string(kMaxSlices) +
+                    " slices of at least 1 ms";
+            return false;
+        }
+        period_ns = spec.duration_ms * 1000000 / slices;
+        std::vector<double> weights = algo->spec.curve;
+        if (spec.algo == "vwap" && weights.empty())
+            weights = history_curve(algo->spec, algo->start_ns);
+        if (weights.empty())
+            weights.assign(static_cast<size_t>(slices), 1.0);
+        double total = 0.0;
+        for (double w : weights) {
+            if (!(w >= 0)) {
+                error = "curve weights must not be negative";
+                return false;
+            }
+            total += w;
+        }
+        if (!(total > 0)) {
+            error = "curve weights must not all be zero";
+            return false;
+        }
+        double sum = 0.0;
+        for (double w : weights) {
+            sum += w;
+            algo->targets.push_back(sum / total);
+        }
+        algo->targets.back() = 1.0;
+    } else if (!(spec.visible > 0) || spec.interval_ms < 1) {
+        error = "iceberg needs visible > 0 and interval_ms >= 1";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (algos_.size() >= kMaxAlgos) {
+        // Forget the oldest finished algorithm to make room.
+        auto it = std::find_if(algos_.begin(), algos_.end(),
+                               [](const auto &a) { return a.second->state != "running"; });
+        if (it == algos_.end()) {
+            error = "too many running algos (" + std::to_string(kMaxAlgos) + ")";
+            return false;
+        }
+        algos_.erase(it);
+    }
+    algo->id = id = next_id_++;
+    const int64_t algo_id = id;
+    algo->timer = TimerWheel::instance().schedule(algo->start_ns, period_ns,
+                                                  [this, algo_id] { step(algo_id); });
+    algos_.emplace(id, std::move(algo));
+    return true;
+}
+
+void ExecAlgos::finish(Algo &algo, const char *state) {
+    algo.state = state;
+    algo.end_ns = now_ns();
+    TimerWheel::instance().cancel(algo.timer);
+}
+
+void ExecAlgos::step(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = algos_.find(id);
+    if (it == algos_.end() || it->second->state != "running")
+        return;
+    // Held across the unlocked order_send: a cancelled algorithm may be
+    // evicted by start() meanwhile.
+    const std::shared_ptr<Algo> keep = it->second;
+    Algo &algo = *keep;
+    const AlgoSpec &spec = algo.spec;
+    const double remaining = spec.volume - algo.filled;
+    bool last = false;
+    double want = 0.0;
+    if (algo.targets.empty()) {
+        if (spec.duration_ms > 0 && now_ns() - algo.start_ns >= spec.duration_ms * 1000000) {
+            finish(algo, "expired");
+            return;
+        }
+        want = std::min(spec.visible, remaining);
+    } else {
+        last = algo.slice + 1 >= algo.targets.size();
+        want = last ? remaining : spec.volume * algo.targets[algo.slice] - algo.filled;
+        ++algo.slice;
+    }
+    want = std::min(round_down(want, spec.volume_step), remaining);
+
+    Tick quote{};
+    const bool quoted = MarketCache::instance().quote(spec.symbol.c_str(), quote);
+    const bool in_limit =
+        spec.limit <= 0 ||
+        (quoted && (spec.type == 0 ? quote.ask > 0 && quote.ask <= spec.limit
+                                   : quote.bid >= spec.limit));
+    if (want < spec.volume_min - kEpsilon || want <= 0 || !in_limit) {
+        if (want > 0 && !in_limit)
+            ++algo.held;
+        if (remaining < spec.volume_min - kEpsilon || remaining <= kEpsilon)
+            finish(algo, "done");
+        else if (last)
+            finish(algo, "expired");
+        return;
+    }
+
+    // The order goes out without the lock; this task is the only one
+    // touching the algorithm's progress.
+    Backend &backend = *algo.backend;
+    const std::string comment = spec.comment.empty() ? spec.algo + " " + std::to_string(id)
+                                                     : spec.comment;
+    mt5bridge_trade_request req{};
+    req.action = kActionDeal;
+    req.type = spec.type;
+    req.symbol = spec.symbol.c_str();
+    req.volume = want;
+    req.deviation = spec.deviation;
+    req.magic = spec.magic;
+    req.comment = comment.c_str();
+    lock.unlock();
+    mt5bridge_trade_result result{};
+    std::string err;
+    bool ok = backend.order_send(req, result, err);
+    ok = ok && (result.retcode == kRetcodeDone || result.retcode == kRetcodeDonePartial ||
+                result.retcode == kRetcodePlaced);
+    if (ok && backend.live())
+        Copier::instance().on_order(req, result);
+    lock.lock();
+
+    ++algo.children;
+    if (!ok) {
+        ++algo.errors;
+        algo.last_error = err.empty() ? "retcode " + std::to_string(result.retcode) +
+                                            (result.comment[0] ? std::string(" ") + result.comment
+                                                               : std::string())
+                                      : err;
+        if (++algo.failures >= kMaxErrors && algo.state == "running")
+            finish(algo, "failed");
+        else if (last && algo.state == "running")
+            finish(algo, "expired");
+        return;
+    }
+    algo.failures = 0;
+    const double volume = result.volume > 0 ? result.volume : want;
+    const double price = result.price > 0 ? result.price : (spec.type == 0 ? quote.ask : quote.bid);
+    algo.filled += volume;
+    algo.notional += price * volume;
+    if (algo.state != "running")
+        return;
+    const double left = spec.volume - algo.filled;
+    if (left < spec.volume_min - kEpsilon || left <= kEpsilon)
+        finish(algo, "done");
+    else if (last)
+        finish(algo, "expired");
+}
+
+bool ExecAlgos::cancel(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = algos_.find(id);
+    if (it == algos_.end() || it->second->state != "running")
+        return false;
+    finish(*it->second, "cancelled");
+    return true;
+}
+
+void ExecAlgos::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : algos_) {
+        if (entry.second->state == "running")
+            finish(*entry.second, "cancelled");
+    }
+}
+
+json_t *ExecAlgos::to_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &entry : algos_) {
+        const Algo &a = *entry.second;
+        json_t *obj = json_pack(
+            "{s:I, s:s, s:s, s:i, s:f, s:s, s:f, s:o, s:I, s:I, s:I, s:I, s:I, s:I, s:I}", "id",
+            static_cast<json_int_t>(a.id), "algo", a.spec.algo.c_str(), "symbol",
+            a.spec.symbol.c_str(), "type", a.spec.type, "volume", a.spec.volume, "state",
+            a.state.c_str(), "filled", a.filled, "avg_price",
+            a.filled > 0 ? json_real(a.notional / a.filled) : json_null(), "children",
+            static_cast<json_int_t>(a.children), "held", static_cast<json_int_t>(a.held),
+            "errors", static_cast<json_int_t>(a.errors), "slice",
+            static_cast<json_int_t>(a.slice), "slices",
+            static_cast<json_int_t>(a.targets.size()), "start_ns",
+            static_cast<json_int_t>(a.start_ns), "end_ns", static_cast<json_int_t>(a.end_ns));
+        if (!a.last_error.empty())
+            json_object_set_new(obj, "last_error", json_string(a.last_error.c_str()));
+        json_array_append_new(out, obj);
+    }
+    return out;
+}
+
+} // namespace mt5bridge
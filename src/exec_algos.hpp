@@ -0,0 +1,109 @@
+/*
+ * exec_algos.hpp
+ *
+ * Parent orders worked inside the bridge by execution algorithms that
+ * send market child orders through the backend's order_send:
+ *
+ *   twap     duration_ms cut into slices equal intervals; each child
+ *            brings the filled volume up to an equal share per slice
+ *   vwap     same intervals, shares following a volume curve: the curve
+ *            weights given, or the M1 tick volume of the same time of day
+ *            over the last lookback_days days of the history store
+ *            (equal shares without history)
+ *   iceberg  a child of at most visible lots every interval_ms until the
+ *            volume is filled, or until duration_ms if set
+ *
+ * Children run on the timer wheel (timer_wheel.hpp), one periodic timer
+ * per algorithm. They are rounded down to volume_step and held below
+ * volume_min; a share held back is carried into the next child. With a
+ * limit price, a child is only sent while the market cache quote is at
+ * or better than it (ask for buys, bid for sells) and is held otherwise,
+ * so the limit needs live quotes of the symbol flowing through the
+ * bridge. A twap or vwap whose last slice leaves volume unfilled ends
+ * expired; three failed children in a row end it failed.
+ *
+ * Children sent to a live backend go through the copier master hook
+ * like any order sent through the bridge.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+
+#include <jansson.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+struct AlgoSpec {
+    std::string algo;               // twap, vwap or iceberg.
+    std::string symbol;
+    int32_t type = 0;               // 0 buy, 1 sell.
+    double volume = 0.0;            // Parent lots.
+    int64_t duration_ms = 0;        // twap/vwap window; iceberg expiry, 0 = none.
+    int64_t slices = 10;            // twap/vwap children.
+    int64_t interval_ms = 1000;     // Iceberg child interval.
+    double visible = 0.0;           // Iceberg child size.
+    double limit = 0.0;             // Worst price; 0 = none.
+    double volume_step = 0.01;
+    double volume_min = 0.01;
+    std::vector<double> curve;      // vwap weights per slice; empty = history.
+    int64_t lookback_days = 5;      // vwap history profile.
+    int32_t deviation = 20;
+    uint64_t magic = 0;
+    std::string comment;
+};
+
+/* Reads {"algo", "symbol", "type", "volume", ...} with the AlgoSpec
+ * member names; absent members keep their defaults.
+ */
+bool algo_spec_from_json(const json_t *obj, AlgoSpec &spec, std::string &error);
+
+class ExecAlgos {
+public:
+    static constexpr size_t kMaxAlgos = 4096;   // Kept, running or finished.
+
+    static ExecAlgos &instance();
+
+    /* Validates spec and starts working it at once through backend,
+     * which must outlive the algorithm. Returns false with error.
+     */
+    bool start(const AlgoSpec &spec, Backend &backend, int64_t &id, std::string &error);
+
+    /* Stops sending children; false for an unknown or finished id. */
+    bool cancel(int64_t id);
+
+    /* Cancels every running algorithm (bridge shutdown). */
+    void stop();
+
+    /* Returns [{"id", "algo", "symbol", "type", "volume", "state",
+     * "filled", "avg_price", "children", "held", "errors", "slice",
+     * "slices", "last_error", "start_ns", "end_ns"}, ...]; state is
+     * running, done, cancelled, expired or failed.
+     */
+    json_t *to_json();
+
+private:
+    struct Algo;
+
+    ExecAlgos() = default;
+    ~ExecAlgos();
+
+    /* Timer task: sends the next child of algorithm id. */
+    void step(int64_t id);
+
+    /* Ends algo with state; called with mutex_ held. */
+    void finish(Algo &algo, const char *state);
+
+    std::mutex mutex_;
+    std::map<int64_t, std::shared_ptr<Algo>> algos_;
+    int64_t next_id_ = 1;
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,357 @@
+/*
+ * expression.cpp
+ *
+ * Recursive descent compiler and column-at-a-time evaluator.
+ */
+
+#include "expression.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace mt5bridge {
+namespace {
+
+constexpr size_t kMaxDepth = 64;    // Nesting the parser accepts.
+
+thread_local std::vector<double> t_columns; // Leaf and stack columns of evaluate().
+
+} // namespace
+
+class ExprParser {
+public:
+    ExprParser(const std::string &text, const ExprLeafCheck &check, Expression &out)
+        : s_(text), check_(check), out_(out) {}
+
+    bool parse(std::string &error) {
+        if (!parse_or(0) || (skip(), pos_ != s_.size() && !fail("unexpected input"))) {
+            error = error_ + " at offset " + std::to_string(pos_) + " of \"" + s_ + "\"";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    using Op = Expression::Op;
+
+    const std::string &s_;
+    const ExprLeafCheck &check_;
+    Expression &out_;
+    size_t pos_ = 0;
+    size_t height_ = 0;         // Stack columns in use after the code so far.
+    std::string error_;
+
+    bool fail(const std::string &msg) {
+        if (error_.empty())
+            error_ = msg;
+        return false;
+    }
+
+    void skip() {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_])))
+            ++pos_;
+    }
+
+    /* Consumes tok if it comes next; words must not run into a name. */
+    bool accept(const char *tok) {
+        skip();
+        const size_t n = std::strlen(tok);
+        if (s_.compare(pos_, n, tok) != 0)
+            return false;
+        if (std::isalpha(static_cast<unsigned char>(tok[0])) && pos_ + n < s_.size() &&
+            (std::isalnum(static_cast<unsigned char>(s_[pos_ + n])) || s_[pos_ + n] == '_'))
+            return false;
+        pos_ += n;
+        return true;
+    }
+
+    void emit(Op op, int delta, uint32_t leaf = 0, double value = 0.0) {
+        out_.code_.push_back({op, leaf, value});
+        height_ = static_cast<size_t>(static_cast<long>(height_) + delta);
+        out_.depth_ = std::max(out_.depth_, height_);
+    }
+
+    bool parse_or(size_t depth) {
+        if (depth > kMaxDepth)
+            return fail("expression nested too deeply");
+        if (!parse_and(depth))
+            return false;
+        while (accept("or") || accept("||")) {
+            if (!parse_and(depth))
+                return false;
+            emit(Op::Or, -1);
+        }
+        return true;
+    }
+
+    bool parse_and(size_t depth) {
+        if (!parse_not(depth))
+            return false;
+        while (accept("and") || accept("&&")) {
+            if (!parse_not(depth))
+                return false;
+            emit(Op::And, -1);
+        }
+        return true;
+    }
+
+    bool parse_not(size_t depth) {
+        if (accept("not") || accept("!")) {
+            if (depth > kMaxDepth)
+                return fail("expression nested too deeply");
+            if (!parse_not(depth + 1))
+                return false;
+            emit(Op::Not, 0);
+            return true;
+        }
+        return parse_compare(depth);
+    }
+
+    bool parse_compare(size_t depth) {
+        if (!parse_sum(depth))
+            return false;
+        static const struct {
+            const char *tok;
+            Op op;
+        } kOps[] = {{"<=", Op::Le}, {">=", Op::Ge}, {"==", Op::Eq}, {"!=", Op::Ne},
+                    {"<", Op::Lt},  {">", Op::Gt}};
+        for (const auto &c : kOps) {
+            if (accept(c.tok)) {
+                if (!parse_sum(depth))
+                    return false;
+                emit(c.op, -1);
+                return true;
+            }
+        }
+        return true;
+    }
+
+    bool parse_sum(size_t depth) {
+        if (!parse_product(depth))
+            return false;
+        for (;;) {
+            const Op op = accept("+") ? Op::Add : accept("-") ? Op::Sub : Op::Const;
+            if (op == Op::Const)
+                return true;
+            if (!parse_product(depth))
+                return false;
+            emit(op, -1);
+        }
+    }
+
+    bool parse_product(size_t depth) {
+        if (!parse_unary(depth))
+            return false;
+        for (;;) {
+            const Op op = accept("*") ? Op::Mul : accept("/") ? Op::Div : Op::Const;
+            if (op == Op::Const)
+                return true;
+            if (!parse_unary(depth))
+                return false;
+            emit(op, -1);
+        }
+    }
+
+    bool parse_unary(size_t depth) {
+        if (accept("-")) {
+            if (depth > kMaxDepth)
+                return fail("expression nested too deeply");
+            if (!parse_unary(depth + 1))
+                return false;
+            emit(Op::Neg, 0);
+            return true;
+        }
+        return parse_primary(depth);
+    }
+
+    bool number(double &v) {
+        skip();
+        const char *begin = s_.c_str() + pos_;
+        if (!std::isdigit(static_cast<unsigned char>(*begin)) && *begin != '.')
+            return false;
+        char *end = nullptr;
+        v = std::strtod(begin, &end);
+        if (end == begin)
+            return false;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    bool parse_primary(size_t depth) {
+        double v;
+        if (number(v)) {
+            emit(Op::Const, 1, 0, v);
+            return true;
+        }
+        if (accept("(")) {
+            if (!parse_or(depth + 1))
+                return false;
+            return accept(")") || fail("expected )");
+        }
+        skip();
+        const size_t start = pos_;
+        while (pos_ < s_.size() &&
+               (std::isalnum(static_cast<unsigned char>(s_[pos_])) || s_[pos_] == '_'))
+            ++pos_;
+        if (pos_ == start || std::isdigit(static_cast<unsigned char>(s_[start])))
+            return fail("expected a number, a name or (");
+        const std::string name = s_.substr(start, pos_ - start);
+
+        static const struct {
+            const char *name;
+            Op op;
+            int args;
+        } kBuiltins[] = {{"abs", Op::Abs, 1},
+                         {"min", Op::Min, 2},
+                         {"max", Op::Max, 2},
+                         {"crosses_above", Op::CrossAbove, 2},
+                         {"crosses_below", Op::CrossBelow, 2}};
+        for (const auto &b : kBuiltins) {
+            if (name != b.name)
+                continue;
+            if (!accept("("))
+                return fail("expected ( after " + name);
+            for (int i = 0; i < b.args; ++i) {
+                if ((i && !accept(",")) || !parse_or(depth + 1))
+                    return fail(name + " takes " + std::to_string(b.args) + " argument(s)");
+            }
+            if (!accept(")"))
+                return fail(name + " takes " + std::to_string(b.args) + " argument(s)");
+            const bool crossing = b.op == Op::CrossAbove || b.op == Op::CrossBelow;
+            emit(b.op, 1 - b.args, crossing ? static_cast<uint32_t>(out_.crossings_++) : 0);
+            return true;
+        }
+
+        ExprLeaf leaf;
+        leaf.name = name;
+        if (accept("(") && !accept(")")) {
+            do {
+                const bool negative = accept("-");
+                if (!number(v))
+                    return fail("arguments of " + name + " must be numbers");
+                leaf.args.push_back(negative ? -v : v);
+            } while (accept(","));
+            if (!accept(")"))
+                return fail("expected ) after the arguments of " + name);
+        }
+        std::string err;
+        if (check_ && !check_(leaf, err))
+            return fail(err);
+        auto &leaves = out_.leaves_;
+        size_t index = 0;
+        while (index < leaves.size() &&
+               (leaves[index].name != leaf.name || leaves[index].args != leaf.args))
+            ++index;
+        if (index == leaves.size())
+            leaves.push_back(leaf);
+        emit(Op::Leaf, 1, static_cast<uint32_t>(index));
+        return true;
+    }
+};
+
+std::shared_ptr<const Expression> Expression::compile(const std::string &text,
+                                                      const ExprLeafCheck &check,
+                                                      std::string &error) {
+    auto expr = std::make_shared<Expression>();
+    expr->text_ = text;
+    ExprParser parser(text, check, *expr);
+    if (!parser.parse(error))
+        return nullptr;
+    return expr;
+}
+
+void Expression::evaluate(ExprColumns &columns, size_t lanes, double *out, double *state) const {
+    if (lanes == 0)
+        return;
+    const size_t nleaves = leaves_.size();
+    if (t_columns.size() < (nleaves + depth_) * lanes)
+        t_columns.resize((nleaves + depth_) * lanes);
+    double *leaf_base = t_columns.data();
+    for (size_t k = 0; k < nleaves; ++k)
+        columns.load(k, leaves_[k], lanes, leaf_base + k * lanes);
+
+    double *stack = leaf_base + nleaves * lanes;
+    size_t top = 0;     // Columns on the stack.
+    constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+    for (const Instr &in : code_) {
+        double *a = stack + (top ? top - 1 : 0) * lanes; // Topmost column.
+        switch (in.op) {
+        case Op::Const:
+            std::fill(stack + top * lanes, stack + (top + 1) * lanes, in.value);
+            ++top;
+            break;
+        case Op::Leaf: {
+            const double *src = leaf_base + in.leaf * lanes;
+            std::copy(src, src + lanes, stack + top * lanes);
+            ++top;
+            break;
+        }
+        case Op::Neg:
+            for (size_t i = 0; i < lanes; ++i) a[i] = -a[i];
+            break;
+        case Op::Not:
+            for (size_t i = 0; i < lanes; ++i) a[i] = truthy(a[i]) ? 0.0 : 1.0;
+            break;
+        case Op::Abs:
+            for (size_t i = 0; i < lanes; ++i) a[i] = std::fabs(a[i]);
+            break;
+#define MT5BRIDGE_BINARY(OP, EXPR)                                                        \
+        case Op::OP:                                                                      \
+        {                                                                                 \
+            double *b = a - lanes;                                                        \
+            for (size_t i = 0; i < lanes; ++i) {                                          \
+                const double x = b[i], y = a[i];                                          \
+                b[i] = (EXPR);                                                            \
+            }                                                                             \
+            --top;                                                                        \
+            break;                                                                        \
+        }
+        MT5BRIDGE_BINARY(Add, x + y)
+        MT5BRIDGE_BINARY(Sub, x - y)
+        MT5BRIDGE_BINARY(Mul, x * y)
+        MT5BRIDGE_BINARY(Div, x / y)
+        MT5BRIDGE_BINARY(Lt, x < y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Le, x <= y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Gt, x > y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Ge, x >= y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Eq, x == y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Ne, x != y && x == x && y == y ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(And, truthy(x) && truthy(y) ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Or, truthy(x) || truthy(y) ? 1.0 : 0.0)
+        MT5BRIDGE_BINARY(Min, x != x || y != y ? kNaN : std::min(x, y))
+        MT5BRIDGE_BINARY(Max, x != x || y != y ? kNaN : std::max(x, y))
+#undef MT5BRIDGE_BINARY
+        case Op::CrossAbove:
+        case Op::CrossBelow: {
+            double *b = a - lanes;
+            if (!state) {
+                std::fill(b, b + lanes, 0.0);
+                --top;
+                break;
+            }
+            double *prev_x = state + 2 * in.leaf * lanes;
+            double *prev_y = prev_x + lanes;
+            // NaN on either side compares false, so no crossing is seen
+            // until two evaluations with known values.
+            const bool above = in.op == Op::CrossAbove;
+            for (size_t i = 0; i < lanes; ++i) {
+                const double x = b[i], y = a[i];
+                const bool crossed = above ? prev_x[i] <= prev_y[i] && x > y
+                                           : prev_x[i] >= prev_y[i] && x < y;
+                prev_x[i] = x;
+                prev_y[i] = y;
+                b[i] = crossed ? 1.0 : 0.0;
+            }
+            --top;
+            break;
+        }
+        }
+    }
+    std::copy(stack, stack + lanes, out);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,114 @@
+/*
+ * expression.hpp
+ *
+ * Small expression language for screens and rules, compiled to a
+ * stack program and evaluated a column at a time.
+ *
+ *   expr     := or
+ *   or       := and { ("or" | "||") and }
+ *   and      := not { ("and" | "&&") not }
+ *   not      := ("not" | "!") not | compare
+ *   compare  := sum [ ("<" | "<=" | ">" | ">=" | "==" | "!=") sum ]
+ *   sum      := product { ("+" | "-") product }
+ *   product  := unary { ("*" | "/") unary }
+ *   unary    := "-" unary | primary
+ *   primary  := number | "(" expr ")" | name [ "(" [ args ] ")" ]
+ *
+ * abs(x), min(a, b) and max(a, b) are built in, and so are
+ * crosses_above(a, b) and crosses_below(a, b): true in a lane when a was
+ * at or below (at or above) b at the previous evaluation and is now
+ * strictly above (below) it. Crossings need the caller to keep per-lane
+ * state between evaluations (state_size()); without it they are false.
+ * Every other name is a
+ * leaf: a value the caller supplies, optionally with constant numeric
+ * arguments, e.g. "spread" or "range(20)". The caller's check decides
+ * which leaves exist when the text is compiled.
+ *
+ * A program runs over a number of lanes (symbols) at once: each leaf is
+ * loaded as a column of one value per lane and each instruction is one
+ * loop over the lanes, which the compiler vectorizes. Unknown values are
+ * NaN; comparisons with NaN are false, and "and", "or" and "not" treat
+ * NaN as false. Truth values are 1 and 0.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+struct ExprLeaf {
+    std::string name;
+    std::vector<double> args;
+};
+
+/* Supplies leaf columns to Expression::evaluate. */
+class ExprColumns {
+public:
+    virtual ~ExprColumns() = default;
+
+    /* Fills out[0, lanes) with the leaf's value in every lane, NaN where
+     * it is unknown. leaf indexes Expression::leaves().
+     */
+    virtual void load(size_t leaf, const ExprLeaf &spec, size_t lanes, double *out) = 0;
+};
+
+/* Accepts a leaf at compile time; false with error if the name or its
+ * argument count is not known.
+ */
+using ExprLeafCheck = std::function<bool(const ExprLeaf &leaf, std::string &error)>;
+
+class Expression {
+public:
+    /* Compiles text; nullptr with error (naming the offset) on a syntax
+     * error or a leaf rejected by check.
+     */
+    static std::shared_ptr<const Expression> compile(const std::string &text,
+                                                     const ExprLeafCheck &check,
+                                                     std::string &error);
+
+    const std::string &text() const { return text_; }
+    const std::vector<ExprLeaf> &leaves() const { return leaves_; }
+
+    /* Doubles of state per lane that crossings keep between evaluations;
+     * 0 if the expression has none.
+     */
+    size_t state_size() const { return 2 * crossings_; }
+
+    /* Writes the expression's value in every lane to out[0, lanes). state,
+     * if not null, holds state_size() * lanes doubles (NaN before the
+     * first evaluation) and is updated. Safe to call from several threads
+     * at once with different state.
+     */
+    void evaluate(ExprColumns &columns, size_t lanes, double *out, double *state = nullptr) const;
+
+    /* True if v counts as true: non-zero and not NaN. */
+    static bool truthy(double v) { return v == v && v != 0.0; }
+
+private:
+    enum class Op : uint8_t {
+        Const, Leaf, Neg, Not, Add, Sub, Mul, Div,
+        Lt, Le, Gt, Ge, Eq, Ne, And, Or, Abs, Min, Max, CrossAbove, CrossBelow
+    };
+
+    struct Instr {
+        Op op;
+        uint32_t leaf = 0;      // Op::Leaf; crossing number of Op::Cross*.
+        double value = 0.0;     // Op::Const.
+    };
+
+    friend class ExprParser;
+
+    std::string text_;
+    std::vector<ExprLeaf> leaves_;
+    std::vector<Instr> code_;
+    size_t depth_ = 0;          // Stack columns the program needs.
+    size_t crossings_ = 0;
+};
+
+} // namespace mt5bridge
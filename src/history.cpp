@@ -0,0 +1,382 @@
+/*
+ * history.cpp
+ *
+ * History file format, memory mapping and append/merge.
+ */
+
+#include "history.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mt5bridge {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'T', '5', 'B', 'H', 'S', 'T', '\0'};
+constexpr uint32_t kVersion = 1;
+
+enum Kind : uint32_t { kTicks = 1, kBars = 2 };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t record_size;
+    int32_t timeframe;
+    char symbol[32];
+    uint64_t reserved;
+};
+static_assert(sizeof(Header) == 64, "history header must stay 64 bytes");
+
+Header make_header(Kind kind, uint32_t record_size, int64_t timeframe, const std::string &symbol) {
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.kind = kind;
+    h.record_size = record_size;
+    h.timeframe = static_cast<int32_t>(timeframe);
+    std::snprintf(h.symbol, sizeof h.symbol, "%s", symbol.c_str());
+    return h;
+}
+
+template <typename T>
+bool open_series(const std::string &path, Kind kind, Series<T> &out, std::string &error) {
+    auto file = MappedFile::open(path, error);
+    if (!file)
+        return false;
+    Header h;
+    if (file->size() < sizeof h) {
+        error = path + ": not a history file";
+        return false;
+    }
+    std::memcpy(&h, file->data(), sizeof h);
+    if (std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 || h.version != kVersion ||
+        h.kind != kind || h.record_size != sizeof(T)) {
+        error = path + ": not a history file of this bridge version";
+        return false;
+    }
+    out.count = (file->size() - sizeof h) / sizeof(T); // A torn last record is ignored.
+    out.records = reinterpret_cast<const T *>(file->data() + sizeof h);
+    out.file = std::move(file);
+    out.owned.reset();
+    return true;
+}
+
+/* 64-bit stream positions; long is 32 bits on Windows. */
+int file_seek(std::FILE *f, int64_t offset, int origin) {
+#if defined(_WIN32)
+    return _fseeki64(f, offset, origin);
+#else
+    return fseeko(f, static_cast<off_t>(offset), origin);
+#endif
+}
+
+int64_t file_tell(std::FILE *f) {
+#if defined(_WIN32)
+    return _ftelli64(f);
+#else
+    return static_cast<int64_t>(ftello(f));
+#endif
+}
+
+/* Opens path for appending, writing the header if the file is new, and
+ * returns the last stored record in last (if any).
+ */
+template <typename T>
+std::FILE *open_append(const std::string &path, const Header &header, T &last, bool &has_last,
+                       std::string &error) {
+    has_last = false;
+    std::FILE *f = std::fopen(path.c_str(), "r+b");
+    if (!f) {
+        f = std::fopen(path.c_str(), "w+b");
+        if (!f || std::fwrite(&header, sizeof header, 1, f) != 1) {
+            if (f)
+                std::fclose(f);
+            error = "cannot create " + path;
+            return nullptr;
+        }
+        return f;
+    }
+    Header h;
+    if (std::fread(&h, sizeof h, 1, f) != 1 || std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 ||
+        h.kind != header.kind || h.record_size != sizeof(T)) {
+        std::fclose(f);
+        error = path + ": not a history file of this bridge version";
+        return nullptr;
+    }
+    file_seek(f, 0, SEEK_END);
+    const int64_t size = file_tell(f);
+    const int64_t records =
+        (size - static_cast<int64_t>(sizeof h)) / static_cast<int64_t>(sizeof(T));
+    // Drop a torn last record so appends stay aligned.
+    file_seek(f, static_cast<int64_t>(sizeof h) + records * static_cast<int64_t>(sizeof(T)),
+              SEEK_SET);
+    if (records > 0) {
+        file_seek(f, -static_cast<int64_t>(sizeof(T)), SEEK_CUR);
+        has_last = std::fread(&last, sizeof last, 1, f) == 1;
+        file_seek(f, 0, SEEK_CUR); // Switch the stream from reading to writing.
+    }
+    return f;
+}
+
+/* Replaces path with header and records, written through a temporary. */
+template <typename T>
+bool rewrite_series(const std::string &path, const Header &header, const std::vector<T> &records,
+                    std::string &error) {
+    const std::string tmp = path + ".tmp";
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        error = "cannot create " + tmp;
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof header, 1, f) == 1 &&
+              std::fwrite(records.data(), sizeof(T), records.size(), f) == records.size();
+    ok = std::fclose(f) == 0 && ok;
+#if defined(_WIN32)
+    ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok) {
+        std::remove(tmp.c_str());
+        error = "cannot write " + path;
+    }
+    return ok;
+}
+
+/* Stored records before the new ones' time range, the new ones, then
+ * stored records after it; replaced counts the stored records dropped.
+ */
+template <typename T, typename Time>
+std::vector<T> merge_range(const Series<T> &stored, const std::vector<T> &records, Time T::*time,
+                           size_t &replaced) {
+    const Time first = records.front().*time;
+    const Time last = records.back().*time;
+    std::vector<T> merged;
+    merged.reserve(stored.count + records.size());
+    for (const T &r : stored)
+        if (r.*time < first)
+            merged.push_back(r);
+    merged.insert(merged.end(), records.begin(), records.end());
+    for (const T &r : stored)
+        if (r.*time > last)
+            merged.push_back(r);
+    replaced = stored.count - (merged.size() - records.size());
+    return merged;
+}
+
+} // namespace
+
+#if defined(_WIN32)
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path, std::string &error) {
+    std::shared_ptr<MappedFile> m(new MappedFile());
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+    m->file_ = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        error = "cannot stat " + path;
+        return nullptr;
+    }
+    m->size_ = static_cast<size_t>(size.QuadPart);
+    if (m->size_ == 0)
+        return m;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        error = "cannot map " + path;
+        return nullptr;
+    }
+    m->mapping_ = mapping;
+    m->data_ = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m->data_) {
+        error = "cannot map " + path;
+        return nullptr;
+    }
+    return m;
+}
+
+MappedFile::~MappedFile() {
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    if (file_)
+        CloseHandle(file_);
+}
+
+#else
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path, std::string &error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        error = "cannot stat " + path;
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> m(new MappedFile());
+    m->size_ = static_cast<size_t>(st.st_size);
+    if (m->size_ > 0) {
+        void *p = mmap(nullptr, m->size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            error = "cannot map " + path;
+            return nullptr;
+        }
+        m->data_ = static_cast<const unsigned char *>(p);
+    }
+    ::close(fd);
+    return m;
+}
+
+MappedFile::~MappedFile() {
+    if (data_)
+        munmap(const_cast<unsigned char *>(data_), size_);
+}
+
+#endif
+
+std::string timeframe_name(int64_t timeframe) {
+    if (timeframe == kTimeframeMN1)
+        return "MN1";
+    if (timeframe == kTimeframeW1)
+        return "W1";
+    if (timeframe == kTimeframeD1)
+        return "D1";
+    const int64_t seconds = timeframe_seconds(timeframe);
+    if (seconds == 0)
+        return std::string();
+    return seconds < 3600 ? "M" + std::to_string(seconds / 60) : "H" + std::to_string(seconds / 3600);
+}
+
+std::string ticks_path(const std::string &dir, const std::string &symbol) {
+    return dir + "/" + symbol + ".ticks";
+}
+
+std::string bars_path(const std::string &dir, const std::string &symbol, int64_t timeframe) {
+    return dir + "/" + symbol + "." + timeframe_name(timeframe) + ".bars";
+}
+
+bool open_ticks(const std::string &path, TickSeries &out, std::string &error) {
+    return open_series(path, kTicks, out, error);
+}
+
+bool open_bars(const std::string &path, BarSeries &out, std::string &error) {
+    return open_series(path, kBars, out, error);
+}
+
+bool save_ticks(const std::string &dir, const std::string &symbol,
+                const std::vector<Tick> &ticks, std::string &error) {
+    if (ticks.empty())
+        return true;
+    const std::string path = ticks_path(dir, symbol);
+    Tick last{};
+    bool has_last = false;
+    std::FILE *f = open_append(path, make_header(kTicks, sizeof(Tick), 0, symbol), last,
+                               has_last, error);
+    if (!f)
+        return false;
+
+    size_t first = 0;
+    if (has_last) {
+        while (first < ticks.size()) {
+            const Tick &t = ticks[first];
+            const bool newer = t.time_msc > last.time_msc ||
+                               (t.time_msc == last.time_msc && t.seq && last.seq && t.seq > last.seq);
+            if (newer)
+                break;
+            ++first;
+        }
+    }
+    const size_t n = ticks.size() - first;
+    bool ok = n == 0 || std::fwrite(ticks.data() + first, sizeof(Tick), n, f) == n;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok)
+        error = "cannot write " + path;
+    return ok;
+}
+
+bool merge_ticks(const std::string &dir, const std::string &symbol,
+                 const std::vector<Tick> &ticks, size_t &replaced, std::string &error) {
+    replaced = 0;
+    if (ticks.empty())
+        return true;
+    const std::string path = ticks_path(dir, symbol);
+    TickSeries stored;
+    std::string ignored;
+    const bool in_order = !open_ticks(path, stored, ignored) || stored.count == 0 ||
+                          ticks.front().time_msc > stored.records[stored.count - 1].time_msc;
+    if (in_order) {
+        stored = TickSeries();
+        return save_ticks(dir, symbol, ticks, error);
+    }
+    std::vector<Tick> merged = merge_range(stored, ticks, &Tick::time_msc, replaced);
+    stored = TickSeries(); // Unmap before the file is replaced.
+    return rewrite_series(path, make_header(kTicks, sizeof(Tick), 0, symbol), merged, error);
+}
+
+bool merge_bars(const std::string &dir, const std::string &symbol, int64_t timeframe,
+                const std::vector<Bar> &bars, size_t &replaced, std::string &error) {
+    replaced = 0;
+    if (bars.empty())
+        return true;
+    if (timeframe_name(timeframe).empty()) {
+        error = "cannot save bars of timeframe " + std::to_string(timeframe);
+        return false;
+    }
+    const std::string path = bars_path(dir, symbol, timeframe);
+
+    // Bar files are small; rewrite the merged series through a temporary.
+    BarSeries stored;
+    std::string ignored;
+    open_bars(path, stored, ignored);
+    std::vector<Bar> merged = merge_range(stored, bars, &Bar::time, replaced);
+    stored = BarSeries();
+    return rewrite_series(path, make_header(kBars, sizeof(Bar), timeframe, symbol), merged,
+                          error);
+}
+
+bool save_bars(const std::string &dir, const std::string &symbol, int64_t timeframe,
+               const std::vector<Bar> &bars, std::string &error) {
+    size_t replaced = 0;
+    return merge_bars(dir, symbol, timeframe, bars, replaced, error);
+}
+
+double infer_point(const Tick *ticks, size_t count) {
+    int digits = 0;
+    const size_t n = count < 1000 ? count : 1000;
+    for (size_t i = 0; i < n; ++i) {
+        for (double price : {ticks[i].bid, ticks[i].ask}) {
+            int d = digits;
+            while (d < 8) {
+                const double scaled = price * std::pow(10.0, d);
+                if (std::fabs(scaled - std::nearbyint(scaled)) < 1e-9 * std::fabs(scaled) + 1e-7)
+                    break;
+                ++d;
+            }
+            digits = d;
+        }
+    }
+    return std::pow(10.0, -digits);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,108 @@
+/*
+ * history.hpp
+ *
+ * Local store of bars and ticks fetched from a backend.
+ *
+ * Requests for copy_ticks_* / copy_rates_* with "save": true append the
+ * returned records to files under history.dir:
+ *
+ *   <symbol>.ticks         ticks, oldest first
+ *   <symbol>.<tf>.bars     bars of one timeframe (M1, H4, D1, ...)
+ *
+ * Each file is a 64-byte header (magic "MT5BHST\0", uint32 version,
+ * uint32 kind, uint32 record_size, int32 timeframe, char symbol[32],
+ * uint64 reserved) followed by Tick or Bar records exactly as laid out in
+ * memory, so a file can be mapped and used in place.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+/* Read-only memory mapping of a whole file. */
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string &path, std::string &error);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile() = default;
+
+    const unsigned char *data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    void *file_ = nullptr;
+    void *mapping_ = nullptr;
+#endif
+};
+
+/* Records of one history file, mapped or built in memory. Copies share
+ * the records, so one series can back many concurrent readers.
+ */
+template <typename T>
+struct Series {
+    std::shared_ptr<MappedFile> file;               // Keeps mapped records alive.
+    std::shared_ptr<const std::vector<T>> owned;    // Records built in memory.
+    const T *records = nullptr;
+    size_t count = 0;
+
+    const T *begin() const { return records; }
+    const T *end() const { return records + count; }
+};
+
+using TickSeries = Series<Tick>;
+using BarSeries = Series<Bar>;
+
+/* "M1", "H4", "D1", "W1", "MN1"; empty for unknown timeframes. */
+std::string timeframe_name(int64_t timeframe);
+
+std::string ticks_path(const std::string &dir, const std::string &symbol);
+std::string bars_path(const std::string &dir, const std::string &symbol, int64_t timeframe);
+
+/* Maps a history file. False with error if it is missing or malformed. */
+bool open_ticks(const std::string &path, TickSeries &out, std::string &error);
+bool open_bars(const std::string &path, BarSeries &out, std::string &error);
+
+/* Appends ticks newer than the last stored one (same-millisecond ticks
+ * are told apart by seq when both carry one).
+ */
+bool save_ticks(const std::string &dir, const std::string &symbol,
+                const std::vector<Tick> &ticks, std::string &error);
+
+/* Stores ticks whatever the stored range: ticks newer than the last
+ * stored one are appended; otherwise the file is rewritten with the
+ * stored ticks inside the new ticks' time range replaced by them.
+ * replaced counts the stored ticks dropped.
+ */
+bool merge_ticks(const std::string &dir, const std::string &symbol,
+                 const std::vector<Tick> &ticks, size_t &replaced, std::string &error);
+
+/* Merges bars by open time; stored bars inside the new bars' time range
+ * are replaced, so a re-fetched forming bar overwrites its earlier state,
+ * and stored bars before and after it are kept. replaced counts the
+ * stored bars dropped.
+ */
+bool merge_bars(const std::string &dir, const std::string &symbol, int64_t timeframe,
+                const std::vector<Bar> &bars, size_t &replaced, std::string &error);
+bool save_bars(const std::string &dir, const std::string &symbol, int64_t timeframe,
+               const std::vector<Bar> &bars, std::string &error);
+
+/* Smallest price step that represents all sampled prices (1e-5 for
+ * five-digit quotes).
+ */
+double infer_point(const Tick *ticks, size_t count);
+
+} // namespace mt5bridge
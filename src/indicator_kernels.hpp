@@ -0,0 +1,167 @@
+/*
+ * indicator_kernels.hpp
+ *
+ * Indicator kernels written once over a vector type.
+ *
+ * Each ISA translation unit includes <cmath> and indicators.hpp, then
+ * includes this file inside a namespace of its own, defines Vec (its
+ * widest vector of doubles) and builds its table with kernels_for<Vec>.
+ * The namespace keeps every instantiation, compiled with that unit's ISA
+ * flags, apart from the other units' (and only reachable through the
+ * table the CPU check selected).
+ *
+ * Vec provides W (lanes) and the static members load, store, set1, max,
+ * sqrt, abs, zero_if_zero(den, v) (lanes where den == 0 become 0),
+ * powers(d) ([d, d^2, ..., d^W]), scan_lanes(v, d) (lane k becomes the sum
+ * over j <= k of d^(k-j) * lane j), broadcast_last and last, plus the
+ * operators + - * /. One is the one-lane version, used for tails.
+ */
+
+struct One {
+    static constexpr size_t W = 1;
+    double v;
+
+    static One load(const double *p) { return {*p}; }
+    static void store(double *p, One a) { *p = a.v; }
+    static One set1(double x) { return {x}; }
+    static One max(One a, One b) { return {a.v > b.v ? a.v : b.v}; }
+    static One sqrt(One a) { return {std::sqrt(a.v)}; }
+    static One abs(One a) { return {a.v < 0.0 ? -a.v : a.v}; }
+    static One zero_if_zero(One den, One a) { return {den.v == 0.0 ? 0.0 : a.v}; }
+    static One powers(double d) { return {d}; }
+    static One scan_lanes(One a, double) { return a; }
+    static One broadcast_last(One a) { return a; }
+    static double last(One a) { return a.v; }
+};
+
+inline One operator+(One a, One b) { return {a.v + b.v}; }
+inline One operator-(One a, One b) { return {a.v - b.v}; }
+inline One operator*(One a, One b) { return {a.v * b.v}; }
+inline One operator/(One a, One b) { return {a.v / b.v}; }
+
+/* Calls f(Vec{}, i) for whole vectors, then f(One{}, i) for the tail. */
+template <typename Vec, typename F>
+void for_lanes(size_t n, F f) {
+    size_t i = 0;
+    for (; i + Vec::W <= n; i += Vec::W)
+        f(Vec{}, i);
+    for (; i < n; ++i)
+        f(One{}, i);
+}
+
+template <typename Vec>
+double k_scan(const double *in, size_t n, double decay, double carry, double *out) {
+    size_t i = 0;
+    if (n >= Vec::W) {
+        const Vec pw = Vec::powers(decay);
+        Vec c = Vec::set1(carry);
+        for (; i + Vec::W <= n; i += Vec::W) {
+            const Vec v = Vec::scan_lanes(Vec::load(in + i), decay) + pw * c;
+            Vec::store(out + i, v);
+            c = Vec::broadcast_last(v);
+        }
+        carry = Vec::last(c);
+    }
+    for (; i < n; ++i)
+        out[i] = carry = in[i] + decay * carry;
+    return carry;
+}
+
+template <typename Vec>
+void k_sub(const double *a, const double *b, size_t n, double *out) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        V::store(out + i, V::load(a + i) - V::load(b + i));
+    });
+}
+
+template <typename Vec>
+void k_affine(const double *in, size_t n, double k, double b, double *out) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        V::store(out + i, V::set1(k) * V::load(in + i) + V::set1(b));
+    });
+}
+
+template <typename Vec>
+void k_sq_diff(const double *a, const double *b, size_t n, double c, double *out) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V x = V::load(a + i) - V::set1(c);
+        const V y = V::load(b + i) - V::set1(c);
+        V::store(out + i, x * x - y * y);
+    });
+}
+
+template <typename Vec>
+void k_moments(const double *sum, const double *sq, size_t n, double c, double inv_p,
+               double *mean, double *sd) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V m = V::load(sum + i) * V::set1(inv_p);
+        const V var = V::load(sq + i) * V::set1(inv_p) - m * m;
+        V::store(mean + i, m + V::set1(c));
+        V::store(sd + i, V::sqrt(V::max(var, V::set1(0.0))));
+    });
+}
+
+template <typename Vec>
+void k_gain_loss(const double *close, size_t n, double *gain, double *loss) {
+    if (n < 2)
+        return;
+    for_lanes<Vec>(n - 1, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V d = V::load(close + i + 1) - V::load(close + i);
+        V::store(gain + i, V::max(d, V::set1(0.0)));
+        V::store(loss + i, V::max(V::set1(0.0) - d, V::set1(0.0)));
+    });
+}
+
+template <typename Vec>
+void k_true_range(const double *high, const double *low, const double *close, size_t n,
+                  double *out) {
+    if (n < 2)
+        return;
+    for_lanes<Vec>(n - 1, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V h = V::load(high + i + 1), l = V::load(low + i + 1), pc = V::load(close + i);
+        V::store(out + i, V::max(h - l, V::max(V::abs(h - pc), V::abs(l - pc))));
+    });
+}
+
+template <typename Vec>
+void k_rsi(const double *gain, const double *loss, size_t n, double *out) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V g = V::load(gain + i);
+        const V total = g + V::load(loss + i);
+        V::store(out + i, V::zero_if_zero(total, V::set1(100.0) * g / total));
+    });
+}
+
+template <typename Vec>
+void k_zscore(const double *x, const double *mean, const double *sd, size_t n, double *out) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        V::store(out + i, (V::load(x + i) - V::load(mean + i)) / V::load(sd + i));
+    });
+}
+
+template <typename Vec>
+void k_bands(const double *mid, const double *sd, size_t n, double k, double *upper,
+             double *lower) {
+    for_lanes<Vec>(n, [&](auto lane, size_t i) {
+        using V = decltype(lane);
+        const V m = V::load(mid + i);
+        const V w = V::set1(k) * V::load(sd + i);
+        V::store(upper + i, m + w);
+        V::store(lower + i, m - w);
+    });
+}
+
+template <typename Vec>
+IndicatorKernels kernels_for(const char *isa) {
+    return {isa,           k_scan<Vec>,      k_sub<Vec>,        k_affine<Vec>,
+            k_sq_diff<Vec>, k_moments<Vec>,   k_gain_loss<Vec>,  k_true_range<Vec>,
+            k_rsi<Vec>,    k_zscore<Vec>,    k_bands<Vec>};
+}
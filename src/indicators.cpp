@@ -0,0 +1,358 @@
+/*
+ * indicators.cpp
+ *
+ * Indicator drivers over the kernel table, scalar kernels and the CPU
+ * check that picks the table.
+ */
+
+#include "indicators.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define MT5BRIDGE_X86 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define MT5BRIDGE_X86 1
+#endif
+
+namespace mt5bridge {
+namespace scalar {
+
+#include "indicator_kernels.hpp"
+
+} // namespace scalar
+
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+std::atomic<const IndicatorKernels *> g_kernels{nullptr};
+
+/* Scratch columns of the calling thread, reused across calls. */
+enum Slot { kIn0, kIn1, kIn2, kTmp0, kTmp1, kTmp2, kTmp3, kSlots };
+thread_local std::vector<double> g_scratch[kSlots];
+
+const IndicatorKernels *scalar_kernels() {
+    static const IndicatorKernels kernels = scalar::kernels_for<scalar::One>("scalar");
+    return &kernels;
+}
+
+struct CpuFeatures {
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+#if defined(MT5BRIDGE_X86)
+
+bool cpuid(unsigned leaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (static_cast<unsigned>(r[0]) < leaf)
+        return false;
+    __cpuidex(r, static_cast<int>(leaf), 0);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = static_cast<unsigned>(r[i]);
+    return true;
+#else
+    return __get_cpuid_count(leaf, 0, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+#endif
+}
+
+/* Register state the OS saves on context switches (XCR0). */
+uint64_t os_saved_state() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+/* The CPU must have the instructions and the OS must save the wider
+ * registers: YMM for AVX2, plus opmask and ZMM for AVX-512.
+ */
+CpuFeatures detect_cpu() {
+    CpuFeatures f;
+    unsigned r1[4], r7[4];
+    if (!cpuid(1, r1) || !(r1[2] & (1u << 27)) || !(r1[2] & (1u << 28)))
+        return f;
+    if (!cpuid(7, r7))
+        return f;
+    const uint64_t xcr0 = os_saved_state();
+    f.avx2 = (xcr0 & 0x6) == 0x6 && (r7[1] & (1u << 5));
+    f.avx512 = f.avx2 && (xcr0 & 0xE6) == 0xE6 && (r7[1] & (1u << 16));
+    return f;
+}
+
+#else
+
+CpuFeatures detect_cpu() { return {}; }
+
+#endif
+
+const IndicatorKernels *select_kernels(const std::string &name) {
+    static const CpuFeatures cpu = detect_cpu();
+    const IndicatorKernels *avx512 = cpu.avx512 ? avx512_indicator_kernels() : nullptr;
+    const IndicatorKernels *avx2 = cpu.avx2 ? avx2_indicator_kernels() : nullptr;
+    if (name == "scalar")
+        return scalar_kernels();
+    if (name != "avx2" && avx512)
+        return avx512;
+    return avx2 ? avx2 : scalar_kernels();
+}
+
+const IndicatorKernels &kernels() {
+    const IndicatorKernels *k = g_kernels.load(std::memory_order_acquire);
+    if (!k) {
+        k = select_kernels("auto");
+        g_kernels.store(k, std::memory_order_release);
+    }
+    return *k;
+}
+
+double *scratch(Slot slot, size_t n) {
+    std::vector<double> &v = g_scratch[slot];
+    if (v.size() < n)
+        v.resize(n);
+    return v.data();
+}
+
+/* in as a contiguous array, gathered into slot unless it already is one. */
+const double *contiguous(const double *in, size_t stride, size_t n, Slot slot) {
+    if (stride == sizeof(double))
+        return in;
+    double *out = scratch(slot, n);
+    const char *p = reinterpret_cast<const char *>(in);
+    for (size_t i = 0; i < n; ++i, p += stride)
+        out[i] = *reinterpret_cast<const double *>(p);
+    return out;
+}
+
+void fill_nan(double *out, size_t count) { std::fill(out, out + count, kNaN); }
+
+bool check(const char *name, const void *in, size_t stride, size_t period, const void *out,
+           std::string &error) {
+    if (!in || !out) {
+        error = std::string(name) + ": null input or output";
+        return false;
+    }
+    if (stride < sizeof(double)) {
+        error = std::string(name) + ": stride smaller than a double";
+        return false;
+    }
+    if (period == 0) {
+        error = std::string(name) + ": period must be positive";
+        return false;
+    }
+    return true;
+}
+
+/* Window mean and standard deviation of x over period p for outputs
+ * p-1 .. n-1; mean or sd may be null. Runs in blocks: each starts from an
+ * exact sum of its first window around c = x[block start] and scans the
+ * per-step differences from there.
+ */
+void window_moments(const double *x, size_t n, size_t p, double *mean, double *sd) {
+    const IndicatorKernels &k = kernels();
+    const size_t block = std::max(kAnchorBlock, p);
+    double *sum = scratch(kTmp0, block);
+    double *sq = sd ? scratch(kTmp1, block) : nullptr;
+    double *tmp_mean = mean ? nullptr : scratch(kTmp2, block);
+    const double inv_p = 1.0 / static_cast<double>(p);
+    for (size_t i0 = p - 1; i0 < n; i0 += block) {
+        const size_t len = std::min(block, n - i0);
+        const double c = x[i0];
+        double s = 0.0, q = 0.0;
+        for (size_t j = i0 + 1 - p; j <= i0; ++j) {
+            const double d = x[j] - c;
+            s += d;
+            q += d * d;
+        }
+        const double *head = x + i0 + 1, *tail = x + i0 + 1 - p;
+        sum[0] = s;
+        k.sub(head, tail, len - 1, sum + 1);
+        k.scan(sum + 1, len - 1, 1.0, s, sum + 1);
+        double *m = mean ? mean + i0 : tmp_mean;
+        if (sd) {
+            sq[0] = q;
+            k.sq_diff(head, tail, len - 1, c, sq + 1);
+            k.scan(sq + 1, len - 1, 1.0, q, sq + 1);
+            k.moments(sum, sq, len, c, inv_p, m, sd + i0);
+        } else {
+            k.affine(sum, len, inv_p, c, m);
+        }
+    }
+}
+
+/* Exponential smoothing of x with factor alpha, seeded with the mean of
+ * the first p values at p-1; writes out[p-1 .. n-1].
+ */
+void smooth(const double *x, size_t n, size_t p, double alpha, double *out) {
+    if (n < p)
+        return;
+    const IndicatorKernels &k = kernels();
+    double seed = 0.0;
+    for (size_t i = 0; i < p; ++i)
+        seed += x[i];
+    seed /= static_cast<double>(p);
+    out[p - 1] = seed;
+    k.affine(x + p, n - p, alpha, 0.0, out + p);
+    k.scan(out + p, n - p, 1.0 - alpha, seed, out + p);
+}
+
+/* Wilder smoothing of n - 1 per-step values into out[period .. n-1]. */
+void wilder(const double *steps, size_t n, size_t period, double *out) {
+    if (n > period)
+        smooth(steps, n - 1, period, 1.0 / static_cast<double>(period), out + 1);
+}
+
+} // namespace
+
+void set_indicator_isa(const std::string &name) {
+    g_kernels.store(select_kernels(name), std::memory_order_release);
+}
+
+const char *indicator_isa() { return kernels().isa; }
+
+bool sma(const double *in, size_t stride, size_t n, size_t period, double *out,
+         std::string &error) {
+    if (!check("sma", in, stride, period, out, error))
+        return false;
+    fill_nan(out, std::min(n, period - 1));
+    window_moments(contiguous(in, stride, n, kIn0), n, period, out, nullptr);
+    return true;
+}
+
+bool ema(const double *in, size_t stride, size_t n, size_t period, double *out,
+         std::string &error) {
+    if (!check("ema", in, stride, period, out, error))
+        return false;
+    fill_nan(out, std::min(n, period - 1));
+    smooth(contiguous(in, stride, n, kIn0), n, period, 2.0 / static_cast<double>(period + 1),
+           out);
+    return true;
+}
+
+bool stddev(const double *in, size_t stride, size_t n, size_t period, double *out,
+            std::string &error) {
+    if (!check("stddev", in, stride, period, out, error))
+        return false;
+    fill_nan(out, std::min(n, period - 1));
+    window_moments(contiguous(in, stride, n, kIn0), n, period, nullptr, out);
+    return true;
+}
+
+bool zscore(const double *in, size_t stride, size_t n, size_t period, double *out,
+            std::string &error) {
+    if (!check("zscore", in, stride, period, out, error))
+        return false;
+    fill_nan(out, std::min(n, period - 1));
+    if (n < period)
+        return true;
+    const double *x = contiguous(in, stride, n, kIn0);
+    double *mean = scratch(kTmp3, n);
+    window_moments(x, n, period, mean, out);
+    const size_t from = period - 1;
+    kernels().zscore(x + from, mean + from, out + from, n - from, out + from);
+    return true;
+}
+
+bool bollinger(const double *in, size_t stride, size_t n, size_t period, double k, double *mid,
+               double *upper, double *lower, std::string &error) {
+    if (!check("bollinger", in, stride, period, mid, error))
+        return false;
+    if (!upper || !lower) {
+        error = "bollinger: null input or output";
+        return false;
+    }
+    const size_t warm = std::min(n, period - 1);
+    fill_nan(mid, warm);
+    fill_nan(upper, warm);
+    fill_nan(lower, warm);
+    if (n < period)
+        return true;
+    window_moments(contiguous(in, stride, n, kIn0), n, period, mid, upper);
+    const size_t from = period - 1;
+    kernels().bands(mid + from, upper + from, n - from, k, upper + from, lower + from);
+    return true;
+}
+
+bool rsi(const double *close, size_t stride, size_t n, size_t period, double *out,
+         std::string &error) {
+    if (!check("rsi", close, stride, period, out, error))
+        return false;
+    fill_nan(out, std::min(n, period));
+    if (n <= period)
+        return true;
+    const IndicatorKernels &k = kernels();
+    const double *c = contiguous(close, stride, n, kIn0);
+    double *gain = scratch(kTmp0, n), *loss = scratch(kTmp1, n);
+    double *avg_gain = scratch(kTmp2, n), *avg_loss = scratch(kTmp3, n);
+    k.gain_loss(c, n, gain, loss);
+    wilder(gain, n, period, avg_gain);
+    wilder(loss, n, period, avg_loss);
+    k.rsi(avg_gain + period, avg_loss + period, n - period, out + period);
+    return true;
+}
+
+bool atr(const double *high, const double *low, const double *close, size_t stride, size_t n,
+         size_t period, double *out, std::string &error) {
+    if (!check("atr", close, stride, period, out, error))
+        return false;
+    if (!high || !low) {
+        error = "atr: null input or output";
+        return false;
+    }
+    fill_nan(out, std::min(n, period));
+    if (n <= period)
+        return true;
+    const IndicatorKernels &k = kernels();
+    double *tr = scratch(kTmp0, n);
+    k.true_range(contiguous(high, stride, n, kIn0), contiguous(low, stride, n, kIn1),
+                 contiguous(close, stride, n, kIn2), n, tr);
+    wilder(tr, n, period, out);
+    return true;
+}
+
+bool macd(const double *close, size_t stride, size_t n, size_t fast, size_t slow, size_t signal,
+          double *macd_out, double *signal_out, double *hist, std::string &error) {
+    if (!check("macd", close, stride, fast, macd_out, error))
+        return false;
+    if (!signal_out || !hist) {
+        error = "macd: null input or output";
+        return false;
+    }
+    if (signal == 0 || fast >= slow) {
+        error = "macd: requires 0 < fast < slow and signal > 0";
+        return false;
+    }
+    const size_t first = slow - 1, warm = std::min(n, slow + signal - 2);
+    fill_nan(macd_out, std::min(n, first));
+    fill_nan(signal_out, warm);
+    fill_nan(hist, warm);
+    if (n < slow)
+        return true;
+    const IndicatorKernels &k = kernels();
+    const double *c = contiguous(close, stride, n, kIn0);
+    double *fast_ema = scratch(kTmp3, n);
+    smooth(c, n, fast, 2.0 / static_cast<double>(fast + 1), fast_ema);
+    smooth(c, n, slow, 2.0 / static_cast<double>(slow + 1), macd_out);
+    k.sub(fast_ema + first, macd_out + first, n - first, macd_out + first);
+    smooth(macd_out + first, n - first, signal, 2.0 / static_cast<double>(signal + 1),
+           signal_out + first);
+    if (n > warm)
+        k.sub(macd_out + warm, signal_out + warm, n - warm, hist + warm);
+    return true;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,103 @@
+/*
+ * indicators.hpp
+ *
+ * Technical indicators over columns of doubles: SMA, EMA, rolling
+ * standard deviation, z-score, Bollinger bands, RSI, ATR and MACD.
+ *
+ * Inputs are n values spaced stride bytes apart, so a field of a bar
+ * array is read in place (&bars[0].close with stride sizeof(Bar)); other
+ * strides than sizeof(double) are gathered once into scratch memory.
+ * Outputs are plain arrays of n values. Positions before the first full
+ * window are NaN. Inputs must be finite.
+ *
+ * Every indicator reduces to two kinds of kernels. Element-wise kernels
+ * combine columns. Scan kernels evaluate out[i] = in[i] + decay *
+ * out[i-1]: running window sums use decay 1, and EMA and Wilder
+ * smoothing use 1 - alpha. Scans run a block of lanes at a time, a
+ * prefix scan inside the register plus the carry from the previous
+ * block, so even the recursive indicators use the full vector width.
+ * Window sums are recomputed exactly every kAnchorBlock outputs,
+ * around a local reference value, which bounds rounding drift on long
+ * series.
+ *
+ * Kernels are built for scalar code, AVX2 and AVX-512F
+ * (indicators_avx2.cpp, indicators_avx512.cpp). indicators.isa selects
+ * one: "auto" takes the widest the CPU and OS support, and a named ISA
+ * the CPU lacks falls back to the next narrower one.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace mt5bridge {
+
+constexpr size_t kAnchorBlock = 4096;
+
+/* Kernel table of one ISA. Counts are elements; pointers may alias only
+ * where noted.
+ */
+struct IndicatorKernels {
+    const char *isa;
+    /* out[i] = in[i] + decay * out[i-1] with out[-1] = carry; returns
+     * out[n-1] (carry if n == 0). in may equal out.
+     */
+    double (*scan)(const double *in, size_t n, double decay, double carry, double *out);
+    void (*sub)(const double *a, const double *b, size_t n, double *out);
+    /* out = k * in + b; in may equal out. */
+    void (*affine)(const double *in, size_t n, double k, double b, double *out);
+    /* out = (a - c)^2 - (b - c)^2. */
+    void (*sq_diff)(const double *a, const double *b, size_t n, double c, double *out);
+    /* From window sums of x - c and (x - c)^2: mean and population
+     * standard deviation.
+     */
+    void (*moments)(const double *sum, const double *sq, size_t n, double c, double inv_p,
+                    double *mean, double *sd);
+    /* n - 1 outputs: gain and loss of close[i+1] against close[i]. */
+    void (*gain_loss)(const double *close, size_t n, double *gain, double *loss);
+    /* n - 1 outputs: true range of bar i+1. */
+    void (*true_range)(const double *high, const double *low, const double *close, size_t n,
+                       double *out);
+    /* 100 * gain / (gain + loss), 0 where both are 0. */
+    void (*rsi)(const double *gain, const double *loss, size_t n, double *out);
+    void (*zscore)(const double *x, const double *mean, const double *sd, size_t n, double *out);
+    /* upper = mid + k * sd, lower = mid - k * sd. */
+    void (*bands)(const double *mid, const double *sd, size_t n, double k, double *upper,
+                  double *lower);
+};
+
+/* Tables of the vector ISAs; nullptr when not built for this target. */
+const IndicatorKernels *avx2_indicator_kernels();
+const IndicatorKernels *avx512_indicator_kernels();
+
+/* Selects kernels for "auto", "scalar", "avx2" or "avx512". */
+void set_indicator_isa(const std::string &name);
+
+/* ISA of the selected kernels. */
+const char *indicator_isa();
+
+/* Each returns false with error for a zero period or null pointer. */
+bool sma(const double *in, size_t stride, size_t n, size_t period, double *out,
+         std::string &error);
+bool ema(const double *in, size_t stride, size_t n, size_t period, double *out,
+         std::string &error);
+bool stddev(const double *in, size_t stride, size_t n, size_t period, double *out,
+            std::string &error);
+bool zscore(const double *in, size_t stride, size_t n, size_t period, double *out,
+            std::string &error);
+bool bollinger(const double *in, size_t stride, size_t n, size_t period, double k, double *mid,
+               double *upper, double *lower, std::string &error);
+/* Wilder's RSI; the first value is at index period. */
+bool rsi(const double *close, size_t stride, size_t n, size_t period, double *out,
+         std::string &error);
+/* Wilder's ATR; the first value is at index period. */
+bool atr(const double *high, const double *low, const double *close, size_t stride, size_t n,
+         size_t period, double *out, std::string &error);
+/* fast < slow; macd from index slow - 1, signal and hist from
+ * slow + signal - 2.
+ */
+bool macd(const double *close, size_t stride, size_t n, size_t fast, size_t slow, size_t signal,
+          double *macd_out, double *signal_out, double *hist, std::string &error);
+
+} // namespace mt5bridge
@@ -0,0 +1,74 @@
+/*
+ * indicators_avx2.cpp
+ *
+ * Indicator kernels on 4-lane AVX2 vectors. Built with AVX2 enabled for
+ * this file only; the table is used only after the CPU check in
+ * indicators.cpp.
+ */
+
+#include "indicators.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace mt5bridge {
+namespace avx2 {
+
+#include "indicator_kernels.hpp"
+
+struct Vec {
+    static constexpr size_t W = 4;
+    __m256d v;
+
+    static Vec load(const double *p) { return {_mm256_loadu_pd(p)}; }
+    static void store(double *p, Vec a) { _mm256_storeu_pd(p, a.v); }
+    static Vec set1(double x) { return {_mm256_set1_pd(x)}; }
+    static Vec max(Vec a, Vec b) { return {_mm256_max_pd(a.v, b.v)}; }
+    static Vec sqrt(Vec a) { return {_mm256_sqrt_pd(a.v)}; }
+    static Vec abs(Vec a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+    static Vec zero_if_zero(Vec den, Vec a) {
+        const __m256d zero = _mm256_setzero_pd();
+        return {_mm256_blendv_pd(a.v, zero, _mm256_cmp_pd(den.v, zero, _CMP_EQ_OQ))};
+    }
+    static Vec powers(double d) {
+        const double d2 = d * d;
+        return {_mm256_set_pd(d2 * d2, d2 * d, d2, d)};
+    }
+    /* Two shift-and-add steps: lanes move up by 1, then by 2. */
+    static Vec scan_lanes(Vec a, double d) {
+        const __m256d s1 = _mm256_blend_pd(_mm256_permute4x64_pd(a.v, 0x90),
+                                           _mm256_setzero_pd(), 0x1);
+        __m256d v = _mm256_add_pd(a.v, _mm256_mul_pd(_mm256_set1_pd(d), s1));
+        const __m256d s2 = _mm256_permute2f128_pd(v, v, 0x08);
+        return {_mm256_add_pd(v, _mm256_mul_pd(_mm256_set1_pd(d * d), s2))};
+    }
+    static Vec broadcast_last(Vec a) { return {_mm256_permute4x64_pd(a.v, 0xFF)}; }
+    static double last(Vec a) { return _mm256_cvtsd_f64(_mm256_permute4x64_pd(a.v, 0xFF)); }
+};
+
+inline Vec operator+(Vec a, Vec b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline Vec operator-(Vec a, Vec b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline Vec operator*(Vec a, Vec b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline Vec operator/(Vec a, Vec b) { return {_mm256_div_pd(a.v, b.v)}; }
+
+} // namespace avx2
+
+const IndicatorKernels *avx2_indicator_kernels() {
+    static const IndicatorKernels kernels = avx2::kernels_for<avx2::Vec>("avx2");
+    return &kernels;
+}
+
+} // namespace mt5bridge
+
+#else
+
+namespace mt5bridge {
+
+const IndicatorKernels *avx2_indicator_kernels() { return nullptr; }
+
+} // namespace mt5bridge
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * indicators_avx512.cpp
+ *
+ * Indicator kernels on 8-lane AVX-512F vectors. Built with AVX-512F
+ * enabled for this file only; the table is used only after the CPU check
+ * in indicators.cpp.
+ */
+
+#include "indicators.hpp"
+
+#include <cmath>
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+/* GCC 12's AVX-512 intrinsics pass _mm512_undefined_pd() as the unused
+ * merge source, which -Wmaybe-uninitialized reports once inlined.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace mt5bridge {
+namespace avx512 {
+
+#include "indicator_kernels.hpp"
+
+struct Vec {
+    static constexpr size_t W = 8;
+    __m512d v;
+
+    static Vec load(const double *p) { return {_mm512_loadu_pd(p)}; }
+    static void store(double *p, Vec a) { _mm512_storeu_pd(p, a.v); }
+    static Vec set1(double x) { return {_mm512_set1_pd(x)}; }
+    static Vec max(Vec a, Vec b) { return {_mm512_max_pd(a.v, b.v)}; }
+    static Vec sqrt(Vec a) { return {_mm512_sqrt_pd(a.v)}; }
+    static Vec abs(Vec a) { return {_mm512_abs_pd(a.v)}; }
+    static Vec zero_if_zero(Vec den, Vec a) {
+        const __m512d zero = _mm512_setzero_pd();
+        return {_mm512_mask_blend_pd(_mm512_cmp_pd_mask(den.v, zero, _CMP_EQ_OQ), a.v, zero)};
+    }
+    static Vec powers(double d) {
+        const double d2 = d * d, d4 = d2 * d2;
+        return {_mm512_set_pd(d4 * d4, d4 * d2 * d, d4 * d2, d4 * d, d4, d2 * d, d2, d)};
+    }
+    /* Three shift-and-add steps: lanes move up by 1, 2, then 4; the
+     * vacated low lanes are zeroed by the mask.
+     */
+    static Vec scan_lanes(Vec a, double d) {
+        const double d2 = d * d;
+        __m512d v = a.v;
+        v = _mm512_fmadd_pd(
+            _mm512_set1_pd(d),
+            _mm512_maskz_permutexvar_pd(0xFE, _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0), v), v);
+        v = _mm512_fmadd_pd(
+            _mm512_set1_pd(d2),
+            _mm512_maskz_permutexvar_pd(0xFC, _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0), v), v);
+        v = _mm512_fmadd_pd(
+            _mm512_set1_pd(d2 * d2),
+            _mm512_maskz_permutexvar_pd(0xF0, _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0), v), v);
+        return {v};
+    }
+    static Vec broadcast_last(Vec a) {
+        return {_mm512_permutexvar_pd(_mm512_set1_epi64(7), a.v)};
+    }
+    static double last(Vec a) { return _mm512_cvtsd_f64(broadcast_last(a).v); }
+};
+
+inline Vec operator+(Vec a, Vec b) { return {_mm512_add_pd(a.v, b.v)}; }
+inline Vec operator-(Vec a, Vec b) { return {_mm512_sub_pd(a.v, b.v)}; }
+inline Vec operator*(Vec a, Vec b) { return {_mm512_mul_pd(a.v, b.v)}; }
+inline Vec operator/(Vec a, Vec b) { return {_mm512_div_pd(a.v, b.v)}; }
+
+} // namespace avx512
+
+const IndicatorKernels *avx512_indicator_kernels() {
+    static const IndicatorKernels kernels = avx512::kernels_for<avx512::Vec>("avx512");
+    return &kernels;
+}
+
+} // namespace mt5bridge
+
+#else
+
+namespace mt5bridge {
+
+const IndicatorKernels *avx512_indicator_kernels() { return nullptr; }
+
+} // namespace mt5bridge
+
+#endif
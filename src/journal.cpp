@@ -0,0 +1,190 @@
+/*
+ * journal.cpp
+ *
+ * Journal encoding, background writer and reader.
+ */
+
+#include "journal.hpp"
+#include "clock.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+const char kMagic[8] = {'M', 'T', '5', 'B', 'J', 'N', 'L', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 24;
+constexpr size_t kRecordFixed = 4 + 1 + 1 + 2 + 8 + 8 + 4 + 4 + 4;
+
+template <class T> void put(std::string &buf, T v) {
+    char raw[sizeof(T)];
+    std::memcpy(raw, &v, sizeof(T));
+    buf.append(raw, sizeof(T));
+}
+
+template <class T> T get(const unsigned char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+std::string dump(const json_t *json) {
+    if (!json)
+        return std::string();
+    char *s = json_dumps(json, JSON_COMPACT | JSON_SORT_KEYS | JSON_ENCODE_ANY);
+    std::string out = s ? s : "";
+    std::free(s);
+    return out;
+}
+
+} // namespace
+
+std::unique_ptr<JournalWriter> JournalWriter::open(const std::string &path, size_t capacity,
+                                                   std::string &error) {
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        error = "cannot create journal: " + path;
+        return nullptr;
+    }
+    std::string header(kMagic, sizeof kMagic);
+    put<uint32_t>(header, kVersion);
+    put<uint32_t>(header, 0);
+    put<int64_t>(header, now_ns());
+    if (std::fwrite(header.data(), 1, header.size(), f) != header.size()) {
+        std::fclose(f);
+        error = "cannot write journal header: " + path;
+        return nullptr;
+    }
+    return std::unique_ptr<JournalWriter>(new JournalWriter(f, capacity));
+}
+
+JournalWriter::JournalWriter(std::FILE *file, size_t capacity)
+    : file_(file), capacity_(capacity ? capacity : 1),
+      has_work_(thread_policy(ThreadRole::DiskWriter)) {
+    thread_ = start_thread(ThreadRole::DiskWriter, [this] { run(); });
+}
+
+JournalWriter::~JournalWriter() {
+    stop_.store(true);
+    has_work_.notify();
+    has_room_.notify();
+    if (thread_.joinable())
+        thread_.join();
+    std::fclose(file_);
+}
+
+void JournalWriter::record_eval(const json_t *request, const json_t *response,
+                                const std::string &error, int64_t t_request_ns,
+                                int64_t t_response_ns) {
+    const bool ok = response != nullptr;
+    const std::string req = dump(request);
+    const std::string resp = dump(response);
+
+    std::string rec;
+    rec.reserve(kRecordFixed + req.size() + resp.size() + error.size());
+    put<uint32_t>(rec, static_cast<uint32_t>(kRecordFixed - 4 + req.size() + resp.size() +
+                                             error.size()));
+    put<uint8_t>(rec, static_cast<uint8_t>(JournalKind::Eval));
+    put<uint8_t>(rec, ok ? 1 : 0);
+    put<uint16_t>(rec, 0);
+    put<int64_t>(rec, t_request_ns);
+    put<int64_t>(rec, t_response_ns);
+    put<uint32_t>(rec, static_cast<uint32_t>(req.size()));
+    put<uint32_t>(rec, static_cast<uint32_t>(resp.size()));
+    put<uint32_t>(rec, static_cast<uint32_t>(error.size()));
+    rec += req;
+    rec += resp;
+    rec += error;
+
+    has_room_.wait([this] {
+        return pending_count_.load() < capacity_ || stop_.load();
+    });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(rec));
+        pending_count_.fetch_add(1);
+    }
+    has_work_.notify();
+}
+
+void JournalWriter::run() {
+    for (;;) {
+        has_work_.wait([this] { return pending_count_.load() > 0 || stop_.load(); });
+
+        std::deque<std::string> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.swap(pending_);
+            pending_count_.store(0);
+        }
+        has_room_.notify();
+
+        if (batch.empty()) {
+            if (stop_.load())
+                break;
+            continue;
+        }
+        for (const std::string &rec : batch) {
+            std::fwrite(rec.data(), 1, rec.size(), file_);
+            bytes_.fetch_add(rec.size(), std::memory_order_relaxed);
+        }
+        records_.fetch_add(batch.size(), std::memory_order_relaxed);
+        std::fflush(file_);
+    }
+}
+
+bool read_journal(const std::string &path, std::vector<JournalRecord> &out,
+                  std::string &error) {
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "cannot open journal: " + path;
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof chunk, f)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    std::fclose(f);
+
+    if (data.size() < kHeaderSize || std::memcmp(data.data(), kMagic, sizeof kMagic) != 0) {
+        error = "not a bridge journal: " + path;
+        return false;
+    }
+    if (get<uint32_t>(data.data() + 8) != kVersion) {
+        error = "unsupported journal version: " + path;
+        return false;
+    }
+
+    size_t pos = kHeaderSize;
+    while (pos + kRecordFixed <= data.size()) {
+        const unsigned char *p = data.data() + pos;
+        const size_t size = get<uint32_t>(p);
+        if (pos + 4 + size > data.size())
+            break; // torn tail
+        JournalRecord rec;
+        rec.kind = static_cast<JournalKind>(p[4]);
+        rec.ok = p[5] != 0;
+        rec.t_request_ns = get<int64_t>(p + 8);
+        rec.t_response_ns = get<int64_t>(p + 16);
+        const size_t req_len = get<uint32_t>(p + 24);
+        const size_t resp_len = get<uint32_t>(p + 28);
+        const size_t err_len = get<uint32_t>(p + 32);
+        if (kRecordFixed + req_len + resp_len + err_len != size + 4) {
+            error = "corrupt journal record at offset " + std::to_string(pos);
+            return false;
+        }
+        rec.request.assign(reinterpret_cast<const char *>(p + kRecordFixed), req_len);
+        rec.response.assign(reinterpret_cast<const char *>(p + kRecordFixed + req_len), resp_len);
+        rec.error.assign(reinterpret_cast<const char *>(p + kRecordFixed + req_len + resp_len),
+                         err_len);
+        if (rec.kind == JournalKind::Eval)
+            out.push_back(std::move(rec));
+        pos += 4 + size;
+    }
+    return true;
+}
+
+} // namespace mt5bridge
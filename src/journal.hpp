@@ -0,0 +1,91 @@
+/*
+ * journal.hpp
+ *
+ * Binary journal of bridge traffic.
+ *
+ * File layout (little-endian):
+ *   header:  char magic[8] = "MT5BJNL\0", uint32 version, uint32 reserved,
+ *            int64 created_ns
+ *   records: uint32 size (bytes after this field), uint8 kind, uint8 ok,
+ *            uint16 reserved, int64 t_request_ns, int64 t_response_ns,
+ *            uint32 request_len, uint32 response_len, uint32 error_len,
+ *            request, response, error
+ *
+ * Eval records hold the request and the response as compact JSON, plus
+ * the error message left by the call (failed calls have no response).
+ * Typed calls are recorded as the eval request they stand for. Times
+ * come from TscClock. A record cut short by a crash ends the journal.
+ */
+
+#pragma once
+
+#include "thread_config.hpp"
+
+#include <jansson.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mt5bridge {
+
+enum class JournalKind : uint8_t { Eval = 1 };
+
+struct JournalRecord {
+    JournalKind kind = JournalKind::Eval;
+    bool ok = true;
+    int64_t t_request_ns = 0;
+    int64_t t_response_ns = 0;
+    std::string request;
+    std::string response;   // JSON; empty when !ok.
+    std::string error;      // mt5bridge_last_error() after the call.
+};
+
+/* Appends records on a disk_writer thread so callers never wait for I/O
+ * unless more than capacity records are pending.
+ */
+class JournalWriter {
+public:
+    static std::unique_ptr<JournalWriter> open(const std::string &path, size_t capacity,
+                                               std::string &error);
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter &) = delete;
+    JournalWriter &operator=(const JournalWriter &) = delete;
+
+    /* Records one mt5bridge_eval call. response may be null on failure. */
+    void record_eval(const json_t *request, const json_t *response,
+                     const std::string &error, int64_t t_request_ns,
+                     int64_t t_response_ns);
+
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+private:
+    JournalWriter(std::FILE *file, size_t capacity);
+    void run();
+
+    std::FILE *file_;
+    size_t capacity_;
+    std::mutex mutex_;
+    std::deque<std::string> pending_;
+    std::atomic<size_t> pending_count_{0};
+    std::atomic<bool> stop_{false};
+    Signal has_work_;
+    Signal has_room_;
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::thread thread_;
+};
+
+/* Reads all complete records of a journal. */
+bool read_journal(const std::string &path, std::vector<JournalRecord> &out,
+                  std::string &error);
+
+} // namespace mt5bridge
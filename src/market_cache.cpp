@@ -0,0 +1,150 @@
+/*
+ * market_cache.cpp
+ *
+ * Symbol interning, quote columns and bar rings.
+ */
+
+#include "market_cache.hpp"
+
+#include "clock.hpp"
+#include "config.hpp"
+
+namespace mt5bridge {
+
+size_t BarRing::merge(const Bar *bars, size_t count) {
+    size_t changed = 0;
+    const size_t cap = bars_.size();
+    for (size_t i = 0; i < count; ++i) {
+        const Bar &b = bars[i];
+        if (count_ && b.time < back(0).time)
+            continue;
+        if (count_ && b.time == back(0).time) {
+            bars_[(head_ + count_ - 1) % cap] = b;
+        } else if (count_ < cap) {
+            bars_[(head_ + count_) % cap] = b;
+            ++count_;
+        } else {
+            bars_[head_] = b;
+            head_ = (head_ + 1) % cap;
+        }
+        ++changed;
+    }
+    return changed;
+}
+
+MarketCache &MarketCache::instance() {
+    static MarketCache cache;
+    return cache;
+}
+
+int32_t MarketCache::intern(const char *symbol) {
+    auto it = ids_.find(symbol);
+    if (it != ids_.end())
+        return it->second;
+    if (names_.size() >= config().cache_max_symbols)
+        return -1;
+    const int32_t id = static_cast<int32_t>(names_.size());
+    names_.emplace_back(symbol);
+    ids_.emplace(names_.back(), id);
+    quotes_.push_back(Tick{});
+    bid_.push_back(0.0);
+    ask_.push_back(0.0);
+    last_.push_back(0.0);
+    time_msc_.push_back(0);
+    recv_ns_.push_back(0);
+    return id;
+}
+
+int32_t MarketCache::id(const char *symbol) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(symbol);
+    return it == ids_.end() ? -1 : it->second;
+}
+
+const std::string &MarketCache::name(int32_t id) const {
+    static const std::string kNone;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return id >= 0 && static_cast<size_t>(id) < names_.size() ? names_[id] : kNone;
+}
+
+int32_t MarketCache::add(const char *symbol) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return intern(symbol);
+}
+
+size_t MarketCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
+
+void MarketCache::on_tick(const char *symbol, const Tick &tick) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int32_t id = intern(symbol);
+    if (id < 0 || tick.time_msc < time_msc_[id])
+        return;
+    quotes_[id] = tick;
+    bid_[id] = tick.bid;
+    ask_[id] = tick.ask;
+    last_[id] = tick.last;
+    time_msc_[id] = tick.time_msc;
+    recv_ns_[id] = tick.recv_ns;
+}
+
+void MarketCache::on_ticks(const char *symbol, const std::vector<Tick> &ticks) {
+    if (!ticks.empty())
+        on_tick(symbol, ticks.back());
+}
+
+void MarketCache::on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars) {
+    if (bars.empty())
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int32_t id = intern(symbol);
+    if (id < 0)
+        return;
+    auto it = bars_.find({id, timeframe});
+    if (it == bars_.end())
+        it = bars_.emplace(std::make_pair(id, timeframe),
+                           BarRing(static_cast<size_t>(config().cache_bars)))
+                 .first;
+    // Only the newest capacity bars can stay.
+    const size_t cap = it->second.capacity();
+    const size_t skip = bars.size() > cap ? bars.size() - cap : 0;
+    it->second.merge(bars.data() + skip, bars.size() - skip);
+}
+
+bool MarketCache::quote(const char *symbol, Tick &out) const {
+    const int64_t ttl = quote_ttl_ns_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(symbol);
+    if (it == ids_.end() || time_msc_[it->second] == 0)
+        return false;
+    const int64_t recv = recv_ns_[it->second];
+    if (ttl > 0 && recv > 0 && now_ns() - recv > ttl)
+        return false;
+    out = quotes_[it->second];
+    return true;
+}
+
+void MarketCache::set_quote_ttl_ms(int64_t ms) {
+    quote_ttl_ns_.store(ms * 1000000, std::memory_order_relaxed);
+}
+
+void MarketCache::read(
+    const std::function<void(const QuoteColumns &quotes, const BarLookup &bars)> &fn) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    QuoteColumns quotes;
+    quotes.count = names_.size();
+    quotes.bid = bid_.data();
+    quotes.ask = ask_.data();
+    quotes.last = last_.data();
+    quotes.time_msc = time_msc_.data();
+    quotes.recv_ns = recv_ns_.data();
+    const BarLookup bars = [this](int32_t id, int64_t timeframe) -> const BarRing * {
+        auto it = bars_.find({id, timeframe});
+        return it == bars_.end() || it->second.size() == 0 ? nullptr : &it->second;
+    };
+    fn(quotes, bars);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,120 @@
+/*
+ * market_cache.hpp
+ *
+ * Latest quote and recent bars of every symbol the bridge has seen.
+ *
+ * Every live tick and bar answer passes through the cache (next to the
+ * stream indicators in responses.cpp): the newest tick of an answer
+ * becomes the symbol's quote, and bars are merged by open time into a
+ * ring of the last cache.bars bars per (symbol, timeframe), the newest of
+ * which may still be forming. Backtest answers are not cached.
+ *
+ * Symbols get dense ids in order of first sight, up to cache.max_symbols;
+ * later symbols are not cached. Ids and names never change while the
+ * bridge runs. Quotes are kept as columns indexed by id, so a pass over
+ * the universe (screener.hpp) reads contiguous arrays.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+/* The last bars of one (symbol, timeframe), oldest first. */
+class BarRing {
+public:
+    explicit BarRing(size_t capacity) : bars_(capacity) {}
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return bars_.size(); }
+
+    /* Bar i of size(), 0 = oldest. */
+    const Bar &at(size_t i) const { return bars_[(head_ + i) % bars_.size()]; }
+    /* Bar back bars before the newest, 0 = newest. */
+    const Bar &back(size_t back) const { return at(count_ - 1 - back); }
+
+    /* Merges bars (ascending open times): a bar at the newest open time
+     * replaces it, newer ones are appended, older ones are ignored.
+     * Returns the bars appended or replaced.
+     */
+    size_t merge(const Bar *bars, size_t count);
+
+private:
+    std::vector<Bar> bars_;
+    size_t head_ = 0;       // Slot of the oldest bar.
+    size_t count_ = 0;
+};
+
+/* Quote columns of all cached symbols, indexed by id. */
+struct QuoteColumns {
+    size_t count = 0;
+    const double *bid = nullptr;
+    const double *ask = nullptr;
+    const double *last = nullptr;
+    const int64_t *time_msc = nullptr;  // 0 while no quote has been seen.
+    const int64_t *recv_ns = nullptr;
+};
+
+/* Bars of (id, timeframe), or null when none are cached. */
+using BarLookup = std::function<const BarRing *(int32_t id, int64_t timeframe)>;
+
+class MarketCache {
+public:
+    static MarketCache &instance();
+
+    /* Id of symbol, or -1 if it is not cached. */
+    int32_t id(const char *symbol) const;
+    /* Id of symbol, assigned if new; -1 when the cache is full. */
+    int32_t add(const char *symbol);
+    /* Name of id; empty for unknown ids. The returned string stays valid. */
+    const std::string &name(int32_t id) const;
+    size_t size() const;
+
+    void on_ticks(const char *symbol, const std::vector<Tick> &ticks);
+    void on_tick(const char *symbol, const Tick &tick);
+    void on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars);
+
+    /* False if symbol has no cached quote, or the quote was received more
+     * than the quote TTL ago.
+     */
+    bool quote(const char *symbol, Tick &out) const;
+
+    /* cache.quote_ttl_ms; 0 keeps quotes fresh forever. */
+    void set_quote_ttl_ms(int64_t ms);
+
+    /* Calls fn with the quote columns and a lookup of each id's bars of
+     * a timeframe (null when none are cached), holding the cache lock.
+     */
+    void read(const std::function<void(const QuoteColumns &quotes, const BarLookup &bars)> &fn) const;
+
+private:
+    MarketCache() = default;
+
+    /* Id of symbol, assigned if new; -1 when the cache is full. Called
+     * with mutex_ held.
+     */
+    int32_t intern(const char *symbol);
+
+    mutable std::mutex mutex_;
+    std::deque<std::string> names_;
+    std::unordered_map<std::string, int32_t> ids_;
+    std::vector<Tick> quotes_;          // Full newest tick per id.
+    std::vector<double> bid_, ask_, last_;
+    std::vector<int64_t> time_msc_, recv_ns_;
+    std::map<std::pair<int32_t, int64_t>, BarRing> bars_;
+    std::atomic<int64_t> quote_ttl_ns_{250 * 1000000LL};
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,141 @@
+/*
+ * market_data.hpp
+ *
+ * Native records for market data handled by the bridge.
+ *
+ * Field names follow the MetaTrader5 Python API (copy_rates_* and
+ * copy_ticks_* record arrays). recv_ns is added by the bridge: the UTC
+ * nanosecond time at which the record was received from the terminal,
+ * taken from TscClock. seq and integrity on ticks are assigned by the
+ * integrity stage (tick_integrity.hpp).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace mt5bridge {
+
+/* Integrity flags added by the bridge (Tick::integrity). */
+enum TickIntegrityFlags : uint32_t {
+    kTickGapWindow = 0x01,  // Poll window started after the last tick seen.
+    kTickGapTime = 0x02     // Silence before this tick exceeded integrity.gap_ms.
+};
+
+/* TICK_FLAG_* values of the MetaTrader5 API. */
+enum TickFlags : uint32_t {
+    kTickFlagBid = 0x02,
+    kTickFlagAsk = 0x04,
+    kTickFlagLast = 0x08,
+    kTickFlagVolume = 0x10,
+    kTickFlagBuy = 0x20,
+    kTickFlagSell = 0x40
+};
+
+/* TIMEFRAME_* values of the MetaTrader5 API that the bridge uses. */
+enum Timeframe : int64_t {
+    kTimeframeM1 = 1,
+    kTimeframeH1 = 0x4001,
+    kTimeframeD1 = 0x4018,
+    kTimeframeW1 = 0x8001,
+    kTimeframeMN1 = 0xC001
+};
+
+/* Length of a TIMEFRAME_* value in seconds; 0 for MN1 (months vary) and
+ * values that are not timeframes.
+ */
+inline int64_t timeframe_seconds(int64_t timeframe) {
+    if (timeframe >= 1 && timeframe <= 30)
+        return timeframe * 60;
+    const int64_t hours = timeframe & 0x3FFF;
+    if ((timeframe & ~int64_t{0x3FFF}) == 0x4000 && hours >= 1 && hours <= 24)
+        return hours * 3600;
+    return timeframe == kTimeframeW1 ? 7 * 86400 : 0;
+}
+
+/* Open time of the bar of length period_s containing time t (seconds).
+ * Weekly bars open on Sunday, as in MetaTrader.
+ */
+inline int64_t bar_open_time(int64_t t, int64_t period_s) {
+    const int64_t shift = period_s == 7 * 86400 ? 3 * 86400 : 0; // 1970-01-04 was a Sunday.
+    int64_t q = (t - shift) / period_s;
+    if ((t - shift) % period_s < 0)
+        --q;
+    return q * period_s + shift;
+}
+
+/* Days from 1970-01-01 to the first of month m (1-12) of year y,
+ * proleptic Gregorian calendar.
+ */
+inline int64_t month_start_days(int64_t y, int64_t m) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+/* Close time of the bar of timeframe opened at open (seconds): open plus
+ * the timeframe's length, or the first of the next month for MN1.
+ */
+inline int64_t bar_close_time(int64_t open, int64_t timeframe) {
+    if (timeframe != kTimeframeMN1)
+        return open + timeframe_seconds(timeframe);
+    // Civil year and month of open.
+    const int64_t days = (open - (open % 86400 < 0 ? 86400 : 0)) / 86400 + 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t mp = (5 * (doe - (365 * yoe + yoe / 4 - yoe / 100)) + 2) / 153;
+    const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t year = yoe + era * 400 + (month <= 2);
+    return (month == 12 ? month_start_days(year + 1, 1) : month_start_days(year, month + 1)) *
+           86400;
+}
+
+struct Bar {
+    int64_t time;           // Bar open time, server seconds.
+    double open;
+    double high;
+    double low;
+    double close;
+    uint64_t tick_volume;
+    int32_t spread;         // Points.
+    uint64_t real_volume;
+    int64_t recv_ns;        // Bridge receive time, UTC ns.
+};
+
+struct Tick {
+    int64_t time_msc;       // Server milliseconds.
+    double bid;
+    double ask;
+    double last;
+    uint64_t volume;
+    uint32_t flags;         // TickFlags.
+    double volume_real;
+    int64_t recv_ns;        // Bridge receive time, UTC ns.
+    uint64_t seq;           // Per-stream sequence number; 0 if unsequenced.
+    uint32_t integrity;     // TickIntegrityFlags.
+};
+
+/* One entry of the account's deal history (history_deals_get). */
+struct Deal {
+    uint64_t ticket;
+    uint64_t order;
+    int64_t time_msc;       // Server milliseconds.
+    int32_t type;           // DEAL_TYPE_*: 0 buy, 1 sell, 2 balance, ...
+    int32_t entry;          // DEAL_ENTRY_*: 0 in, 1 out, 2 in/out, 3 out by.
+    int32_t reason;         // DEAL_REASON_*.
+    uint64_t magic;
+    uint64_t position_id;
+    double volume;
+    double price;
+    double commission;
+    double swap;
+    double profit;
+    double fee;
+    char symbol[32];
+    char comment[32];
+};
+
+} // namespace mt5bridge
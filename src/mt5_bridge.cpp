@@ -27,18 +27,57 @@
  */
 
 #include "mt5bridge/mt5bridge.hpp"
+#include "asof.hpp"
+#include "backend.hpp"
+#include "bar_windows.hpp"
+#include "backtest_runner.hpp"
+#include "clock.hpp"
+#include "config.hpp"
+#include "copier.hpp"
+#include "csv_io.hpp"
+#include "exec_algos.hpp"
+#include "history.hpp"
+#include "indicators.hpp"
+#include "journal.hpp"
+#include "market_cache.hpp"
+#include "portfolio.hpp"
+#include "py_convert.hpp"
+#include "responses.hpp"
+#include "rolling_matrix.hpp"
+#include "scheduled_requests.hpp"
+#include "screener.hpp"
+#include "signal_rules.hpp"
+#include "server_time.hpp"
+#include "stream_indicators.hpp"
+#include "tick_integrity.hpp"
+#include "thread_config.hpp"
+#include "timer_wheel.hpp"
 
 #include <Python.h>
 #include <jansson.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace {
+using mt5bridge::req_int;
+using mt5bridge::req_string;
+
 std::mutex g_mutex;                 // Guards interpreter lifetime.
 bool g_initialized = false;         // True once Python is initialized.
-std::string g_last_error;           // Last error message exposed by API.
+thread_local std::string g_last_error; // Last error of the calling thread.
+thread_local std::string g_last_json;  // Last mt5bridge_eval_json answer of the thread.
+std::wstring g_python_home;         // Must outlive the interpreter.
+std::unique_ptr<mt5bridge::Backend> g_backend;       // Null: embedded Python.
+std::unique_ptr<mt5bridge::JournalWriter> g_journal; // Non-null while recording.
 
 void set_error(const std::string &msg) { g_last_error = msg; }
 void clear_error() { g_last_error.clear(); }
@@ -58,187 +97,2426 @@ void set_python_error() {
     Py_XDECREF(pvalue);
     Py_XDECREF(ptrace);
 }
-} // namespace
 
-extern "C" {
+/* Re-anchors the TSC clock every clock.reanchor_ms on the timer wheel;
+ * mt5bridge_shutdown drops the timer with the others.
+ */
+void start_clock_reanchor(const mt5bridge::Config &cfg) {
+    mt5bridge::TscClock &clock = mt5bridge::TscClock::instance();
+    if (!clock.using_tsc() || cfg.clock_reanchor_ms == 0)
+        return;
+    const int64_t period_ns = static_cast<int64_t>(cfg.clock_reanchor_ms) * 1000000;
+    mt5bridge::TimerWheel::instance().schedule(clock.now_ns() + period_ns, period_ns, [] {
+        mt5bridge::TscClock::instance().reanchor();
+    });
+}
 
-MT5BRIDGE_API int mt5bridge_initialize(const wchar_t *python_home) {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    clear_error();
+/* Pushes settings that may change while initialized into the modules
+ * that cache them.
+ */
+void apply_live_config(const mt5bridge::Config &cfg) {
+    auto &integrity = mt5bridge::TickIntegrity::instance();
+    integrity.set_enabled(cfg.integrity_enabled);
+    integrity.set_gap_ms(static_cast<int64_t>(cfg.integrity_gap_ms));
+    mt5bridge::set_indicator_isa(cfg.indicators_isa);
+    mt5bridge::MarketCache::instance().set_quote_ttl_ms(
+        static_cast<int64_t>(cfg.cache_quote_ttl_ms));
+}
 
-    if (g_initialized)
-        return 0; // already initialized
+/* Records the MetaTrader5 last_error() tuple after a call returned None. */
+void set_mt5_error(PyObject *mt5, const char *call) {
+    std::string msg = std::string(call) + " failed";
+    PyObject *err = PyObject_CallMethod(mt5, "last_error", nullptr);
+    PyObject *str = err ? PyObject_Str(err) : nullptr;
+    if (str && PyUnicode_AsUTF8(str))
+        msg += std::string(": ") + PyUnicode_AsUTF8(str);
+    Py_XDECREF(str);
+    Py_XDECREF(err);
+    PyErr_Clear();
+    set_error(msg);
+}
 
-    Py_SetProgramName(const_cast<wchar_t *>(L"mt5bridge"));
-    if (python_home)
-        Py_SetPythonHome(const_cast<wchar_t *>(python_home));
+void missing_params(const char *method, const char *params) {
+    set_error(std::string(method) + " requires " + params);
+}
 
-    Py_Initialize();
-    if (!Py_IsInitialized()) {
-        set_error("Py_Initialize failed");
-        return -1;
-    }
+/* Maps an indicator result to the C API's 0 / -1. */
+int indicator_status(bool ok, const std::string &err) {
+    if (ok)
+        return 0;
+    set_error(err);
+    return -1;
+}
 
-    // Import MetaTrader5 module and initialize connection.
-    PyGILState_STATE gs = PyGILState_Ensure();
-    PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
-    if (!mt5) {
+/* Converts a copy_rates_* result. None (no data / no terminal) maps to
+ * JSON null as before; records carry recv_ns taken when the call returned.
+ */
+json_t *rates_response(PyObject *mt5, PyObject *res, const char *call,
+                       const json_t *req) {
+    const int64_t recv_ns = mt5bridge::now_ns();
+    if (!res) {
         set_python_error();
-        PyGILState_Release(gs);
-        Py_Finalize();
-        return -1;
+        return nullptr;
     }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, call);
+        return json_null();
+    }
+    std::vector<mt5bridge::Bar> bars;
+    std::string err;
+    bool ok = mt5bridge::decode_rates(res, recv_ns, bars, err);
+    Py_DECREF(res);
+    if (!ok) {
+        set_error(err);
+        return nullptr;
+    }
+    json_t *out = mt5bridge::bars_response(bars, req, err);
+    if (!out)
+        set_error(err);
+    return out;
+}
 
-    PyObject *res = PyObject_CallMethod(mt5, "initialize", nullptr);
+json_t *ticks_response(PyObject *mt5, PyObject *res, const char *call,
+                       const json_t *req) {
+    const int64_t recv_ns = mt5bridge::now_ns();
     if (!res) {
         set_python_error();
-        Py_DECREF(mt5);
-        PyGILState_Release(gs);
-        Py_Finalize();
-        return -1;
+        return nullptr;
     }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, call);
+        return json_null();
+    }
+    std::vector<mt5bridge::Tick> ticks;
+    std::string err;
+    bool ok = mt5bridge::decode_ticks(res, recv_ns, ticks, err);
     Py_DECREF(res);
-    Py_DECREF(mt5);
-    PyGILState_Release(gs);
+    if (!ok) {
+        set_error(err);
+        return nullptr;
+    }
+    json_t *out = mt5bridge::ticks_response(ticks, req, err);
+    if (!out)
+        set_error(err);
+    return out;
+}
 
-    // Release the GIL so that other threads may call into the API.
-    PyEval_SaveThread();
+/* Converts a trade call result (OrderSendResult, ...) and stamps it. */
+json_t *trade_response(PyObject *mt5, PyObject *res, const char *call) {
+    const int64_t recv_ns = mt5bridge::now_ns();
+    if (!res) {
+        set_python_error();
+        return nullptr;
+    }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, call);
+        return json_null();
+    }
+    json_t *out = mt5bridge::py_to_json(res);
+    Py_DECREF(res);
+    if (!out) {
+        set_python_error();
+        return nullptr;
+    }
+    if (json_is_object(out))
+        json_object_set_new(out, "recv_ns", json_integer(recv_ns));
+    return out;
+}
 
-    g_initialized = true;
-    return 0;
+json_t *handle_get_m1_bars(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    long long count = 0;
+    if (!symbol || !req_int(req, "count", count)) {
+        missing_params("get_m1_bars", "symbol and count");
+        return nullptr;
+    }
+    PyObject *tf = PyObject_GetAttrString(mt5, "TIMEFRAME_M1");
+    if (!tf) {
+        set_python_error();
+        return nullptr;
+    }
+    PyObject *res = PyObject_CallMethod(mt5, "copy_rates_from_pos", "sOii", symbol,
+                                        tf, 0, static_cast<int>(count));
+    Py_DECREF(tf);
+    return rates_response(mt5, res, "copy_rates_from_pos", req);
 }
 
-MT5BRIDGE_API void mt5bridge_shutdown() {
-    std::lock_guard<std::mutex> lock(g_mutex);
-    clear_error();
+json_t *handle_copy_rates_from_pos(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    long long timeframe = 0, start = 0, count = 0;
+    if (!symbol || !req_int(req, "timeframe", timeframe) || !req_int(req, "count", count)) {
+        missing_params("copy_rates_from_pos", "symbol, timeframe and count");
+        return nullptr;
+    }
+    req_int(req, "start", start);
+    PyObject *res = PyObject_CallMethod(mt5, "copy_rates_from_pos", "siii", symbol,
+                                        static_cast<int>(timeframe),
+                                        static_cast<int>(start),
+                                        static_cast<int>(count));
+    return rates_response(mt5, res, "copy_rates_from_pos", req);
+}
 
-    if (!g_initialized)
-        return;
+json_t *handle_copy_ticks_from(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    long long date_from = 0, count = 0;
+    long long flags = -1; // COPY_TICKS_ALL
+    if (!symbol || !req_int(req, "date_from", date_from) || !req_int(req, "count", count)) {
+        missing_params("copy_ticks_from", "symbol, date_from and count");
+        return nullptr;
+    }
+    req_int(req, "flags", flags);
+    PyObject *res = PyObject_CallMethod(mt5, "copy_ticks_from", "sLii", symbol,
+                                        date_from, static_cast<int>(count),
+                                        static_cast<int>(flags));
+    return ticks_response(mt5, res, "copy_ticks_from", req);
+}
 
-    PyGILState_STATE gs = PyGILState_Ensure();
+json_t *handle_symbol_info_tick(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol) {
+        missing_params("symbol_info_tick", "symbol");
+        return nullptr;
+    }
+    PyObject *res = PyObject_CallMethod(mt5, "symbol_info_tick", "s", symbol);
+    const int64_t recv_ns = mt5bridge::now_ns();
+    if (!res) {
+        set_python_error();
+        return nullptr;
+    }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, "symbol_info_tick");
+        return json_null();
+    }
+    mt5bridge::Tick tick;
+    std::string err;
+    bool ok = mt5bridge::decode_tick(res, recv_ns, tick, err);
+    Py_DECREF(res);
+    if (!ok) {
+        set_error(err);
+        return nullptr;
+    }
+    json_t *out = mt5bridge::tick_response(tick, req, err);
+    if (!out)
+        set_error(err);
+    return out;
+}
 
-    // Attempt to gracefully shutdown the MetaTrader5 module.
-    PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
-    if (mt5) {
-        PyObject *res = PyObject_CallMethod(mt5, "shutdown", nullptr);
-        if (!res)
-            set_python_error();
-        else
-            Py_DECREF(res);
-        Py_DECREF(mt5);
-    } else {
-        PyErr_Clear();
+json_t *handle_open_market_buy(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    json_t *volume = json_object_get(req, "volume");
+    if (!symbol || !json_is_number(volume)) {
+        missing_params("open_market_buy", "symbol and volume");
+        return nullptr;
+    }
+    // ORDER_TYPE_BUY == 0 in MetaTrader5 Python API
+    PyObject *order = Py_BuildValue("{s:s,s:d,s:i}",
+                                    "symbol", symbol,
+                                    "volume", json_number_value(volume),
+                                    "type", 0);
+    if (!order) {
+        set_python_error();
+        return nullptr;
     }
+    PyObject *res = PyObject_CallMethod(mt5, "order_send", "O", order);
+    Py_DECREF(order);
+    return trade_response(mt5, res, "order_send");
+}
 
-    PyGILState_Release(gs);
+json_t *handle_symbol_info(PyObject *mt5, const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol) {
+        missing_params("symbol_info", "symbol");
+        return nullptr;
+    }
+    PyObject *res = PyObject_CallMethod(mt5, "symbol_info", "s", symbol);
+    if (!res) {
+        set_python_error();
+        return nullptr;
+    }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, "symbol_info");
+        return json_null();
+    }
+    json_t *out = mt5bridge::py_to_json(res);
+    Py_DECREF(res);
+    if (!out)
+        set_python_error();
+    return out;
+}
 
-    Py_Finalize();
-    g_initialized = false;
+/* Passes "request" through as the MetaTrader5 trade request dict. */
+json_t *handle_order_send(PyObject *mt5, const json_t *req) {
+    json_t *trade = json_object_get(req, "request");
+    if (!json_is_object(trade)) {
+        missing_params("order_send", "a request object");
+        return nullptr;
+    }
+    PyObject *order = mt5bridge::json_to_py(trade);
+    if (!order) {
+        set_python_error();
+        return nullptr;
+    }
+    PyObject *res = PyObject_CallMethod(mt5, "order_send", "O", order);
+    Py_DECREF(order);
+    return trade_response(mt5, res, "order_send");
 }
 
-MT5BRIDGE_API json_t *mt5bridge_eval(json_t *request) {
-    if (!request) {
-        set_error("request is null");
+/* date_from and date_to are server seconds; "group" filters symbols. */
+json_t *handle_history_deals_get(PyObject *mt5, const json_t *req) {
+    long long date_from = 0, date_to = 0;
+    if (!req_int(req, "date_from", date_from) || !req_int(req, "date_to", date_to)) {
+        missing_params("history_deals_get", "date_from and date_to");
         return nullptr;
     }
-    if (!g_initialized) {
-        set_error("bridge not initialized");
+    PyObject *fn = PyObject_GetAttrString(mt5, "history_deals_get");
+    PyObject *args = Py_BuildValue("(LL)", date_from, date_to);
+    PyObject *kwargs = nullptr;
+    if (const char *group = req_string(req, "group"))
+        kwargs = Py_BuildValue("{s:s}", "group", group);
+    PyObject *res = fn && args ? PyObject_Call(fn, args, kwargs) : nullptr;
+    Py_XDECREF(kwargs);
+    Py_XDECREF(args);
+    Py_XDECREF(fn);
+    if (!res) {
+        set_python_error();
+        return nullptr;
+    }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, "history_deals_get");
+        return json_null();
+    }
+    std::vector<mt5bridge::Deal> deals;
+    std::string err;
+    const bool ok = mt5bridge::decode_deals(res, deals, err);
+    Py_DECREF(res);
+    json_t *out = ok ? mt5bridge::deals_response(deals, req, err) : nullptr;
+    if (!out)
+        set_error(err);
+    return out;
+}
+
+json_t *handle_positions_get(PyObject *mt5, const json_t *) {
+    PyObject *res = PyObject_CallMethod(mt5, "positions_get", nullptr);
+    if (!res) {
+        set_python_error();
         return nullptr;
     }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, "positions_get");
+        return json_null();
+    }
+    json_t *out = mt5bridge::py_to_json(res);
+    Py_DECREF(res);
+    if (!out)
+        set_python_error();
+    return out;
+}
+
+/* Methods forwarded to the MetaTrader5 module. Handlers run with the GIL
+ * held and return nullptr after calling set_error on failure.
+ */
+struct PyMethod {
+    const char *name;
+    json_t *(*fn)(PyObject *mt5, const json_t *request);
+};
+
+const PyMethod kPyMethods[] = {
+    {"get_m1_bars", handle_get_m1_bars},
+    {"copy_rates_from_pos", handle_copy_rates_from_pos},
+    {"copy_ticks_from", handle_copy_ticks_from},
+    {"symbol_info_tick", handle_symbol_info_tick},
+    {"symbol_info", handle_symbol_info},
+    {"open_market_buy", handle_open_market_buy},
+    {"order_send", handle_order_send},
+    {"positions_get", handle_positions_get},
+    {"history_deals_get", handle_history_deals_get},
+};
 
-    ScopedJson result; // ensures result is freed on error paths
+const PyMethod *find_py_method(const char *name) {
+    for (const auto &m : kPyMethods)
+        if (std::strcmp(m.name, name) == 0)
+            return &m;
+    return nullptr;
+}
 
-    char *req_str = json_dumps(request, JSON_COMPACT);
-    if (!req_str) {
-        set_error("failed to serialize request");
+json_t *eval_python(const char *method, const json_t *request) {
+    const PyMethod *handler = find_py_method(method);
+    if (!handler) {
+        set_error("unknown method");
         return nullptr;
     }
 
+    json_t *result = nullptr;
     PyGILState_STATE gs = PyGILState_Ensure();
-    PyObject *json_mod = PyImport_ImportModule("json");
     PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
-    if (!json_mod || !mt5) {
+    if (mt5) {
+        result = handler->fn(mt5, request);
+        Py_DECREF(mt5);
+    } else {
         set_python_error();
-        goto done;
     }
+    PyGILState_Release(gs);
+    return result;
+}
 
-    PyObject *loads = PyObject_GetAttrString(json_mod, "loads");
-    PyObject *dumps = PyObject_GetAttrString(json_mod, "dumps");
-    if (!loads || !dumps) {
+/* Runs fn(mt5) with the GIL held and the MetaTrader5 module imported. */
+template <typename Fn>
+bool with_mt5(std::string &error, Fn fn) {
+    bool ok = false;
+    PyGILState_STATE gs = PyGILState_Ensure();
+    PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
+    if (mt5) {
+        ok = fn(mt5);
+        Py_DECREF(mt5);
+    } else {
         set_python_error();
-        goto done;
+        error = g_last_error;
     }
+    PyGILState_Release(gs);
+    return ok;
+}
 
-    PyObject *req_dict = PyObject_CallFunction(loads, "s", req_str);
-    if (!req_dict) {
+/* False with error when a MetaTrader5 call raised or answered None;
+ * otherwise the caller owns res.
+ */
+bool mt5_result(PyObject *mt5, PyObject *res, const char *call, std::string &error) {
+    if (!res) {
         set_python_error();
-        goto done;
+        error = g_last_error;
+        return false;
+    }
+    if (res == Py_None) {
+        Py_DECREF(res);
+        set_mt5_error(mt5, call);
+        error = g_last_error;
+        return false;
+    }
+    return true;
+}
+
+/* Serves the typed API from the embedded interpreter. Typed calls decode
+ * the MetaTrader5 results straight into records (py_convert.hpp) and run
+ * the same bridge stages as the JSON handlers above, without building or
+ * parsing any JSON.
+ */
+class PythonBackend : public mt5bridge::Backend {
+public:
+    const char *name() const override { return "python"; }
+    bool live() const override { return true; }
+    json_t *eval(const char *method, const json_t *request, std::string &error) override {
+        clear_error();
+        json_t *result = eval_python(method, request);
+        error = g_last_error;
+        return result;
     }
+    bool serves(const char *method) const override { return find_py_method(method) != nullptr; }
 
-    PyObject *method_obj = PyDict_GetItemString(req_dict, "method");
-    if (!method_obj) {
-        set_error("missing method");
-        Py_DECREF(req_dict);
-        goto done;
+    bool symbol_info_tick(const char *symbol, mt5bridge::Tick &out,
+                          std::string &error) override {
+        const bool ok = with_mt5(error, [&](PyObject *mt5) {
+            PyObject *res = PyObject_CallMethod(mt5, "symbol_info_tick", "s", symbol);
+            const int64_t recv_ns = mt5bridge::now_ns();
+            if (!mt5_result(mt5, res, "symbol_info_tick", error))
+                return false;
+            const bool decoded = mt5bridge::decode_tick(res, recv_ns, out, error);
+            Py_DECREF(res);
+            return decoded;
+        });
+        if (!ok)
+            return false;
+        json_t *req = json_pack("{s:s}", "symbol", symbol);
+        mt5bridge::feed_tick(out, req);
+        json_decref(req);
+        return true;
     }
-    const char *method = PyUnicode_AsUTF8(method_obj);
 
-    PyObject *py_response = nullptr;
+    bool copy_ticks_from(const char *symbol, int64_t date_from, int64_t count, int64_t flags,
+                         std::vector<mt5bridge::Tick> &out, std::string &error) override {
+        out.clear();
+        const bool ok = with_mt5(error, [&](PyObject *mt5) {
+            PyObject *res = PyObject_CallMethod(mt5, "copy_ticks_from", "sLii", symbol,
+                                                static_cast<long long>(date_from),
+                                                static_cast<int>(count), static_cast<int>(flags));
+            const int64_t recv_ns = mt5bridge::now_ns();
+            if (!mt5_result(mt5, res, "copy_ticks_from", error))
+                return false;
+            const bool decoded = mt5bridge::decode_ticks(res, recv_ns, out, error);
+            Py_DECREF(res);
+            return decoded;
+        });
+        if (!ok)
+            return false;
+        json_t *req = json_pack("{s:s, s:I, s:I}", "symbol", symbol, "date_from",
+                                static_cast<json_int_t>(date_from), "flags",
+                                static_cast<json_int_t>(flags));
+        const bool fed = mt5bridge::feed_ticks(out, req, error);
+        json_decref(req);
+        return fed;
+    }
 
-    if (std::strcmp(method, "get_m1_bars") == 0) {
-        PyObject *symbol = PyDict_GetItemString(req_dict, "symbol");
-        PyObject *count = PyDict_GetItemString(req_dict, "count");
-        PyObject *tf = PyObject_GetAttrString(mt5, "TIMEFRAME_M1");
-        if (symbol && count && tf) {
-            py_response = PyObject_CallMethod(mt5, "copy_rates_from_pos", "sOii",
-                                              PyUnicode_AsUTF8(symbol), tf, 0,
-                                              static_cast<int>(PyLong_AsLong(count)));
-        }
-        Py_XDECREF(tf);
-    } else if (std::strcmp(method, "open_market_buy") == 0) {
-        PyObject *symbol = PyDict_GetItemString(req_dict, "symbol");
-        PyObject *volume = PyDict_GetItemString(req_dict, "volume");
-        if (symbol && volume) {
-            // ORDER_TYPE_BUY == 0 in MetaTrader5 Python API
-            PyObject *order = Py_BuildValue("{s:s,s:d,s:i}",
-                                            "symbol", PyUnicode_AsUTF8(symbol),
-                                            "volume", PyFloat_AsDouble(volume),
-                                            "type", 0);
-            py_response = PyObject_CallMethod(mt5, "order_send", "O", order);
+    bool copy_rates_from_pos(const char *symbol, int64_t timeframe, int64_t start,
+                             int64_t count, std::vector<mt5bridge::Bar> &out,
+                             std::string &error) override {
+        out.clear();
+        const bool ok = with_mt5(error, [&](PyObject *mt5) {
+            PyObject *res = PyObject_CallMethod(mt5, "copy_rates_from_pos", "siii", symbol,
+                                                static_cast<int>(timeframe),
+                                                static_cast<int>(start), static_cast<int>(count));
+            const int64_t recv_ns = mt5bridge::now_ns();
+            if (!mt5_result(mt5, res, "copy_rates_from_pos", error))
+                return false;
+            const bool decoded = mt5bridge::decode_rates(res, recv_ns, out, error);
+            Py_DECREF(res);
+            return decoded;
+        });
+        if (!ok)
+            return false;
+        json_t *req = json_pack("{s:s, s:I, s:I}", "symbol", symbol, "timeframe",
+                                static_cast<json_int_t>(timeframe), "start",
+                                static_cast<json_int_t>(start));
+        const bool fed = mt5bridge::feed_bars(out, req, error);
+        json_decref(req);
+        return fed;
+    }
+
+    bool order_send(const mt5bridge_trade_request &request, mt5bridge_trade_result &result,
+                    std::string &error) override {
+        return with_mt5(error, [&](PyObject *mt5) {
+            PyObject *order = Py_BuildValue(
+                "{s:i, s:i, s:s, s:d, s:d, s:d, s:d, s:i, s:K}", "action", request.action,
+                "type", request.type, "symbol", request.symbol ? request.symbol : "", "volume",
+                request.volume, "price", request.price, "sl", request.sl, "tp", request.tp,
+                "deviation", request.deviation, "magic",
+                static_cast<unsigned long long>(request.magic));
+            bool built = order != nullptr;
+            if (built && request.position) {
+                PyObject *position = PyLong_FromUnsignedLongLong(request.position);
+                built = position && PyDict_SetItemString(order, "position", position) == 0;
+                Py_XDECREF(position);
+            }
+            if (built && request.comment) {
+                PyObject *comment = PyUnicode_FromString(request.comment);
+                built = comment && PyDict_SetItemString(order, "comment", comment) == 0;
+                Py_XDECREF(comment);
+            }
+            if (!built) {
+                Py_XDECREF(order);
+                set_python_error();
+                error = g_last_error;
+                return false;
+            }
+            PyObject *res = PyObject_CallMethod(mt5, "order_send", "O", order);
+            const int64_t recv_ns = mt5bridge::now_ns();
             Py_DECREF(order);
+            if (!mt5_result(mt5, res, "order_send", error))
+                return false;
+            const bool decoded = mt5bridge::decode_trade_result(res, recv_ns, result, error);
+            Py_DECREF(res);
+            return decoded;
+        });
+    }
+
+    bool positions_get(std::vector<mt5bridge_position> &out, std::string &error) override {
+        out.clear();
+        return with_mt5(error, [&](PyObject *mt5) {
+            PyObject *res = PyObject_CallMethod(mt5, "positions_get", nullptr);
+            if (!mt5_result(mt5, res, "positions_get", error))
+                return false;
+            const bool decoded = mt5bridge::decode_positions(res, out, error);
+            Py_DECREF(res);
+            return decoded;
+        });
+    }
+};
+
+PythonBackend g_python_backend;
+
+mt5bridge::Backend &backend() {
+    if (mt5bridge::Backend *bound = mt5bridge::thread_backend())
+        return *bound;
+    return g_backend ? *g_backend : static_cast<mt5bridge::Backend &>(g_python_backend);
+}
+
+/* Common prologue of the typed calls. */
+bool typed_call_ready() {
+    if (!g_initialized) {
+        set_error("bridge not initialized");
+        return false;
+    }
+    clear_error();
+    return true;
+}
+
+/* Journals a typed call as the eval request it stands for, with its
+ * answer (null if the call failed); takes both.
+ */
+void journal_typed(json_t *request, json_t *answer, const std::string &error,
+                   int64_t t_request) {
+    g_journal->record_eval(request, answer, error, t_request, mt5bridge::now_ns());
+    json_decref(request);
+    json_decref(answer);
+}
+
+template <typename Record>
+json_t *records_json(const std::vector<Record> &records, json_t *(*to_json)(const Record &)) {
+    json_t *arr = json_array();
+    for (const Record &r : records)
+        json_array_append_new(arr, to_json(r));
+    return arr;
+}
+
+/* The typed tick and bar copies, single and batched, journaled. */
+bool copy_ticks(const char *symbol, int64_t date_from, int64_t count, int64_t flags,
+                std::vector<mt5bridge::Tick> &ticks, std::string &err) {
+    const int64_t t_request = mt5bridge::now_ns();
+    const bool ok = backend().copy_ticks_from(symbol, date_from, count, flags, ticks, err);
+    if (g_journal)
+        journal_typed(mt5bridge::copy_ticks_request(symbol, date_from, count, flags),
+                      ok ? records_json(ticks, mt5bridge::tick_to_json) : nullptr, err,
+                      t_request);
+    return ok;
+}
+
+bool copy_rates(const char *symbol, int64_t timeframe, int64_t start, int64_t count,
+                std::vector<mt5bridge::Bar> &bars, std::string &err) {
+    const int64_t t_request = mt5bridge::now_ns();
+    const bool ok = backend().copy_rates_from_pos(symbol, timeframe, start, count, bars, err);
+    if (g_journal)
+        journal_typed(mt5bridge::copy_rates_request(symbol, timeframe, start, count),
+                      ok ? records_json(bars, mt5bridge::bar_to_json) : nullptr, err, t_request);
+    return ok;
+}
+
+/* Holds the GIL for a whole copy_*_batch call when the interpreter
+ * serves it, so its symbols do not each take and release it. Request
+ * batches do not: their native methods may block on other threads that
+ * need the GIL.
+ */
+class BatchGil {
+public:
+    BatchGil() : held_(g_initialized && !g_backend && !mt5bridge::thread_backend()) {
+        if (held_)
+            state_ = PyGILState_Ensure();
+    }
+    ~BatchGil() {
+        if (held_)
+            PyGILState_Release(state_);
+    }
+    BatchGil(const BatchGil &) = delete;
+    BatchGil &operator=(const BatchGil &) = delete;
+
+private:
+    bool held_;
+    PyGILState_STATE state_{};
+};
+
+/* Fills row i of out (count records wide) with fetch(symbols[i]) and
+ * counts[i] with its size, or -1 if that symbol failed; the error of the
+ * last failure is kept. Returns the records copied in total.
+ */
+template <typename Out, typename Record, typename Fetch>
+int64_t copy_batch(const char *const *symbols, size_t symbol_count, size_t count, Out *out,
+                   int64_t *counts, Fetch fetch) {
+    static_assert(sizeof(Out) == sizeof(Record), "C and native records must match");
+    if (!typed_call_ready())
+        return -1;
+    if ((!symbols || !counts || (!out && count)) && symbol_count) {
+        set_error("symbols, out and counts must not be null");
+        return -1;
+    }
+    BatchGil gil;
+    int64_t total = 0;
+    std::string failure;
+    std::vector<Record> records;
+    for (size_t i = 0; i < symbol_count; ++i) {
+        std::string err;
+        records.clear();
+        if (!symbols[i] || !fetch(symbols[i], records, err)) {
+            failure = std::string(symbols[i] ? symbols[i] : "(null)") + ": " +
+                      (symbols[i] ? err : "symbol is null");
+            counts[i] = -1;
+            continue;
         }
+        const size_t n = std::min(records.size(), count);
+        if (n)
+            std::memcpy(out + i * count, records.data(), n * sizeof(Record));
+        counts[i] = static_cast<int64_t>(n);
+        total += counts[i];
+    }
+    set_error(failure);
+    return total;
+}
+
+/* Runs mt5bridge_eval-like fn on JSON text and keeps the compact answer
+ * in the calling thread's buffer.
+ */
+const char *eval_text(const char *request, json_t *(*fn)(json_t *)) {
+    if (!request) {
+        set_error("request is null");
+        return nullptr;
+    }
+    json_error_t parse_error;
+    json_t *req = json_loads(request, 0, &parse_error);
+    if (!req) {
+        set_error(std::string("invalid request JSON: ") + parse_error.text);
+        return nullptr;
+    }
+    json_t *result = fn(req);
+    json_decref(req);
+    if (!result)
+        return nullptr;
+    char *text = json_dumps(result, JSON_COMPACT | JSON_ENCODE_ANY);
+    json_decref(result);
+    if (!text) {
+        set_error("cannot encode result");
+        return nullptr;
+    }
+    g_last_json = text;
+    std::free(text);
+    return g_last_json.c_str();
+}
+
+json_t *journal_status(const json_t *) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "recording", json_boolean(g_journal != nullptr));
+    json_object_set_new(obj, "records", json_integer(g_journal ? static_cast<json_int_t>(g_journal->records()) : 0));
+    json_object_set_new(obj, "bytes", json_integer(g_journal ? static_cast<json_int_t>(g_journal->bytes()) : 0));
+    json_object_set_new(obj, "backend", json_string(g_backend ? g_backend->name() : "python"));
+    return obj;
+}
+
+/* {"method": "import_csv", "path", "symbol"[, "timeframe"]}: reads a CSV
+ * file into the history store, as bars of timeframe if given, otherwise
+ * as ticks. Stored records inside the file's time range are replaced.
+ */
+json_t *import_csv(const json_t *req) {
+    const char *path = req_string(req, "path");
+    const char *symbol = req_string(req, "symbol");
+    if (!path || !symbol) {
+        missing_params("import_csv", "path and symbol");
+        return nullptr;
+    }
+    long long timeframe = 0;
+    const bool bars = req_int(req, "timeframe", timeframe);
+    const std::string dir = mt5bridge::config().history_dir;
+    const auto t0 = std::chrono::steady_clock::now();
+    mt5bridge::CsvStats stats;
+    std::string err;
+    size_t written = 0, replaced = 0;
+    bool ok;
+    if (bars) {
+        std::vector<mt5bridge::Bar> records;
+        ok = mt5bridge::read_csv(path, records, stats, err) &&
+             mt5bridge::merge_bars(dir, symbol, timeframe, records, replaced, err);
+        written = records.size();
     } else {
-        set_error("unknown method");
+        std::vector<mt5bridge::Tick> records;
+        ok = mt5bridge::read_csv(path, records, stats, err) &&
+             mt5bridge::merge_ticks(dir, symbol, records, replaced, err);
+        written = records.size();
+    }
+    if (!ok) {
+        set_error(err);
+        return nullptr;
     }
+    const int64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - t0).count();
+    return json_pack("{s:s, s:s, s:s, s:I, s:I, s:I, s:i, s:I}", "path", path, "symbol", symbol,
+                     "kind", bars ? "bars" : "ticks", "rows", static_cast<json_int_t>(written),
+                     "replaced", static_cast<json_int_t>(replaced), "bytes",
+                     static_cast<json_int_t>(stats.bytes), "workers",
+                     static_cast<int>(stats.workers), "wall_ns", static_cast<json_int_t>(wall_ns));
+}
 
-    Py_DECREF(req_dict);
+template <typename T>
+json_t *series_file(const std::string &path, const mt5bridge::Series<T> &series) {
+    const auto *records = reinterpret_cast<const unsigned char *>(series.records);
+    const json_int_t offset = series.file ? static_cast<json_int_t>(records - series.file->data()) : 0;
+    return json_pack("{s:s, s:I, s:I, s:I}", "path", path.c_str(), "offset", offset,
+                     "record_size", static_cast<json_int_t>(sizeof(T)), "count",
+                     static_cast<json_int_t>(series.count));
+}
 
-    if (py_response) {
-        PyObject *resp_str = PyObject_CallFunctionObjArgs(dumps, py_response, NULL);
-        if (resp_str) {
-            const char *c_resp = PyUnicode_AsUTF8(resp_str);
-            if (c_resp)
-                result.ptr = json_loads(c_resp, 0, nullptr);
-            else
-                set_python_error();
-            Py_DECREF(resp_str);
-        } else {
-            set_python_error();
-        }
-        Py_DECREF(py_response);
-    } else if (PyErr_Occurred()) {
-        set_python_error();
+/* {"method": "history_file", "symbol"[, "timeframe"]}: where the stored
+ * ticks (or bars of timeframe) of symbol lie, for callers that map the
+ * file themselves: {"path", "offset", "record_size", "count"}.
+ */
+json_t *history_file(const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol) {
+        missing_params("history_file", "symbol");
+        return nullptr;
     }
+    const std::string dir = mt5bridge::config().history_dir;
+    std::string err;
+    long long timeframe = 0;
+    json_t *out = nullptr;
+    if (req_int(req, "timeframe", timeframe)) {
+        const std::string path = mt5bridge::bars_path(dir, symbol, timeframe);
+        mt5bridge::BarSeries series;
+        if (mt5bridge::open_bars(path, series, err))
+            out = series_file(path, series);
+    } else {
+        const std::string path = mt5bridge::ticks_path(dir, symbol);
+        mt5bridge::TickSeries series;
+        if (mt5bridge::open_ticks(path, series, err))
+            out = series_file(path, series);
+    }
+    if (!out)
+        set_error(err);
+    return out;
+}
 
-    
- done:
-    Py_XDECREF(dumps);
-    Py_XDECREF(loads);
-    Py_XDECREF(json_mod);
-    Py_XDECREF(mt5);
-    PyGILState_Release(gs);
-    free(req_str);
-    return result.release();
+json_t *stream_indicator_add(const json_t *req) {
+    const char *symbol = req_string(req, "symbol");
+    const char *kind = req_string(req, "kind");
+    if (!symbol || !kind) {
+        missing_params("stream_indicator_add", "symbol and kind");
+        return nullptr;
+    }
+    long long timeframe = 0, period = 0;
+    req_int(req, "timeframe", timeframe);
+    req_int(req, "period", period);
+    const char *field = req_string(req, "field");
+    mt5bridge::StreamSpec spec;
+    spec.symbol = symbol;
+    spec.kind = kind;
+    spec.timeframe = timeframe;
+    spec.field = field ? field : "";
+    spec.period = period > 0 ? static_cast<uint64_t>(period) : 0;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::StreamIndicators::instance().add(spec, id, err)) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *stream_indicator_remove(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("stream_indicator_remove", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::StreamIndicators::instance().remove(id)) {
+        set_error("unknown indicator id " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+json_t *stream_indicators(const json_t *req) {
+    return mt5bridge::StreamIndicators::instance().to_json(req_string(req, "symbol"));
+}
+
+/* Reads the "symbols" array of strings; false with error otherwise. */
+bool req_symbols(const json_t *req, const char *method, std::vector<const char *> &out) {
+    const json_t *symbols = json_object_get(req, "symbols");
+    if (!json_is_array(symbols)) {
+        missing_params(method, "a symbols array");
+        return false;
+    }
+    size_t index;
+    json_t *value;
+    json_array_foreach(symbols, index, value) {
+        if (!json_is_string(value)) {
+            set_error(std::string(method) + ": symbols must be strings");
+            return false;
+        }
+        out.push_back(json_string_value(value));
+    }
+    return true;
+}
+
+uint64_t record_seq(const mt5bridge::Bar &) { return 0; }
+uint64_t record_seq(const mt5bridge::Tick &tick) { return tick.seq; }
+
+/* Builds the {"time": [[...]], "<field>": [[...]], ...} matrices of an
+ * asof answer; cells without a record are null.
+ */
+template <typename T, size_t N>
+bool asof_matrices(json_t *out, const std::vector<T> &cells, size_t rows, size_t cols,
+                   const json_t *fields, const char *const *defaults,
+                   const mt5bridge::RecordField (&table)[N], int64_t T::*time,
+                   const char *time_name) {
+    std::vector<const mt5bridge::RecordField *> wanted;
+    std::vector<const char *> names;
+    if (json_is_array(fields)) {
+        size_t i;
+        json_t *name;
+        json_array_foreach(fields, i, name) names.push_back(json_string_value(name));
+    } else {
+        for (const char *const *d = defaults; *d; ++d)
+            names.push_back(*d);
+    }
+    for (const char *name : names) {
+        const mt5bridge::RecordField *found = mt5bridge::find_field(table, name);
+        if (!found) {
+            set_error(std::string("asof: unknown field ") + (name ? name : "(not a string)"));
+            return false;
+        }
+        wanted.push_back(found);
+    }
+    json_t *times = json_array();
+    std::vector<json_t *> matrices;
+    for (size_t k = 0; k < wanted.size(); ++k)
+        matrices.push_back(json_array());
+    for (size_t i = 0; i < rows; ++i) {
+        json_t *time_row = json_array();
+        std::vector<json_t *> field_rows;
+        for (size_t k = 0; k < wanted.size(); ++k)
+            field_rows.push_back(json_array());
+        for (size_t j = 0; j < cols; ++j) {
+            const T &cell = cells[i * cols + j];
+            const bool empty = cell.*time == 0;
+            json_array_append_new(time_row, empty ? json_null() : json_integer(cell.*time));
+            for (size_t k = 0; k < wanted.size(); ++k) {
+                json_t *v = empty ? nullptr
+                                  : mt5bridge::field_to_json(&cell, *wanted[k], record_seq(cell));
+                json_array_append_new(field_rows[k], v ? v : json_null());
+            }
+        }
+        json_array_append_new(times, time_row);
+        for (size_t k = 0; k < wanted.size(); ++k)
+            json_array_append_new(matrices[k], field_rows[k]);
+    }
+    json_object_set_new(out, time_name, times);
+    for (size_t k = 0; k < wanted.size(); ++k)
+        json_object_set_new(out, wanted[k]->name, matrices[k]);
+    return true;
+}
+
+constexpr size_t kAsofMaxCells = size_t{1} << 24; // Bounds the JSON answer.
+
+/* {"method": "asof", "symbols": [...], "times": [...] | "from", "to",
+ * "step"[, "timeframe"][, "fields": [...]]}: the last stored tick (or
+ * closed bar of timeframe) of every symbol as of every time, as dense
+ * symbol x time matrices: {"symbols", "times", "time_msc" (bars:
+ * "time"), "<field>", ..., "filled", "missing"}. Times are milliseconds
+ * for ticks and seconds for bars; fields default to bid and ask for
+ * ticks and close for bars.
+ */
+json_t *asof(const json_t *req) {
+    const json_t *symbols_json = json_object_get(req, "symbols");
+    std::vector<const char *> symbols;
+    if (!req_symbols(req, "asof", symbols))
+        return nullptr;
+    size_t index;
+    json_t *value;
+    std::vector<int64_t> times;
+    long long from = 0, to = 0, step = 0;
+    if (const json_t *times_json = json_object_get(req, "times")) {
+        if (!json_is_array(times_json)) {
+            set_error("asof: times must be an array of integers");
+            return nullptr;
+        }
+        json_array_foreach(times_json, index, value) {
+            if (!json_is_integer(value)) {
+                set_error("asof: times must be integers");
+                return nullptr;
+            }
+            times.push_back(json_integer_value(value));
+        }
+    } else if (req_int(req, "from", from) && req_int(req, "to", to) && req_int(req, "step", step)) {
+        if (step <= 0 || to < from) {
+            set_error("asof: step must be positive and to not before from");
+            return nullptr;
+        }
+        const uint64_t count = static_cast<uint64_t>(to - from) / static_cast<uint64_t>(step) + 1;
+        if (count > kAsofMaxCells) {
+            set_error("asof: grid of " + std::to_string(count) + " times is too large");
+            return nullptr;
+        }
+        for (long long t = from; t <= to; t += step)
+            times.push_back(t);
+    } else {
+        missing_params("asof", "times or from, to and step");
+        return nullptr;
+    }
+    if (!times.empty() && symbols.size() > kAsofMaxCells / times.size()) {
+        set_error("asof: more than " + std::to_string(kAsofMaxCells) + " cells");
+        return nullptr;
+    }
+
+    const std::string dir = mt5bridge::config().history_dir;
+    const json_t *fields = json_object_get(req, "fields");
+    long long timeframe = 0;
+    mt5bridge::AsofStats stats;
+    std::string err;
+    json_t *out = json_object();
+    bool ok;
+    if (req_int(req, "timeframe", timeframe)) {
+        static const char *const kDefaults[] = {"close", nullptr};
+        std::vector<mt5bridge::Bar> cells(symbols.size() * times.size());
+        ok = mt5bridge::asof_bars(dir, symbols.data(), symbols.size(), timeframe, times.data(),
+                                  times.size(), cells.data(), stats, err);
+        if (!ok)
+            set_error(err);
+        ok = ok && asof_matrices(out, cells, symbols.size(), times.size(), fields, kDefaults,
+                                 mt5bridge::kBarFields, &mt5bridge::Bar::time, "time");
+    } else {
+        static const char *const kDefaults[] = {"bid", "ask", nullptr};
+        std::vector<mt5bridge::Tick> cells(symbols.size() * times.size());
+        ok = mt5bridge::asof_ticks(dir, symbols.data(), symbols.size(), times.data(), times.size(),
+                                   cells.data(), stats, err);
+        if (!ok)
+            set_error(err);
+        ok = ok && asof_matrices(out, cells, symbols.size(), times.size(), fields, kDefaults,
+                                 mt5bridge::kTickFields, &mt5bridge::Tick::time_msc,
+                                 "time_msc");
+    }
+    if (!ok) {
+        json_decref(out);
+        return nullptr;
+    }
+    json_object_set(out, "symbols", const_cast<json_t *>(symbols_json));
+    json_t *grid = json_array();
+    for (int64_t t : times)
+        json_array_append_new(grid, json_integer(t));
+    json_object_set_new(out, "times", grid);
+    json_object_set_new(out, "filled", json_integer(static_cast<json_int_t>(stats.filled)));
+    json_object_set_new(out, "missing", json_integer(static_cast<json_int_t>(stats.missing)));
+    return out;
+}
+
+json_t *rolling_matrix_add(const json_t *req) {
+    std::vector<const char *> symbols;
+    long long timeframe = 0, window = 0;
+    if (!req_symbols(req, "rolling_matrix_add", symbols))
+        return nullptr;
+    if (!req_int(req, "timeframe", timeframe) || !req_int(req, "window", window)) {
+        missing_params("rolling_matrix_add", "symbols, timeframe and window");
+        return nullptr;
+    }
+    mt5bridge::MatrixSpec spec;
+    spec.symbols.assign(symbols.begin(), symbols.end());
+    spec.timeframe = timeframe;
+    spec.window = window > 0 ? static_cast<uint64_t>(window) : 0;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::RollingMatrices::instance().add(spec, mt5bridge::config().history_dir, id,
+                                                    err)) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *rolling_matrix_remove(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("rolling_matrix_remove", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::RollingMatrices::instance().remove(id)) {
+        set_error("unknown matrix id " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+/* {"method": "rolling_matrix", "id"[, "kind"]}: the matrix of kind
+ * "correlation" (default) or "covariance" as {"id", "kind", "symbols",
+ * "timeframe", "window", "rows", "time", "matrix": [[...], ...]};
+ * undefined entries are null.
+ */
+json_t *rolling_matrix(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("rolling_matrix", "id");
+        return nullptr;
+    }
+    const char *kind = req_string(req, "kind");
+    if (!kind)
+        kind = "correlation";
+    const bool correlation = std::strcmp(kind, "correlation") == 0;
+    if (!correlation && std::strcmp(kind, "covariance") != 0) {
+        set_error(std::string("rolling_matrix: unknown kind ") + kind);
+        return nullptr;
+    }
+    mt5bridge::MatrixValue value;
+    mt5bridge::MatrixSpec spec;
+    if (!mt5bridge::RollingMatrices::instance().read(id, correlation, value, &spec)) {
+        set_error("unknown matrix id " + std::to_string(id));
+        return nullptr;
+    }
+    const size_t n = spec.symbols.size();
+    json_t *symbols = json_array();
+    json_t *matrix = json_array();
+    for (size_t i = 0; i < n; ++i) {
+        json_array_append_new(symbols, json_string(spec.symbols[i].c_str()));
+        json_t *row = json_array();
+        for (size_t j = 0; j < n; ++j) {
+            const double v = value.values[i * n + j];
+            json_array_append_new(row, std::isnan(v) ? json_null() : json_real(v));
+        }
+        json_array_append_new(matrix, row);
+    }
+    return json_pack("{s:I, s:s, s:o, s:I, s:I, s:I, s:I, s:o}", "id", static_cast<json_int_t>(id),
+                     "kind", kind, "symbols", symbols, "timeframe",
+                     static_cast<json_int_t>(spec.timeframe), "window",
+                     static_cast<json_int_t>(spec.window), "rows",
+                     static_cast<json_int_t>(value.rows), "time",
+                     static_cast<json_int_t>(value.time), "matrix", matrix);
+}
+
+/* {"method": "screen", "filter"[, "timeframe"]}: the cached symbols for
+ * which filter holds, reading bars of timeframe (default M1):
+ * {"ids", "symbols", "scanned"}.
+ */
+json_t *screen(const json_t *req) {
+    const char *filter = req_string(req, "filter");
+    if (!filter) {
+        missing_params("screen", "filter");
+        return nullptr;
+    }
+    long long timeframe = mt5bridge::kTimeframeM1;
+    req_int(req, "timeframe", timeframe);
+    mt5bridge::ScreenResult result;
+    std::string err;
+    if (!mt5bridge::screen(filter, timeframe, result, err)) {
+        set_error(err);
+        return nullptr;
+    }
+    const auto &cache = mt5bridge::MarketCache::instance();
+    json_t *ids = json_array();
+    json_t *symbols = json_array();
+    for (int32_t id : result.ids) {
+        json_array_append_new(ids, json_integer(id));
+        json_array_append_new(symbols, json_string(cache.name(id).c_str()));
+    }
+    return json_pack("{s:o, s:o, s:I}", "ids", ids, "symbols", symbols, "scanned",
+                     static_cast<json_int_t>(result.scanned));
+}
+
+/* {"method": "rule_add", "rule"[, "symbols"][, "timeframe"]}: registers
+ * a signal rule over the symbols (default every cached symbol), reading
+ * bars of timeframe (default M1): {"id"}.
+ */
+json_t *rule_add(const json_t *req) {
+    const char *rule = req_string(req, "rule");
+    if (!rule) {
+        missing_params("rule_add", "rule");
+        return nullptr;
+    }
+    mt5bridge::RuleSpec spec;
+    spec.rule = rule;
+    if (json_object_get(req, "symbols")) {
+        std::vector<const char *> symbols;
+        if (!req_symbols(req, "rule_add", symbols))
+            return nullptr;
+        spec.symbols.assign(symbols.begin(), symbols.end());
+    }
+    long long timeframe = mt5bridge::kTimeframeM1;
+    req_int(req, "timeframe", timeframe);
+    spec.timeframe = timeframe;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::SignalRules::instance().add(spec, id, err)) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *rule_remove(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("rule_remove", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::SignalRules::instance().remove(id)) {
+        set_error("unknown rule id " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+/* {"method": "rules_evaluate"}: runs every rule once and returns all
+ * queued events: {"events": [{"rule", "symbol", "id", "time_msc"}, ...],
+ * "rules", "lanes", "fired", "dropped"}.
+ */
+json_t *rules_evaluate(const json_t *) {
+    auto &rules = mt5bridge::SignalRules::instance();
+    const mt5bridge::RulePass pass = rules.evaluate();
+    const auto &cache = mt5bridge::MarketCache::instance();
+    json_t *events = json_array();
+    mt5bridge::RuleEvent batch[256];
+    while (const size_t n = rules.take(batch, 256)) {
+        for (size_t i = 0; i < n; ++i) {
+            const mt5bridge::RuleEvent &e = batch[i];
+            json_array_append_new(
+                events, json_pack("{s:I, s:s, s:i, s:I}", "rule", static_cast<json_int_t>(e.rule),
+                                  "symbol", cache.name(e.symbol).c_str(), "id", e.symbol,
+                                  "time_msc", static_cast<json_int_t>(e.time_msc)));
+        }
+    }
+    return json_pack("{s:o, s:I, s:I, s:I, s:I}", "events", events, "rules",
+                     static_cast<json_int_t>(pass.rules), "lanes",
+                     static_cast<json_int_t>(pass.lanes), "fired",
+                     static_cast<json_int_t>(pass.fired), "dropped",
+                     static_cast<json_int_t>(rules.dropped()));
+}
+
+/* {"method": "copier_poll"}: publishes master deals made outside the
+ * bridge: {"published"}.
+ */
+json_t *copier_poll(const json_t *) {
+    if (!typed_call_ready())
+        return nullptr;
+    std::string err;
+    const int64_t n = mt5bridge::Copier::instance().poll(backend(), err);
+    if (n < 0) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "published", static_cast<json_int_t>(n));
+}
+
+/* {"method": "copier_follow"[, "timeout_ms"]}: copies the master deals
+ * published since the last call, waiting up to timeout_ms (default
+ * 1000) for one: {"handled"}.
+ */
+json_t *copier_follow(const json_t *req) {
+    if (!typed_call_ready())
+        return nullptr;
+    long long timeout_ms = 1000;
+    req_int(req, "timeout_ms", timeout_ms);
+    std::string err;
+    const int64_t n = mt5bridge::Copier::instance().follow(backend(), timeout_ms, err);
+    if (n < 0) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "handled", static_cast<json_int_t>(n));
+}
+
+/* Syncs the portfolio from the bridge backend; a backtest's positions
+ * must not replace the account's.
+ */
+int64_t sync_portfolio() {
+    if (mt5bridge::thread_backend()) {
+        set_error("the portfolio follows the bridge backend, not a backtest");
+        return -1;
+    }
+    std::string err;
+    const int64_t n = mt5bridge::Portfolio::instance().sync(backend(), err);
+    if (n < 0)
+        set_error(err);
+    return n;
+}
+
+/* {"method": "portfolio_sync"}: reloads the positions and what pricing
+ * them needs, then answers like {"method": "portfolio"}.
+ */
+json_t *portfolio_sync(const json_t *) {
+    if (!typed_call_ready() || sync_portfolio() < 0)
+        return nullptr;
+    return mt5bridge::Portfolio::instance().to_json();
+}
+
+/* Starts an algorithm on the bridge backend; backtests bind their own
+ * backend to the thread, which ends before the algorithm would.
+ */
+int64_t start_algo(const mt5bridge::AlgoSpec &spec) {
+    if (mt5bridge::thread_backend()) {
+        set_error("algos run on the bridge backend, not inside a backtest");
+        return -1;
+    }
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::ExecAlgos::instance().start(spec, backend(), id, err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+/* {"method": "algo_start", "algo", "symbol", "type", "volume", ...}:
+ * starts a twap, vwap or iceberg parent order: {"id"}.
+ */
+json_t *algo_start(const json_t *req) {
+    if (!typed_call_ready())
+        return nullptr;
+    mt5bridge::AlgoSpec spec;
+    std::string err;
+    if (!mt5bridge::algo_spec_from_json(req, spec, err)) {
+        set_error("algo_start: " + err);
+        return nullptr;
+    }
+    const int64_t id = start_algo(spec);
+    return id < 0 ? nullptr : json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *algo_cancel(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("algo_cancel", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::ExecAlgos::instance().cancel(id)) {
+        set_error("no running algo " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+/* Runs a scheduled request on the timer thread. */
+json_t *eval_scheduled(json_t *request, std::string &error) {
+    json_t *result = mt5bridge_eval(request);
+    if (!result)
+        error = g_last_error;
+    return result;
+}
+
+bool known_method(const char *method);
+
+/* Starts a schedule on the bridge backend; like algorithms, schedules
+ * outlive the backtest a handler runs in.
+ */
+int64_t add_schedule(const mt5bridge::ScheduleSpec &spec) {
+    if (mt5bridge::thread_backend()) {
+        set_error("schedules run on the bridge backend, not inside a backtest");
+        return -1;
+    }
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::ScheduledRequests::instance().add(spec, eval_scheduled, known_method, id,
+                                                      err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+/* {"method": "schedule", "request": {...}, "period_ms", "offset_ms",
+ * "align"}: runs request on the timer wheel, keeping its last answer:
+ * {"id"}.
+ */
+json_t *schedule(const json_t *req) {
+    if (!typed_call_ready())
+        return nullptr;
+    mt5bridge::ScheduleSpec spec;
+    std::string err;
+    if (!mt5bridge::schedule_spec_from_json(req, spec, err)) {
+        set_error("schedule: " + err);
+        return nullptr;
+    }
+    const int64_t id = add_schedule(spec);
+    return id < 0 ? nullptr : json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *unschedule(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("unschedule", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::ScheduledRequests::instance().remove(id)) {
+        set_error("no schedule " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+json_t *scheduled_result(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("scheduled_result", "id");
+        return nullptr;
+    }
+    json_t *out = mt5bridge::ScheduledRequests::instance().result(id);
+    if (!out)
+        set_error("no schedule " + std::to_string(id));
+    return out;
+}
+
+/* Opens a bar window on the bridge backend, which outlives backtests. */
+int64_t open_bar_window(const char *symbol, int64_t timeframe, int64_t count,
+                        int64_t refresh_ms) {
+    if (mt5bridge::thread_backend()) {
+        set_error("bar windows run on the bridge backend, not inside a backtest");
+        return -1;
+    }
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::BarWindows::instance().open(symbol, timeframe, count, refresh_ms, backend(),
+                                                id, err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+/* {"method": "bar_window_open", "symbol", "count", "timeframe",
+ * "refresh_ms"}: {"id"}. timeframe defaults to M1, refresh_ms to 0.
+ */
+json_t *bar_window_open(const json_t *req) {
+    if (!typed_call_ready())
+        return nullptr;
+    const char *symbol = req_string(req, "symbol");
+    long long count = 0, timeframe = mt5bridge::kTimeframeM1, refresh_ms = 0;
+    if (!symbol || !req_int(req, "count", count)) {
+        missing_params("bar_window_open", "symbol and count");
+        return nullptr;
+    }
+    req_int(req, "timeframe", timeframe);
+    req_int(req, "refresh_ms", refresh_ms);
+    const int64_t id = open_bar_window(symbol, timeframe, count, refresh_ms);
+    return id < 0 ? nullptr : json_pack("{s:I}", "id", static_cast<json_int_t>(id));
+}
+
+json_t *bar_window_close(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("bar_window_close", "id");
+        return nullptr;
+    }
+    if (!mt5bridge::BarWindows::instance().close(id)) {
+        set_error("no bar window " + std::to_string(id));
+        return nullptr;
+    }
+    return json_true();
+}
+
+json_t *bar_window_refresh(const json_t *req) {
+    long long id = 0;
+    if (!req_int(req, "id", id)) {
+        missing_params("bar_window_refresh", "id");
+        return nullptr;
+    }
+    std::string err;
+    const int64_t changed = mt5bridge::BarWindows::instance().refresh(id, err);
+    if (changed < 0) {
+        set_error(err);
+        return nullptr;
+    }
+    return json_pack("{s:I}", "changed", static_cast<json_int_t>(changed));
+}
+
+/* {"method": "bar_window", "id", "from", "version"}: the window's bars
+ * opened at or after from (default all), none if version is current.
+ */
+json_t *bar_window(const json_t *req) {
+    long long id = 0, from = 0, version = -1;
+    if (!req_int(req, "id", id)) {
+        missing_params("bar_window", "id");
+        return nullptr;
+    }
+    req_int(req, "from", from);
+    req_int(req, "version", version);
+    json_t *out = mt5bridge::BarWindows::instance().bars_json(id, from, version);
+    if (!out)
+        set_error("no bar window " + std::to_string(id));
+    return out;
+}
+
+/* Methods answered from bridge state; they never reach a backend and are
+ * not journaled.
+ */
+struct NativeMethod {
+    const char *name;
+    json_t *(*fn)(const json_t *request);
+};
+
+const NativeMethod kNativeMethods[] = {
+    {"config", [](const json_t *) { return mt5bridge::config_to_json(); }},
+    {"server_time", [](const json_t *) { return mt5bridge::ServerClock::instance().to_json(); }},
+    {"tick_integrity", [](const json_t *) { return mt5bridge::TickIntegrity::instance().to_json(); }},
+    {"journal", journal_status},
+    {"import_csv", import_csv},
+    {"history_file", history_file},
+    {"stream_indicator_add", stream_indicator_add},
+    {"stream_indicator_remove", stream_indicator_remove},
+    {"stream_indicators", stream_indicators},
+    {"asof", asof},
+    {"rolling_matrix_add", rolling_matrix_add},
+    {"rolling_matrix_remove", rolling_matrix_remove},
+    {"rolling_matrix", rolling_matrix},
+    {"rolling_matrices", [](const json_t *) { return mt5bridge::RollingMatrices::instance().to_json(); }},
+    {"screen", screen},
+    {"rule_add", rule_add},
+    {"rule_remove", rule_remove},
+    {"rules", [](const json_t *) { return mt5bridge::SignalRules::instance().to_json(); }},
+    {"rules_evaluate", rules_evaluate},
+    {"copier", [](const json_t *) { return mt5bridge::Copier::instance().to_json(); }},
+    {"copier_poll", copier_poll},
+    {"copier_follow", copier_follow},
+    {"portfolio", [](const json_t *) { return mt5bridge::Portfolio::instance().to_json(); }},
+    {"portfolio_sync", portfolio_sync},
+    {"algo_start", algo_start},
+    {"algo_cancel", algo_cancel},
+    {"algos", [](const json_t *) { return mt5bridge::ExecAlgos::instance().to_json(); }},
+    {"timer_wheel", [](const json_t *) { return mt5bridge::TimerWheel::instance().to_json(); }},
+    {"schedule", schedule},
+    {"unschedule", unschedule},
+    {"scheduled_result", scheduled_result},
+    {"schedules", [](const json_t *) { return mt5bridge::ScheduledRequests::instance().to_json(); }},
+    {"bar_window_open", bar_window_open},
+    {"bar_window_close", bar_window_close},
+    {"bar_window_refresh", bar_window_refresh},
+    {"bar_window", bar_window},
+    {"bar_windows", [](const json_t *) { return mt5bridge::BarWindows::instance().to_json(); }},
+};
+
+/* True if mt5bridge_eval serves method, natively or on the backend. */
+bool known_method(const char *method) {
+    for (const auto &m : kNativeMethods)
+        if (std::strcmp(m.name, method) == 0)
+            return true;
+    return backend().serves(method);
+}
+} // namespace
+
+extern "C" {
+
+MT5BRIDGE_API int mt5bridge_initialize(const wchar_t *python_home) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    clear_error();
+
+    if (g_initialized)
+        return 0; // already initialized
+
+    std::string err;
+    if (!mt5bridge::config_resolve(err)) {
+        set_error(err);
+        return -1;
+    }
+    const mt5bridge::Config cfg = mt5bridge::config();
+
+    mt5bridge::TscClock &clock = mt5bridge::TscClock::instance();
+    clock.use_tsc(cfg.clock_tsc);
+    clock.calibrate();
+
+    if (!mt5bridge::ServerClock::instance().configure(
+            cfg.time_dst_rule, cfg.time_base_offset_s, cfg.time_offset_window_s, err)) {
+        set_error(err);
+        return -1;
+    }
+    apply_live_config(cfg);
+
+    if (!cfg.journal_record.empty()) {
+        g_journal = mt5bridge::JournalWriter::open(
+            cfg.journal_record, static_cast<size_t>(cfg.queue_capacity), err);
+        if (!g_journal) {
+            set_error(err);
+            return -1;
+        }
+    }
+
+    // Offline backends serve requests without Python or a terminal.
+    g_backend = mt5bridge::make_backend(cfg, err);
+    if (!err.empty()) {
+        g_journal.reset();
+        set_error(err);
+        return -1;
+    }
+    if (g_backend) {
+        start_clock_reanchor(cfg);
+        mt5bridge::config_freeze(true);
+        g_initialized = true;
+        return 0;
+    }
+
+    // An explicit argument wins over python_home from the configuration.
+    Py_SetProgramName(const_cast<wchar_t *>(L"mt5bridge"));
+    if (python_home) {
+        g_python_home = python_home;
+    } else if (!cfg.python_home.empty()) {
+        wchar_t *decoded = Py_DecodeLocale(cfg.python_home.c_str(), nullptr);
+        if (!decoded) {
+            g_journal.reset();
+            set_error("cannot decode python_home");
+            return -1;
+        }
+        g_python_home = decoded;
+        PyMem_RawFree(decoded);
+    } else {
+        g_python_home.clear();
+    }
+    if (!g_python_home.empty())
+        Py_SetPythonHome(g_python_home.c_str());
+
+    // The calling thread owns the interpreter from here on. A refused
+    // policy (e.g. missing real-time privileges) does not stop startup.
+    mt5bridge::apply_thread_policy(mt5bridge::ThreadRole::PythonExecutor);
+    Py_Initialize();
+    if (!Py_IsInitialized()) {
+        g_journal.reset();
+        set_error("Py_Initialize failed");
+        return -1;
+    }
+
+    // Import MetaTrader5 module and initialize connection.
+    PyGILState_STATE gs = PyGILState_Ensure();
+    PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
+    if (!mt5) {
+        set_python_error();
+        PyGILState_Release(gs);
+        Py_Finalize();
+        g_journal.reset();
+        return -1;
+    }
+
+    PyObject *res = cfg.terminal_path.empty()
+                        ? PyObject_CallMethod(mt5, "initialize", nullptr)
+                        : PyObject_CallMethod(mt5, "initialize", "s",
+                                              cfg.terminal_path.c_str());
+    if (!res) {
+        set_python_error();
+        Py_DECREF(mt5);
+        PyGILState_Release(gs);
+        Py_Finalize();
+        g_journal.reset();
+        return -1;
+    }
+    Py_DECREF(res);
+    Py_DECREF(mt5);
+    PyGILState_Release(gs);
+
+    // Release the GIL so that other threads may call into the API.
+    PyEval_SaveThread();
+
+    start_clock_reanchor(cfg);
+    mt5bridge::config_freeze(true);
+    g_initialized = true;
+    return 0;
+}
+
+MT5BRIDGE_API void mt5bridge_shutdown() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    clear_error();
+
+    if (!g_initialized)
+        return;
+    mt5bridge::ExecAlgos::instance().stop();
+    mt5bridge::ScheduledRequests::instance().stop();
+    mt5bridge::BarWindows::instance().stop();
+    mt5bridge::TimerWheel::instance().stop();
+    mt5bridge::Copier::instance().close();
+
+    if (g_backend) {
+        g_backend.reset();
+        g_journal.reset();
+        mt5bridge::config_freeze(false);
+        g_initialized = false;
+        return;
+    }
+
+    PyGILState_STATE gs = PyGILState_Ensure();
+
+    // Attempt to gracefully shutdown the MetaTrader5 module.
+    PyObject *mt5 = PyImport_ImportModule("MetaTrader5");
+    if (mt5) {
+        PyObject *res = PyObject_CallMethod(mt5, "shutdown", nullptr);
+        if (!res)
+            set_python_error();
+        else
+            Py_DECREF(res);
+        Py_DECREF(mt5);
+    } else {
+        PyErr_Clear();
+    }
+
+    PyGILState_Release(gs);
+
+    Py_Finalize();
+    g_journal.reset(); // flushes pending records
+    mt5bridge::config_freeze(false);
+    g_initialized = false;
+}
+
+MT5BRIDGE_API json_t *mt5bridge_eval(json_t *request) {
+    if (!request) {
+        set_error("request is null");
+        return nullptr;
+    }
+
+    const char *method = json_string_value(json_object_get(request, "method"));
+    if (!method) {
+        set_error("missing method");
+        return nullptr;
+    }
+
+    // Methods served natively never touch the interpreter.
+    for (const auto &m : kNativeMethods) {
+        if (std::strcmp(method, m.name) == 0) {
+            clear_error();
+            return m.fn(request);
+        }
+    }
+
+    if (!g_initialized) {
+        set_error("bridge not initialized");
+        return nullptr;
+    }
+
+    clear_error();
+    const int64_t t_request = mt5bridge::now_ns();
+    json_t *result = nullptr;
+    if (g_backend) {
+        std::string err;
+        result = backend().eval(method, request, err);
+        if (!err.empty())
+            set_error(err);
+    } else {
+        result = eval_python(method, request);
+    }
+    // Only orders that reached the live account are published to followers.
+    const bool live = backend().live();
+    if (result && live && std::strcmp(method, "order_send") == 0) {
+        mt5bridge::Copier::instance().on_order(json_object_get(request, "request"), result);
+    } else if (result && live && std::strcmp(method, "open_market_buy") == 0) {
+        json_t *trade = json_pack("{s:O?, s:i}", "symbol", json_object_get(request, "symbol"),
+                                  "type", 0);
+        mt5bridge::Copier::instance().on_order(trade, result);
+        json_decref(trade);
+    } else if (json_is_array(result) && std::strcmp(method, "positions_get") == 0 &&
+               !mt5bridge::thread_backend()) {
+        std::vector<mt5bridge_position> positions;
+        mt5bridge::positions_from_json(result, positions);
+        mt5bridge::Portfolio::instance().on_positions(positions);
+    } else if (json_is_object(result) && std::strcmp(method, "symbol_info") == 0) {
+        mt5bridge::Portfolio::instance().on_symbol_info(result);
+    }
+    if (g_journal)
+        g_journal->record_eval(request, result, g_last_error, t_request, mt5bridge::now_ns());
+    return result;
+}
+
+MT5BRIDGE_API int mt5bridge_symbol_info_tick(const char *symbol, mt5bridge_tick *out) {
+    if (!typed_call_ready())
+        return -1;
+    if (!symbol || !out) {
+        set_error("symbol and out must not be null");
+        return -1;
+    }
+    mt5bridge::Tick tick;
+    std::string err;
+    const int64_t t_request = mt5bridge::now_ns();
+    const bool ok = backend().symbol_info_tick(symbol, tick, err);
+    if (g_journal)
+        journal_typed(mt5bridge::symbol_info_tick_request(symbol),
+                      ok ? mt5bridge::tick_to_json(tick) : nullptr, err, t_request);
+    if (!ok) {
+        set_error(err);
+        return -1;
+    }
+    std::memcpy(out, &tick, sizeof *out);
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copy_ticks_from(const char *symbol, int64_t date_from,
+                                               size_t count, int flags,
+                                               mt5bridge_tick *out) {
+    if (!typed_call_ready())
+        return -1;
+    if (!symbol || (!out && count)) {
+        set_error("symbol and out must not be null");
+        return -1;
+    }
+    std::vector<mt5bridge::Tick> ticks;
+    std::string err;
+    if (!copy_ticks(symbol, date_from, static_cast<int64_t>(count), flags, ticks, err)) {
+        set_error(err);
+        return -1;
+    }
+    const size_t n = std::min(ticks.size(), count);
+    if (n)
+        std::memcpy(out, ticks.data(), n * sizeof *out);
+    return static_cast<int64_t>(n);
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copy_rates_from_pos(const char *symbol, int timeframe,
+                                                   int64_t start, size_t count,
+                                                   mt5bridge_bar *out) {
+    if (!typed_call_ready())
+        return -1;
+    if (!symbol || (!out && count)) {
+        set_error("symbol and out must not be null");
+        return -1;
+    }
+    std::vector<mt5bridge::Bar> bars;
+    std::string err;
+    if (!copy_rates(symbol, timeframe, start, static_cast<int64_t>(count), bars, err)) {
+        set_error(err);
+        return -1;
+    }
+    const size_t n = std::min(bars.size(), count);
+    if (n)
+        std::memcpy(out, bars.data(), n * sizeof *out);
+    return static_cast<int64_t>(n);
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copy_ticks_batch(const char *const *symbols, size_t symbol_count,
+                                                int64_t date_from, size_t count, int flags,
+                                                mt5bridge_tick *out, int64_t *counts) {
+    return copy_batch<mt5bridge_tick, mt5bridge::Tick>(
+        symbols, symbol_count, count, out, counts,
+        [&](const char *symbol, std::vector<mt5bridge::Tick> &ticks, std::string &err) {
+            return copy_ticks(symbol, date_from, static_cast<int64_t>(count), flags, ticks, err);
+        });
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copy_rates_batch(const char *const *symbols, size_t symbol_count,
+                                                int timeframe, int64_t start, size_t count,
+                                                mt5bridge_bar *out, int64_t *counts) {
+    return copy_batch<mt5bridge_bar, mt5bridge::Bar>(
+        symbols, symbol_count, count, out, counts,
+        [&](const char *symbol, std::vector<mt5bridge::Bar> &bars, std::string &err) {
+            return copy_rates(symbol, timeframe, start, static_cast<int64_t>(count), bars, err);
+        });
+}
+
+MT5BRIDGE_API int64_t mt5bridge_asof_ticks(const char *const *symbols, size_t symbol_count,
+                                          const int64_t *times_msc, size_t time_count,
+                                          mt5bridge_tick *out) {
+    static_assert(sizeof(mt5bridge_tick) == sizeof(mt5bridge::Tick), "C and native ticks must match");
+    if (!typed_call_ready())
+        return -1;
+    mt5bridge::AsofStats stats;
+    std::string err;
+    if (!mt5bridge::asof_ticks(mt5bridge::config().history_dir, symbols, symbol_count, times_msc,
+                               time_count, reinterpret_cast<mt5bridge::Tick *>(out), stats, err)) {
+        set_error(err);
+        return -1;
+    }
+    set_error(stats.missing_error);
+    return static_cast<int64_t>(stats.filled);
+}
+
+MT5BRIDGE_API int64_t mt5bridge_asof_bars(const char *const *symbols, size_t symbol_count,
+                                         int timeframe, const int64_t *times, size_t time_count,
+                                         mt5bridge_bar *out) {
+    static_assert(sizeof(mt5bridge_bar) == sizeof(mt5bridge::Bar), "C and native bars must match");
+    if (!typed_call_ready())
+        return -1;
+    mt5bridge::AsofStats stats;
+    std::string err;
+    if (!mt5bridge::asof_bars(mt5bridge::config().history_dir, symbols, symbol_count, timeframe,
+                              times, time_count, reinterpret_cast<mt5bridge::Bar *>(out), stats,
+                              err)) {
+        set_error(err);
+        return -1;
+    }
+    set_error(stats.missing_error);
+    return static_cast<int64_t>(stats.filled);
+}
+
+MT5BRIDGE_API int mt5bridge_order_send(const mt5bridge_trade_request *request,
+                                      mt5bridge_trade_result *result) {
+    if (!typed_call_ready())
+        return -1;
+    if (!request || !result || !request->symbol) {
+        set_error("request, request->symbol and result must not be null");
+        return -1;
+    }
+    std::string err;
+    const int64_t t_request = mt5bridge::now_ns();
+    const bool ok = backend().order_send(*request, *result, err);
+    if (g_journal)
+        journal_typed(mt5bridge::order_send_request(*request),
+                      ok ? mt5bridge::trade_result_to_json(*result) : nullptr, err, t_request);
+    if (!ok) {
+        set_error(err);
+        return -1;
+    }
+    if (backend().live())
+        mt5bridge::Copier::instance().on_order(*request, *result);
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_positions_get(mt5bridge_position *out, size_t capacity) {
+    if (!typed_call_ready())
+        return -1;
+    if (!out && capacity) {
+        set_error("out must not be null");
+        return -1;
+    }
+    std::vector<mt5bridge_position> positions;
+    std::string err;
+    const int64_t t_request = mt5bridge::now_ns();
+    const bool ok = backend().positions_get(positions, err);
+    if (g_journal)
+        journal_typed(json_pack("{s:s}", "method", "positions_get"),
+                      ok ? records_json(positions, mt5bridge::position_to_json) : nullptr, err,
+                      t_request);
+    if (!ok) {
+        set_error(err);
+        return -1;
+    }
+    if (!mt5bridge::thread_backend())
+        mt5bridge::Portfolio::instance().on_positions(positions);
+    const size_t n = std::min(positions.size(), capacity);
+    if (n)
+        std::memcpy(out, positions.data(), n * sizeof *out);
+    return static_cast<int64_t>(positions.size());
+}
+
+MT5BRIDGE_API int mt5bridge_run(const char *const *symbols, size_t count,
+                               mt5bridge_tick_handler handler, void *user) {
+    if (!typed_call_ready())
+        return -1;
+    if (!handler || (!symbols && count)) {
+        set_error("handler and symbols must not be null");
+        return -1;
+    }
+    std::vector<std::string> names(symbols, symbols + count);
+    std::string err;
+    if (!backend().run(names, handler, user, err)) {
+        set_error(err);
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API json_t *mt5bridge_backtest_parallel(const mt5bridge_backtest_job *jobs,
+                                                 size_t count,
+                                                 mt5bridge_tick_handler handler) {
+    if (!typed_call_ready())
+        return nullptr;
+    auto *base = dynamic_cast<mt5bridge::BacktestBackend *>(g_backend.get());
+    if (!base) {
+        set_error("backtest_parallel requires backend=backtest");
+        return nullptr;
+    }
+    std::string err;
+    json_t *result = mt5bridge::run_backtests(*base, jobs, count, handler, err);
+    if (!result)
+        set_error(err);
+    return result;
+}
+
+MT5BRIDGE_API json_t *mt5bridge_eval_batch(json_t *requests) {
+    if (!json_is_array(requests)) {
+        set_error("requests must be a JSON array");
+        return nullptr;
+    }
+    // Each request the interpreter serves takes the GIL itself.
+    json_t *out = json_array();
+    size_t i;
+    json_t *request;
+    json_array_foreach(requests, i, request) {
+        json_t *result = mt5bridge_eval(request);
+        if (!result)
+            result = json_pack("{s:s}", "error", g_last_error.c_str());
+        json_array_append_new(out, result);
+    }
+    clear_error();
+    return out;
+}
+
+MT5BRIDGE_API const char *mt5bridge_eval_json(const char *request) {
+    return eval_text(request, mt5bridge_eval);
+}
+
+MT5BRIDGE_API const char *mt5bridge_eval_batch_json(const char *requests) {
+    return eval_text(requests, mt5bridge_eval_batch);
+}
+
+MT5BRIDGE_API int64_t mt5bridge_now_ns() { return mt5bridge::now_ns(); }
+
+MT5BRIDGE_API int mt5bridge_server_to_utc_ns(const int64_t *times, size_t count,
+                                            int64_t unit_ns, int64_t *out) {
+    clear_error();
+    if ((!times || !out) && count) {
+        set_error("times and out must not be null");
+        return -1;
+    }
+    if (unit_ns <= 0 || 1000000000 % unit_ns != 0) {
+        set_error("unit_ns must divide one second");
+        return -1;
+    }
+    if (!mt5bridge::ServerClock::instance().to_utc_ns(times, sizeof(int64_t), count,
+                                                      unit_ns, out)) {
+        set_error("server time offset not known yet");
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int mt5bridge_set_thread_policy(const char *role, json_t *policy) {
+    clear_error();
+
+    mt5bridge::ThreadRole r;
+    if (!mt5bridge::parse_thread_role(role, r)) {
+        set_error("unknown thread role");
+        return -1;
+    }
+
+    mt5bridge::ThreadPolicy p = mt5bridge::thread_policy(r);
+    std::string err;
+    if (!mt5bridge::thread_policy_from_json(policy, p, err) ||
+        !mt5bridge::config_set_thread_policy(r, p, err)) {
+        set_error(err);
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int mt5bridge_config_load(const char *path) {
+    clear_error();
+    if (!path) {
+        set_error("path is null");
+        return -1;
+    }
+    std::string err;
+    if (!mt5bridge::config_load_file(path, err)) {
+        set_error(err);
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int mt5bridge_config_set(const char *key, const char *value) {
+    clear_error();
+    if (!key || !value) {
+        set_error("key and value must not be null");
+        return -1;
+    }
+    std::string err;
+    if (!mt5bridge::config_set(key, value, err)) {
+        set_error(err);
+        return -1;
+    }
+    apply_live_config(mt5bridge::config());
+    return 0;
+}
+
+MT5BRIDGE_API json_t *mt5bridge_config_get() {
+    clear_error();
+    return mt5bridge::config_to_json();
+}
+
+MT5BRIDGE_API int mt5bridge_sma(const double *in, size_t stride, size_t n, size_t period,
+                               double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::sma(in, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_ema(const double *in, size_t stride, size_t n, size_t period,
+                               double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::ema(in, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_stddev(const double *in, size_t stride, size_t n, size_t period,
+                                  double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::stddev(in, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_zscore(const double *in, size_t stride, size_t n, size_t period,
+                                  double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::zscore(in, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_bollinger(const double *in, size_t stride, size_t n, size_t period,
+                                     double k, double *mid, double *upper, double *lower) {
+    clear_error();
+    std::string err;
+    return indicator_status(
+        mt5bridge::bollinger(in, stride, n, period, k, mid, upper, lower, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_rsi(const double *close, size_t stride, size_t n, size_t period,
+                               double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::rsi(close, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_atr(const double *high, const double *low, const double *close,
+                               size_t stride, size_t n, size_t period, double *out) {
+    clear_error();
+    std::string err;
+    return indicator_status(mt5bridge::atr(high, low, close, stride, n, period, out, err), err);
+}
+
+MT5BRIDGE_API int mt5bridge_macd(const double *close, size_t stride, size_t n, size_t fast,
+                                size_t slow, size_t signal, double *macd, double *signal_line,
+                                double *hist) {
+    clear_error();
+    std::string err;
+    return indicator_status(
+        mt5bridge::macd(close, stride, n, fast, slow, signal, macd, signal_line, hist, err), err);
+}
+
+MT5BRIDGE_API const char *mt5bridge_indicator_isa() { return mt5bridge::indicator_isa(); }
+
+MT5BRIDGE_API int64_t mt5bridge_stream_indicator_add(const char *symbol, const char *kind,
+                                                    int timeframe, const char *field,
+                                                    size_t period) {
+    clear_error();
+    if (!symbol || !kind) {
+        set_error("symbol and kind must not be null");
+        return -1;
+    }
+    mt5bridge::StreamSpec spec;
+    spec.symbol = symbol;
+    spec.kind = kind;
+    spec.timeframe = timeframe;
+    spec.field = field ? field : "";
+    spec.period = period;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::StreamIndicators::instance().add(spec, id, err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+MT5BRIDGE_API int mt5bridge_stream_indicator_remove(int64_t id) {
+    clear_error();
+    if (!mt5bridge::StreamIndicators::instance().remove(id)) {
+        set_error("unknown indicator id " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int mt5bridge_stream_indicator_read(int64_t id, mt5bridge_stream_value *out) {
+    mt5bridge::StreamValue v;
+    if (!out || !mt5bridge::StreamIndicators::instance().read(id, v)) {
+        set_error("unknown indicator id " + std::to_string(id));
+        return -1;
+    }
+    out->value = v.value;
+    out->time_msc = v.time_msc;
+    out->samples = v.samples;
+    out->ready = v.ready ? 1 : 0;
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_rolling_matrix_add(const char *const *symbols, size_t symbol_count,
+                                                  int timeframe, size_t window) {
+    clear_error();
+    if (!symbols && symbol_count) {
+        set_error("symbols must not be null");
+        return -1;
+    }
+    mt5bridge::MatrixSpec spec;
+    for (size_t i = 0; i < symbol_count; ++i) {
+        if (!symbols[i]) {
+            set_error("symbols must not be null");
+            return -1;
+        }
+        spec.symbols.emplace_back(symbols[i]);
+    }
+    spec.timeframe = timeframe;
+    spec.window = window;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::RollingMatrices::instance().add(spec, mt5bridge::config().history_dir, id,
+                                                    err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+MT5BRIDGE_API int mt5bridge_rolling_matrix_remove(int64_t id) {
+    clear_error();
+    if (!mt5bridge::RollingMatrices::instance().remove(id)) {
+        set_error("unknown matrix id " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_rolling_matrix_read(int64_t id, int correlation, double *out,
+                                                   size_t capacity, int64_t *time) {
+    mt5bridge::MatrixValue value;
+    if (!mt5bridge::RollingMatrices::instance().read(id, correlation != 0, value)) {
+        set_error("unknown matrix id " + std::to_string(id));
+        return -1;
+    }
+    if (!out || capacity < value.values.size()) {
+        set_error("out must hold " + std::to_string(value.values.size()) + " values");
+        return -1;
+    }
+    std::copy(value.values.begin(), value.values.end(), out);
+    if (time)
+        *time = value.time;
+    return static_cast<int64_t>(value.rows);
+}
+
+MT5BRIDGE_API int32_t mt5bridge_symbol_id(const char *symbol) {
+    return symbol ? mt5bridge::MarketCache::instance().id(symbol) : -1;
+}
+
+MT5BRIDGE_API const char *mt5bridge_symbol_name(int32_t id) {
+    const std::string &name = mt5bridge::MarketCache::instance().name(id);
+    return name.empty() ? nullptr : name.c_str();
+}
+
+MT5BRIDGE_API int64_t mt5bridge_screen(const char *filter, int timeframe, int32_t *ids,
+                                      size_t capacity) {
+    clear_error();
+    if (!filter || (!ids && capacity)) {
+        set_error("filter and ids must not be null");
+        return -1;
+    }
+    mt5bridge::ScreenResult result;
+    std::string err;
+    if (!mt5bridge::screen(filter, timeframe, result, err)) {
+        set_error(err);
+        return -1;
+    }
+    std::copy_n(result.ids.begin(), std::min(capacity, result.ids.size()), ids);
+    return static_cast<int64_t>(result.ids.size());
+}
+
+MT5BRIDGE_API int64_t mt5bridge_rule_add(const char *rule, const char *const *symbols,
+                                         size_t symbol_count, int timeframe) {
+    clear_error();
+    if (!rule || (!symbols && symbol_count)) {
+        set_error("rule and symbols must not be null");
+        return -1;
+    }
+    mt5bridge::RuleSpec spec;
+    spec.rule = rule;
+    for (size_t i = 0; i < symbol_count; ++i) {
+        if (!symbols[i]) {
+            set_error("symbols must not be null");
+            return -1;
+        }
+        spec.symbols.emplace_back(symbols[i]);
+    }
+    spec.timeframe = timeframe;
+    int64_t id = 0;
+    std::string err;
+    if (!mt5bridge::SignalRules::instance().add(spec, id, err)) {
+        set_error(err);
+        return -1;
+    }
+    return id;
+}
+
+MT5BRIDGE_API int mt5bridge_rule_remove(int64_t id) {
+    clear_error();
+    if (!mt5bridge::SignalRules::instance().remove(id)) {
+        set_error("unknown rule id " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_rules_evaluate() {
+    return static_cast<int64_t>(mt5bridge::SignalRules::instance().evaluate().fired);
+}
+
+MT5BRIDGE_API int64_t mt5bridge_rule_events(mt5bridge_rule_event *out, size_t capacity) {
+    clear_error();
+    if (!out && capacity) {
+        set_error("out must not be null");
+        return -1;
+    }
+    static_assert(sizeof(mt5bridge_rule_event) == sizeof(mt5bridge::RuleEvent),
+                  "mt5bridge_rule_event must match RuleEvent");
+    return static_cast<int64_t>(mt5bridge::SignalRules::instance().take(
+        reinterpret_cast<mt5bridge::RuleEvent *>(out), capacity));
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copier_poll() {
+    if (!typed_call_ready())
+        return -1;
+    std::string err;
+    const int64_t n = mt5bridge::Copier::instance().poll(backend(), err);
+    if (n < 0)
+        set_error(err);
+    return n;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_copier_follow(int timeout_ms) {
+    if (!typed_call_ready())
+        return -1;
+    std::string err;
+    const int64_t n = mt5bridge::Copier::instance().follow(backend(), timeout_ms, err);
+    if (n < 0)
+        set_error(err);
+    return n;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_portfolio_sync() {
+    if (!typed_call_ready())
+        return -1;
+    return sync_portfolio();
+}
+
+MT5BRIDGE_API int mt5bridge_portfolio_read(mt5bridge_portfolio_totals *out) {
+    clear_error();
+    if (!out) {
+        set_error("out must not be null");
+        return -1;
+    }
+    const mt5bridge::PortfolioTotals t = mt5bridge::Portfolio::instance().totals();
+    out->pnl = t.pnl;
+    out->exposure_gross = t.exposure_gross;
+    out->positions = t.positions;
+    out->unpriced = t.unpriced;
+    out->unconverted = t.unconverted;
+    out->ticks = t.ticks;
+    out->updated_ns = t.updated_ns;
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_algo_start(const mt5bridge_algo_spec *spec) {
+    if (!typed_call_ready())
+        return -1;
+    if (!spec || !spec->algo || !spec->symbol || (!spec->curve && spec->curve_count)) {
+        set_error("spec, algo, symbol and curve must not be null");
+        return -1;
+    }
+    mt5bridge::AlgoSpec s;
+    s.algo = spec->algo;
+    s.symbol = spec->symbol;
+    s.type = spec->type;
+    s.volume = spec->volume;
+    s.duration_ms = spec->duration_ms;
+    s.visible = spec->visible;
+    s.limit = spec->limit;
+    s.magic = spec->magic;
+    s.curve.assign(spec->curve, spec->curve + spec->curve_count);
+    if (spec->comment)
+        s.comment = spec->comment;
+    // Zero members keep the defaults.
+    if (spec->slices)
+        s.slices = spec->slices;
+    if (spec->interval_ms)
+        s.interval_ms = spec->interval_ms;
+    if (spec->volume_step > 0)
+        s.volume_step = spec->volume_step;
+    if (spec->volume_min > 0)
+        s.volume_min = spec->volume_min;
+    if (spec->lookback_days)
+        s.lookback_days = spec->lookback_days;
+    if (spec->deviation)
+        s.deviation = spec->deviation;
+    return start_algo(s);
+}
+
+MT5BRIDGE_API int mt5bridge_algo_cancel(int64_t id) {
+    clear_error();
+    if (!mt5bridge::ExecAlgos::instance().cancel(id)) {
+        set_error("no running algo " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_schedule(const char *request, int64_t period_ms,
+                                        int64_t offset_ms, int align,
+                                        mt5bridge_request_handler handler, void *user) {
+    if (!typed_call_ready())
+        return -1;
+    if (!request) {
+        set_error("request is null");
+        return -1;
+    }
+    json_error_t parse_error;
+    json_t *req = json_loads(request, 0, &parse_error);
+    if (!req) {
+        set_error(std::string("invalid request JSON: ") + parse_error.text);
+        return -1;
+    }
+    mt5bridge::ScheduleSpec spec;
+    spec.request = req;
+    spec.period_ms = period_ms;
+    spec.offset_ms = offset_ms;
+    spec.align = align != 0;
+    spec.handler = handler;
+    spec.user = user;
+    const int64_t id = add_schedule(spec);
+    json_decref(req);
+    return id;
+}
+
+MT5BRIDGE_API int mt5bridge_unschedule(int64_t id) {
+    clear_error();
+    if (!mt5bridge::ScheduledRequests::instance().remove(id)) {
+        set_error("no schedule " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_bar_window_open(const char *symbol, int timeframe, size_t count,
+                                               int64_t refresh_ms) {
+    if (!typed_call_ready())
+        return -1;
+    return open_bar_window(symbol, timeframe, static_cast<int64_t>(count), refresh_ms);
+}
+
+MT5BRIDGE_API int mt5bridge_bar_window_close(int64_t id) {
+    clear_error();
+    if (!mt5bridge::BarWindows::instance().close(id)) {
+        set_error("no bar window " + std::to_string(id));
+        return -1;
+    }
+    return 0;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_bar_window_refresh(int64_t id) {
+    clear_error();
+    std::string err;
+    const int64_t changed = mt5bridge::BarWindows::instance().refresh(id, err);
+    if (changed < 0)
+        set_error(err);
+    return changed;
+}
+
+MT5BRIDGE_API int64_t mt5bridge_bar_window_read(int64_t id, mt5bridge_bar *out, size_t capacity,
+                                               uint64_t *version) {
+    clear_error();
+    if (!out && capacity) {
+        set_error("out must not be null");
+        return -1;
+    }
+    std::vector<mt5bridge::Bar> bars;
+    uint64_t v = 0;
+    if (!mt5bridge::BarWindows::instance().read(id, capacity, bars, v)) {
+        set_error("no bar window " + std::to_string(id));
+        return -1;
+    }
+    if (!bars.empty())
+        std::memcpy(out, bars.data(), bars.size() * sizeof *out);
+    if (version)
+        *version = v;
+    return static_cast<int64_t>(bars.size());
+}
+
+MT5BRIDGE_API int64_t mt5bridge_bar_window_subscribe(int64_t id, mt5bridge_bar_handler handler,
+                                                    void *user) {
+    clear_error();
+    const int64_t subscription = mt5bridge::BarWindows::instance().subscribe(id, handler, user);
+    if (subscription < 0)
+        set_error(handler ? "no bar window " + std::to_string(id)
+                          : std::string("handler must not be null"));
+    return subscription;
+}
+
+MT5BRIDGE_API int mt5bridge_bar_window_unsubscribe(int64_t subscription) {
+    clear_error();
+    if (!mt5bridge::BarWindows::instance().unsubscribe(subscription)) {
+        set_error("no bar window subscription " + std::to_string(subscription));
+        return -1;
+    }
+    return 0;
 }
 
 MT5BRIDGE_API const char *mt5bridge_last_error() {
@@ -0,0 +1,123 @@
+/*
+ * parallel.cpp
+ *
+ * Range-splitting work stealing over per-worker blocks.
+ */
+
+#include "parallel.hpp"
+#include "config.hpp"
+#include "thread_config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mt5bridge {
+namespace {
+
+struct alignas(64) Block {
+    std::mutex mutex;
+    size_t next = 0;    // Next index the owner takes.
+    size_t end = 0;     // One past the last index of the block.
+};
+
+bool take(Block &b, size_t &index) {
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (b.next == b.end)
+        return false;
+    index = b.next++;
+    return true;
+}
+
+/* Moves the back half of the fullest other block into own. A range in
+ * transit is invisible to other thieves, but the thief that holds it runs
+ * it, so a worker that finds nothing to steal may safely stop.
+ */
+bool steal(std::vector<std::unique_ptr<Block>> &blocks, unsigned self) {
+    for (;;) {
+        unsigned victim = self;
+        size_t most = 0;
+        for (unsigned i = 0; i < blocks.size(); ++i) {
+            if (i == self)
+                continue;
+            std::lock_guard<std::mutex> lock(blocks[i]->mutex);
+            const size_t left = blocks[i]->end - blocks[i]->next;
+            if (left > most) {
+                most = left;
+                victim = i;
+            }
+        }
+        if (victim == self)
+            return false;
+
+        size_t from, to;
+        {
+            Block &v = *blocks[victim];
+            std::lock_guard<std::mutex> lock(v.mutex);
+            const size_t left = v.end - v.next;
+            if (left == 0)
+                continue; // Drained meanwhile; look again.
+            from = v.next + left / 2; // A single item goes to the thief.
+            to = v.end;
+            v.end = from;
+        }
+        Block &own = *blocks[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.next = from;
+        own.end = to;
+        return true;
+    }
+}
+
+} // namespace
+
+unsigned worker_count(size_t items) {
+    uint64_t n = config().threads_workers;
+    if (n == 0)
+        n = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(n, items)));
+}
+
+ParallelStats parallel_for(size_t count, unsigned workers,
+                           const std::function<void(size_t index, unsigned worker)> &fn) {
+    ParallelStats stats;
+    workers = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(workers, count)));
+    stats.workers = workers;
+    if (workers == 1) {
+        for (size_t i = 0; i < count; ++i)
+            fn(i, 0);
+        return stats;
+    }
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    for (unsigned w = 0; w < workers; ++w) {
+        blocks.emplace_back(new Block());
+        blocks[w]->next = count * w / workers;
+        blocks[w]->end = count * (w + 1) / workers;
+    }
+
+    std::atomic<uint64_t> steals{0};
+    auto work = [&](unsigned self) {
+        size_t index;
+        for (;;) {
+            while (take(*blocks[self], index))
+                fn(index, self);
+            if (!steal(blocks, self))
+                return;
+            steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w)
+        threads.push_back(start_thread(ThreadRole::Worker, [&work, w] { work(w); }));
+    for (std::thread &t : threads)
+        t.join();
+    stats.steals = steals.load();
+    return stats;
+}
+
+} // namespace mt5bridge
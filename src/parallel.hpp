@@ -0,0 +1,38 @@
+/*
+ * parallel.hpp
+ *
+ * Work-stealing parallel loop on Worker-role threads.
+ *
+ * The index range is split evenly into one contiguous block per worker.
+ * A worker takes items from the front of its own block; once that is
+ * empty it steals the back half of the fullest remaining block. Items
+ * stay contiguous per worker, which keeps cache locality for cheap items,
+ * and uneven items (a backtest over a liquid symbol next to one over a
+ * thin one) still spread over all workers.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace mt5bridge {
+
+struct ParallelStats {
+    unsigned workers = 0;
+    uint64_t steals = 0;    // Successful steals across all workers.
+};
+
+/* Worker count for threads.workers (0 = one per core), capped at items. */
+unsigned worker_count(size_t items);
+
+/* Calls fn(index, worker) once for every index in [0, count) on workers
+ * threads and returns when all calls have returned. worker is in
+ * [0, workers) and identifies the calling thread, for per-worker scratch
+ * state. workers == 1 runs on the calling thread.
+ */
+ParallelStats parallel_for(size_t count, unsigned workers,
+                           const std::function<void(size_t index, unsigned worker)> &fn);
+
+} // namespace mt5bridge
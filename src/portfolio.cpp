@@ -0,0 +1,455 @@
+/*
+ * portfolio.cpp
+ *
+ * Incremental mark-to-market of open positions and currency conversion.
+ */
+
+#include "portfolio.hpp"
+
+#include "clock.hpp"
+#include "config.hpp"
+#include "market_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <set>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int32_t kPositionBuy = 0; // POSITION_TYPE_BUY
+const char *const kVehicle = "USD";  // Tried when no direct pair converts.
+
+double sign(const mt5bridge_position &p) { return p.type == kPositionBuy ? 1.0 : -1.0; }
+
+/* Account currency amount as JSON; null when no rate resolves. */
+json_t *amount(double value, double rate) {
+    return std::isfinite(rate) ? json_real(value * rate) : json_null();
+}
+
+} // namespace
+
+Portfolio &Portfolio::instance() {
+    static Portfolio portfolio;
+    return portfolio;
+}
+
+size_t Portfolio::symbol(const std::string &name) {
+    auto it = by_name_.find(name);
+    if (it != by_name_.end())
+        return it->second;
+    Symbol s;
+    s.name = name;
+    Tick quote{};
+    if (MarketCache::instance().quote(name.c_str(), quote) && quote.bid > 0 && quote.ask > 0) {
+        s.bid = quote.bid;
+        s.ask = quote.ask;
+        s.time_msc = quote.time_msc;
+    }
+    symbols_.push_back(std::move(s));
+    by_name_.emplace(name, symbols_.size() - 1);
+    return symbols_.size() - 1;
+}
+
+void Portfolio::set_currency(const std::string &currency) {
+    if (currency == currency_)
+        return;
+    currency_ = currency;
+    paths_valid_ = false;
+    rebuild(); // Unpriced positions count in the account currency.
+}
+
+double Portfolio::position_pnl(const Symbol &s, const Position &p) const {
+    double mark = p.pos.type == kPositionBuy ? s.bid : s.ask;
+    if (s.mid() <= 0)
+        mark = p.pos.price_current > 0 ? p.pos.price_current : p.pos.price_open;
+    return sign(p.pos) * (mark - p.pos.price_open) * p.pos.volume * s.contract_size;
+}
+
+double Portfolio::notional(const Symbol &s) const {
+    double sum = 0.0;
+    for (size_t i : s.positions) {
+        const Position &p = positions_[i];
+        const double mark = s.mid() > 0 ? s.mid() : p.pos.price_current;
+        sum += sign(p.pos) * p.pos.volume * s.contract_size * mark;
+    }
+    return sum;
+}
+
+void Portfolio::rebuild() {
+    currencies_.clear();
+    magics_.clear();
+    unpriced_ = 0;
+    for (Symbol &s : symbols_) {
+        s.positions.clear();
+        s.pnl = 0.0;
+        s.notional = 0.0;
+        s.currency = nullptr;
+    }
+    for (size_t i = 0; i < positions_.size(); ++i) {
+        Position &p = positions_[i];
+        Symbol &s = symbols_[p.symbol];
+        s.positions.push_back(i);
+        Magic &magic = magics_[p.pos.magic];
+        ++magic.positions;
+        if (s.priced()) {
+            s.currency = &currencies_[s.profit];
+            p.currency = s.currency;
+            p.pnl = position_pnl(s, p);
+            if (s.pair()) {
+                const double units = sign(p.pos) * p.pos.volume * s.contract_size;
+                currencies_[s.base].exposure += units;
+                s.currency->exposure -= units * p.pos.price_open;
+            }
+        } else {
+            p.currency = &currencies_[currency_];
+            p.pnl = p.pos.profit;
+            ++unpriced_;
+        }
+        s.pnl += p.pnl;
+        p.currency->pnl += p.pnl;
+        p.magic_pnl = &magic.pnl[s.priced() ? s.profit : currency_];
+        *p.magic_pnl += p.pnl;
+    }
+    for (Symbol &s : symbols_) {
+        if (s.priced() && !s.pair() && !s.positions.empty()) {
+            s.notional = notional(s);
+            s.currency->exposure += s.notional;
+        }
+    }
+}
+
+void Portfolio::on_positions(const std::vector<mt5bridge_position> &positions) {
+    const std::string currency = config().portfolio_currency;
+    std::lock_guard<std::mutex> lock(mutex_);
+    currency_ = currency;
+    paths_valid_ = false;
+    positions_.clear();
+    positions_.reserve(positions.size());
+    opened_msc_ = 0;
+    for (const mt5bridge_position &pos : positions) {
+        Position p;
+        p.pos = pos;
+        p.symbol = symbol(pos.symbol);
+        positions_.push_back(p);
+        opened_msc_ = std::max(opened_msc_, pos.time_msc);
+    }
+    rebuild();
+    updated_ns_ = now_ns();
+}
+
+void Portfolio::on_symbol_info(const json_t *info) {
+    const char *name = json_string_value(json_object_get(info, "name"));
+    const char *profit = json_string_value(json_object_get(info, "currency_profit"));
+    const char *base = json_string_value(json_object_get(info, "currency_base"));
+    const double contract_size = json_number_value(json_object_get(info, "trade_contract_size"));
+    if (!name || !profit || !*profit || contract_size <= 0)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Symbol &s = symbols_[symbol(name)];
+    if (s.profit == profit && s.base == (base ? base : "") && s.contract_size == contract_size)
+        return;
+    s.profit = profit;
+    s.base = base ? base : "";
+    s.contract_size = contract_size;
+    paths_valid_ = false;
+    if (!s.positions.empty()) {
+        rebuild();
+        updated_ns_ = now_ns();
+    }
+}
+
+void Portfolio::on_tick(const char *symbol, const Tick &tick) {
+    if (tick.bid <= 0 || tick.ask <= 0)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_name_.find(symbol);
+    if (it == by_name_.end())
+        return;
+    Symbol &s = symbols_[it->second];
+    if (tick.time_msc < s.time_msc)
+        return;
+    mark(s, tick);
+}
+
+void Portfolio::mark(Symbol &s, const Tick &tick) {
+    if (s.pair() && s.mid() <= 0)
+        paths_valid_ = false; // A new edge of the currency graph.
+    s.bid = tick.bid;
+    s.ask = tick.ask;
+    s.time_msc = tick.time_msc;
+    ++ticks_;
+    if (s.positions.empty() || !s.priced())
+        return;
+    for (size_t i : s.positions) {
+        Position &p = positions_[i];
+        const double pnl = position_pnl(s, p);
+        const double delta = pnl - p.pnl;
+        p.pnl = pnl;
+        p.currency->pnl += delta;
+        *p.magic_pnl += delta;
+        s.pnl += delta;
+    }
+    if (!s.pair()) {
+        const double value = notional(s);
+        s.currency->exposure += value - s.notional;
+        s.notional = value;
+    }
+    updated_ns_ = now_ns();
+}
+
+void Portfolio::on_ticks(const char *symbol, const std::vector<Tick> &ticks) {
+    if (ticks.empty())
+        return;
+    const Tick &tick = ticks.back();
+    if (tick.bid <= 0 || tick.ask <= 0)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_name_.find(symbol);
+    if (it == by_name_.end())
+        return;
+    // A copied range may lie in the past; it marks nothing unless it is
+    // newer than the quote already marked and reaches past the newest
+    // position's opening.
+    Symbol &s = symbols_[it->second];
+    if (tick.time_msc <= s.time_msc || tick.time_msc < opened_msc_)
+        return;
+    mark(s, tick);
+}
+
+void Portfolio::resolve() {
+    if (paths_valid_)
+        return;
+    paths_.clear();
+    std::unordered_map<std::string, std::vector<size_t>> edges;
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        const Symbol &s = symbols_[i];
+        if (s.pair() && s.mid() > 0) {
+            edges[s.base].push_back(i);
+            edges[s.profit].push_back(i);
+        }
+    }
+    // Breadth-first from the account currency; a path is stored from its
+    // currency towards the account currency.
+    paths_[currency_];
+    std::deque<std::string> queue{currency_};
+    while (!queue.empty()) {
+        const std::string from = queue.front();
+        queue.pop_front();
+        for (size_t i : edges[from]) {
+            const Symbol &s = symbols_[i];
+            const bool to_base = s.profit == from;
+            const std::string &to = to_base ? s.base : s.profit;
+            if (paths_.count(to))
+                continue;
+            std::vector<Hop> path{{i, to_base}};
+            const std::vector<Hop> &rest = paths_[from];
+            path.insert(path.end(), rest.begin(), rest.end());
+            paths_.emplace(to, std::move(path));
+            queue.push_back(to);
+        }
+    }
+    paths_valid_ = true;
+}
+
+double Portfolio::rate(const std::string &currency) {
+    resolve();
+    auto it = paths_.find(currency);
+    if (it == paths_.end())
+        return std::numeric_limits<double>::quiet_NaN();
+    double r = 1.0;
+    for (const Hop &hop : it->second) {
+        const double mid = symbols_[hop.symbol].mid();
+        r = hop.base ? r * mid : r / mid;
+    }
+    return r;
+}
+
+std::vector<std::string> Portfolio::unconverted() {
+    std::vector<std::string> out;
+    for (const auto &entry : currencies_) {
+        const bool used = entry.second.pnl != 0.0 || entry.second.exposure != 0.0;
+        if (used && !std::isfinite(rate(entry.first)))
+            out.push_back(entry.first);
+    }
+    return out;
+}
+
+int64_t Portfolio::sync(Backend &backend, std::string &error) {
+    std::vector<mt5bridge_position> positions;
+    if (!backend.positions_get(positions, error))
+        return -1;
+    on_positions(positions);
+
+    // Backend answers come back through the tick hooks, so the lock is
+    // not held while asking.
+    auto fetch = [&](const std::string &name, bool spec) {
+        std::string err;
+        if (spec) {
+            json_t *req = json_pack("{s:s, s:s}", "method", "symbol_info", "symbol", name.c_str());
+            json_t *info = backend.eval("symbol_info", req, err);
+            json_decref(req);
+            const bool found = json_is_object(info);
+            if (found)
+                on_symbol_info(info);
+            json_decref(info);
+            if (!found)
+                return false;
+        }
+        Tick tick{};
+        if (backend.symbol_info_tick(name.c_str(), tick, err))
+            on_tick(name.c_str(), tick);
+        return true;
+    };
+
+    std::vector<std::string> specs, quotes;
+    std::set<std::string> suffixes{""};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const Symbol &s : symbols_) {
+            if (s.positions.empty())
+                continue;
+            if (!s.priced())
+                specs.push_back(s.name);
+            else if (s.mid() <= 0)
+                quotes.push_back(s.name);
+        }
+    }
+    for (const std::string &name : specs)
+        fetch(name, true);
+    for (const std::string &name : quotes)
+        fetch(name, false);
+
+    std::deque<std::string> missing;
+    std::string currency;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        currency = currency_;
+        for (const Symbol &s : symbols_) {
+            if (!s.positions.empty() && s.pair() && s.name.compare(0, 6, s.base + s.profit) == 0)
+                suffixes.insert(s.name.substr(6));
+        }
+        for (const std::string &c : unconverted())
+            missing.push_back(c);
+    }
+    std::set<std::string> tried;
+    while (!missing.empty()) {
+        const std::string ccy = missing.front();
+        missing.pop_front();
+        if (!tried.insert(ccy).second)
+            continue;
+        bool found = false;
+        for (const std::string &via : {currency, std::string(kVehicle)}) {
+            if (via == ccy)
+                continue;
+            for (const std::string &suffix : suffixes) {
+                for (const std::string &name : {ccy + via + suffix, via + ccy + suffix}) {
+                    bool known = false, quoted = false;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        auto it = by_name_.find(name);
+                        if (it != by_name_.end()) {
+                            known = symbols_[it->second].priced();
+                            quoted = symbols_[it->second].mid() > 0;
+                        }
+                    }
+                    if (known && quoted)
+                        continue;
+                    if (fetch(name, !known)) {
+                        found = true;
+                        break;
+                    }
+                }
+                if (found)
+                    break;
+            }
+            if (found) {
+                if (via != currency)
+                    missing.push_back(via);
+                break;
+            }
+        }
+    }
+    return static_cast<int64_t>(positions.size());
+}
+
+PortfolioTotals Portfolio::totals() {
+    const std::string currency = config().portfolio_currency;
+    std::lock_guard<std::mutex> lock(mutex_);
+    set_currency(currency);
+    PortfolioTotals t;
+    for (const auto &entry : currencies_) {
+        const double r = rate(entry.first);
+        if (!std::isfinite(r)) {
+            if (entry.second.pnl != 0.0 || entry.second.exposure != 0.0)
+                ++t.unconverted;
+            continue;
+        }
+        t.pnl += entry.second.pnl * r;
+        if (entry.first != currency_)
+            t.exposure_gross += std::fabs(entry.second.exposure * r);
+    }
+    t.positions = static_cast<int64_t>(positions_.size());
+    t.unpriced = unpriced_;
+    t.ticks = ticks_;
+    t.updated_ns = updated_ns_;
+    return t;
+}
+
+json_t *Portfolio::to_json() {
+    const PortfolioTotals t = totals();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    json_t *currencies = json_array();
+    for (const auto &entry : currencies_) {
+        const double r = rate(entry.first);
+        json_array_append_new(
+            currencies, json_pack("{s:s, s:o, s:o, s:o}", "currency", entry.first.c_str(), "rate",
+                                  std::isfinite(r) ? json_real(r) : json_null(), "pnl",
+                                  amount(entry.second.pnl, r), "exposure",
+                                  amount(entry.second.exposure, r)));
+    }
+
+    json_t *symbols = json_array();
+    for (const Symbol &s : symbols_) {
+        if (s.positions.empty())
+            continue;
+        double volume = 0.0;
+        for (size_t i : s.positions)
+            volume += sign(positions_[i].pos) * positions_[i].pos.volume;
+        const std::string &ccy = s.priced() ? s.profit : currency_;
+        const double r = rate(ccy);
+        json_array_append_new(
+            symbols,
+            json_pack("{s:s, s:s, s:I, s:f, s:o, s:f, s:f, s:f}", "symbol", s.name.c_str(),
+                      "currency", ccy.c_str(), "positions",
+                      static_cast<json_int_t>(s.positions.size()), "volume", volume, "pnl",
+                      amount(s.pnl, r), "pnl_profit", s.pnl, "bid", s.bid, "ask", s.ask));
+    }
+
+    json_t *magics = json_array();
+    for (const auto &entry : magics_) {
+        double pnl = 0.0;
+        for (const auto &part : entry.second.pnl)
+            pnl += part.second * rate(part.first);
+        json_array_append_new(
+            magics, json_pack("{s:I, s:I, s:o}", "magic", static_cast<json_int_t>(entry.first),
+                              "positions", static_cast<json_int_t>(entry.second.positions), "pnl",
+                              std::isfinite(pnl) ? json_real(pnl) : json_null()));
+    }
+
+    json_t *missing = json_array();
+    for (const std::string &c : unconverted())
+        json_array_append_new(missing, json_string(c.c_str()));
+
+    return json_pack("{s:s, s:f, s:f, s:I, s:I, s:I, s:I, s:o, s:o, s:o, s:o}", "currency",
+                     currency_.c_str(), "pnl", t.pnl, "exposure_gross", t.exposure_gross,
+                     "positions", static_cast<json_int_t>(t.positions), "unpriced",
+                     static_cast<json_int_t>(t.unpriced), "ticks", static_cast<json_int_t>(t.ticks),
+                     "updated_ns", static_cast<json_int_t>(t.updated_ns), "currencies", currencies,
+                     "symbols", symbols, "magics", magics, "unconverted", missing);
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,177 @@
+/*
+ * portfolio.hpp
+ *
+ * Open positions marked to market on every quote the bridge observes,
+ * with PnL and currency exposure in the account currency.
+ *
+ * The position set comes from positions_get answers passing through the
+ * bridge (mt5bridge_eval or the typed call) or from sync(), which also
+ * fetches what pricing needs. Each set replaces the previous one. A
+ * symbol is priced once its symbol_info (currency_base, currency_profit,
+ * trade_contract_size) has been seen; until then its positions count
+ * with the profit the terminal reported, taken as account currency, and
+ * are counted as unpriced.
+ *
+ * Live ticks reach the engine next to the market cache (responses.cpp).
+ * A tick of a symbol with positions re-marks those positions only, buys
+ * at the bid and sells at the ask, and adds the PnL changes to the
+ * symbol, magic and currency sums; everything else stays as it was.
+ * Sums are kept in the currency they arise in and converted when read,
+ * so a quote that moves a conversion rate costs nothing on the tick
+ * path.
+ *
+ * Conversion walks a currency graph whose edges are the priced symbols
+ * with a base currency different from their profit currency, at the mid
+ * of their latest quote. The shortest path from each currency to
+ * portfolio.currency is resolved once and reused until a symbol spec,
+ * a first quote of an edge or the account currency changes. Amounts in
+ * a currency with no path are reported as unconverted and left out of
+ * the totals.
+ *
+ * Exposure per currency: a position in a currency pair is long its base
+ * currency by volume * contract size and short that amount times the
+ * open price in the profit currency; a position in any other symbol
+ * (base currency equal to the profit currency, as for CFDs) is its
+ * notional at the current mark in the profit currency.
+ *
+ * Backtest answers and positions served by a thread-bound backend do not
+ * reach the engine.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+/* Portfolio totals in the account currency. */
+struct PortfolioTotals {
+    double pnl = 0.0;
+    double exposure_gross = 0.0;    // Sum of |exposure| outside the account currency.
+    int64_t positions = 0;
+    int64_t unpriced = 0;           // Positions without a symbol spec.
+    int64_t unconverted = 0;        // Currencies with no path to the account currency.
+    int64_t ticks = 0;              // Quotes applied since start.
+    int64_t updated_ns = 0;         // Last re-mark or position set (bridge clock).
+};
+
+class Portfolio {
+public:
+    static Portfolio &instance();
+
+    /* Replaces the position set. */
+    void on_positions(const std::vector<mt5bridge_position> &positions);
+
+    /* Records a symbol_info answer (an object with name, currency_base,
+     * currency_profit and trade_contract_size).
+     */
+    void on_symbol_info(const json_t *info);
+
+    /* Re-marks the positions of symbol; ticks without a bid and ask are
+     * ignored. on_ticks applies the newest tick of a copied range only if
+     * it is newer than the symbol's last marked quote and not older than
+     * the newest position's open time.
+     */
+    void on_tick(const char *symbol, const Tick &tick);
+    void on_ticks(const char *symbol, const std::vector<Tick> &ticks);
+
+    /* Loads the positions from backend, then the symbol specs and quotes
+     * of their symbols and of the currency pairs converting their
+     * currencies (tried as <ccy><account>, <account><ccy> and through
+     * USD, with each position symbol's suffix). Returns the positions,
+     * -1 with error if positions_get fails.
+     */
+    int64_t sync(Backend &backend, std::string &error);
+
+    PortfolioTotals totals();
+
+    /* Returns {"currency", "pnl", "exposure_gross", "positions",
+     * "unpriced", "ticks", "updated_ns", "currencies": [{"currency",
+     * "rate", "pnl", "exposure"}], "symbols": [{"symbol", "currency",
+     * "positions", "volume", "pnl", "pnl_profit", "bid", "ask"}],
+     * "magics": [{"magic", "positions", "pnl"}], "unconverted": [...]}.
+     * Account currency amounts are null where no rate resolves.
+     */
+    json_t *to_json();
+
+private:
+    /* Sums in one currency. */
+    struct Currency {
+        double pnl = 0.0;
+        double exposure = 0.0;
+    };
+
+    struct Magic {
+        int64_t positions = 0;
+        std::map<std::string, double> pnl;  // By currency.
+    };
+
+    struct Symbol {
+        std::string name;
+        std::string base, profit;       // Empty until symbol_info is seen.
+        double contract_size = 0.0;     // 0 until symbol_info is seen.
+        double bid = 0.0, ask = 0.0;
+        int64_t time_msc = 0;
+        std::vector<size_t> positions;  // Indexes into positions_.
+        double pnl = 0.0;               // Profit currency.
+        double notional = 0.0;          // Signed, profit currency; non-pair symbols.
+        Currency *currency = nullptr;   // Sums its positions count in.
+
+        bool priced() const { return contract_size > 0 && !profit.empty(); }
+        bool pair() const { return priced() && !base.empty() && base != profit; }
+        double mid() const { return bid > 0 && ask > 0 ? (bid + ask) / 2 : 0.0; }
+    };
+
+    struct Position {
+        mt5bridge_position pos;
+        size_t symbol;
+        double pnl = 0.0;               // In *currency.
+        Currency *currency = nullptr;
+        double *magic_pnl = nullptr;
+    };
+
+    /* One edge of a conversion path. */
+    struct Hop {
+        size_t symbol;
+        bool base;                      // Leaves the symbol's base currency.
+    };
+
+    Portfolio() = default;
+
+    /* The rest run with mutex_ held. */
+    size_t symbol(const std::string &name);
+    void set_currency(const std::string &currency);
+    void rebuild();
+    void mark(Symbol &s, const Tick &tick);
+    double position_pnl(const Symbol &s, const Position &p) const;
+    double notional(const Symbol &s) const;
+    void resolve();
+    double rate(const std::string &currency);
+    std::vector<std::string> unconverted();
+
+    std::mutex mutex_;
+    std::string currency_;
+    std::vector<Symbol> symbols_;
+    std::unordered_map<std::string, size_t> by_name_;
+    std::vector<Position> positions_;
+    std::map<std::string, Currency> currencies_;
+    std::map<uint64_t, Magic> magics_;
+    std::unordered_map<std::string, std::vector<Hop>> paths_;
+    bool paths_valid_ = false;
+    int64_t unpriced_ = 0;
+    int64_t ticks_ = 0;
+    int64_t updated_ns_ = 0;
+    int64_t opened_msc_ = 0;            // Newest position open time.
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,475 @@
+/*
+ * py_convert.cpp
+ *
+ * numpy record decoding and generic Python -> JSON conversion.
+ */
+
+#include "py_convert.hpp"
+#include "record_fields.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+const RecordField kDealFields[] = {
+    {"ticket", offsetof(Deal, ticket), 'u', false},
+    {"order", offsetof(Deal, order), 'u', false},
+    {"time_msc", offsetof(Deal, time_msc), 'l', false},
+    {"type", offsetof(Deal, type), 'i', false},
+    {"entry", offsetof(Deal, entry), 'i', false},
+    {"reason", offsetof(Deal, reason), 'i', false},
+    {"magic", offsetof(Deal, magic), 'u', false},
+    {"position_id", offsetof(Deal, position_id), 'u', false},
+    {"volume", offsetof(Deal, volume), 'd', false},
+    {"price", offsetof(Deal, price), 'd', false},
+    {"commission", offsetof(Deal, commission), 'd', false},
+    {"swap", offsetof(Deal, swap), 'd', false},
+    {"profit", offsetof(Deal, profit), 'd', false},
+    {"fee", offsetof(Deal, fee), 'd', false},
+};
+
+const RecordField kPositionFields[] = {
+    {"ticket", offsetof(mt5bridge_position, ticket), 'u', false},
+    {"type", offsetof(mt5bridge_position, type), 'i', false},
+    {"volume", offsetof(mt5bridge_position, volume), 'd', false},
+    {"price_open", offsetof(mt5bridge_position, price_open), 'd', false},
+    {"price_current", offsetof(mt5bridge_position, price_current), 'd', false},
+    {"sl", offsetof(mt5bridge_position, sl), 'd', false},
+    {"tp", offsetof(mt5bridge_position, tp), 'd', false},
+    {"profit", offsetof(mt5bridge_position, profit), 'd', false},
+    {"time_msc", offsetof(mt5bridge_position, time_msc), 'l', false},
+    {"magic", offsetof(mt5bridge_position, magic), 'u', false},
+};
+
+const RecordField kTradeResultFields[] = {
+    {"retcode", offsetof(mt5bridge_trade_result, retcode), 'w', false},
+    {"deal", offsetof(mt5bridge_trade_result, deal), 'u', false},
+    {"order", offsetof(mt5bridge_trade_result, order), 'u', false},
+    {"volume", offsetof(mt5bridge_trade_result, volume), 'd', false},
+    {"price", offsetof(mt5bridge_trade_result, price), 'd', false},
+    {"bid", offsetof(mt5bridge_trade_result, bid), 'd', false},
+    {"ask", offsetof(mt5bridge_trade_result, ask), 'd', false},
+};
+
+/* Source location of one field inside a numpy record. */
+struct FieldMap {
+    size_t src_offset;
+    size_t src_size;
+    char kind;          // numpy dtype kind: 'i', 'u' or 'f'.
+    size_t dst_offset;
+    char dst;           // RecordField::type.
+};
+
+template <class T> T load(const unsigned char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+bool read_number(const unsigned char *p, char kind, size_t size, double &f,
+                 int64_t &i) {
+    switch (kind) {
+    case 'f':
+        if (size == 8)
+            f = load<double>(p);
+        else if (size == 4)
+            f = load<float>(p);
+        else
+            return false;
+        i = static_cast<int64_t>(f);
+        return true;
+    case 'i':
+        if (size == 8)
+            i = load<int64_t>(p);
+        else if (size == 4)
+            i = load<int32_t>(p);
+        else
+            return false;
+        f = static_cast<double>(i);
+        return true;
+    case 'u':
+        if (size == 8)
+            i = static_cast<int64_t>(load<uint64_t>(p));
+        else if (size == 4)
+            i = load<uint32_t>(p);
+        else
+            return false;
+        f = static_cast<double>(i);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void store(unsigned char *dst, char type, double f, int64_t i) {
+    switch (type) {
+    case 'l': { int64_t v = i; std::memcpy(dst, &v, sizeof v); break; }
+    case 'u': { uint64_t v = static_cast<uint64_t>(i); std::memcpy(dst, &v, sizeof v); break; }
+    case 'i': { int32_t v = static_cast<int32_t>(i); std::memcpy(dst, &v, sizeof v); break; }
+    case 'w': { uint32_t v = static_cast<uint32_t>(i); std::memcpy(dst, &v, sizeof v); break; }
+    case 'd': std::memcpy(dst, &f, sizeof f); break;
+    }
+}
+
+/* Resolves the numpy layout of the requested fields. */
+bool map_fields(PyObject *array, const RecordField *specs, size_t nspecs,
+                std::vector<FieldMap> &out, size_t &itemsize, std::string &error) {
+    PyObject *dtype = PyObject_GetAttrString(array, "dtype");
+    PyObject *fields = dtype ? PyObject_GetAttrString(dtype, "fields") : nullptr;
+    PyObject *size_obj = dtype ? PyObject_GetAttrString(dtype, "itemsize") : nullptr;
+    bool ok = fields && PyDict_Check(fields) && size_obj;
+    if (!ok) {
+        PyErr_Clear();
+        error = "result is not a structured array";
+    } else {
+        itemsize = PyLong_AsSize_t(size_obj);
+    }
+
+    for (size_t k = 0; ok && k < nspecs; ++k) {
+        if (specs[k].bridge)
+            continue;
+        PyObject *entry = PyDict_GetItemString(fields, specs[k].name); // borrowed
+        PyObject *fdtype = entry && PyTuple_Check(entry) && PyTuple_Size(entry) >= 2
+                               ? PyTuple_GetItem(entry, 0)
+                               : nullptr;
+        if (!fdtype) {
+            error = std::string("missing field ") + specs[k].name;
+            ok = false;
+            break;
+        }
+        PyObject *kind = PyObject_GetAttrString(fdtype, "kind");
+        PyObject *fsize = PyObject_GetAttrString(fdtype, "itemsize");
+        const char *kind_str = kind ? PyUnicode_AsUTF8(kind) : nullptr;
+        FieldMap m;
+        m.src_offset = PyLong_AsSize_t(PyTuple_GetItem(entry, 1));
+        m.src_size = fsize ? PyLong_AsSize_t(fsize) : 0;
+        m.kind = kind_str ? kind_str[0] : '\0';
+        m.dst_offset = specs[k].offset;
+        m.dst = specs[k].type;
+        Py_XDECREF(kind);
+        Py_XDECREF(fsize);
+        if (PyErr_Occurred() || m.src_offset + m.src_size > itemsize) {
+            PyErr_Clear();
+            error = std::string("unsupported layout of field ") + specs[k].name;
+            ok = false;
+            break;
+        }
+        out.push_back(m);
+    }
+
+    Py_XDECREF(size_obj);
+    Py_XDECREF(fields);
+    Py_XDECREF(dtype);
+    return ok;
+}
+
+template <class Record>
+bool decode_records(PyObject *array, const RecordField *specs, size_t nspecs,
+                    int64_t recv_ns, std::vector<Record> &out, std::string &error) {
+    std::vector<FieldMap> fields;
+    size_t itemsize = 0;
+    if (!map_fields(array, specs, nspecs, fields, itemsize, error))
+        return false;
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(array, &view, PyBUF_C_CONTIGUOUS) != 0) {
+        PyErr_Clear();
+        error = "result does not expose a contiguous buffer";
+        return false;
+    }
+
+    const size_t n = itemsize ? static_cast<size_t>(view.len) / itemsize : 0;
+    const unsigned char *src = static_cast<const unsigned char *>(view.buf);
+    const size_t base = out.size();
+    out.resize(base + n);
+
+    bool ok = true;
+    for (size_t r = 0; r < n && ok; ++r) {
+        const unsigned char *rec = src + r * itemsize;
+        unsigned char *dst = reinterpret_cast<unsigned char *>(&out[base + r]);
+        for (const FieldMap &m : fields) {
+            double f = 0;
+            int64_t i = 0;
+            if (!read_number(rec + m.src_offset, m.kind, m.src_size, f, i)) {
+                error = "unsupported numeric field type";
+                ok = false;
+                break;
+            }
+            store(dst + m.dst_offset, m.dst, f, i);
+        }
+        out[base + r].recv_ns = recv_ns;
+    }
+
+    PyBuffer_Release(&view);
+    if (!ok)
+        out.resize(base);
+    return ok;
+}
+
+bool get_attr_number(PyObject *obj, const char *name, double &f, int64_t &i) {
+    PyObject *v = PyObject_GetAttrString(obj, name);
+    if (!v)
+        return false;
+    if (PyFloat_Check(v)) {
+        f = PyFloat_AsDouble(v);
+        i = static_cast<int64_t>(f);
+    } else {
+        i = PyLong_AsLongLong(v);
+        f = static_cast<double>(i);
+    }
+    Py_DECREF(v);
+    return !PyErr_Occurred();
+}
+
+bool get_attr_string(PyObject *obj, const char *name, char *dst, size_t size) {
+    PyObject *v = PyObject_GetAttrString(obj, name);
+    const char *str = v ? PyUnicode_AsUTF8(v) : nullptr;
+    if (str)
+        std::snprintf(dst, size, "%s", str);
+    Py_XDECREF(v);
+    return str != nullptr;
+}
+
+/* Reads the numeric attributes named by specs from a named tuple into
+ * the record at dst; what names the record in the error.
+ */
+template <size_t N>
+bool read_attrs(PyObject *obj, const RecordField (&specs)[N], void *dst, const char *what,
+                std::string &error) {
+    unsigned char *base = static_cast<unsigned char *>(dst);
+    for (const RecordField &spec : specs) {
+        if (spec.bridge)
+            continue;
+        double f = 0;
+        int64_t i = 0;
+        if (!get_attr_number(obj, spec.name, f, i)) {
+            PyErr_Clear();
+            error = std::string(what) + " has no numeric field " + spec.name;
+            return false;
+        }
+        store(base + spec.offset, spec.type, f, i);
+    }
+    return true;
+}
+
+} // namespace
+
+bool decode_rates(PyObject *array, int64_t recv_ns, std::vector<Bar> &out,
+                  std::string &error) {
+    return decode_records(array, kBarFields, sizeof(kBarFields) / sizeof(kBarFields[0]),
+                          recv_ns, out, error);
+}
+
+bool decode_ticks(PyObject *array, int64_t recv_ns, std::vector<Tick> &out,
+                  std::string &error) {
+    return decode_records(array, kTickFields, sizeof(kTickFields) / sizeof(kTickFields[0]),
+                          recv_ns, out, error);
+}
+
+bool decode_tick(PyObject *tick, int64_t recv_ns, Tick &out, std::string &error) {
+    Tick t{};
+    if (!read_attrs(tick, kTickFields, &t, "tick", error))
+        return false;
+    t.recv_ns = recv_ns;
+    out = t;
+    return true;
+}
+
+bool decode_deals(PyObject *deals, std::vector<Deal> &out, std::string &error) {
+    PyObject *seq = PySequence_Fast(deals, "not a sequence");
+    if (!seq) {
+        PyErr_Clear();
+        error = "history_deals_get result is not a sequence";
+        return false;
+    }
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    out.reserve(out.size() + static_cast<size_t>(n));
+    bool ok = true;
+    for (Py_ssize_t r = 0; r < n && ok; ++r) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, r); // borrowed
+        Deal d{};
+        ok = read_attrs(item, kDealFields, &d, "deal", error);
+        if (ok && (!get_attr_string(item, "symbol", d.symbol, sizeof d.symbol) ||
+                   !get_attr_string(item, "comment", d.comment, sizeof d.comment))) {
+            PyErr_Clear();
+            error = "deal has no symbol or comment";
+            ok = false;
+        }
+        if (ok)
+            out.push_back(d);
+    }
+    Py_DECREF(seq);
+    return ok;
+}
+
+bool decode_positions(PyObject *positions, std::vector<mt5bridge_position> &out,
+                      std::string &error) {
+    PyObject *seq = PySequence_Fast(positions, "not a sequence");
+    if (!seq) {
+        PyErr_Clear();
+        error = "positions_get result is not a sequence";
+        return false;
+    }
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    out.reserve(out.size() + static_cast<size_t>(n));
+    bool ok = true;
+    for (Py_ssize_t r = 0; r < n && ok; ++r) {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, r); // borrowed
+        mt5bridge_position p{};
+        ok = read_attrs(item, kPositionFields, &p, "position", error);
+        if (ok && !get_attr_string(item, "symbol", p.symbol, sizeof p.symbol)) {
+            PyErr_Clear();
+            error = "position has no symbol";
+            ok = false;
+        }
+        if (ok)
+            out.push_back(p);
+    }
+    Py_DECREF(seq);
+    return ok;
+}
+
+bool decode_trade_result(PyObject *result, int64_t recv_ns, mt5bridge_trade_result &out,
+                         std::string &error) {
+    mt5bridge_trade_result r{};
+    if (!read_attrs(result, kTradeResultFields, &r, "order_send result", error))
+        return false;
+    if (!get_attr_string(result, "comment", r.comment, sizeof r.comment))
+        PyErr_Clear(); // The comment is informational.
+    r.recv_ns = recv_ns;
+    out = r;
+    return true;
+}
+
+json_t *py_to_json(PyObject *obj) {
+    if (obj == Py_None)
+        return json_null();
+    if (PyBool_Check(obj))
+        return json_boolean(obj == Py_True);
+    if (PyLong_Check(obj)) {
+        int overflow = 0;
+        long long v = PyLong_AsLongLongAndOverflow(obj, &overflow);
+        if (overflow)
+            return json_real(PyLong_AsDouble(obj));
+        return json_integer(v);
+    }
+    if (PyFloat_Check(obj))
+        return json_real(PyFloat_AsDouble(obj));
+    if (PyUnicode_Check(obj)) {
+        Py_ssize_t len = 0;
+        const char *s = PyUnicode_AsUTF8AndSize(obj, &len);
+        return s ? json_stringn(s, static_cast<size_t>(len)) : nullptr;
+    }
+    if (PyDict_Check(obj)) {
+        json_t *out = json_object();
+        PyObject *key, *value;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(obj, &pos, &key, &value)) {
+            PyObject *key_str = PyObject_Str(key);
+            json_t *v = key_str ? py_to_json(value) : nullptr;
+            const char *k = key_str ? PyUnicode_AsUTF8(key_str) : nullptr;
+            if (!v || !k) {
+                json_decref(v);
+                Py_XDECREF(key_str);
+                json_decref(out);
+                return nullptr;
+            }
+            json_object_set_new(out, k, v);
+            Py_DECREF(key_str);
+        }
+        return out;
+    }
+
+    // Named tuples (TradeRequest, OrderSendResult, Tick, ...) keep their
+    // field names; numpy scalars and arrays go through their Python value.
+    const char *adapters[] = {"_asdict", "tolist"};
+    for (const char *name : adapters) {
+        if (PyTuple_Check(obj) && std::strcmp(name, "_asdict") != 0)
+            continue;
+        if (!PyObject_HasAttrString(obj, name))
+            continue;
+        PyObject *plain = PyObject_CallMethod(obj, name, nullptr);
+        if (!plain)
+            return nullptr;
+        json_t *out = plain == obj ? nullptr : py_to_json(plain);
+        Py_DECREF(plain);
+        if (out)
+            return out;
+        if (PyErr_Occurred())
+            return nullptr;
+    }
+
+    if (PyList_Check(obj) || PyTuple_Check(obj)) {
+        PyObject *seq = PySequence_Fast(obj, "expected a sequence");
+        if (!seq)
+            return nullptr;
+        json_t *out = json_array();
+        Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            json_t *v = py_to_json(PySequence_Fast_GET_ITEM(seq, i));
+            if (!v) {
+                json_decref(out);
+                Py_DECREF(seq);
+                return nullptr;
+            }
+            json_array_append_new(out, v);
+        }
+        Py_DECREF(seq);
+        return out;
+    }
+
+    PyErr_Format(PyExc_TypeError, "cannot convert %s to JSON", Py_TYPE(obj)->tp_name);
+    return nullptr;
+}
+
+PyObject *json_to_py(const json_t *value) {
+    switch (json_typeof(value)) {
+    case JSON_NULL:
+        Py_RETURN_NONE;
+    case JSON_TRUE:
+        Py_RETURN_TRUE;
+    case JSON_FALSE:
+        Py_RETURN_FALSE;
+    case JSON_INTEGER:
+        return PyLong_FromLongLong(json_integer_value(value));
+    case JSON_REAL:
+        return PyFloat_FromDouble(json_real_value(value));
+    case JSON_STRING:
+        return PyUnicode_FromStringAndSize(json_string_value(value),
+                                           static_cast<Py_ssize_t>(json_string_length(value)));
+    case JSON_ARRAY: {
+        PyObject *out = PyList_New(static_cast<Py_ssize_t>(json_array_size(value)));
+        for (size_t i = 0; out && i < json_array_size(value); ++i) {
+            PyObject *item = json_to_py(json_array_get(value, i));
+            if (!item) {
+                Py_DECREF(out);
+                return nullptr;
+            }
+            PyList_SET_ITEM(out, static_cast<Py_ssize_t>(i), item);
+        }
+        return out;
+    }
+    case JSON_OBJECT: {
+        PyObject *out = PyDict_New();
+        const char *key;
+        json_t *member;
+        json_object_foreach(const_cast<json_t *>(value), key, member) {
+            PyObject *item = json_to_py(member);
+            if (!item || PyDict_SetItemString(out, key, item) < 0) {
+                Py_XDECREF(item);
+                Py_DECREF(out);
+                return nullptr;
+            }
+            Py_DECREF(item);
+        }
+        return out;
+    }
+    }
+    PyErr_SetString(PyExc_TypeError, "unsupported JSON value");
+    return nullptr;
+}
+
+} // namespace mt5bridge
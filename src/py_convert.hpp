@@ -0,0 +1,60 @@
+/*
+ * py_convert.hpp
+ *
+ * Conversion of MetaTrader5 Python results into native records and JSON
+ * without a json.dumps round trip.
+ *
+ * Rate and tick arrays returned by copy_rates_* / copy_ticks_* are numpy
+ * structured arrays; they are read through the buffer protocol using the
+ * field offsets reported by their dtype. All functions require the GIL.
+ */
+
+#pragma once
+
+#include <Python.h>
+#include <jansson.h>
+
+#include "mt5bridge/mt5bridge.hpp"
+#include "market_data.hpp"
+
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+/* Appends the records of a copy_rates_* result to out, stamping recv_ns. */
+bool decode_rates(PyObject *array, int64_t recv_ns, std::vector<Bar> &out,
+                  std::string &error);
+
+/* Appends the records of a copy_ticks_* result to out, stamping recv_ns. */
+bool decode_ticks(PyObject *array, int64_t recv_ns, std::vector<Tick> &out,
+                  std::string &error);
+
+/* Decodes the Tick named tuple returned by symbol_info_tick. */
+bool decode_tick(PyObject *tick, int64_t recv_ns, Tick &out, std::string &error);
+
+/* Appends the TradeDeal named tuples of a history_deals_get result. */
+bool decode_deals(PyObject *deals, std::vector<Deal> &out, std::string &error);
+
+/* Appends the TradePosition named tuples of a positions_get result. */
+bool decode_positions(PyObject *positions, std::vector<mt5bridge_position> &out,
+                      std::string &error);
+
+/* Decodes the OrderSendResult named tuple returned by order_send,
+ * stamping recv_ns.
+ */
+bool decode_trade_result(PyObject *result, int64_t recv_ns, mt5bridge_trade_result &out,
+                         std::string &error);
+
+/* Converts None/bool/int/float/str, dicts, sequences, named tuples and
+ * numpy scalars/arrays into JSON. Returns nullptr with a Python error set
+ * on failure.
+ */
+json_t *py_to_json(PyObject *obj);
+
+/* Converts JSON into the equivalent Python objects (objects become dicts,
+ * arrays lists). Returns a new reference, or nullptr with a Python error.
+ */
+PyObject *json_to_py(const json_t *value);
+
+} // namespace mt5bridge
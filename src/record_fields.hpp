@@ -0,0 +1,72 @@
+/*
+ * record_fields.hpp
+ *
+ * The members of Bar and Tick by name, offset and type: one table per
+ * record type, used by the numpy decoder (py_convert.hpp), the "fields"
+ * and "decimate" options of bar and tick answers (responses.hpp) and
+ * the asof matrices.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mt5bridge {
+
+struct RecordField {
+    const char *name;
+    size_t offset;
+    char type;      // 'l' int64_t, 'd' double, 'u' uint64_t, 'i' int32_t, 'w' uint32_t,
+                    // 'q' sequence number, 'g' gap flag, 'n' integrity flags (all
+                    // three only on sequenced ticks).
+    bool bridge;    // Added by the bridge; not in the terminal's records.
+};
+
+inline constexpr RecordField kBarFields[] = {
+    {"time", offsetof(Bar, time), 'l', false},
+    {"open", offsetof(Bar, open), 'd', false},
+    {"high", offsetof(Bar, high), 'd', false},
+    {"low", offsetof(Bar, low), 'd', false},
+    {"close", offsetof(Bar, close), 'd', false},
+    {"tick_volume", offsetof(Bar, tick_volume), 'u', false},
+    {"spread", offsetof(Bar, spread), 'i', false},
+    {"real_volume", offsetof(Bar, real_volume), 'u', false},
+    {"recv_ns", offsetof(Bar, recv_ns), 'l', true},
+};
+
+inline constexpr RecordField kTickFields[] = {
+    {"time_msc", offsetof(Tick, time_msc), 'l', false},
+    {"bid", offsetof(Tick, bid), 'd', false},
+    {"ask", offsetof(Tick, ask), 'd', false},
+    {"last", offsetof(Tick, last), 'd', false},
+    {"volume", offsetof(Tick, volume), 'u', false},
+    {"flags", offsetof(Tick, flags), 'w', false},
+    {"volume_real", offsetof(Tick, volume_real), 'd', false},
+    {"recv_ns", offsetof(Tick, recv_ns), 'l', true},
+    {"seq", offsetof(Tick, seq), 'q', true},
+    {"gap", offsetof(Tick, integrity), 'g', true},
+    {"integrity", offsetof(Tick, integrity), 'n', true},
+};
+
+/* The member of type T at offset bytes into record. */
+template <typename T> T field_load(const void *record, size_t offset) {
+    T v;
+    std::memcpy(&v, static_cast<const unsigned char *>(record) + offset, sizeof v);
+    return v;
+}
+
+/* The field called name, nullptr if there is none. */
+template <size_t N>
+const RecordField *find_field(const RecordField (&table)[N], const char *name) {
+    for (const RecordField &f : table) {
+        if (name && std::strcmp(name, f.name) == 0)
+            return &f;
+    }
+    return nullptr;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,80 @@
+/*
+ * replay_backend.cpp
+ *
+ * Journal-backed request matching and latency emulation.
+ */
+
+#include "replay_backend.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+std::string canonical(const json_t *request) {
+    char *s = json_dumps(request, JSON_COMPACT | JSON_SORT_KEYS);
+    std::string out = s ? s : "";
+    std::free(s);
+    return out;
+}
+
+} // namespace
+
+std::unique_ptr<ReplayBackend> ReplayBackend::open(const std::string &path, double speed,
+                                                   std::string &error) {
+    if (path.empty()) {
+        error = "backend=replay requires journal.replay";
+        return nullptr;
+    }
+    std::vector<JournalRecord> records;
+    if (!read_journal(path, records, error))
+        return nullptr;
+    return std::unique_ptr<ReplayBackend>(new ReplayBackend(std::move(records), speed));
+}
+
+ReplayBackend::ReplayBackend(std::vector<JournalRecord> records, double speed)
+    : records_(std::move(records)), speed_(speed) {
+    for (size_t i = 0; i < records_.size(); ++i) {
+        // Re-canonicalize so journals written by other tools still match.
+        json_t *req = json_loads(records_[i].request.c_str(), 0, nullptr);
+        if (!req)
+            continue;
+        index_[canonical(req)].records.push_back(i);
+        json_decref(req);
+    }
+}
+
+json_t *ReplayBackend::eval(const char *method, const json_t *request, std::string &error) {
+    const JournalRecord *rec = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(canonical(request));
+        if (it == index_.end()) {
+            error = std::string("no recorded response for ") + method;
+            return nullptr;
+        }
+        Entry &e = it->second;
+        rec = &records_[e.records[e.next]];
+        if (e.next + 1 < e.records.size())
+            ++e.next;
+    }
+
+    if (speed_ > 0 && rec->t_response_ns > rec->t_request_ns) {
+        const auto delay = std::chrono::nanoseconds(static_cast<int64_t>(
+            static_cast<double>(rec->t_response_ns - rec->t_request_ns) / speed_));
+        std::this_thread::sleep_for(delay);
+    }
+
+    error = rec->error;
+    if (!rec->ok)
+        return nullptr;
+    json_error_t jerr;
+    json_t *out = json_loads(rec->response.c_str(), JSON_DECODE_ANY, &jerr);
+    if (!out)
+        error = std::string("corrupt recorded response: ") + jerr.text;
+    return out;
+}
+
+} // namespace mt5bridge
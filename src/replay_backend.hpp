@@ -0,0 +1,46 @@
+/*
+ * replay_backend.hpp
+ *
+ * Backend serving requests from a recorded journal.
+ *
+ * Requests are matched on their canonical JSON (compact, sorted keys).
+ * Repeated identical requests are answered with the recorded responses
+ * in recording order; once those run out the last one is repeated. With
+ * speed > 0 each answer is delayed by its recorded latency divided by
+ * speed (1 = as recorded, 10 = ten times faster); speed 0 answers at once.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "journal.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+class ReplayBackend : public Backend {
+public:
+    static std::unique_ptr<ReplayBackend> open(const std::string &path, double speed,
+                                               std::string &error);
+
+    const char *name() const override { return "replay"; }
+    json_t *eval(const char *method, const json_t *request, std::string &error) override;
+
+private:
+    struct Entry {
+        std::vector<size_t> records;   // Indices into records_, in order.
+        size_t next = 0;
+    };
+
+    ReplayBackend(std::vector<JournalRecord> records, double speed);
+
+    std::vector<JournalRecord> records_;
+    double speed_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> index_;
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,485 @@
+/*
+ * responses.cpp
+ *
+ * Shared post-processing and JSON building of market data answers.
+ */
+
+#include "responses.hpp"
+#include "arrow_ipc.hpp"
+#include "csv_io.hpp"
+#include "config.hpp"
+#include "history.hpp"
+#include "market_cache.hpp"
+#include "portfolio.hpp"
+#include "rolling_matrix.hpp"
+#include "server_time.hpp"
+#include "stream_indicators.hpp"
+#include "tick_integrity.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+/* Fills utc with the UTC nanosecond times of n records when the request
+ * asks for them with "utc": true; leaves it empty otherwise.
+ */
+bool convert_to_utc(const json_t *req, const void *first, size_t stride, size_t n,
+                    int64_t unit_ns, std::vector<int64_t> &utc, std::string &error) {
+    if (!json_is_true(json_object_get(req, "utc")) || n == 0)
+        return true;
+    utc.resize(n);
+    if (!ServerClock::instance().to_utc_ns(first, stride, n, unit_ns, utc.data())) {
+        error = "server time offset not known yet";
+        return false;
+    }
+    return true;
+}
+
+/* Writes records to the "arrow" path of the request and answers with a
+ * summary of the export.
+ */
+template <typename R>
+json_t *arrow_response(const char *path, const std::vector<R> &records,
+                       const std::vector<int64_t> &utc, const json_t *req, std::string &error) {
+    const bool stream = json_is_true(json_object_get(req, "arrow_stream"));
+    ArrowExport out;
+    if (!write_arrow(path, stream, records, utc, out, error))
+        return nullptr;
+    return json_pack("{s:s, s:s, s:I, s:I}", "path", path, "format", stream ? "stream" : "file",
+                     "rows", static_cast<json_int_t>(out.rows), "bytes",
+                     static_cast<json_int_t>(out.bytes));
+}
+
+/* Writes records to the "csv" path of the request. */
+template <typename R>
+json_t *csv_response(const char *path, const std::vector<R> &records,
+                     const std::vector<int64_t> &utc, std::string &error) {
+    CsvStats out;
+    if (!write_csv(path, records, utc, out, error))
+        return nullptr;
+    return json_pack("{s:s, s:s, s:I, s:I}", "path", path, "format", "csv", "rows",
+                     static_cast<json_int_t>(out.rows), "bytes", static_cast<json_int_t>(out.bytes));
+}
+
+int64_t member_int(const json_t *obj, const char *key) {
+    json_t *v = json_object_get(obj, key);
+    return json_is_integer(v) ? json_integer_value(v) : static_cast<int64_t>(json_number_value(v));
+}
+
+double member_real(const json_t *obj, const char *key) {
+    return json_number_value(json_object_get(obj, key));
+}
+
+/* Fields named by the request's "fields" array, in its order; empty
+ * when it asks for every field.
+ */
+template <size_t N>
+bool wanted_fields(const json_t *req, const RecordField (&table)[N],
+                   std::vector<const RecordField *> &out, std::string &error) {
+    const json_t *fields = json_object_get(req, "fields");
+    if (!fields)
+        return true;
+    if (!json_is_array(fields) || json_array_size(fields) == 0) {
+        error = "fields must be a non-empty array of field names";
+        return false;
+    }
+    size_t i;
+    json_t *name;
+    json_array_foreach(fields, i, name) {
+        const RecordField *f = find_field(table, json_string_value(name));
+        if (!f) {
+            const char *text = json_string_value(name);
+            error = std::string("unknown field ") + (text ? text : "(not a string)");
+            return false;
+        }
+        out.push_back(f);
+    }
+    return true;
+}
+
+/* Object with the wanted fields of one record. */
+json_t *project(const void *record, const std::vector<const RecordField *> &fields,
+                uint64_t seq) {
+    json_t *obj = json_object();
+    for (const RecordField *f : fields) {
+        if (json_t *v = field_to_json(record, *f, seq))
+            json_object_set_new(obj, f->name, v);
+    }
+    return obj;
+}
+
+json_t *record_json(const Bar &bar, const std::vector<const RecordField *> &fields) {
+    return fields.empty() ? bar_to_json(bar) : project(&bar, fields, 0);
+}
+
+json_t *record_json(const Tick &tick, const std::vector<const RecordField *> &fields) {
+    return fields.empty() ? tick_to_json(tick) : project(&tick, fields, tick.seq);
+}
+
+/* Folds bar b into the bar of its time bucket. */
+void bucket_merge(Bar &acc, const Bar &b) {
+    acc.high = std::max(acc.high, b.high);
+    acc.low = std::min(acc.low, b.low);
+    acc.close = b.close;
+    acc.tick_volume += b.tick_volume;
+    acc.spread = b.spread;
+    acc.real_volume += b.real_volume;
+    acc.recv_ns = b.recv_ns;
+}
+
+/* A tick bucket keeps its last tick. */
+void bucket_merge(Tick &acc, const Tick &t) { acc = t; }
+
+/* A bar bucket opens at its boundary; a tick keeps its time. */
+void bucket_open(Bar &bar, int64_t bucket, int64_t bucket_ms) {
+    bar.time = bucket * bucket_ms / 1000;
+}
+void bucket_open(Tick &, int64_t, int64_t) {}
+
+/* Time bucket of record time t (unit_ms per time unit). */
+int64_t bucket_of(int64_t t, int64_t unit_ms, int64_t bucket_ms) {
+    const int64_t ms = t * unit_ms;
+    return ms / bucket_ms - (ms % bucket_ms < 0 ? 1 : 0);
+}
+
+/* Thins records by the request's "decimate" rules, applied in this
+ * order: {"bucket_ms": one record per time bucket (a bar aggregating the
+ * bars of the bucket, the last tick), "min_change": only records whose
+ * "field" moved by at least this much from the last one kept,
+ * "every": every Nth record}.
+ */
+template <typename R, size_t N>
+bool decimate(const json_t *req, std::vector<R> &records, int64_t R::*time, int64_t unit_ms,
+              const RecordField (&table)[N], const char *default_field,
+              std::string &error) {
+    const json_t *rules = json_object_get(req, "decimate");
+    if (!rules)
+        return true;
+    if (!json_is_object(rules)) {
+        error = "decimate must be an object";
+        return false;
+    }
+    long long bucket_ms = 0, every = 0;
+    double min_change = 0.0;
+    const char *name = req_string(rules, "field");
+    const RecordField *field = find_field(table, name ? name : default_field);
+    if ((json_object_get(rules, "bucket_ms") && (!req_int(rules, "bucket_ms", bucket_ms) ||
+                                                  bucket_ms <= 0 || bucket_ms % unit_ms)) ||
+        (json_object_get(rules, "every") && (!req_int(rules, "every", every) || every <= 0)) ||
+        (json_object_get(rules, "min_change") &&
+         (!req_number(rules, "min_change", min_change) || !(min_change > 0)))) {
+        error = "decimate needs bucket_ms (a multiple of " + std::to_string(unit_ms) +
+                "), every and min_change above zero";
+        return false;
+    }
+    if (!field || field->type != 'd') {
+        error = std::string("decimate: ") + (name ? name : default_field) +
+                " is not a price field";
+        return false;
+    }
+
+    size_t kept = 0;
+    if (bucket_ms > 0) {
+        int64_t bucket = 0;
+        for (size_t i = 0; i < records.size(); ++i) {
+            const int64_t b = bucket_of(records[i].*time, unit_ms, bucket_ms);
+            if (kept && b == bucket) {
+                bucket_merge(records[kept - 1], records[i]);
+                continue;
+            }
+            bucket = b;
+            records[kept++] = records[i];
+            bucket_open(records[kept - 1], b, bucket_ms);
+        }
+        records.resize(kept);
+    }
+    if (min_change > 0) {
+        double last = 0.0;
+        kept = 0;
+        for (size_t i = 0; i < records.size(); ++i) {
+            const double v = field_load<double>(&records[i], field->offset);
+            if (kept && std::fabs(v - last) < min_change)
+                continue;
+            last = v;
+            records[kept++] = records[i];
+        }
+        records.resize(kept);
+    }
+    if (every > 1) {
+        kept = 0;
+        for (size_t i = 0; i < records.size(); i += static_cast<size_t>(every))
+            records[kept++] = records[i];
+        records.resize(kept);
+    }
+    return true;
+}
+
+} // namespace
+
+json_t *field_to_json(const void *record, const RecordField &field, uint64_t seq) {
+    switch (field.type) {
+    case 'l': return json_integer(field_load<int64_t>(record, field.offset));
+    case 'd': return json_real(field_load<double>(record, field.offset));
+    case 'u':
+        return json_integer(static_cast<json_int_t>(field_load<uint64_t>(record, field.offset)));
+    case 'i': return json_integer(field_load<int32_t>(record, field.offset));
+    case 'w': return json_integer(field_load<uint32_t>(record, field.offset));
+    case 'q': return seq ? json_integer(static_cast<json_int_t>(seq)) : nullptr;
+    case 'n': return seq ? json_integer(field_load<uint32_t>(record, field.offset)) : nullptr;
+    default: return seq ? json_boolean(field_load<uint32_t>(record, field.offset) != 0) : nullptr;
+    }
+}
+
+json_t *bar_to_json(const Bar &bar) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "time", json_integer(bar.time));
+    json_object_set_new(obj, "open", json_real(bar.open));
+    json_object_set_new(obj, "high", json_real(bar.high));
+    json_object_set_new(obj, "low", json_real(bar.low));
+    json_object_set_new(obj, "close", json_real(bar.close));
+    json_object_set_new(obj, "tick_volume", json_integer(static_cast<json_int_t>(bar.tick_volume)));
+    json_object_set_new(obj, "spread", json_integer(bar.spread));
+    json_object_set_new(obj, "real_volume", json_integer(static_cast<json_int_t>(bar.real_volume)));
+    json_object_set_new(obj, "recv_ns", json_integer(bar.recv_ns));
+    return obj;
+}
+
+json_t *tick_to_json(const Tick &tick) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "time_msc", json_integer(tick.time_msc));
+    json_object_set_new(obj, "bid", json_real(tick.bid));
+    json_object_set_new(obj, "ask", json_real(tick.ask));
+    json_object_set_new(obj, "last", json_real(tick.last));
+    json_object_set_new(obj, "volume", json_integer(static_cast<json_int_t>(tick.volume)));
+    json_object_set_new(obj, "flags", json_integer(tick.flags));
+    json_object_set_new(obj, "volume_real", json_real(tick.volume_real));
+    json_object_set_new(obj, "recv_ns", json_integer(tick.recv_ns));
+    if (tick.seq) {
+        json_object_set_new(obj, "seq", json_integer(static_cast<json_int_t>(tick.seq)));
+        json_object_set_new(obj, "gap", json_boolean(tick.integrity != 0));
+        json_object_set_new(obj, "integrity", json_integer(tick.integrity));
+    }
+    return obj;
+}
+
+json_t *deal_to_json(const Deal &deal) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "ticket", json_integer(static_cast<json_int_t>(deal.ticket)));
+    json_object_set_new(obj, "order", json_integer(static_cast<json_int_t>(deal.order)));
+    json_object_set_new(obj, "time", json_integer(deal.time_msc / 1000));
+    json_object_set_new(obj, "time_msc", json_integer(deal.time_msc));
+    json_object_set_new(obj, "type", json_integer(deal.type));
+    json_object_set_new(obj, "entry", json_integer(deal.entry));
+    json_object_set_new(obj, "reason", json_integer(deal.reason));
+    json_object_set_new(obj, "magic", json_integer(static_cast<json_int_t>(deal.magic)));
+    json_object_set_new(obj, "position_id", json_integer(static_cast<json_int_t>(deal.position_id)));
+    json_object_set_new(obj, "volume", json_real(deal.volume));
+    json_object_set_new(obj, "price", json_real(deal.price));
+    json_object_set_new(obj, "commission", json_real(deal.commission));
+    json_object_set_new(obj, "swap", json_real(deal.swap));
+    json_object_set_new(obj, "profit", json_real(deal.profit));
+    json_object_set_new(obj, "fee", json_real(deal.fee));
+    json_object_set_new(obj, "symbol", json_stringn(deal.symbol, strnlen(deal.symbol, sizeof deal.symbol)));
+    json_object_set_new(obj, "comment", json_stringn(deal.comment, strnlen(deal.comment, sizeof deal.comment)));
+    return obj;
+}
+
+bool json_to_bar(const json_t *value, Bar &out) {
+    if (!json_is_object(value))
+        return false;
+    out.time = member_int(value, "time");
+    out.open = member_real(value, "open");
+    out.high = member_real(value, "high");
+    out.low = member_real(value, "low");
+    out.close = member_real(value, "close");
+    out.tick_volume = static_cast<uint64_t>(member_int(value, "tick_volume"));
+    out.spread = static_cast<int32_t>(member_int(value, "spread"));
+    out.real_volume = static_cast<uint64_t>(member_int(value, "real_volume"));
+    out.recv_ns = member_int(value, "recv_ns");
+    return true;
+}
+
+bool json_to_tick(const json_t *value, Tick &out) {
+    if (!json_is_object(value))
+        return false;
+    out.time_msc = member_int(value, "time_msc");
+    out.bid = member_real(value, "bid");
+    out.ask = member_real(value, "ask");
+    out.last = member_real(value, "last");
+    out.volume = static_cast<uint64_t>(member_int(value, "volume"));
+    out.flags = static_cast<uint32_t>(member_int(value, "flags"));
+    out.volume_real = member_real(value, "volume_real");
+    out.recv_ns = member_int(value, "recv_ns");
+    out.seq = static_cast<uint64_t>(member_int(value, "seq"));
+    // Older answers carry only the gap flag.
+    const json_t *integrity = json_object_get(value, "integrity");
+    out.integrity = json_is_integer(integrity)
+                        ? static_cast<uint32_t>(json_integer_value(integrity))
+                        : json_is_true(json_object_get(value, "gap")) ? uint32_t{kTickGapWindow}
+                                                                      : 0u;
+    return true;
+}
+
+const char *req_string(const json_t *req, const char *key) {
+    return json_string_value(json_object_get(req, key));
+}
+
+bool req_int(const json_t *req, const char *key, long long &out) {
+    json_t *v = json_object_get(req, key);
+    if (!json_is_integer(v))
+        return false;
+    out = json_integer_value(v);
+    return true;
+}
+
+bool req_number(const json_t *req, const char *key, double &out) {
+    json_t *v = json_object_get(req, key);
+    if (!json_is_number(v))
+        return false;
+    out = json_number_value(v);
+    return true;
+}
+
+bool feed_bars(const std::vector<Bar> &bars, const json_t *req, std::string &error) {
+    long long timeframe = kTimeframeM1; // get_m1_bars has no timeframe member.
+    req_int(req, "timeframe", timeframe);
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol)
+        return true;
+    long long start = 0;
+    req_int(req, "start", start);
+    StreamIndicators::instance().on_bars(symbol, timeframe, bars, start <= 0);
+    RollingMatrices::instance().on_bars(symbol, timeframe, bars, start <= 0);
+    MarketCache::instance().on_bars(symbol, timeframe, bars);
+    return !json_is_true(json_object_get(req, "save")) ||
+           save_bars(config().history_dir, symbol, timeframe, bars, error);
+}
+
+bool feed_ticks(std::vector<Tick> &ticks, const json_t *req, std::string &error) {
+    if (!ticks.empty())
+        ServerClock::instance().observe(ticks.back().time_msc, ticks.back().recv_ns);
+
+    // Polled streams go through the integrity stage unless the caller
+    // asks for the source's raw answer.
+    auto &integrity = TickIntegrity::instance();
+    const char *symbol = req_string(req, "symbol");
+    if (!symbol)
+        return true;
+    if (integrity.enabled() && !json_is_true(json_object_get(req, "raw"))) {
+        long long flags = -1, date_from = -1;
+        req_int(req, "flags", flags);
+        req_int(req, "date_from", date_from);
+        std::string stream = std::string(symbol) + "/" + std::to_string(flags);
+        integrity.process(stream, ticks, date_from >= 0 ? date_from * 1000 : -1);
+    }
+    StreamIndicators::instance().on_ticks(symbol, ticks);
+    MarketCache::instance().on_ticks(symbol, ticks);
+    Portfolio::instance().on_ticks(symbol, ticks);
+    return !json_is_true(json_object_get(req, "save")) ||
+           save_ticks(config().history_dir, symbol, ticks, error);
+}
+
+void feed_tick(const Tick &tick, const json_t *req) {
+    ServerClock::instance().observe(tick.time_msc, tick.recv_ns);
+    if (const char *symbol = req_string(req, "symbol")) {
+        MarketCache::instance().on_tick(symbol, tick);
+        Portfolio::instance().on_tick(symbol, tick);
+    }
+}
+
+json_t *bars_response(const std::vector<Bar> &bars, const json_t *req, std::string &error,
+                      bool live) {
+    if (live && !feed_bars(bars, req, error))
+        return nullptr;
+    std::vector<const RecordField *> fields;
+    if (!wanted_fields(req, kBarFields, fields, error))
+        return nullptr;
+    // The bridge stages above saw every bar; the answer may not.
+    const bool thin = json_object_get(req, "decimate") != nullptr;
+    std::vector<Bar> thinned;
+    if (thin) {
+        thinned = bars;
+        if (!decimate(req, thinned, &Bar::time, 1000, kBarFields, "close", error))
+            return nullptr;
+    }
+    const std::vector<Bar> &out_bars = thin ? thinned : bars;
+    std::vector<int64_t> utc;
+    if (!convert_to_utc(req, out_bars.empty() ? nullptr : &out_bars[0].time, sizeof(Bar),
+                        out_bars.size(), 1000000000, utc, error))
+        return nullptr;
+    if (const char *path = req_string(req, "arrow"))
+        return arrow_response(path, out_bars, utc, req, error);
+    if (const char *path = req_string(req, "csv"))
+        return csv_response(path, out_bars, utc, error);
+    json_t *out = json_array();
+    for (size_t i = 0; i < out_bars.size(); ++i) {
+        json_t *obj = record_json(out_bars[i], fields);
+        if (!utc.empty())
+            json_object_set_new(obj, "time_utc_ns", json_integer(utc[i]));
+        json_array_append_new(out, obj);
+    }
+    return out;
+}
+
+json_t *ticks_response(std::vector<Tick> &ticks, const json_t *req, std::string &error,
+                       bool live) {
+    if (live && !feed_ticks(ticks, req, error))
+        return nullptr;
+    std::vector<const RecordField *> fields;
+    if (!wanted_fields(req, kTickFields, fields, error) ||
+        !decimate(req, ticks, &Tick::time_msc, 1, kTickFields, "bid", error))
+        return nullptr;
+    std::vector<int64_t> utc;
+    if (!convert_to_utc(req, ticks.empty() ? nullptr : &ticks[0].time_msc, sizeof(Tick),
+                        ticks.size(), 1000000, utc, error))
+        return nullptr;
+    if (const char *path = req_string(req, "arrow"))
+        return arrow_response(path, ticks, utc, req, error);
+    if (const char *path = req_string(req, "csv"))
+        return csv_response(path, ticks, utc, error);
+    json_t *out = json_array();
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        json_t *obj = record_json(ticks[i], fields);
+        if (!utc.empty())
+            json_object_set_new(obj, "time_utc_ns", json_integer(utc[i]));
+        json_array_append_new(out, obj);
+    }
+    return out;
+}
+
+json_t *deals_response(const std::vector<Deal> &deals, const json_t *req, std::string &error) {
+    std::vector<int64_t> utc;
+    if (!convert_to_utc(req, deals.empty() ? nullptr : &deals[0].time_msc, sizeof(Deal),
+                        deals.size(), 1000000, utc, error))
+        return nullptr;
+    if (const char *path = req_string(req, "arrow"))
+        return arrow_response(path, deals, utc, req, error);
+    json_t *out = json_array();
+    for (size_t i = 0; i < deals.size(); ++i) {
+        json_t *obj = deal_to_json(deals[i]);
+        if (!utc.empty())
+            json_object_set_new(obj, "time_utc_ns", json_integer(utc[i]));
+        json_array_append_new(out, obj);
+    }
+    return out;
+}
+
+json_t *tick_response(const Tick &tick, const json_t *req, std::string &error) {
+    feed_tick(tick, req);
+    std::vector<const RecordField *> fields;
+    if (!wanted_fields(req, kTickFields, fields, error))
+        return nullptr;
+    std::vector<int64_t> utc;
+    if (!convert_to_utc(req, &tick.time_msc, sizeof tick, 1, 1000000, utc, error))
+        return nullptr;
+    json_t *out = record_json(tick, fields);
+    if (!utc.empty())
+        json_object_set_new(out, "time_utc_ns", json_integer(utc[0]));
+    return out;
+}
+
+} // namespace mt5bridge
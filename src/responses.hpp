@@ -0,0 +1,87 @@
+/*
+ * responses.hpp
+ *
+ * Request parameter access and market data answers shared by every
+ * backend.
+ *
+ * Bars and ticks are built into the same JSON whichever backend produced
+ * them, after the same bridge stages: ticks feed the server clock and go
+ * through the integrity stage (unless "raw": true), both update the
+ * stream indicators of their symbol (stream_indicators.hpp) and the
+ * market cache (market_cache.hpp), ticks also re-mark the portfolio
+ * (portfolio.hpp), bars also their rolling matrices
+ * (rolling_matrix.hpp), "save": true appends the records to the local
+ * history store (history.hpp), and
+ * "utc": true adds time_utc_ns to each record. The answer alone is then
+ * thinned by "decimate" ({"bucket_ms", "min_change", "field", "every"})
+ * and cut down to the members listed in "fields". "arrow": "<path>" writes
+ * the records to an Arrow IPC file (arrow_ipc.hpp) and "csv": "<path>" to
+ * a CSV file (csv_io.hpp); both answer {"path", "format", "rows",
+ * "bytes"} instead of the records.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+#include "record_fields.hpp"
+
+#include <jansson.h>
+
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+/* Returns the string member key, or nullptr if absent or not a string. */
+const char *req_string(const json_t *req, const char *key);
+
+/* Reads an integer member; false if absent or not an integer. */
+bool req_int(const json_t *req, const char *key, long long &out);
+
+/* Reads a numeric member; false if absent or not a number. */
+bool req_number(const json_t *req, const char *key, double &out);
+
+/* Value of one field of record (a Bar or Tick); nullptr for the seq,
+ * gap and integrity fields of an unsequenced tick (seq 0).
+ */
+json_t *field_to_json(const void *record, const RecordField &field, uint64_t seq);
+
+json_t *bar_to_json(const Bar &bar);
+json_t *tick_to_json(const Tick &tick);
+json_t *deal_to_json(const Deal &deal);
+
+/* Inverse of bar_to_json/tick_to_json; missing members read as zero.
+ * False if value is not an object.
+ */
+bool json_to_bar(const json_t *value, Bar &out);
+bool json_to_tick(const json_t *value, Tick &out);
+
+/* The bridge stages of a copy_rates_*, copy_ticks_* or symbol_info_tick
+ * answer alone, for typed calls that skip the JSON. req holds the
+ * request's parameters ("symbol", "timeframe", "start", "date_from",
+ * "flags", "raw", "save"); ticks may be dropped and sequenced.
+ */
+bool feed_bars(const std::vector<Bar> &bars, const json_t *req, std::string &error);
+bool feed_ticks(std::vector<Tick> &ticks, const json_t *req, std::string &error);
+void feed_tick(const Tick &tick, const json_t *req);
+
+/* Answers for copy_rates_* requests. live is false for records read back
+ * from history (backtests), which skip the server clock, integrity and
+ * "save" stages.
+ */
+json_t *bars_response(const std::vector<Bar> &bars, const json_t *req, std::string &error,
+                      bool live = true);
+
+/* Answers for copy_ticks_* requests; live ticks may be dropped and
+ * sequenced.
+ */
+json_t *ticks_response(std::vector<Tick> &ticks, const json_t *req, std::string &error,
+                       bool live = true);
+
+/* Answers for history_deals_get. */
+json_t *deals_response(const std::vector<Deal> &deals, const json_t *req, std::string &error);
+
+/* Answer for symbol_info_tick. */
+json_t *tick_response(const Tick &tick, const json_t *req, std::string &error);
+
+} // namespace mt5bridge
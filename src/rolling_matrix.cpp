@@ -0,0 +1,318 @@
+/*
+ * rolling_matrix.cpp
+ *
+ * Row alignment and tiled rank-k updates of rolling product sums.
+ */
+
+#include "rolling_matrix.hpp"
+
+#include "history.hpp"
+#include "indicators.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mt5bridge {
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr size_t kTile = 64;                    // Symbols per tile side.
+constexpr size_t kParallelWork = size_t{1} << 20; // Multiply-adds worth spreading.
+constexpr uint64_t kMaxCells = uint64_t{1} << 26;  // Window rows x symbols.
+
+} // namespace
+
+struct RollingMatrices::Matrix {
+    int64_t id = 0;
+    MatrixSpec spec;
+    size_t n = 0;
+    std::unordered_map<std::string, size_t> index;
+    std::vector<int64_t> last_time;     // Newest closed bar taken, per symbol.
+    std::vector<double> last_close;     // Close of the last committed row, per symbol.
+    std::map<int64_t, std::vector<double>> pending; // Open time -> closes (NaN = none).
+
+    std::vector<double> ring;           // window x n returns.
+    size_t head = 0;                    // Next ring row to write.
+    uint64_t rows = 0;
+    int64_t time = 0;
+
+    std::vector<double> sum;            // Sum of each column over the window.
+    std::vector<double> prod;           // n x n pairwise product sums; upper triangle.
+    std::vector<std::pair<size_t, size_t>> tiles; // Upper-triangle tiles (I, J), J >= I.
+    uint64_t since_anchor = 0;
+
+    std::vector<double> added, evicted; // Rows entering and leaving since the last flush.
+    bool rebuild = false;               // The batch outgrew the window: rebuild from ring.
+
+    void init(const MatrixSpec &s);
+    void take(size_t k, const Bar &b);
+    void commit();
+    void commit_row(int64_t t, const std::vector<double> &closes);
+    void flush();
+    void update(const double *x, size_t count, double sign);
+    void read(bool correlation, MatrixValue &out) const;
+};
+
+void RollingMatrices::Matrix::init(const MatrixSpec &s) {
+    spec = s;
+    n = s.symbols.size();
+    for (size_t k = 0; k < n; ++k)
+        index[s.symbols[k]] = k;
+    last_time.assign(n, std::numeric_limits<int64_t>::min());
+    last_close.assign(n, 0.0);
+    ring.assign(s.window * n, 0.0);
+    sum.assign(n, 0.0);
+    prod.assign(n * n, 0.0);
+    const size_t t = (n + kTile - 1) / kTile;
+    for (size_t i = 0; i < t; ++i)
+        for (size_t j = i; j < t; ++j)
+            tiles.emplace_back(i, j);
+}
+
+void RollingMatrices::Matrix::take(size_t k, const Bar &b) {
+    if (b.time <= last_time[k] || !(b.close > 0.0))
+        return;
+    last_time[k] = b.time;
+    auto it = pending.find(b.time);
+    if (it == pending.end())
+        it = pending.emplace(b.time, std::vector<double>(n, kNaN)).first;
+    it->second[k] = b.close;
+}
+
+/* Commits the times every symbol has reached, then the oldest others
+ * while more than a window of them wait.
+ */
+void RollingMatrices::Matrix::commit() {
+    const int64_t frontier = *std::min_element(last_time.begin(), last_time.end());
+    while (!pending.empty() &&
+           (pending.begin()->first <= frontier || pending.size() > spec.window)) {
+        commit_row(pending.begin()->first, pending.begin()->second);
+        pending.erase(pending.begin());
+    }
+}
+
+void RollingMatrices::Matrix::commit_row(int64_t t, const std::vector<double> &closes) {
+    bool primed = true;
+    for (size_t k = 0; k < n; ++k) {
+        if (!(last_close[k] > 0.0))
+            primed = false;
+    }
+    if (!primed) {
+        // No previous close for some symbol yet: this row only seeds them.
+        for (size_t k = 0; k < n; ++k) {
+            if (!std::isnan(closes[k]))
+                last_close[k] = closes[k];
+        }
+        return;
+    }
+    const size_t w = spec.window;
+    double *slot = &ring[head * n];
+    if (!rebuild && rows == w)
+        evicted.insert(evicted.end(), slot, slot + n);
+    for (size_t k = 0; k < n; ++k) {
+        const double c = std::isnan(closes[k]) ? last_close[k] : closes[k];
+        slot[k] = std::log(c / last_close[k]);
+        last_close[k] = c;
+    }
+    if (!rebuild)
+        added.insert(added.end(), slot, slot + n);
+    if (added.size() >= w * n) {
+        rebuild = true;
+        added.clear();
+        evicted.clear();
+    }
+    head = (head + 1) % w;
+    rows = std::min<uint64_t>(rows + 1, w);
+    time = t;
+    ++since_anchor;
+}
+
+void RollingMatrices::Matrix::flush() {
+    if (rebuild || since_anchor >= kAnchorBlock) {
+        std::fill(sum.begin(), sum.end(), 0.0);
+        std::fill(prod.begin(), prod.end(), 0.0);
+        update(ring.data(), rows, 1.0); // Rows past `rows` are not written yet.
+        since_anchor = 0;
+    } else {
+        update(added.data(), added.size() / std::max<size_t>(n, 1), 1.0);
+        update(evicted.data(), evicted.size() / std::max<size_t>(n, 1), -1.0);
+    }
+    rebuild = false;
+    added.clear();
+    evicted.clear();
+}
+
+/* Adds sign times the count rows of x (n wide) to the sums, one upper
+ * triangle tile of the products per task.
+ */
+void RollingMatrices::Matrix::update(const double *x, size_t count, double sign) {
+    if (count == 0)
+        return;
+    for (size_t r = 0; r < count; ++r)
+        for (size_t k = 0; k < n; ++k)
+            sum[k] += sign * x[r * n + k];
+    const unsigned workers =
+        n * n * count / 2 >= kParallelWork ? worker_count(tiles.size()) : 1;
+    parallel_for(tiles.size(), workers, [&](size_t t, unsigned) {
+        const size_t i0 = tiles[t].first * kTile, i1 = std::min(n, i0 + kTile);
+        const size_t j0 = tiles[t].second * kTile, j1 = std::min(n, j0 + kTile);
+        for (size_t i = i0; i < i1; ++i) {
+            double *out = &prod[i * n];
+            const size_t jb = std::max(j0, i);
+            for (size_t r = 0; r < count; ++r) {
+                const double *row = x + r * n;
+                const double xi = sign * row[i];
+                for (size_t j = jb; j < j1; ++j)
+                    out[j] += xi * row[j];
+            }
+        }
+    });
+}
+
+void RollingMatrices::Matrix::read(bool correlation, MatrixValue &out) const {
+    out.values.assign(n * n, kNaN);
+    out.time = rows ? time : 0;
+    out.rows = rows;
+    if (rows < 2)
+        return;
+    const double m = static_cast<double>(rows);
+    auto cov = [&](size_t i, size_t j) {
+        if (i > j)
+            std::swap(i, j);
+        return (prod[i * n + j] - sum[i] * sum[j] / m) / (m - 1.0);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double v = cov(i, j);
+            if (correlation) {
+                const double den = std::sqrt(cov(i, i) * cov(j, j));
+                v = den > 0.0 ? std::max(-1.0, std::min(1.0, v / den)) : kNaN;
+            }
+            out.values[i * n + j] = v;
+        }
+    }
+}
+
+RollingMatrices &RollingMatrices::instance() {
+    static RollingMatrices matrices;
+    return matrices;
+}
+
+RollingMatrices::RollingMatrices() = default;
+RollingMatrices::~RollingMatrices() = default;
+
+bool RollingMatrices::add(const MatrixSpec &spec, const std::string &history_dir, int64_t &id,
+                          std::string &error) {
+    const size_t n = spec.symbols.size();
+    if (n == 0 || n > kMaxSymbols) {
+        error = "matrix requires 1 to " + std::to_string(kMaxSymbols) + " symbols";
+        return false;
+    }
+    if (timeframe_name(spec.timeframe).empty()) {
+        error = "unknown timeframe " + std::to_string(spec.timeframe);
+        return false;
+    }
+    if (spec.window < 2 || spec.window * n > kMaxCells) {
+        error = "window must be at least 2 and window x symbols at most " +
+                std::to_string(kMaxCells);
+        return false;
+    }
+    auto m = std::make_unique<Matrix>();
+    m->init(spec);
+    if (m->index.size() != n) {
+        error = "matrix symbols must be distinct";
+        return false;
+    }
+
+    // Warm up from the store. The newest stored bar may have been saved
+    // while forming, so it is left for the next poll.
+    for (size_t k = 0; k < n; ++k) {
+        BarSeries series;
+        std::string ignored;
+        if (!open_bars(bars_path(history_dir, spec.symbols[k], spec.timeframe), series, ignored) ||
+            series.count < 2)
+            continue;
+        const size_t last = series.count - 1;
+        const size_t first = last > spec.window + 1 ? last - spec.window - 1 : 0;
+        for (size_t i = first; i < last; ++i)
+            m->take(k, series.records[i]);
+    }
+    m->commit();
+    m->flush();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = m->id = next_id_++;
+    for (const std::string &symbol : spec.symbols)
+        by_symbol_[symbol].push_back(m.get());
+    matrices_.emplace(id, std::move(m));
+    return true;
+}
+
+bool RollingMatrices::remove(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = matrices_.find(id);
+    if (it == matrices_.end())
+        return false;
+    for (const std::string &symbol : it->second->spec.symbols) {
+        auto s = by_symbol_.find(symbol);
+        s->second.erase(std::find(s->second.begin(), s->second.end(), it->second.get()));
+        if (s->second.empty())
+            by_symbol_.erase(s);
+    }
+    matrices_.erase(it);
+    return true;
+}
+
+bool RollingMatrices::read(int64_t id, bool correlation, MatrixValue &out,
+                           MatrixSpec *spec) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = matrices_.find(id);
+    if (it == matrices_.end())
+        return false;
+    it->second->read(correlation, out);
+    if (spec)
+        *spec = it->second->spec;
+    return true;
+}
+
+void RollingMatrices::on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars,
+                              bool forming) {
+    if (bars.empty())
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_symbol_.find(symbol);
+    if (it == by_symbol_.end())
+        return;
+    const size_t closed = forming ? bars.size() - 1 : bars.size();
+    for (Matrix *m : it->second) {
+        if (m->spec.timeframe != timeframe)
+            continue;
+        const size_t k = m->index.at(symbol);
+        for (size_t i = 0; i < closed; ++i)
+            m->take(k, bars[i]);
+        m->commit();
+        m->flush();
+    }
+}
+
+json_t *RollingMatrices::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &kv : matrices_) {
+        const Matrix &m = *kv.second;
+        json_t *symbols = json_array();
+        for (const std::string &s : m.spec.symbols)
+            json_array_append_new(symbols, json_string(s.c_str()));
+        json_array_append_new(
+            out, json_pack("{s:I, s:o, s:I, s:I, s:I, s:I}", "id", static_cast<json_int_t>(m.id),
+                           "symbols", symbols, "timeframe", static_cast<json_int_t>(m.spec.timeframe),
+                           "window", static_cast<json_int_t>(m.spec.window), "rows",
+                           static_cast<json_int_t>(m.rows), "time",
+                           static_cast<json_int_t>(m.rows ? m.time : 0)));
+    }
+    return out;
+}
+
+} // namespace mt5bridge
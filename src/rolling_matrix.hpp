@@ -0,0 +1,99 @@
+/*
+ * rolling_matrix.hpp
+ *
+ * Rolling covariance and correlation matrices of many symbols' bar
+ * returns, kept up to date inside the bridge as bars arrive.
+ *
+ * A matrix is registered for a set of symbols, a timeframe and a window
+ * of W bars. It warms up from the history store (history.hpp) when the
+ * symbols have stored bars, and every live bar answer for one of its
+ * symbols passes through on_bars afterwards, as for stream indicators
+ * (stream_indicators.hpp): closed bars newer than the last one taken are
+ * consumed once, the forming bar is left for a later poll.
+ *
+ * Symbols are aligned by bar open time. A time becomes a row once every
+ * symbol has delivered a closed bar at or after it; a symbol with no bar
+ * at that time keeps its previous close, i.e. contributes a zero return.
+ * If one symbol falls more than W rows behind, the oldest pending rows
+ * are committed with its previous close rather than held back. Row
+ * values are log returns of the close.
+ *
+ * The matrix keeps the sums of the last W rows and of their pairwise
+ * products, so a new row costs one rank-1 update in and one out, O(N^2)
+ * for N symbols, instead of recomputing O(W N^2). The N x N product sums
+ * are updated in 64 x 64 tiles of the upper triangle, each fitting in
+ * the L1/L2 caches, and tiles run on threads.workers threads once a
+ * batch is large enough to pay for them. The sums are rebuilt from the
+ * window every kAnchorBlock rows to bound rounding drift.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+struct MatrixSpec {
+    std::vector<std::string> symbols;
+    int64_t timeframe = kTimeframeM1;
+    uint64_t window = 0;    // Rows (bars) per window, at least 2.
+};
+
+struct MatrixValue {
+    std::vector<double> values; // N x N, row-major; NaN where undefined.
+    int64_t time = 0;           // Open time of the newest row, 0 before the first.
+    uint64_t rows = 0;          // Rows in the window, up to window.
+};
+
+class RollingMatrices {
+public:
+    static constexpr size_t kMaxSymbols = 4096;
+
+    static RollingMatrices &instance();
+
+    /* Registers a matrix and warms it up from the bars stored under
+     * history_dir; false with error on an invalid spec.
+     */
+    bool add(const MatrixSpec &spec, const std::string &history_dir, int64_t &id,
+             std::string &error);
+
+    /* False if id is unknown. */
+    bool remove(int64_t id);
+
+    /* Sample covariance of the window's returns, or their Pearson
+     * correlation; false if id is unknown. spec, if not null, receives
+     * the matrix's spec.
+     */
+    bool read(int64_t id, bool correlation, MatrixValue &out, MatrixSpec *spec = nullptr) const;
+
+    /* forming: the last bar is still open. */
+    void on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars,
+                 bool forming);
+
+    /* Returns [{"id", "symbols", "timeframe", "window", "rows", "time"}, ...]. */
+    json_t *to_json() const;
+
+private:
+    struct Matrix;
+
+    RollingMatrices();
+    ~RollingMatrices();
+
+    mutable std::mutex mutex_;
+    int64_t next_id_ = 1;
+    std::map<int64_t, std::unique_ptr<Matrix>> matrices_;
+    std::unordered_map<std::string, std::vector<Matrix *>> by_symbol_;
+};
+
+} // namespace mt5bridge
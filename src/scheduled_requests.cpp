@@ -0,0 +1,247 @@
+/*
+ * scheduled_requests.cpp
+ *
+ * Periodic and one-off bridge requests run on the timer wheel.
+ */
+
+#include "scheduled_requests.hpp"
+
+#include "clock.hpp"
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int64_t kNsPerMs = 1000000;
+
+bool read_int(const json_t *obj, const char *key, int64_t &out, std::string &error) {
+    const json_t *v = json_object_get(obj, key);
+    if (!v)
+        return true;
+    if (!json_is_integer(v)) {
+        error = std::string(key) + " must be an integer";
+        return false;
+    }
+    out = json_integer_value(v);
+    return true;
+}
+
+} // namespace
+
+struct ScheduledRequests::Schedule {
+    int64_t id = 0;
+    json_t *request = nullptr;      // Owned.
+    std::string method;
+    int64_t period_ns = 0;
+    int64_t start_ns = 0;           // First run.
+    int64_t next_ns = 0;            // 0 once a one-off has run.
+    uint64_t timer = 0;
+    Eval eval = nullptr;
+    mt5bridge_request_handler handler = nullptr;
+    void *user = nullptr;
+    json_t *result = nullptr;       // Owned; last answer.
+    std::string error;              // Last error.
+    int64_t runs = 0;
+    int64_t errors = 0;
+    int64_t fetched_ns = 0;
+    int64_t latency_ns = 0;
+
+    ~Schedule() {
+        json_decref(request);
+        json_decref(result);
+    }
+};
+
+bool schedule_spec_from_json(const json_t *obj, ScheduleSpec &spec, std::string &error) {
+    json_t *request = json_object_get(obj, "request");
+    if (!json_is_object(request)) {
+        error = "request must be an object with a method";
+        return false;
+    }
+    spec.request = request;
+    const json_t *align = json_object_get(obj, "align");
+    if (align && !json_is_boolean(align)) {
+        error = "align must be a boolean";
+        return false;
+    }
+    spec.align = json_is_true(align);
+    return read_int(obj, "period_ms", spec.period_ms, error) &&
+           read_int(obj, "offset_ms", spec.offset_ms, error);
+}
+
+ScheduledRequests &ScheduledRequests::instance() {
+    static ScheduledRequests requests;
+    return requests;
+}
+
+ScheduledRequests::~ScheduledRequests() = default;
+
+bool ScheduledRequests::add(const ScheduleSpec &spec, Eval eval, Knows knows, int64_t &id,
+                            std::string &error) {
+    const char *method = json_string_value(json_object_get(spec.request, "method"));
+    if (!method) {
+        error = "request must be an object with a method";
+        return false;
+    }
+    if (!knows(method)) {
+        error = std::string("unknown method ") + method;
+        return false;
+    }
+    if (spec.period_ms < 0 || spec.offset_ms < 0) {
+        error = "period_ms and offset_ms must not be negative";
+        return false;
+    }
+    if (spec.align && spec.period_ms == 0) {
+        error = "align needs period_ms > 0";
+        return false;
+    }
+
+    auto schedule = std::make_unique<Schedule>();
+    schedule->request = json_deep_copy(spec.request);
+    schedule->method = method;
+    schedule->period_ns = spec.period_ms * kNsPerMs;
+    schedule->eval = eval;
+    schedule->handler = spec.handler;
+    schedule->user = spec.user;
+    const int64_t now = now_ns();
+    schedule->start_ns =
+        (spec.align ? (now / schedule->period_ns + 1) * schedule->period_ns : now) +
+        spec.offset_ms * kNsPerMs;
+    schedule->next_ns = schedule->start_ns;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (schedules_.size() >= kMaxSchedules) {
+        // Forget the oldest one-off that has run to make room.
+        auto it = std::find_if(schedules_.begin(), schedules_.end(),
+                               [](const auto &s) { return s.second->next_ns == 0; });
+        if (it == schedules_.end()) {
+            error = "too many schedules (" + std::to_string(kMaxSchedules) + ")";
+            return false;
+        }
+        schedules_.erase(it);
+    }
+    schedule->id = id = next_id_++;
+    const int64_t schedule_id = id;
+    schedule->timer = TimerWheel::instance().schedule(
+        schedule->start_ns, schedule->period_ns, [this, schedule_id] { run(schedule_id); });
+    schedules_.emplace(id, std::move(schedule));
+    return true;
+}
+
+bool ScheduledRequests::remove(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = schedules_.find(id);
+    if (it == schedules_.end())
+        return false;
+    TimerWheel::instance().cancel(it->second->timer);
+    schedules_.erase(it);
+    const std::thread::id self = std::this_thread::get_id();
+    ran_.wait(lock, [&] {
+        auto r = running_.find(id);
+        return r == running_.end() || r->second == self;
+    });
+    return true;
+}
+
+void ScheduledRequests::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto &entry : schedules_)
+        TimerWheel::instance().cancel(entry.second->timer);
+    schedules_.clear();
+    const std::thread::id self = std::this_thread::get_id();
+    ran_.wait(lock, [&] {
+        return std::all_of(running_.begin(), running_.end(),
+                           [&](const auto &r) { return r.second == self; });
+    });
+}
+
+void ScheduledRequests::end_run(int64_t id) {
+    running_.erase(id);
+    ran_.notify_all();
+}
+
+void ScheduledRequests::run(int64_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = schedules_.find(id);
+    if (it == schedules_.end())
+        return;
+    // The request runs without the lock, so it may be removed meanwhile.
+    json_t *request = json_incref(it->second->request);
+    const Eval eval = it->second->eval;
+    const mt5bridge_request_handler handler = it->second->handler;
+    void *user = it->second->user;
+    running_[id] = std::this_thread::get_id();
+    lock.unlock();
+
+    const int64_t start = now_ns();
+    std::string err;
+    json_t *result = eval(request, err);
+    const int64_t end = now_ns();
+    json_decref(request);
+    if (!result && err.empty())
+        err = "request failed";
+
+    lock.lock();
+    it = schedules_.find(id);
+    if (it == schedules_.end()) {
+        json_decref(result);
+        end_run(id);
+        return;
+    }
+    Schedule &s = *it->second;
+    ++s.runs;
+    if (!result)
+        ++s.errors;
+    json_decref(s.result);
+    s.result = result;
+    s.error = err;
+    s.fetched_ns = end;
+    s.latency_ns = end - start;
+    s.next_ns = s.period_ns > 0
+                    ? s.start_ns + ((end - s.start_ns) / s.period_ns + 1) * s.period_ns
+                    : 0;
+    if (!handler) {
+        end_run(id);
+        return;
+    }
+    char *text = result ? json_dumps(result, JSON_COMPACT | JSON_ENCODE_ANY) : nullptr;
+    const std::string error = err;
+    lock.unlock();
+    handler(id, text, text || error.empty() ? nullptr : error.c_str(), user);
+    std::free(text);
+    lock.lock();
+    end_run(id);
+}
+
+json_t *ScheduledRequests::describe(const Schedule &s, bool with_result) const {
+    json_t *out = json_pack(
+        "{s:I, s:s, s:I, s:I, s:I, s:s?, s:I, s:f, s:I}", "id", static_cast<json_int_t>(s.id),
+        "method", s.method.c_str(), "period_ms", static_cast<json_int_t>(s.period_ns / kNsPerMs),
+        "runs", static_cast<json_int_t>(s.runs), "errors", static_cast<json_int_t>(s.errors),
+        "error", s.error.empty() ? nullptr : s.error.c_str(), "fetched_ns",
+        static_cast<json_int_t>(s.fetched_ns), "latency_us", s.latency_ns / 1e3, "next_ns",
+        static_cast<json_int_t>(s.next_ns));
+    if (with_result)
+        json_object_set_new(out, "result", s.result ? json_deep_copy(s.result) : json_null());
+    return out;
+}
+
+json_t *ScheduledRequests::result(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = schedules_.find(id);
+    return it == schedules_.end() ? nullptr : describe(*it->second, true);
+}
+
+json_t *ScheduledRequests::to_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &entry : schedules_)
+        json_array_append_new(out, describe(*entry.second, false));
+    return out;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,113 @@
+/*
+ * scheduled_requests.hpp
+ *
+ * Bridge requests run on the timer wheel (timer_wheel.hpp) instead of a
+ * sleep loop per consumer: positions_get every second, a quote every
+ * 200 ms, the last bar just after each minute boundary.
+ *
+ * A schedule holds one mt5bridge_eval request. It first runs offset_ms
+ * from now, or with align offset_ms after the next multiple of period_ms
+ * of the bridge clock (UTC), then every period_ms; period_ms 0 runs it
+ * once. Every schedule runs on the timer thread, one request after the
+ * other, so consumers polling the same terminal no longer wake together
+ * and contend for the interpreter; a request slower than its period skips
+ * the runs it missed rather than queueing them.
+ *
+ * The last answer or error of each schedule is kept for polling, and is
+ * also handed to the schedule's handler, if any, on the timer thread. A
+ * handler should return quickly: the next timer waits for it. remove()
+ * and stop() wait for a run in progress on another thread, so once they
+ * return no handler call is still running and its user data may be
+ * freed; called from the schedule's own handler they return at once.
+ */
+
+#pragma once
+
+#include "mt5bridge/mt5bridge.hpp"
+
+#include <jansson.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mt5bridge {
+
+struct ScheduleSpec {
+    json_t *request = nullptr;      // Borrowed; {"method", ...}.
+    int64_t period_ms = 0;          // 0 = once.
+    int64_t offset_ms = 0;          // Delay, or phase past the boundary with align.
+    bool align = false;             // Runs on multiples of period_ms.
+    mt5bridge_request_handler handler = nullptr;
+    void *user = nullptr;
+};
+
+/* Reads {"request", "period_ms", "offset_ms", "align"}; spec.request
+ * borrows from obj.
+ */
+bool schedule_spec_from_json(const json_t *obj, ScheduleSpec &spec, std::string &error);
+
+class ScheduledRequests {
+public:
+    static constexpr size_t kMaxSchedules = 1024;   // Kept, pending or finished.
+
+    /* Runs a request; returns its answer, or nullptr with error. */
+    using Eval = json_t *(*)(json_t *request, std::string &error);
+
+    /* True if eval serves method. */
+    using Knows = bool (*)(const char *method);
+
+    static ScheduledRequests &instance();
+
+    /* Starts a schedule whose requests go through eval; a method knows
+     * rejects is refused here rather than failing every run. Returns
+     * false with error.
+     */
+    bool add(const ScheduleSpec &spec, Eval eval, Knows knows, int64_t &id,
+             std::string &error);
+
+    /* Stops a schedule and forgets it, waiting for a run in progress on
+     * another thread to finish. False for an unknown id.
+     */
+    bool remove(int64_t id);
+
+    /* Drops every schedule (bridge shutdown). */
+    void stop();
+
+    /* Returns {"id", "method", "period_ms", "runs", "errors", "result",
+     * "error", "fetched_ns", "latency_us", "next_ns"} with the last answer
+     * (null before the first or after a failed run), or nullptr for an
+     * unknown id.
+     */
+    json_t *result(int64_t id);
+
+    /* Returns the same objects for every schedule, without "result". */
+    json_t *to_json();
+
+private:
+    struct Schedule;
+
+    ScheduledRequests() = default;
+    ~ScheduledRequests();
+
+    /* Timer task: runs schedule id once. */
+    void run(int64_t id);
+
+    /* Called with mutex_ held. */
+    json_t *describe(const Schedule &schedule, bool with_result) const;
+
+    /* Marks run id finished and wakes remove()/stop(); mutex_ held. */
+    void end_run(int64_t id);
+
+    std::mutex mutex_;
+    std::condition_variable ran_;
+    std::map<int64_t, std::unique_ptr<Schedule>> schedules_;
+    std::map<int64_t, std::thread::id> running_;   // Runs in progress.
+    int64_t next_id_ = 1;
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,265 @@
+/*
+ * screener.cpp
+ *
+ * Market leaves over cached quotes and bars, and filter evaluation.
+ */
+
+#include "screener.hpp"
+
+#include "clock.hpp"
+#include "indicators.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace mt5bridge {
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr size_t kMaxCompiled = 256;    // Filters kept compiled by text.
+constexpr double kMaxBarsBack = 1 << 24;
+
+enum class Leaf {
+    Bid, Ask, Last, Mid, Spread, TimeMsc, AgeMs,
+    Open, High, Low, Close, Volume, BarSpread, Bars,
+    Range, Highest, Lowest, Sma, Stddev, Change, VolumeZscore, Ema, Rsi, Atr
+};
+
+struct LeafName {
+    const char *name;
+    Leaf leaf;
+    int min_args;
+    int max_args;
+    int min_value;      // Smallest accepted argument.
+};
+
+const LeafName kLeaves[] = {
+    {"bid", Leaf::Bid, 0, 0, 0},
+    {"ask", Leaf::Ask, 0, 0, 0},
+    {"last", Leaf::Last, 0, 0, 0},
+    {"mid", Leaf::Mid, 0, 0, 0},
+    {"spread", Leaf::Spread, 0, 0, 0},
+    {"time_msc", Leaf::TimeMsc, 0, 0, 0},
+    {"age_ms", Leaf::AgeMs, 0, 0, 0},
+    {"open", Leaf::Open, 0, 1, 0},
+    {"high", Leaf::High, 0, 1, 0},
+    {"low", Leaf::Low, 0, 1, 0},
+    {"close", Leaf::Close, 0, 1, 0},
+    {"volume", Leaf::Volume, 0, 1, 0},
+    {"bar_spread", Leaf::BarSpread, 0, 1, 0},
+    {"bars", Leaf::Bars, 0, 0, 0},
+    {"range", Leaf::Range, 1, 1, 1},
+    {"highest", Leaf::Highest, 1, 1, 1},
+    {"lowest", Leaf::Lowest, 1, 1, 1},
+    {"sma", Leaf::Sma, 1, 1, 1},
+    {"stddev", Leaf::Stddev, 1, 1, 1},
+    {"change", Leaf::Change, 1, 1, 1},
+    {"volume_zscore", Leaf::VolumeZscore, 1, 1, 2},
+    {"ema", Leaf::Ema, 1, 1, 1},
+    {"rsi", Leaf::Rsi, 1, 1, 1},
+    {"atr", Leaf::Atr, 1, 1, 1},
+};
+
+const LeafName *find_leaf(const std::string &name) {
+    for (const LeafName &l : kLeaves) {
+        if (name == l.name)
+            return &l;
+    }
+    return nullptr;
+}
+
+double bar_volume(const Bar &b) {
+    return static_cast<double>(b.real_volume ? b.real_volume : b.tick_volume);
+}
+
+thread_local std::vector<Bar> t_bars;      // Ring copied out for the indicators.
+thread_local std::vector<double> t_values;
+
+/* Newest value of ema, rsi or atr with period n over every cached bar. */
+double indicator_leaf(Leaf leaf, size_t n, const BarRing &r) {
+    const size_t size = r.size();
+    if (size < (leaf == Leaf::Ema ? n : n + 1))
+        return kNaN;
+    t_bars.resize(size);
+    t_values.resize(size);
+    for (size_t i = 0; i < size; ++i)
+        t_bars[i] = r.at(i);
+    const Bar *b = t_bars.data();
+    std::string err;
+    bool ok;
+    if (leaf == Leaf::Ema)
+        ok = ema(&b->close, sizeof(Bar), size, n, t_values.data(), err);
+    else if (leaf == Leaf::Rsi)
+        ok = rsi(&b->close, sizeof(Bar), size, n, t_values.data(), err);
+    else
+        ok = atr(&b->high, &b->low, &b->close, sizeof(Bar), size, n, t_values.data(), err);
+    return ok ? t_values[size - 1] : kNaN;
+}
+
+/* Value of a bar leaf with argument n over ring r. */
+double bar_leaf(Leaf leaf, size_t n, const BarRing *r) {
+    if (leaf == Leaf::Bars)
+        return r ? static_cast<double>(r->size()) : 0.0;
+    if (!r)
+        return kNaN;
+    const size_t size = r->size();
+    switch (leaf) {
+    case Leaf::Open: return n < size ? r->back(n).open : kNaN;
+    case Leaf::High: return n < size ? r->back(n).high : kNaN;
+    case Leaf::Low: return n < size ? r->back(n).low : kNaN;
+    case Leaf::Close: return n < size ? r->back(n).close : kNaN;
+    case Leaf::Volume: return n < size ? bar_volume(r->back(n)) : kNaN;
+    case Leaf::BarSpread: return n < size ? static_cast<double>(r->back(n).spread) : kNaN;
+    case Leaf::Change:
+        return n < size && r->back(n).close != 0.0 ? r->back(0).close / r->back(n).close - 1.0 : kNaN;
+    case Leaf::Ema:
+    case Leaf::Rsi:
+    case Leaf::Atr:
+        return indicator_leaf(leaf, n, *r);
+    default: break;
+    }
+    if (leaf == Leaf::VolumeZscore) {
+        if (n + 1 > size)
+            return kNaN;
+        double sum = 0.0, sq = 0.0;
+        for (size_t i = 1; i <= n; ++i)
+            sum += bar_volume(r->back(i));
+        const double mean = sum / static_cast<double>(n);
+        for (size_t i = 1; i <= n; ++i) {
+            const double d = bar_volume(r->back(i)) - mean;
+            sq += d * d;
+        }
+        const double sd = std::sqrt(sq / static_cast<double>(n));
+        return sd > 0.0 ? (bar_volume(r->back(0)) - mean) / sd : kNaN;
+    }
+    if (n > size)
+        return kNaN;
+    double hi = -std::numeric_limits<double>::infinity();
+    double lo = std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        const Bar &b = r->back(i);
+        hi = std::max(hi, b.high);
+        lo = std::min(lo, b.low);
+        sum += b.close;
+    }
+    const double mean = sum / static_cast<double>(n);
+    switch (leaf) {
+    case Leaf::Range: return hi - lo;
+    case Leaf::Highest: return hi;
+    case Leaf::Lowest: return lo;
+    case Leaf::Sma: return mean;
+    default: {
+        double sq = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            const double d = r->back(i).close - mean;
+            sq += d * d;
+        }
+        return std::sqrt(sq / static_cast<double>(n));
+    }
+    }
+}
+
+std::mutex g_compiled_mutex;
+std::unordered_map<std::string, std::shared_ptr<const Expression>> g_compiled;
+
+std::shared_ptr<const Expression> compiled(const std::string &filter, std::string &error) {
+    std::lock_guard<std::mutex> lock(g_compiled_mutex);
+    auto it = g_compiled.find(filter);
+    if (it != g_compiled.end())
+        return it->second;
+    auto expr = Expression::compile(filter, market_leaf_check, error);
+    if (!expr)
+        return nullptr;
+    if (expr->state_size()) {
+        error = "crosses_above and crosses_below need a rule (rule_add), not a screen";
+        return nullptr;
+    }
+    if (g_compiled.size() >= kMaxCompiled)
+        g_compiled.clear();
+    g_compiled.emplace(filter, expr);
+    return expr;
+}
+
+} // namespace
+
+bool market_leaf_check(const ExprLeaf &leaf, std::string &error) {
+    const LeafName *l = find_leaf(leaf.name);
+    if (!l) {
+        error = "unknown name " + leaf.name;
+        return false;
+    }
+    const int args = static_cast<int>(leaf.args.size());
+    if (args < l->min_args || args > l->max_args) {
+        error = leaf.name + " takes " +
+                (l->min_args == l->max_args ? std::to_string(l->min_args)
+                                            : std::to_string(l->min_args) + " or " +
+                                                  std::to_string(l->max_args)) +
+                " argument(s)";
+        return false;
+    }
+    for (double a : leaf.args) {
+        if (a != std::floor(a) || a < l->min_value || a > kMaxBarsBack) {
+            error = "argument of " + leaf.name + " must be an integer >= " +
+                    std::to_string(l->min_value);
+            return false;
+        }
+    }
+    return true;
+}
+
+void MarketColumns::load(size_t, const ExprLeaf &spec, size_t lanes, double *out) {
+    const Leaf leaf = find_leaf(spec.name)->leaf;
+    const size_t n = spec.args.empty() ? 0 : static_cast<size_t>(spec.args[0]);
+    const QuoteColumns &q = quotes_;
+    if (leaf >= Leaf::Open) {
+        for (size_t i = 0; i < lanes; ++i) {
+            const int32_t id = ids_ ? ids_[i] : static_cast<int32_t>(i);
+            out[i] = id < 0 ? kNaN : bar_leaf(leaf, n, bars_(id, timeframe_));
+        }
+        return;
+    }
+    const int64_t now = leaf == Leaf::AgeMs ? now_ns() : 0;
+    for (size_t i = 0; i < lanes; ++i) {
+        const int32_t id = ids_ ? ids_[i] : static_cast<int32_t>(i);
+        if (id < 0 || static_cast<size_t>(id) >= q.count || q.time_msc[id] == 0) {
+            out[i] = kNaN;
+            continue;
+        }
+        switch (leaf) {
+        case Leaf::Bid: out[i] = q.bid[id]; break;
+        case Leaf::Ask: out[i] = q.ask[id]; break;
+        case Leaf::Last: out[i] = q.last[id]; break;
+        case Leaf::Mid: out[i] = 0.5 * (q.bid[id] + q.ask[id]); break;
+        case Leaf::Spread: out[i] = q.ask[id] - q.bid[id]; break;
+        case Leaf::TimeMsc: out[i] = static_cast<double>(q.time_msc[id]); break;
+        default:
+            out[i] = q.recv_ns[id] ? static_cast<double>(now - q.recv_ns[id]) / 1e6 : kNaN;
+            break;
+        }
+    }
+}
+
+bool screen(const std::string &filter, int64_t timeframe, ScreenResult &out, std::string &error) {
+    const auto expr = compiled(filter, error);
+    if (!expr)
+        return false;
+    out.ids.clear();
+    MarketCache::instance().read([&](const QuoteColumns &quotes, const BarLookup &bars) {
+        MarketColumns columns(quotes, bars, timeframe);
+        std::vector<double> values(quotes.count);
+        expr->evaluate(columns, quotes.count, values.data());
+        for (size_t i = 0; i < quotes.count; ++i) {
+            if (Expression::truthy(values[i]))
+                out.ids.push_back(static_cast<int32_t>(i));
+        }
+        out.scanned = quotes.count;
+    });
+    return true;
+}
+
+} // namespace mt5bridge
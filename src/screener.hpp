@@ -0,0 +1,76 @@
+/*
+ * screener.hpp
+ *
+ * Filters evaluated over every symbol of the market cache
+ * (market_cache.hpp) in one pass.
+ *
+ * A filter is an expression (expression.hpp) over these leaves, true for
+ * the symbols to return:
+ *
+ *   bid, ask, last, mid    cached quote
+ *   spread                 ask - bid
+ *   time_msc, age_ms       quote time; milliseconds since it was received
+ *   open(n), high(n), low(n), close(n), volume(n), bar_spread(n)
+ *                          bar n back from the newest (default 0, the
+ *                          newest, which may still be forming); volume is
+ *                          real volume, else tick volume
+ *   bars                   bars cached
+ *   range(n)               highest high - lowest low of the newest n bars
+ *   highest(n), lowest(n)  highest high, lowest low of the newest n bars
+ *   sma(n), stddev(n)      mean and population deviation of n closes
+ *   change(n)              close(0) / close(n) - 1
+ *   volume_zscore(n)       z-score of volume(0) against the n bars before it
+ *   ema(n), rsi(n), atr(n) newest value over all cached bars (indicators.hpp;
+ *                          Wilder's RSI and ATR)
+ *
+ * e.g. "spread < 0.0002 and range(20) > 0.0015 and volume_zscore(50) > 2".
+ * Bar leaves read the bars of the screen's timeframe and are NaN (so the
+ * symbol fails comparisons) when too few are cached. Compiled filters are
+ * kept by text, so a screen run every cycle is parsed once. Crossings
+ * are stateful and only allowed in rules (signal_rules.hpp).
+ */
+
+#pragma once
+
+#include "expression.hpp"
+#include "market_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+/* ExprLeafCheck accepting the leaves above. */
+bool market_leaf_check(const ExprLeaf &leaf, std::string &error);
+
+/* Leaf columns read from the market cache inside MarketCache::read; lane
+ * i is symbol ids[i], or symbol i when ids is null.
+ */
+class MarketColumns : public ExprColumns {
+public:
+    MarketColumns(const QuoteColumns &quotes, const BarLookup &bars, int64_t timeframe,
+                  const int32_t *ids = nullptr)
+        : quotes_(quotes), bars_(bars), timeframe_(timeframe), ids_(ids) {}
+
+    void load(size_t leaf, const ExprLeaf &spec, size_t lanes, double *out) override;
+
+private:
+    const QuoteColumns &quotes_;
+    const BarLookup &bars_;
+    int64_t timeframe_;
+    const int32_t *ids_;
+};
+
+struct ScreenResult {
+    std::vector<int32_t> ids;   // Matching symbol ids, ascending.
+    size_t scanned = 0;         // Symbols evaluated.
+};
+
+/* Evaluates filter over the cached symbols, reading bars of timeframe.
+ * False with error if filter does not compile.
+ */
+bool screen(const std::string &filter, int64_t timeframe, ScreenResult &out, std::string &error);
+
+} // namespace mt5bridge
@@ -0,0 +1,288 @@
+/*
+ * server_time.cpp
+ *
+ * Server offset estimation, DST calendars and bulk time conversion.
+ */
+
+#include "server_time.hpp"
+#include "clock.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+constexpr int64_t kStepMs = 15 * 60 * 1000;        // Offsets are multiples of 15 min.
+constexpr int64_t kMaxOffsetMs = 14 * 3600 * 1000;  // UTC-12 .. UTC+14.
+constexpr int64_t kDay = 86400;
+
+int64_t year_of(int64_t days) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+/* 0 = Sunday. 1970-01-01 was a Thursday. */
+int weekday(int64_t days) { return static_cast<int>(((days % 7) + 11) % 7); }
+
+int64_t nth_sunday(int64_t y, unsigned m, int n) {
+    int64_t first = days_from_civil(y, m, 1);
+    return first + (7 - weekday(first)) % 7 + 7 * (n - 1);
+}
+
+int64_t last_sunday(int64_t y, unsigned m) {
+    int64_t last = days_from_civil(m == 12 ? y + 1 : y, m == 12 ? 1 : m + 1, 1) - 1;
+    return last - weekday(last);
+}
+
+/* UTC seconds at which summer time starts and ends in year y. */
+void dst_bounds(DstRule rule, int64_t y, int64_t &start, int64_t &end) {
+    if (rule == DstRule::Eu) {
+        start = last_sunday(y, 3) * kDay + 3600;        // 01:00 UTC
+        end = last_sunday(y, 10) * kDay + 3600;
+    } else {
+        start = nth_sunday(y, 3, 2) * kDay + 7 * 3600;  // 02:00 New York (EST)
+        end = nth_sunday(y, 11, 1) * kDay + 6 * 3600;   // 02:00 New York (EDT)
+    }
+}
+
+int64_t round_to_step(int64_t ms) {
+    return floor_div(ms + kStepMs / 2, kStepMs) * kStepMs;
+}
+
+} // namespace
+
+/* Days since 1970-01-01 for a proleptic Gregorian date. */
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool parse_dst_rule(const std::string &name, DstRule &rule) {
+    if (name == "none" || name.empty())
+        rule = DstRule::None;
+    else if (name == "eu")
+        rule = DstRule::Eu;
+    else if (name == "us")
+        rule = DstRule::Us;
+    else
+        return false;
+    return true;
+}
+
+bool dst_active(DstRule rule, int64_t utc_s) {
+    if (rule == DstRule::None)
+        return false;
+    int64_t start, end;
+    dst_bounds(rule, year_of(floor_div(utc_s, kDay)), start, end);
+    return utc_s >= start && utc_s < end;
+}
+
+ServerClock &ServerClock::instance() {
+    static ServerClock clock;
+    return clock;
+}
+
+bool ServerClock::configure(const std::string &dst_rule, const std::string &base_offset,
+                            uint64_t window_s, std::string &error) {
+    DstRule rule;
+    if (!parse_dst_rule(dst_rule, rule)) {
+        error = "time.dst_rule must be one of none, eu, us";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    rule_.store(static_cast<int>(rule), std::memory_order_release);
+    window_ms_ = static_cast<int64_t>(window_s) * 1000;
+    window_.clear();
+    below_since_ms_ = -1;
+
+    if (base_offset.empty()) {
+        fixed_ = false;
+        known_.store(false, std::memory_order_release);
+        return true;
+    }
+
+    errno = 0;
+    char *end = nullptr;
+    long long v = std::strtoll(base_offset.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v * 1000 > kMaxOffsetMs || v * 1000 < -kMaxOffsetMs) {
+        error = "time.base_offset_s must be an offset in seconds within +-14h";
+        return false;
+    }
+    fixed_ = true;
+    base_s_.store(v, std::memory_order_release);
+    known_.store(true, std::memory_order_release);
+    return true;
+}
+
+void ServerClock::observe(int64_t server_msc, int64_t recv_ns) {
+    const int64_t recv_ms = floor_div(recv_ns, 1000000);
+    const DstRule rule = static_cast<DstRule>(rule_.load(std::memory_order_acquire));
+    const int64_t shift_ms = dst_active(rule, recv_ms / 1000) ? 3600000 : 0;
+    const int64_t raw = server_msc - recv_ms - shift_ms;
+    // Ticks older than any possible offset are history, not a clock sample.
+    if (raw > kMaxOffsetMs + kStepMs || raw < -kMaxOffsetMs - kStepMs)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++samples_;
+    while (!window_.empty() && window_.back().raw_ms <= raw)
+        window_.pop_back();
+    window_.push_back({recv_ms, raw});
+    while (window_.front().recv_ms < recv_ms - window_ms_)
+        window_.pop_front();
+
+    const int64_t best = window_.front().raw_ms;
+    const int64_t candidate = round_to_step(best);
+    const int64_t base_ms = base_s_.load(std::memory_order_relaxed) * 1000;
+
+    if (known_.load(std::memory_order_relaxed)) {
+        const int64_t lag = base_ms - raw;
+        if (lag >= 0 && (min_lag_ms_ < 0 || lag < min_lag_ms_))
+            min_lag_ms_ = lag;
+    }
+    if (fixed_)
+        return;
+
+    if (!known_.load(std::memory_order_relaxed) || candidate > base_ms) {
+        base_s_.store(candidate / 1000, std::memory_order_release);
+        known_.store(true, std::memory_order_release);
+        below_since_ms_ = -1;
+        min_lag_ms_ = -1;
+    } else if (candidate < base_ms) {
+        if (below_since_ms_ < 0)
+            below_since_ms_ = recv_ms;
+        else if (recv_ms - below_since_ms_ >= window_ms_) {
+            base_s_.store(candidate / 1000, std::memory_order_release);
+            below_since_ms_ = -1;
+            min_lag_ms_ = -1;
+        }
+    } else {
+        below_since_ms_ = -1;
+    }
+}
+
+int64_t ServerClock::offset_at_utc(int64_t utc_s) const {
+    const DstRule rule = static_cast<DstRule>(rule_.load(std::memory_order_acquire));
+    return base_s_.load(std::memory_order_acquire) + (dst_active(rule, utc_s) ? 3600 : 0);
+}
+
+int64_t ServerClock::server_to_utc(int64_t server_s) const {
+    int64_t lo, hi, offset;
+    segment(server_s, lo, hi, offset);
+    return server_s - offset;
+}
+
+void ServerClock::segment(int64_t server_s, int64_t &lo, int64_t &hi,
+                          int64_t &offset) const {
+    const DstRule rule = static_cast<DstRule>(rule_.load(std::memory_order_acquire));
+    const int64_t base = base_s_.load(std::memory_order_acquire);
+    if (rule == DstRule::None) {
+        lo = INT64_MIN;
+        hi = INT64_MAX;
+        offset = base;
+        return;
+    }
+
+    // Server time s is summer time iff s - base - 1h falls in the UTC
+    // summer interval. In the repeated autumn hour this prefers summer
+    // time; times in the skipped spring hour use standard time.
+    const int64_t y = year_of(floor_div(server_s - base, kDay));
+    int64_t start, end;
+    dst_bounds(rule, y, start, end);
+    const int64_t dst_lo = start + base + 3600;
+    const int64_t dst_hi = end + base + 3600;
+    if (server_s >= dst_lo && server_s < dst_hi) {
+        lo = dst_lo;
+        hi = dst_hi;
+        offset = base + 3600;
+    } else if (server_s < dst_lo) {
+        lo = days_from_civil(y, 1, 1) * kDay + base;
+        hi = dst_lo;
+        offset = base;
+    } else {
+        lo = dst_hi;
+        hi = days_from_civil(y + 1, 1, 1) * kDay + base;
+        offset = base;
+    }
+}
+
+bool ServerClock::to_utc_ns(const void *base, size_t stride, size_t n, int64_t unit_ns,
+                            int64_t *out) const {
+    if (!known())
+        return false;
+
+    const unsigned char *p = static_cast<const unsigned char *>(base);
+    auto at = [p, stride](size_t i) {
+        int64_t v;
+        std::memcpy(&v, p + i * stride, sizeof v);
+        return v;
+    };
+    const int64_t per_s = 1000000000 / unit_ns;
+
+    size_t i = 0;
+    while (i < n) {
+        int64_t lo, hi, offset;
+        segment(floor_div(at(i), per_s), lo, hi, offset);
+        // Convert the bounds to input units once so the run scan and the
+        // conversion loop stay branch-free per element.
+        const int64_t lo_u = lo == INT64_MIN ? INT64_MIN : lo * per_s;
+        const int64_t hi_u = hi == INT64_MAX ? INT64_MAX : hi * per_s;
+        size_t j = i;
+        while (j < n) {
+            const int64_t t = at(j);
+            if (t < lo_u || t >= hi_u)
+                break;
+            ++j;
+        }
+        const int64_t off_ns = offset * 1000000000;
+        if (stride == sizeof(int64_t)) {
+            const int64_t *src = static_cast<const int64_t *>(base);
+            for (size_t k = i; k < j; ++k)
+                out[k] = src[k] * unit_ns - off_ns;
+        } else {
+            for (size_t k = i; k < j; ++k)
+                out[k] = at(k) * unit_ns - off_ns;
+        }
+        i = j;
+    }
+    return true;
+}
+
+json_t *ServerClock::to_json() const {
+    static const char *const kRuleNames[] = {"none", "eu", "us"};
+    const int rule = rule_.load(std::memory_order_acquire);
+    const int64_t now_s = floor_div(now_ns(), 1000000000);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *obj = json_object();
+    json_object_set_new(obj, "known", json_boolean(known()));
+    json_object_set_new(obj, "base_offset_s", json_integer(base_s_.load()));
+    bool summer = dst_active(static_cast<DstRule>(rule), now_s);
+    json_object_set_new(obj, "offset_s", json_integer(base_s_.load() + (summer ? 3600 : 0)));
+    json_object_set_new(obj, "dst_rule", json_string(kRuleNames[rule]));
+    json_object_set_new(obj, "dst_active", json_boolean(summer));
+    json_object_set_new(obj, "fixed", json_boolean(fixed_));
+    json_object_set_new(obj, "samples", json_integer(static_cast<json_int_t>(samples_)));
+    json_object_set_new(obj, "min_lag_ms", min_lag_ms_ < 0 ? json_null() : json_integer(min_lag_ms_));
+    return obj;
+}
+
+} // namespace mt5bridge
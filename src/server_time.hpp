@@ -0,0 +1,101 @@
+/*
+ * server_time.hpp
+ *
+ * Estimation of the broker server time offset and conversion of server
+ * timestamps to UTC.
+ *
+ * MetaTrader reports bar and tick times in broker server time. The
+ * offset is estimated from every fresh tick by comparing its time_msc
+ * with the bridge receive time (recv_ns): server - utc equals the offset
+ * minus transport delay and tick staleness, so the windowed maximum is
+ * rounded to the nearest 15 minutes. Increases are taken at once (a tick
+ * cannot come from the future); decreases need a whole window of
+ * agreeing samples so a quiet market cannot drag the offset down.
+ *
+ * Daylight saving is described by a rule ("eu" or "us" transition dates)
+ * on top of a base offset, which lets historical times on either side of
+ * a transition convert correctly.
+ */
+
+#pragma once
+
+#include <jansson.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace mt5bridge {
+
+enum class DstRule { None, Eu, Us };
+
+bool parse_dst_rule(const std::string &name, DstRule &rule);
+
+/* True if the rule's summer time is in effect at utc_s. */
+bool dst_active(DstRule rule, int64_t utc_s);
+
+/* Days since 1970-01-01 for a proleptic Gregorian date. */
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d);
+
+class ServerClock {
+public:
+    static ServerClock &instance();
+
+    /* Applies the time.* settings. base_offset is empty to estimate it,
+     * otherwise a fixed offset in seconds (e.g. "7200").
+     */
+    bool configure(const std::string &dst_rule, const std::string &base_offset,
+                   uint64_t window_s, std::string &error);
+
+    /* Feeds one tick: its server time and the bridge receive time. */
+    void observe(int64_t server_msc, int64_t recv_ns);
+
+    bool known() const { return known_.load(std::memory_order_acquire); }
+
+    /* Offset (server - UTC) in seconds in effect at utc_s. */
+    int64_t offset_at_utc(int64_t utc_s) const;
+
+    /* Converts one server time in seconds to UTC seconds. */
+    int64_t server_to_utc(int64_t server_s) const;
+
+    /* Converts n server timestamps to UTC nanoseconds. Element i is read as
+     * an int64 at base + i * stride and counted in units of unit_ns (1e9
+     * for bar times, 1e6 for time_msc). Runs of equal offset are converted
+     * in a tight loop. Returns false if the offset is not known yet.
+     */
+    bool to_utc_ns(const void *base, size_t stride, size_t n, int64_t unit_ns,
+                   int64_t *out) const;
+
+    /* Returns {"known", "offset_s", "base_offset_s", "dst_rule",
+     * "dst_active", "fixed", "samples", "min_lag_ms"}.
+     */
+    json_t *to_json() const;
+
+private:
+    ServerClock() = default;
+
+    /* Server-time interval [lo, hi) containing server_s with one offset. */
+    void segment(int64_t server_s, int64_t &lo, int64_t &hi, int64_t &offset) const;
+
+    struct Sample {
+        int64_t recv_ms;
+        int64_t raw_ms;     // server - utc, normalized to the base offset.
+    };
+
+    std::atomic<int> rule_{static_cast<int>(DstRule::None)};
+    std::atomic<int64_t> base_s_{0};
+    std::atomic<bool> known_{false};
+    bool fixed_ = false;
+
+    mutable std::mutex mutex_;
+    std::deque<Sample> window_; // Monotonic (decreasing raw_ms) window max.
+    int64_t window_ms_ = 600000;
+    int64_t below_since_ms_ = -1;
+    uint64_t samples_ = 0;
+    int64_t min_lag_ms_ = -1;
+};
+
+} // namespace mt5bridge
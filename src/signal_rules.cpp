@@ -0,0 +1,242 @@
+/*
+ * signal_rules.cpp
+ *
+ * Rule registry, shared leaf columns and edge-triggered events.
+ */
+
+#include "signal_rules.hpp"
+
+#include "market_cache.hpp"
+#include "parallel.hpp"
+#include "screener.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <unordered_map>
+
+namespace mt5bridge {
+namespace {
+
+constexpr size_t kParallelLanes = 1 << 14;  // Lanes per pass worth threads.
+
+/* Leaf column over every cached symbol, shared by the rules reading it. */
+struct LeafColumn {
+    int64_t timeframe;
+    const ExprLeaf *leaf;
+    std::vector<double> values;
+};
+
+/* Leaves share a column only if their arguments are the same doubles,
+ * so every argument is written out in full.
+ */
+std::string column_key(int64_t timeframe, const ExprLeaf &leaf) {
+    std::string key = std::to_string(timeframe) + ':' + leaf.name;
+    char arg[32];
+    for (double a : leaf.args) {
+        std::snprintf(arg, sizeof arg, ",%.17g", a);
+        key += arg;
+    }
+    return key;
+}
+
+/* A rule's leaves gathered from the shared columns for its lanes. */
+class GatheredColumns : public ExprColumns {
+public:
+    GatheredColumns(const std::vector<LeafColumn> &columns, const std::vector<size_t> &index,
+                    const std::vector<int32_t> &ids)
+        : columns_(columns), index_(index), ids_(ids) {}
+
+    void load(size_t leaf, const ExprLeaf &, size_t lanes, double *out) override {
+        const double *src = columns_[index_[leaf]].values.data();
+        if (ids_.empty()) {
+            std::copy(src, src + lanes, out);
+            return;
+        }
+        for (size_t i = 0; i < lanes; ++i)
+            out[i] = src[ids_[i]];
+    }
+
+private:
+    const std::vector<LeafColumn> &columns_;
+    const std::vector<size_t> &index_;
+    const std::vector<int32_t> &ids_;
+};
+
+} // namespace
+
+struct SignalRules::Rule {
+    int64_t id = 0;
+    RuleSpec spec;
+    std::shared_ptr<const Expression> expr;
+    std::vector<int32_t> ids;       // Lane symbols; empty = every cached symbol.
+    size_t lanes = 0;
+    std::vector<double> state;      // expr->state_size() rows of lanes values.
+    std::vector<uint8_t> truth;     // Value of each lane at the last pass.
+    uint64_t fired = 0;
+
+    /* Widens the per-lane state to lanes, keeping the existing lanes. */
+    void grow(size_t count) {
+        if (count <= lanes)
+            return;
+        const size_t rows = expr->state_size();
+        std::vector<double> next(rows * count, std::numeric_limits<double>::quiet_NaN());
+        for (size_t r = 0; r < rows; ++r)
+            std::copy_n(state.begin() + r * lanes, lanes, next.begin() + r * count);
+        state.swap(next);
+        truth.resize(count, 0);
+        lanes = count;
+    }
+};
+
+SignalRules::SignalRules() = default;
+SignalRules::~SignalRules() = default;
+
+SignalRules &SignalRules::instance() {
+    static SignalRules rules;
+    return rules;
+}
+
+bool SignalRules::add(const RuleSpec &spec, int64_t &id, std::string &error) {
+    auto rule = std::make_unique<Rule>();
+    rule->spec = spec;
+    rule->expr = Expression::compile(spec.rule, market_leaf_check, error);
+    if (!rule->expr)
+        return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rules_.size() >= kMaxRules) {
+        error = "too many rules (" + std::to_string(kMaxRules) + ")";
+        return false;
+    }
+    auto &cache = MarketCache::instance();
+    for (const std::string &symbol : spec.symbols) {
+        const int32_t sid = cache.add(symbol.c_str());
+        if (sid < 0) {
+            error = "market cache is full (cache.max_symbols), cannot add " + symbol;
+            return false;
+        }
+        rule->ids.push_back(sid);
+    }
+    if (!rule->ids.empty())
+        rule->grow(rule->ids.size());
+    rule->id = id = next_id_++;
+    rules_.emplace(id, std::move(rule));
+    return true;
+}
+
+bool SignalRules::remove(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rules_.erase(id) != 0;
+}
+
+RulePass SignalRules::evaluate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RulePass pass;
+    pass.rules = rules_.size();
+    if (rules_.empty())
+        return pass;
+    std::vector<Rule *> rules;
+    rules.reserve(rules_.size());
+    for (auto &entry : rules_)
+        rules.push_back(entry.second.get());
+    std::vector<std::vector<RuleEvent>> events(rules.size());
+
+    MarketCache::instance().read([&](const QuoteColumns &quotes, const BarLookup &bars) {
+        // One column per distinct (timeframe, leaf) across all rules.
+        std::vector<LeafColumn> columns;
+        std::unordered_map<std::string, size_t> by_key;
+        std::vector<std::vector<size_t>> index(rules.size());
+        for (size_t r = 0; r < rules.size(); ++r) {
+            const Rule &rule = *rules[r];
+            for (const ExprLeaf &leaf : rule.expr->leaves()) {
+                const auto ins =
+                    by_key.emplace(column_key(rule.spec.timeframe, leaf), columns.size());
+                if (ins.second)
+                    columns.push_back({rule.spec.timeframe, &leaf, {}});
+                index[r].push_back(ins.first->second);
+            }
+            pass.lanes += rule.ids.empty() ? quotes.count : rule.ids.size();
+        }
+        pass.columns = columns.size();
+
+        const size_t load = columns.size() * quotes.count;
+        parallel_for(columns.size(), load >= kParallelLanes ? worker_count(columns.size()) : 1,
+                     [&](size_t c, unsigned) {
+                         LeafColumn &column = columns[c];
+                         column.values.resize(quotes.count);
+                         MarketColumns market(quotes, bars, column.timeframe);
+                         market.load(0, *column.leaf, quotes.count, column.values.data());
+                     });
+
+        parallel_for(rules.size(), pass.lanes >= kParallelLanes ? worker_count(rules.size()) : 1,
+                     [&](size_t r, unsigned) {
+                         Rule &rule = *rules[r];
+                         const size_t lanes = rule.ids.empty() ? quotes.count : rule.ids.size();
+                         if (lanes == 0)
+                             return;
+                         rule.grow(lanes);
+                         thread_local std::vector<double> values;
+                         values.resize(lanes);
+                         GatheredColumns gathered(columns, index[r], rule.ids);
+                         rule.expr->evaluate(gathered, lanes, values.data(), rule.state.data());
+                         for (size_t i = 0; i < lanes; ++i) {
+                             const uint8_t now = Expression::truthy(values[i]) ? 1 : 0;
+                             if (now && !rule.truth[i]) {
+                                 const int32_t sid =
+                                     rule.ids.empty() ? static_cast<int32_t>(i) : rule.ids[i];
+                                 events[r].push_back({rule.id, quotes.time_msc[sid], sid});
+                             }
+                             rule.truth[i] = now;
+                         }
+                         rule.fired += events[r].size();
+                     });
+    });
+
+    std::lock_guard<std::mutex> events_lock(events_mutex_);
+    for (const auto &fired : events) {
+        for (const RuleEvent &e : fired) {
+            if (pending_.size() >= kMaxPending) {
+                pending_.pop_front();
+                ++dropped_;
+            }
+            pending_.push_back(e);
+        }
+        pass.fired += fired.size();
+    }
+    return pass;
+}
+
+size_t SignalRules::take(RuleEvent *out, size_t capacity) {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    const size_t n = std::min(capacity, pending_.size());
+    std::copy_n(pending_.begin(), n, out);
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(n));
+    return n;
+}
+
+uint64_t SignalRules::dropped() const {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    return dropped_;
+}
+
+json_t *SignalRules::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &entry : rules_) {
+        const Rule &rule = *entry.second;
+        json_t *symbols = json_null();
+        if (!rule.spec.symbols.empty()) {
+            symbols = json_array();
+            for (const std::string &s : rule.spec.symbols)
+                json_array_append_new(symbols, json_string(s.c_str()));
+        }
+        json_array_append_new(
+            out, json_pack("{s:I, s:s, s:I, s:o, s:I}", "id", static_cast<json_int_t>(rule.id),
+                           "rule", rule.spec.rule.c_str(), "timeframe",
+                           static_cast<json_int_t>(rule.spec.timeframe), "symbols", symbols,
+                           "fired", static_cast<json_int_t>(rule.fired)));
+    }
+    return out;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,107 @@
+/*
+ * signal_rules.hpp
+ *
+ * Signal rules evaluated inside the bridge over the market cache.
+ *
+ * A rule is an expression (expression.hpp) over the screener's leaves
+ * (screener.hpp), e.g. "crosses_above(ema(12), ema(26)) and spread <
+ * 0.0003", registered for a list of symbols (or every cached symbol) and
+ * a bar timeframe. A rule fires for a symbol when it turns true there: an
+ * event is queued on the evaluation where its value goes from false (or
+ * unknown) to true, and it fires again only after turning false.
+ *
+ * evaluate() runs every rule once, typically once per polling cycle after
+ * the cycle's ticks and bars went through the cache. A pass first loads
+ * each distinct (timeframe, leaf) of all rules once as a column over the
+ * whole cache, so a thousand rules reading ema(20) compute it once per
+ * symbol; then each rule runs its program over its own symbols, the
+ * leaves gathered from those columns. Both steps run on threads.workers
+ * threads once a pass is large enough to pay for them. Crossings keep
+ * their previous values per rule and symbol between passes.
+ *
+ * Events wait in a queue of kMaxPending until take() drains them; when
+ * it is full the oldest are dropped and counted.
+ */
+
+#pragma once
+
+#include "expression.hpp"
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mt5bridge {
+
+struct RuleSpec {
+    std::string rule;
+    std::vector<std::string> symbols;   // Empty = every cached symbol.
+    int64_t timeframe = kTimeframeM1;   // Bars the bar leaves read.
+};
+
+struct RuleEvent {
+    int64_t rule = 0;
+    int64_t time_msc = 0;   // Time of the symbol's cached quote, 0 if none.
+    int32_t symbol = 0;     // Market cache id.
+};
+
+struct RulePass {
+    size_t rules = 0;
+    size_t lanes = 0;       // (rule, symbol) pairs evaluated.
+    size_t columns = 0;     // Distinct leaf columns loaded.
+    size_t fired = 0;
+};
+
+class SignalRules {
+public:
+    static constexpr size_t kMaxRules = 65536;
+    static constexpr size_t kMaxPending = 1 << 20;
+
+    static SignalRules &instance();
+
+    /* Compiles and registers a rule; its symbols enter the market cache.
+     * False with error if the rule does not compile, the cache is full
+     * or kMaxRules exist.
+     */
+    bool add(const RuleSpec &spec, int64_t &id, std::string &error);
+
+    /* False if id is unknown. */
+    bool remove(int64_t id);
+
+    /* Evaluates every rule and queues the events that fired. */
+    RulePass evaluate();
+
+    /* Moves up to capacity queued events, oldest first, to out. */
+    size_t take(RuleEvent *out, size_t capacity);
+
+    /* Events dropped from the full queue so far. */
+    uint64_t dropped() const;
+
+    /* Returns [{"id", "rule", "timeframe", "symbols", "fired"}, ...];
+     * symbols is null for a rule over every cached symbol.
+     */
+    json_t *to_json() const;
+
+private:
+    struct Rule;
+
+    SignalRules();
+    ~SignalRules();
+
+    mutable std::mutex mutex_;          // Rules; held for a whole pass.
+    int64_t next_id_ = 1;
+    std::map<int64_t, std::unique_ptr<Rule>> rules_;
+    mutable std::mutex events_mutex_;   // Queue, so take() never waits for a pass.
+    std::deque<RuleEvent> pending_;
+    uint64_t dropped_ = 0;
+};
+
+} // namespace mt5bridge
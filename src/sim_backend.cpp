@@ -0,0 +1,450 @@
+/*
+ * sim_backend.cpp
+ *
+ * Synthetic price paths, tick grids, bar aggregation and the fill model.
+ */
+
+#include "sim_backend.hpp"
+#include "clock.hpp"
+#include "responses.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+// MetaTrader5 trade constants.
+constexpr long long kActionDeal = 1;        // TRADE_ACTION_DEAL
+constexpr long long kOrderBuy = 0;          // ORDER_TYPE_BUY
+constexpr long long kOrderSell = 1;         // ORDER_TYPE_SELL
+constexpr int kRetcodeRequote = 10004;
+constexpr int kRetcodeDone = 10009;
+constexpr int kRetcodeInvalid = 10013;
+constexpr int kRetcodeInvalidVolume = 10014;
+constexpr long long kCopyTicksTrade = 2;    // COPY_TICKS_TRADE
+
+constexpr double kVolumeMin = 0.01;
+constexpr double kVolumeMax = 100.0;
+constexpr double kVolumeStep = 0.01;
+
+constexpr int64_t kNsPerSec = 1000000000;
+
+/* Noise periods of the price path, in seconds. */
+constexpr int64_t kPeriods[] = {7 * 86400, 86400, 4 * 3600, 3600, 900, 60, 10, 1};
+constexpr size_t kLevels = sizeof kPeriods / sizeof kPeriods[0];
+
+/* Bars wider than this many ticks take their extremes from a sample. */
+constexpr int64_t kBarSamples = 64;
+
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash(uint64_t key, uint64_t stream, int64_t i) {
+    return mix(key ^ mix(stream * 0xD6E8FEB86659FD93ull + static_cast<uint64_t>(i)));
+}
+
+/* Uniform in [0, 1). */
+double unit(uint64_t h) { return static_cast<double>(h >> 11) * 0x1.0p-53; }
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+int64_t ceil_div(int64_t a, int64_t b) { return -floor_div(-a, b); }
+
+double round_to(double price, double point) { return std::nearbyint(price / point) * point; }
+
+json_t *unknown_symbol(const char *call, const char *name, std::string &error) {
+    error = std::string(call) + " failed: unknown symbol " + name;
+    return json_null();
+}
+
+} // namespace
+
+const SimBackend::Method SimBackend::kMethods[] = {
+    {"get_m1_bars", &SimBackend::handle_get_m1_bars},
+    {"copy_rates_from_pos", &SimBackend::handle_copy_rates_from_pos},
+    {"copy_ticks_from", &SimBackend::handle_copy_ticks_from},
+    {"symbol_info_tick", &SimBackend::handle_symbol_info_tick},
+    {"symbol_info", &SimBackend::handle_symbol_info},
+    {"open_market_buy", &SimBackend::handle_open_market_buy},
+    {"order_send", &SimBackend::handle_order_send},
+};
+
+std::unique_ptr<SimBackend> SimBackend::create(const Config &cfg, std::string &error) {
+    if (cfg.sim_symbols == 0 || cfg.sim_tick_rate == 0) {
+        error = "backend=sim requires sim.symbols and sim.tick_rate above zero";
+        return nullptr;
+    }
+    return std::unique_ptr<SimBackend>(new SimBackend(cfg));
+}
+
+SimBackend::SimBackend(const Config &cfg)
+    : seed_(cfg.sim_seed),
+      volatility_(cfg.sim_volatility),
+      spread_points_(static_cast<int>(cfg.sim_spread_points)),
+      slippage_points_(static_cast<int64_t>(cfg.sim_slippage_points)),
+      fill_latency_us_(static_cast<int64_t>(cfg.sim_fill_latency_us)) {
+    const double interval = static_cast<double>(cfg.sim_symbols) * kNsPerSec /
+                            static_cast<double>(cfg.sim_tick_rate);
+    interval_ns_ = std::max<int64_t>(1, std::llround(interval));
+
+    int width = 4;
+    for (uint64_t n = cfg.sim_symbols - 1; n >= 10000; n /= 10)
+        ++width;
+    symbols_.reserve(cfg.sim_symbols);
+    for (uint64_t i = 0; i < cfg.sim_symbols; ++i) {
+        char name[32];
+        std::snprintf(name, sizeof name, "SIM%0*llu", width, static_cast<unsigned long long>(i));
+        Symbol sym;
+        sym.name = name;
+        sym.key = mix(seed_ ^ mix(i + 1));
+        // Every fourth symbol is priced like an equity index, the rest
+        // like FX majors.
+        if (i % 4 == 3) {
+            sym.digits = 2;
+            sym.base = 50.0 + 450.0 * unit(hash(sym.key, 1, 0));
+        } else {
+            sym.digits = 5;
+            sym.base = 0.5 + 1.5 * unit(hash(sym.key, 1, 0));
+        }
+        sym.point = std::pow(10.0, -sym.digits);
+        sym.base = round_to(sym.base, sym.point);
+        sym.phase_ns = static_cast<int64_t>(unit(hash(sym.key, 2, 0)) * static_cast<double>(interval_ns_));
+        by_name_.emplace(sym.name, symbols_.size());
+        symbols_.push_back(std::move(sym));
+    }
+}
+
+json_t *SimBackend::eval(const char *method, const json_t *request, std::string &error) {
+    for (const auto &m : kMethods)
+        if (std::strcmp(m.name, method) == 0)
+            return (this->*m.fn)(request, error);
+    error = "unknown method";
+    return nullptr;
+}
+
+bool SimBackend::serves(const char *method) const {
+    for (const auto &m : kMethods)
+        if (std::strcmp(m.name, method) == 0)
+            return true;
+    return false;
+}
+
+const SimBackend::Symbol *SimBackend::find(const char *name) const {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? nullptr : &symbols_[it->second];
+}
+
+double SimBackend::path(const Symbol &sym, int64_t t_ns) const {
+    static const auto scale = [] {
+        // Random-walk scaling per level; sqrt(3) gives the uniform knots
+        // unit variance.
+        std::array<double, kLevels> s{};
+        for (size_t l = 0; l < kLevels; ++l)
+            s[l] = std::sqrt(3.0 * static_cast<double>(kPeriods[l]) / 86400.0);
+        return s;
+    }();
+
+    double x = 0.0;
+    for (size_t l = 0; l < kLevels; ++l) {
+        const int64_t period_ns = kPeriods[l] * kNsPerSec;
+        const int64_t i = floor_div(t_ns, period_ns);
+        const double f = static_cast<double>(t_ns - i * period_ns) / static_cast<double>(period_ns);
+        const double v0 = 2.0 * unit(hash(sym.key, 16 + l, i)) - 1.0;
+        const double v1 = 2.0 * unit(hash(sym.key, 16 + l, i + 1)) - 1.0;
+        x += scale[l] * (v0 + (v1 - v0) * f * f * (3.0 - 2.0 * f));
+    }
+    return volatility_ * x;
+}
+
+Tick SimBackend::tick_at(const Symbol &sym, int64_t k, int64_t recv_ns) const {
+    const int64_t t_ns = k * interval_ns_ + sym.phase_ns;
+    const uint64_t h = hash(sym.key, 3, k);
+    // One point of quote noise on top of the path, and a spread that
+    // widens by up to three points.
+    const double mid = sym.base * std::exp(path(sym, t_ns)) + (unit(h) - 0.5) * 2.0 * sym.point;
+    Tick tick{};
+    tick.time_msc = floor_div(t_ns, 1000000);
+    tick.bid = round_to(mid, sym.point);
+    tick.ask = round_to(tick.bid + (spread_points_ + static_cast<int>(h >> 62)) * sym.point, sym.point);
+    tick.recv_ns = recv_ns;
+    return tick;
+}
+
+int64_t SimBackend::last_tick_index(const Symbol &sym, int64_t t_ns) const {
+    return floor_div(t_ns - sym.phase_ns, interval_ns_);
+}
+
+Tick SimBackend::quote(const Symbol &sym, int64_t t_ns) const {
+    const int64_t k = last_tick_index(sym, t_ns);
+    if (k < 0)
+        return Tick{};
+    Tick tick = tick_at(sym, k, t_ns);
+    tick.flags = kTickFlagBid | kTickFlagAsk;
+    return tick;
+}
+
+json_t *SimBackend::handle_copy_ticks_from(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    long long date_from = 0, count = 0;
+    long long flags = -1; // COPY_TICKS_ALL
+    if (!name || !req_int(request, "date_from", date_from) || !req_int(request, "count", count)) {
+        error = "copy_ticks_from requires symbol, date_from and count";
+        return nullptr;
+    }
+    req_int(request, "flags", flags);
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("copy_ticks_from", name, error);
+
+    const int64_t now = now_ns();
+    std::vector<Tick> ticks;
+    // Only quote ticks are simulated; there are no trade ticks to copy.
+    if (flags != kCopyTicksTrade && count > 0) {
+        const int64_t first = std::max<int64_t>(
+            0, ceil_div(date_from * kNsPerSec - sym->phase_ns, interval_ns_));
+        const int64_t last = last_tick_index(*sym, now);
+        const int64_t n = std::min<int64_t>(count, last - first + 1);
+        if (n > 0) {
+            ticks.reserve(static_cast<size_t>(n));
+            Tick prev = first > 0 ? tick_at(*sym, first - 1, now) : Tick{};
+            for (int64_t k = first; k < first + n; ++k) {
+                Tick tick = tick_at(*sym, k, now);
+                tick.flags = (tick.bid != prev.bid ? uint32_t{kTickFlagBid} : 0u) |
+                             (tick.ask != prev.ask ? uint32_t{kTickFlagAsk} : 0u);
+                if (tick.flags == 0) // Noise landed on the same quote.
+                    tick.flags = kTickFlagBid | kTickFlagAsk;
+                prev = tick;
+                ticks.push_back(tick);
+            }
+        }
+    }
+    return ticks_response(ticks, request, error);
+}
+
+json_t *SimBackend::copy_rates(const Symbol &sym, int64_t timeframe, int64_t start,
+                               int64_t count, const json_t *request,
+                               std::string &error) const {
+    const int64_t period = timeframe_seconds(timeframe);
+    if (period == 0) {
+        error = "copy_rates_from_pos failed: unsupported timeframe " + std::to_string(timeframe);
+        return json_null();
+    }
+
+    const int64_t now = now_ns();
+    const int64_t current = bar_open_time(floor_div(now, kNsPerSec), period);
+    std::vector<Bar> bars;
+    bars.reserve(static_cast<size_t>(std::max<int64_t>(0, std::min<int64_t>(count, 1 << 20))));
+    for (int64_t pos = start; pos < start + count; ++pos) {
+        const int64_t open_s = current - pos * period;
+        if (open_s < 0)
+            break;
+        const int64_t first = std::max<int64_t>(
+            0, ceil_div(open_s * kNsPerSec - sym.phase_ns, interval_ns_));
+        const int64_t last = last_tick_index(sym, std::min(now, (open_s + period) * kNsPerSec - 1));
+        if (last < first)
+            continue; // No ticks, no bar.
+
+        Bar bar{};
+        bar.time = open_s;
+        bar.open = tick_at(sym, first, now).bid;
+        bar.close = tick_at(sym, last, now).bid;
+        bar.high = std::max(bar.open, bar.close);
+        bar.low = std::min(bar.open, bar.close);
+        const int64_t n = last - first + 1;
+        const int64_t samples = std::min(n, kBarSamples);
+        for (int64_t s = 1; s + 1 < samples; ++s) {
+            const double bid = tick_at(sym, first + s * (n - 1) / (samples - 1), now).bid;
+            bar.high = std::max(bar.high, bid);
+            bar.low = std::min(bar.low, bid);
+        }
+        bar.tick_volume = static_cast<uint64_t>(n);
+        bar.spread = spread_points_;
+        bar.recv_ns = now;
+        bars.push_back(bar);
+    }
+    std::reverse(bars.begin(), bars.end()); // Oldest first, as MetaTrader returns them.
+    return bars_response(bars, request, error);
+}
+
+json_t *SimBackend::handle_copy_rates_from_pos(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    long long timeframe = 0, start = 0, count = 0;
+    if (!name || !req_int(request, "timeframe", timeframe) || !req_int(request, "count", count)) {
+        error = "copy_rates_from_pos requires symbol, timeframe and count";
+        return nullptr;
+    }
+    req_int(request, "start", start);
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("copy_rates_from_pos", name, error);
+    return copy_rates(*sym, timeframe, start, count, request, error);
+}
+
+json_t *SimBackend::handle_get_m1_bars(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    long long count = 0;
+    if (!name || !req_int(request, "count", count)) {
+        error = "get_m1_bars requires symbol and count";
+        return nullptr;
+    }
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("copy_rates_from_pos", name, error);
+    return copy_rates(*sym, kTimeframeM1, 0, count, request, error);
+}
+
+json_t *SimBackend::handle_symbol_info_tick(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    if (!name) {
+        error = "symbol_info_tick requires symbol";
+        return nullptr;
+    }
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("symbol_info_tick", name, error);
+    return tick_response(quote(*sym, now_ns()), request, error);
+}
+
+json_t *SimBackend::handle_symbol_info(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    if (!name) {
+        error = "symbol_info requires symbol";
+        return nullptr;
+    }
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("symbol_info", name, error);
+
+    const Tick tick = quote(*sym, now_ns());
+    const bool index = sym->digits == 2;
+    json_t *obj = json_object();
+    json_object_set_new(obj, "name", json_string(sym->name.c_str()));
+    json_object_set_new(obj, "description", json_string("Synthetic symbol"));
+    json_object_set_new(obj, "path", json_string(("Synthetic\\" + sym->name).c_str()));
+    json_object_set_new(obj, "currency_base", json_string(index ? "USD" : "SIM"));
+    json_object_set_new(obj, "currency_profit", json_string("USD"));
+    json_object_set_new(obj, "currency_margin", json_string(index ? "USD" : "SIM"));
+    json_object_set_new(obj, "digits", json_integer(sym->digits));
+    json_object_set_new(obj, "point", json_real(sym->point));
+    json_object_set_new(obj, "spread", json_integer(spread_points_));
+    json_object_set_new(obj, "spread_float", json_true());
+    json_object_set_new(obj, "trade_contract_size", json_real(index ? 1.0 : 100000.0));
+    json_object_set_new(obj, "trade_tick_size", json_real(sym->point));
+    json_object_set_new(obj, "trade_mode", json_integer(4)); // SYMBOL_TRADE_MODE_FULL
+    json_object_set_new(obj, "volume_min", json_real(kVolumeMin));
+    json_object_set_new(obj, "volume_max", json_real(kVolumeMax));
+    json_object_set_new(obj, "volume_step", json_real(kVolumeStep));
+    json_object_set_new(obj, "visible", json_true());
+    json_object_set_new(obj, "select", json_true());
+    json_object_set_new(obj, "time", json_integer(floor_div(tick.time_msc, 1000)));
+    json_object_set_new(obj, "bid", json_real(tick.bid));
+    json_object_set_new(obj, "ask", json_real(tick.ask));
+    return obj;
+}
+
+json_t *SimBackend::handle_order_send(const json_t *request, std::string &error) {
+    json_t *trade = json_object_get(request, "request");
+    if (!json_is_object(trade)) {
+        error = "order_send requires a request object";
+        return nullptr;
+    }
+    return fill(trade, error);
+}
+
+json_t *SimBackend::handle_open_market_buy(const json_t *request, std::string &error) {
+    const char *name = req_string(request, "symbol");
+    double volume = 0;
+    if (!name || !req_number(request, "volume", volume)) {
+        error = "open_market_buy requires symbol and volume";
+        return nullptr;
+    }
+    json_t *trade = json_pack("{s:I, s:s, s:f, s:I}", "action", kActionDeal, "symbol", name,
+                              "volume", volume, "type", kOrderBuy);
+    json_t *out = fill(trade, error);
+    json_decref(trade);
+    return out;
+}
+
+json_t *SimBackend::fill(const json_t *trade, std::string &error) {
+    const char *name = req_string(trade, "symbol");
+    if (!name) {
+        error = "order_send requires request.symbol";
+        return nullptr;
+    }
+    const Symbol *sym = find(name);
+    if (!sym)
+        return unknown_symbol("order_send", name, error);
+
+    long long action = 0, type = -1, deviation = -1;
+    double volume = 0, price = 0;
+    req_int(trade, "action", action);
+    req_int(trade, "type", type);
+    req_int(trade, "deviation", deviation);
+    req_number(trade, "volume", volume);
+    req_number(trade, "price", price);
+
+    int retcode = kRetcodeDone;
+    const char *comment = "Request executed";
+    const double steps = volume / kVolumeStep;
+    if (action != kActionDeal || (type != kOrderBuy && type != kOrderSell)) {
+        retcode = kRetcodeInvalid;
+        comment = "Invalid request";
+    } else if (volume < kVolumeMin - 1e-9 || volume > kVolumeMax + 1e-9 ||
+               std::fabs(steps - std::nearbyint(steps)) > 1e-6) {
+        retcode = kRetcodeInvalidVolume;
+        comment = "Invalid volume";
+    }
+
+    if (retcode == kRetcodeDone && fill_latency_us_ > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(fill_latency_us_));
+    const Tick tick = quote(*sym, now_ns());
+    const uint64_t ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+
+    double fill_price = 0;
+    if (retcode == kRetcodeDone) {
+        const int64_t slip = slippage_points_ > 0
+            ? static_cast<int64_t>(hash(seed_, 4, static_cast<int64_t>(ticket)) %
+                                   static_cast<uint64_t>(slippage_points_ + 1))
+            : 0;
+        fill_price = type == kOrderBuy ? tick.ask + slip * sym->point
+                                       : tick.bid - slip * sym->point;
+        fill_price = round_to(fill_price, sym->point);
+        if (price > 0 && deviation >= 0 &&
+            std::fabs(fill_price - price) > (static_cast<double>(deviation) + 0.5) * sym->point) {
+            retcode = kRetcodeRequote;
+            comment = "Requote";
+            fill_price = 0;
+        }
+    }
+    const bool done = retcode == kRetcodeDone;
+
+    json_t *out = json_object();
+    json_object_set_new(out, "retcode", json_integer(retcode));
+    json_object_set_new(out, "deal", json_integer(done ? static_cast<json_int_t>(ticket) : 0));
+    json_object_set_new(out, "order", json_integer(done ? static_cast<json_int_t>(ticket) : 0));
+    json_object_set_new(out, "volume", json_real(done ? volume : 0.0));
+    json_object_set_new(out, "price", json_real(fill_price));
+    json_object_set_new(out, "bid", json_real(tick.bid));
+    json_object_set_new(out, "ask", json_real(tick.ask));
+    json_object_set_new(out, "comment", json_string(comment));
+    json_object_set_new(out, "request_id", json_integer(static_cast<json_int_t>(ticket)));
+    json_object_set_new(out, "retcode_external", json_integer(0));
+    json_object_set_new(out, "request", json_deep_copy(trade));
+    json_object_set_new(out, "recv_ns", json_integer(now_ns()));
+    return out;
+}
+
+} // namespace mt5bridge
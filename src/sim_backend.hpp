@@ -0,0 +1,95 @@
+/*
+ * sim_backend.hpp
+ *
+ * Synthetic market backend for load testing without MetaTrader.
+ *
+ * Serves the bridge method set for sim.symbols symbols named SIM0000,
+ * SIM0001, ... Each symbol ticks on a fixed grid so that sim.tick_rate
+ * ticks per second are produced across all of them, up to the current
+ * time. Prices are a pure function of (seed, symbol, time): a sum of
+ * smoothed hashed noise at periods from one week to one second, scaled
+ * like a random walk with sim.volatility daily deviation. Any window of
+ * history can therefore be generated on demand, in any order, and two
+ * runs with the same seed see the same market.
+ *
+ * Market orders fill at the quote current when the fill happens, after
+ * sim.fill_latency_us, moved against the trader by up to
+ * sim.slippage_points. Orders whose fill is further than the request's
+ * deviation from its price are requoted.
+ */
+
+#pragma once
+
+#include "backend.hpp"
+#include "market_data.hpp"
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+class SimBackend : public Backend {
+public:
+    static std::unique_ptr<SimBackend> create(const Config &cfg, std::string &error);
+
+    const char *name() const override { return "sim"; }
+    json_t *eval(const char *method, const json_t *request, std::string &error) override;
+    bool serves(const char *method) const override;
+
+private:
+    struct Symbol {
+        std::string name;
+        uint64_t key;           // Hash seed of the symbol's price path.
+        int digits;
+        double point;
+        double base;            // Price level around which the path moves.
+        int64_t phase_ns;       // Offset of the symbol's tick grid.
+    };
+
+    explicit SimBackend(const Config &cfg);
+
+    const Symbol *find(const char *name) const;
+
+    /* Log-price deviation from the base at time t_ns. */
+    double path(const Symbol &sym, int64_t t_ns) const;
+
+    /* The k-th tick of the symbol's grid; flags are left to the caller. */
+    Tick tick_at(const Symbol &sym, int64_t k, int64_t recv_ns) const;
+
+    /* Index of the last tick at or before t_ns. */
+    int64_t last_tick_index(const Symbol &sym, int64_t t_ns) const;
+
+    /* The latest tick at t_ns, or a zero tick before the first one. */
+    Tick quote(const Symbol &sym, int64_t t_ns) const;
+
+    json_t *copy_rates(const Symbol &sym, int64_t timeframe, int64_t start, int64_t count,
+                       const json_t *request, std::string &error) const;
+    json_t *handle_copy_ticks_from(const json_t *request, std::string &error);
+    json_t *handle_copy_rates_from_pos(const json_t *request, std::string &error);
+    json_t *handle_get_m1_bars(const json_t *request, std::string &error);
+    json_t *handle_symbol_info_tick(const json_t *request, std::string &error);
+    json_t *handle_symbol_info(const json_t *request, std::string &error);
+    json_t *handle_order_send(const json_t *request, std::string &error);
+    json_t *handle_open_market_buy(const json_t *request, std::string &error);
+
+    json_t *fill(const json_t *trade, std::string &error);
+
+    struct Method {
+        const char *name;
+        json_t *(SimBackend::*fn)(const json_t *request, std::string &error);
+    };
+    static const Method kMethods[];
+
+    std::vector<Symbol> symbols_;
+    std::unordered_map<std::string, size_t> by_name_;
+    uint64_t seed_;
+    int64_t interval_ns_;       // Tick spacing of one symbol.
+    double volatility_;
+    int spread_points_;
+    int64_t slippage_points_;
+    int64_t fill_latency_us_;
+    std::atomic<uint64_t> next_ticket_{1};
+};
+
+} // namespace mt5bridge
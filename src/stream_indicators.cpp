@@ -0,0 +1,423 @@
+/*
+ * stream_indicators.cpp
+ *
+ * O(1) indicator updates and their sequence-locked publication.
+ */
+
+#include "stream_indicators.hpp"
+
+#include "indicators.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace mt5bridge {
+namespace {
+
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+constexpr uint64_t kMaxPeriod = 1u << 24;
+
+enum class Kind { Ema, Variance, Stddev, Min, Max, Vwap };
+enum class Field { Open, High, Low, Close, Bid, Ask, Last, Mid };
+
+struct KindName {
+    const char *name;
+    Kind kind;
+};
+
+const KindName kKinds[] = {
+    {"ema", Kind::Ema}, {"variance", Kind::Variance}, {"stddev", Kind::Stddev},
+    {"min", Kind::Min}, {"max", Kind::Max},           {"vwap", Kind::Vwap},
+};
+
+struct FieldName {
+    const char *name;
+    Field field;
+    bool bars;
+};
+
+const FieldName kFields[] = {
+    {"open", Field::Open, true}, {"high", Field::High, true}, {"low", Field::Low, true},
+    {"close", Field::Close, true}, {"bid", Field::Bid, false}, {"ask", Field::Ask, false},
+    {"last", Field::Last, false}, {"mid", Field::Mid, false},
+};
+
+double bar_field(const Bar &b, Field f) {
+    switch (f) {
+    case Field::Open: return b.open;
+    case Field::High: return b.high;
+    case Field::Low: return b.low;
+    default: return b.close;
+    }
+}
+
+double tick_field(const Tick &t, Field f) {
+    switch (f) {
+    case Field::Ask: return t.ask;
+    case Field::Last: return t.last;
+    case Field::Mid: return 0.5 * (t.bid + t.ask);
+    default: return t.bid;
+    }
+}
+
+} // namespace
+
+struct StreamIndicators::Slot {
+    // Published under the sequence lock: odd while an update is written.
+    std::atomic<uint64_t> seq{0};
+    std::atomic<int64_t> id{0}; // 0 = free.
+    std::atomic<double> value{kNaN};
+    std::atomic<int64_t> time_msc{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<bool> ready{false};
+
+    // Updater state, guarded by StreamIndicators::mutex_.
+    StreamSpec spec;
+    Kind kind = Kind::Ema;
+    Field field = Field::Close;
+    uint64_t generation = 0;
+    int64_t last_msc = std::numeric_limits<int64_t>::min(); // Newest sample consumed.
+    uint64_t last_seq = 0;
+    uint64_t n = 0;             // Samples consumed.
+    uint64_t since_anchor = 0;  // Window updates since the sums were recomputed.
+    double acc = 0.0;           // EMA, window mean, or price x volume sum.
+    double acc2 = 0.0;          // M2 of the window, or volume sum.
+    std::vector<double> ring;   // Window samples (vwap: price x volume).
+    std::vector<double> ring2;  // vwap: window volumes.
+    std::vector<std::pair<uint64_t, double>> deque; // min/max: (sample, value).
+    size_t dq_head = 0, dq_size = 0;
+
+    double current() const;
+    void push(double x, double w);
+    void write();
+};
+
+double StreamIndicators::Slot::current() const {
+    const uint64_t p = spec.period;
+    if (kind == Kind::Vwap)
+        return acc2 > 0.0 && (p == 0 || n >= p) ? acc / acc2 : kNaN;
+    if (n < p)
+        return kNaN;
+    switch (kind) {
+    case Kind::Ema: return acc;
+    case Kind::Variance: return std::max(acc2, 0.0) / static_cast<double>(p);
+    case Kind::Stddev: return std::sqrt(std::max(acc2, 0.0) / static_cast<double>(p));
+    default: return deque[dq_head].second;
+    }
+}
+
+void StreamIndicators::Slot::push(double x, double w) {
+    const uint64_t p = spec.period;
+    const double dp = static_cast<double>(p);
+    switch (kind) {
+    case Kind::Ema:
+        if (n < p) {
+            acc += x;
+            if (n + 1 == p)
+                acc /= dp;
+        } else {
+            acc += 2.0 / (dp + 1.0) * (x - acc);
+        }
+        break;
+    case Kind::Variance:
+    case Kind::Stddev:
+        if (n < p) {
+            ring[n] = x;
+            const double d = x - acc;
+            acc += d / static_cast<double>(n + 1);
+            acc2 += d * (x - acc);
+        } else {
+            double &slot = ring[n % p];
+            const double y = slot, old_mean = acc;
+            slot = x;
+            acc += (x - y) / dp;
+            acc2 += (x - y) * (x - acc + y - old_mean);
+            if (++since_anchor >= kAnchorBlock) {
+                since_anchor = 0;
+                double sum = 0.0, sq = 0.0;
+                for (double v : ring)
+                    sum += v;
+                acc = sum / dp;
+                for (double v : ring)
+                    sq += (v - acc) * (v - acc);
+                acc2 = sq;
+            }
+        }
+        break;
+    case Kind::Min:
+    case Kind::Max: {
+        if (dq_size && deque[dq_head].first + p <= n) {
+            dq_head = (dq_head + 1) % p;
+            --dq_size;
+        }
+        const bool is_min = kind == Kind::Min;
+        while (dq_size) {
+            const double back = deque[(dq_head + dq_size - 1) % p].second;
+            if (is_min ? back < x : back > x)
+                break;
+            --dq_size;
+        }
+        deque[(dq_head + dq_size) % p] = {n, x};
+        ++dq_size;
+        break;
+    }
+    case Kind::Vwap:
+        acc += x * w;
+        acc2 += w;
+        if (p) {
+            const size_t i = n % p;
+            if (n >= p) {
+                acc -= ring[i];
+                acc2 -= ring2[i];
+            }
+            ring[i] = x * w;
+            ring2[i] = w;
+            if (++since_anchor >= kAnchorBlock && n + 1 >= p) {
+                since_anchor = 0;
+                acc = acc2 = 0.0;
+                for (size_t j = 0; j < p; ++j) {
+                    acc += ring[j];
+                    acc2 += ring2[j];
+                }
+            }
+        }
+        break;
+    }
+    ++n;
+}
+
+void StreamIndicators::Slot::write() {
+    const double v = current();
+    const uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    value.store(v, std::memory_order_relaxed);
+    time_msc.store(n ? last_msc : 0, std::memory_order_relaxed);
+    samples.store(n, std::memory_order_relaxed);
+    ready.store(!std::isnan(v), std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+}
+
+StreamIndicators &StreamIndicators::instance() {
+    static StreamIndicators indicators;
+    return indicators;
+}
+
+StreamIndicators::StreamIndicators() : slots_(new Slot[kCapacity]) {
+    free_.reserve(kCapacity);
+    for (size_t i = kCapacity; i > 0; --i)
+        free_.push_back(i - 1);
+}
+
+StreamIndicators::~StreamIndicators() = default;
+
+bool StreamIndicators::add(const StreamSpec &spec, int64_t &id, std::string &error) {
+    const KindName *kind = nullptr;
+    for (const KindName &k : kKinds) {
+        if (spec.kind == k.name)
+            kind = &k;
+    }
+    if (!kind) {
+        error = "unknown indicator kind: " + spec.kind;
+        return false;
+    }
+    const bool bars = spec.timeframe != 0;
+    const FieldName *field = nullptr;
+    const std::string name = spec.field.empty() ? (bars ? "close" : "bid") : spec.field;
+    for (const FieldName &f : kFields) {
+        if (name == f.name && f.bars == bars)
+            field = &f;
+    }
+    if (!field) {
+        error = "field " + name + " does not exist for " + (bars ? "bars" : "ticks");
+        return false;
+    }
+    if (spec.symbol.empty() || spec.timeframe < 0) {
+        error = "indicator requires a symbol and a timeframe >= 0";
+        return false;
+    }
+    if ((spec.period == 0 && kind->kind != Kind::Vwap) || spec.period > kMaxPeriod) {
+        error = "period must be between 1 and " + std::to_string(kMaxPeriod);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        error = "too many indicators (" + std::to_string(kCapacity) + ")";
+        return false;
+    }
+    const size_t index = free_.back();
+    free_.pop_back();
+    Slot &s = slots_[index];
+    s.spec = spec;
+    s.spec.field = field->name;
+    s.kind = kind->kind;
+    s.field = field->field;
+    s.last_msc = std::numeric_limits<int64_t>::min();
+    s.last_seq = s.n = s.since_anchor = 0;
+    s.acc = s.acc2 = 0.0;
+    const bool windowed = s.kind == Kind::Variance || s.kind == Kind::Stddev ||
+                          (s.kind == Kind::Vwap && spec.period);
+    s.ring.assign(windowed ? spec.period : 0, 0.0);
+    s.ring2.assign(s.kind == Kind::Vwap ? s.ring.size() : 0, 0.0);
+    const bool extremes = s.kind == Kind::Min || s.kind == Kind::Max;
+    s.deque.assign(extremes ? spec.period : 0, {0, 0.0});
+    s.dq_head = s.dq_size = 0;
+
+    id = static_cast<int64_t>(++s.generation * kCapacity + index + 1);
+    s.id.store(id, std::memory_order_relaxed);
+    s.write();
+    by_symbol_[spec.symbol].push_back(index);
+    active_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool StreamIndicators::remove(int64_t id) {
+    if (id <= 0)
+        return false;
+    const size_t index = static_cast<size_t>(id - 1) % kCapacity;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot &s = slots_[index];
+    if (s.id.load(std::memory_order_relaxed) != id)
+        return false;
+    const uint64_t seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.id.store(0, std::memory_order_relaxed);
+    s.seq.store(seq + 2, std::memory_order_release);
+
+    auto it = by_symbol_.find(s.spec.symbol);
+    it->second.erase(std::find(it->second.begin(), it->second.end(), index));
+    if (it->second.empty())
+        by_symbol_.erase(it);
+    free_.push_back(index);
+    active_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool StreamIndicators::read(int64_t id, StreamValue &out) const {
+    if (id <= 0)
+        return false;
+    const Slot &s = slots_[static_cast<size_t>(id - 1) % kCapacity];
+    for (;;) {
+        const uint64_t before = s.seq.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int64_t current = s.id.load(std::memory_order_relaxed);
+        out.value = s.value.load(std::memory_order_relaxed);
+        out.time_msc = s.time_msc.load(std::memory_order_relaxed);
+        out.samples = s.samples.load(std::memory_order_relaxed);
+        out.ready = s.ready.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == before)
+            return current == id;
+    }
+}
+
+void StreamIndicators::on_ticks(const char *symbol, const std::vector<Tick> &ticks) {
+    if (active_.load(std::memory_order_relaxed) == 0 || ticks.empty())
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_symbol_.find(symbol);
+    if (it == by_symbol_.end())
+        return;
+    for (size_t index : it->second) {
+        Slot &s = slots_[index];
+        if (s.spec.timeframe != 0)
+            continue;
+        bool consumed = false;
+        for (const Tick &t : ticks) {
+            const bool fresh = t.time_msc > s.last_msc ||
+                               (t.time_msc == s.last_msc && t.seq > s.last_seq);
+            if (!fresh)
+                continue;
+            s.last_msc = t.time_msc;
+            s.last_seq = t.seq;
+            double x, w = 0.0;
+            if (s.kind == Kind::Vwap) {
+                x = t.last > 0.0 ? t.last : 0.5 * (t.bid + t.ask);
+                w = t.volume_real > 0.0 ? t.volume_real : static_cast<double>(t.volume);
+                if (!(w > 0.0))
+                    continue;
+            } else {
+                x = tick_field(t, s.field);
+            }
+            if (!(x > 0.0))
+                continue;
+            s.push(x, w);
+            consumed = true;
+        }
+        if (consumed)
+            s.write();
+    }
+}
+
+void StreamIndicators::on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars,
+                               bool forming) {
+    if (active_.load(std::memory_order_relaxed) == 0 || bars.empty())
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_symbol_.find(symbol);
+    if (it == by_symbol_.end())
+        return;
+    const size_t closed = forming ? bars.size() - 1 : bars.size();
+    for (size_t index : it->second) {
+        Slot &s = slots_[index];
+        if (s.spec.timeframe != timeframe)
+            continue;
+        bool consumed = false;
+        for (size_t i = 0; i < closed; ++i) {
+            const Bar &b = bars[i];
+            if (b.time * 1000 <= s.last_msc)
+                continue;
+            s.last_msc = b.time * 1000;
+            double x, w = 0.0;
+            if (s.kind == Kind::Vwap) {
+                x = (b.high + b.low + b.close) / 3.0;
+                w = static_cast<double>(b.real_volume ? b.real_volume : b.tick_volume);
+                if (!(w > 0.0))
+                    continue;
+            } else {
+                x = bar_field(b, s.field);
+            }
+            if (!(x > 0.0))
+                continue;
+            s.push(x, w);
+            consumed = true;
+        }
+        if (consumed)
+            s.write();
+    }
+}
+
+json_t *StreamIndicators::to_json(const char *symbol) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *out = json_array();
+    for (const auto &kv : by_symbol_) {
+        if (symbol && kv.first != symbol)
+            continue;
+        for (size_t index : kv.second) {
+            const Slot &s = slots_[index];
+            const double value = s.current();
+            json_t *obj = json_object();
+            json_object_set_new(obj, "id", json_integer(s.id.load(std::memory_order_relaxed)));
+            json_object_set_new(obj, "symbol", json_string(s.spec.symbol.c_str()));
+            json_object_set_new(obj, "kind", json_string(s.spec.kind.c_str()));
+            json_object_set_new(obj, "timeframe", json_integer(s.spec.timeframe));
+            json_object_set_new(obj, "field", json_string(s.spec.field.c_str()));
+            json_object_set_new(obj, "period", json_integer(static_cast<json_int_t>(s.spec.period)));
+            json_object_set_new(obj, "value", std::isnan(value) ? json_null() : json_real(value));
+            json_object_set_new(obj, "time_msc", json_integer(s.n ? s.last_msc : 0));
+            json_object_set_new(obj, "samples", json_integer(static_cast<json_int_t>(s.n)));
+            json_object_set_new(obj, "ready", json_boolean(!std::isnan(value)));
+            json_array_append_new(out, obj);
+        }
+    }
+    return out;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,108 @@
+/*
+ * stream_indicators.hpp
+ *
+ * Indicators kept up to date inside the bridge as bars and ticks arrive.
+ *
+ * An indicator is registered for one symbol and one source: its ticks
+ * (timeframe 0) or its bars of one timeframe. Every live bar or tick
+ * answer passes through on_bars/on_ticks after the integrity stage, and
+ * each indicator takes the records newer than the last one it consumed,
+ * so overlapping polls count every record once and a new indicator warms
+ * up from the history in the next answer. The newest bar of an answer is
+ * still forming and is left for a later poll, unless the request asked
+ * from a "start" past it. Ticks sharing the newest consumed millisecond
+ * are only taken when the integrity stage sequenced them as new.
+ *
+ * Each update is O(1):
+ *
+ *   ema       seeded with the mean of the first period samples
+ *   variance  population variance of the last period samples, by
+ *   stddev    windowed Welford updates
+ *   min, max  monotonic deque over the last period samples
+ *   vwap      volume-weighted price; period 0 = since registration
+ *
+ * VWAP weighs bars' typical price by real volume, else tick volume, and
+ * ticks' last price (mid when there is none) by their volume; ticks
+ * without volume are skipped. Other kinds read one field: open, high,
+ * low or close of bars (default close), bid, ask, last or mid of ticks
+ * (default bid). Samples with a non-positive price are skipped.
+ *
+ * Updates are serialized by a mutex. Readers never take it: each
+ * indicator publishes its value under a sequence lock in a slot that is
+ * never freed, and ids carry a generation so a read through a stale id
+ * fails instead of returning a reused slot's value.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+struct StreamSpec {
+    std::string symbol;
+    std::string kind;       // ema, variance, stddev, min, max or vwap.
+    int64_t timeframe = 0;  // 0 = ticks.
+    std::string field;      // Empty = close for bars, bid for ticks.
+    uint64_t period = 0;
+};
+
+struct StreamValue {
+    double value = 0.0;     // NaN until ready.
+    int64_t time_msc = 0;   // Time of the last sample consumed.
+    uint64_t samples = 0;   // Samples consumed so far.
+    bool ready = false;
+};
+
+class StreamIndicators {
+public:
+    static constexpr size_t kCapacity = 4096;
+
+    static StreamIndicators &instance();
+
+    /* Registers an indicator; false with error on an invalid spec or
+     * when kCapacity indicators exist.
+     */
+    bool add(const StreamSpec &spec, int64_t &id, std::string &error);
+
+    /* False if id is unknown. */
+    bool remove(int64_t id);
+
+    /* Lock-free; false if id is unknown. */
+    bool read(int64_t id, StreamValue &out) const;
+
+    void on_ticks(const char *symbol, const std::vector<Tick> &ticks);
+    /* forming: the last bar is still open. */
+    void on_bars(const char *symbol, int64_t timeframe, const std::vector<Bar> &bars,
+                 bool forming);
+
+    /* Returns [{"id", "symbol", "kind", "timeframe", "field", "period",
+     * "value", "time_msc", "samples", "ready"}, ...], of one symbol when
+     * symbol is not null.
+     */
+    json_t *to_json(const char *symbol) const;
+
+private:
+    struct Slot;
+
+    StreamIndicators();
+    ~StreamIndicators();
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> active_{0};
+    mutable std::mutex mutex_;
+    std::vector<size_t> free_;
+    std::unordered_map<std::string, std::vector<size_t>> by_symbol_;
+};
+
+} // namespace mt5bridge
@@ -0,0 +1,314 @@
+/*
+ * thread_config.cpp
+ *
+ * Per-role thread policies and their application through the native
+ * thread APIs (Win32 on Windows, pthreads elsewhere).
+ */
+
+#include "thread_config.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MT5BRIDGE_HAS_PAUSE 1
+#endif
+
+namespace mt5bridge {
+namespace {
+
+constexpr size_t kRoleCount = static_cast<size_t>(ThreadRole::Count);
+
+std::mutex g_policy_mutex;
+std::array<ThreadPolicy, kRoleCount> g_policies;
+
+const char *const kRoleNames[kRoleCount] = {
+    "python_executor", "quote_poller", "disk_writer", "timer", "worker"};
+
+struct NamedSched {
+    const char *name;
+    SchedPolicy value;
+};
+const NamedSched kSchedNames[] = {{"normal", SchedPolicy::Normal},
+                                  {"idle", SchedPolicy::Idle},
+                                  {"fifo", SchedPolicy::Fifo},
+                                  {"rr", SchedPolicy::RoundRobin}};
+
+struct NamedWait {
+    const char *name;
+    WaitMode value;
+};
+const NamedWait kWaitNames[] = {{"block", WaitMode::Block},
+                                {"spin", WaitMode::Spin},
+                                {"spin_then_park", WaitMode::SpinThenPark}};
+
+void append_error(std::string *error, const std::string &msg) {
+    if (!error)
+        return;
+    if (!error->empty())
+        *error += "; ";
+    *error += msg;
+}
+
+#if defined(_WIN32)
+
+bool apply_affinity(const std::vector<int> &cpus, std::string *error) {
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            append_error(error, "cpu index out of range: " + std::to_string(cpu));
+            return false;
+        }
+        mask |= static_cast<DWORD_PTR>(1) << cpu;
+    }
+    if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        append_error(error, "SetThreadAffinityMask failed");
+        return false;
+    }
+    return true;
+}
+
+bool apply_sched(SchedPolicy sched, int priority, std::string *error) {
+    int win_priority = THREAD_PRIORITY_NORMAL;
+    switch (sched) {
+    case SchedPolicy::Normal:
+        win_priority = priority < -2 ? -2 : (priority > 2 ? 2 : priority);
+        break;
+    case SchedPolicy::Idle:
+        win_priority = THREAD_PRIORITY_IDLE;
+        break;
+    case SchedPolicy::Fifo:
+    case SchedPolicy::RoundRobin:
+        win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+        break;
+    }
+    if (!SetThreadPriority(GetCurrentThread(), win_priority)) {
+        append_error(error, "SetThreadPriority failed");
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool apply_affinity(const std::vector<int> &cpus, std::string *error) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            append_error(error, "cpu index out of range: " + std::to_string(cpu));
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        append_error(error, std::string("pthread_setaffinity_np: ") + std::strerror(rc));
+        return false;
+    }
+    return true;
+#else
+    (void)cpus;
+    append_error(error, "cpu affinity not supported on this platform");
+    return false;
+#endif
+}
+
+bool apply_sched(SchedPolicy sched, int priority, std::string *error) {
+    int policy = SCHED_OTHER;
+    sched_param param{};
+    switch (sched) {
+    case SchedPolicy::Normal:
+        break;
+    case SchedPolicy::Idle:
+#if defined(SCHED_IDLE)
+        policy = SCHED_IDLE;
+#endif
+        break;
+    case SchedPolicy::Fifo:
+        policy = SCHED_FIFO;
+        param.sched_priority = priority;
+        break;
+    case SchedPolicy::RoundRobin:
+        policy = SCHED_RR;
+        param.sched_priority = priority;
+        break;
+    }
+    int rc = pthread_setschedparam(pthread_self(), policy, &param);
+    if (rc != 0) {
+        append_error(error, std::string("pthread_setschedparam: ") + std::strerror(rc));
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
+const char *to_string(ThreadRole role) {
+    size_t idx = static_cast<size_t>(role);
+    return idx < kRoleCount ? kRoleNames[idx] : "unknown";
+}
+
+bool parse_thread_role(const char *name, ThreadRole &role) {
+    if (!name)
+        return false;
+    for (size_t i = 0; i < kRoleCount; ++i) {
+        if (std::strcmp(name, kRoleNames[i]) == 0) {
+            role = static_cast<ThreadRole>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void set_thread_policy(ThreadRole role, const ThreadPolicy &policy) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    g_policies[static_cast<size_t>(role)] = policy;
+}
+
+ThreadPolicy thread_policy(ThreadRole role) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    return g_policies[static_cast<size_t>(role)];
+}
+
+bool apply_thread_policy(ThreadRole role, std::string *error) {
+    ThreadPolicy policy = thread_policy(role);
+    bool ok = true;
+    if (!policy.cpus.empty())
+        ok = apply_affinity(policy.cpus, error) && ok;
+    if (policy.sched != SchedPolicy::Normal || policy.priority != 0)
+        ok = apply_sched(policy.sched, policy.priority, error) && ok;
+    return ok;
+}
+
+std::thread start_thread(ThreadRole role, std::function<void()> fn) {
+    return std::thread([role, fn = std::move(fn)]() {
+        // A refused policy (e.g. missing real-time privileges) must not
+        // stop the thread from doing its job.
+        apply_thread_policy(role);
+        fn();
+    });
+}
+
+bool thread_policy_from_json(const json_t *obj, ThreadPolicy &policy,
+                             std::string &error) {
+    if (!json_is_object(obj)) {
+        error = "thread policy must be an object";
+        return false;
+    }
+
+    if (json_t *cpus = json_object_get(obj, "cpus")) {
+        if (!json_is_array(cpus)) {
+            error = "cpus must be an array";
+            return false;
+        }
+        std::vector<int> list;
+        for (size_t i = 0; i < json_array_size(cpus); ++i) {
+            json_t *v = json_array_get(cpus, i);
+            if (!json_is_integer(v) || json_integer_value(v) < 0) {
+                error = "cpus must contain non-negative integers";
+                return false;
+            }
+            list.push_back(static_cast<int>(json_integer_value(v)));
+        }
+        policy.cpus = std::move(list);
+    }
+
+    if (json_t *sched = json_object_get(obj, "sched")) {
+        const char *name = json_string_value(sched);
+        bool found = false;
+        for (const auto &s : kSchedNames) {
+            if (name && std::strcmp(name, s.name) == 0) {
+                policy.sched = s.value;
+                found = true;
+            }
+        }
+        if (!found) {
+            error = "sched must be one of normal, idle, fifo, rr";
+            return false;
+        }
+    }
+
+    if (json_t *prio = json_object_get(obj, "priority")) {
+        if (!json_is_integer(prio)) {
+            error = "priority must be an integer";
+            return false;
+        }
+        policy.priority = static_cast<int>(json_integer_value(prio));
+    }
+
+    if (json_t *wait = json_object_get(obj, "wait")) {
+        const char *name = json_string_value(wait);
+        bool found = false;
+        for (const auto &w : kWaitNames) {
+            if (name && std::strcmp(name, w.name) == 0) {
+                policy.wait = w.value;
+                found = true;
+            }
+        }
+        if (!found) {
+            error = "wait must be one of block, spin, spin_then_park";
+            return false;
+        }
+    }
+
+    if (json_t *spin = json_object_get(obj, "spin_us")) {
+        if (!json_is_integer(spin) || json_integer_value(spin) < 0) {
+            error = "spin_us must be a non-negative integer";
+            return false;
+        }
+        policy.spin_us = static_cast<uint32_t>(json_integer_value(spin));
+    }
+
+    bool realtime = policy.sched == SchedPolicy::Fifo ||
+                    policy.sched == SchedPolicy::RoundRobin;
+    if (realtime && (policy.priority < 1 || policy.priority > 99)) {
+        error = "real-time priority must be in 1..99";
+        return false;
+    }
+    return true;
+}
+
+json_t *thread_policy_to_json(const ThreadPolicy &policy) {
+    json_t *cpus = json_array();
+    for (int cpu : policy.cpus)
+        json_array_append_new(cpus, json_integer(cpu));
+
+    const char *sched = "normal";
+    for (const auto &s : kSchedNames)
+        if (s.value == policy.sched)
+            sched = s.name;
+    const char *wait = "block";
+    for (const auto &w : kWaitNames)
+        if (w.value == policy.wait)
+            wait = w.name;
+
+    json_t *obj = json_object();
+    json_object_set_new(obj, "cpus", cpus);
+    json_object_set_new(obj, "sched", json_string(sched));
+    json_object_set_new(obj, "priority", json_integer(policy.priority));
+    json_object_set_new(obj, "wait", json_string(wait));
+    json_object_set_new(obj, "spin_us", json_integer(policy.spin_us));
+    return obj;
+}
+
+void Signal::cpu_relax() {
+#if defined(MT5BRIDGE_HAS_PAUSE)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,157 @@
+/*
+ * thread_config.hpp
+ *
+ * Placement and scheduling of the threads owned by the bridge.
+ *
+ * Every thread the bridge starts belongs to a role (Python executor,
+ * quote poller, disk writer, ...). Each role carries a ThreadPolicy
+ * describing the CPUs it may run on, the scheduler class/priority and
+ * how it waits for work. Policies are process-wide and are applied by
+ * the thread itself when it starts (see start_thread()), so changing a
+ * policy affects threads started afterwards.
+ */
+
+#pragma once
+
+#include <jansson.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mt5bridge {
+
+enum class ThreadRole {
+    PythonExecutor, // Thread starting the embedded interpreter (mt5bridge_initialize).
+    QuotePoller,    // Threads polling ticks/bars from the terminal.
+    DiskWriter,     // Journal and history writers.
+    Timer,          // Timer wheel driving scheduled work.
+    Worker,         // Compute workers (backtests, matrices, ...).
+    Count
+};
+
+enum class SchedPolicy {
+    Normal,     // Default time-sharing scheduler.
+    Idle,       // Lowest priority, runs only when CPUs are idle.
+    Fifo,       // Real-time FIFO (time-critical priority on Windows).
+    RoundRobin  // Real-time round-robin (time-critical priority on Windows).
+};
+
+enum class WaitMode {
+    Block,        // Park on a condition variable immediately.
+    Spin,         // Busy-spin; lowest latency, burns a core.
+    SpinThenPark  // Spin for spin_us, then park.
+};
+
+struct ThreadPolicy {
+    std::vector<int> cpus;        // Allowed CPUs; empty lets the OS decide.
+    SchedPolicy sched = SchedPolicy::Normal;
+    int priority = 0;             // Relative (-2..2) for Normal, 1..99 for real-time.
+    WaitMode wait = WaitMode::Block;
+    uint32_t spin_us = 50;        // Spin budget for SpinThenPark.
+};
+
+const char *to_string(ThreadRole role);
+bool parse_thread_role(const char *name, ThreadRole &role);
+
+/* Replaces the policy of a role. Thread-safe. */
+void set_thread_policy(ThreadRole role, const ThreadPolicy &policy);
+
+/* Returns a copy of the current policy of a role. */
+ThreadPolicy thread_policy(ThreadRole role);
+
+/* Applies the policy of role to the calling thread.
+ * Returns false and fills error if the OS refused part of it; the
+ * remaining settings are still applied.
+ */
+bool apply_thread_policy(ThreadRole role, std::string *error = nullptr);
+
+/* Starts a thread that applies the policy of role before running fn. */
+std::thread start_thread(ThreadRole role, std::function<void()> fn);
+
+/* Parses {"cpus":[..], "sched":"fifo", "priority":n, "wait":"spin_then_park",
+ * "spin_us":n}. Missing members keep their current value in policy.
+ */
+bool thread_policy_from_json(const json_t *obj, ThreadPolicy &policy,
+                             std::string &error);
+json_t *thread_policy_to_json(const ThreadPolicy &policy);
+
+/* Wakeup primitive honouring a WaitMode.
+ *
+ * Producers change shared state and call notify(); consumers call
+ * wait(pred) which returns once pred() holds. In SpinThenPark mode the
+ * consumer polls pred() for spin_us before parking, and producers only
+ * take the mutex when a consumer is actually parked.
+ */
+class Signal {
+public:
+    explicit Signal(WaitMode mode = WaitMode::Block, uint32_t spin_us = 50)
+        : mode_(mode), spin_us_(spin_us) {}
+
+    explicit Signal(const ThreadPolicy &policy)
+        : Signal(policy.wait, policy.spin_us) {}
+
+    void notify() {
+        // Orders the caller's state change before the parked_ check.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_seq_cst) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+    }
+
+    template <class Pred> void wait(Pred pred) {
+        wait_until(pred, std::chrono::steady_clock::time_point::max());
+    }
+
+    /* Returns pred() at exit; false means the deadline passed first. */
+    template <class Pred>
+    bool wait_until(Pred pred, std::chrono::steady_clock::time_point deadline) {
+        if (pred())
+            return true;
+        if (mode_ != WaitMode::Block) {
+            const auto spin_end =
+                mode_ == WaitMode::Spin
+                    ? deadline
+                    : std::chrono::steady_clock::now() +
+                          std::chrono::microseconds(spin_us_);
+            while (std::chrono::steady_clock::now() < spin_end) {
+                for (int i = 0; i < 64; ++i) {
+                    if (pred())
+                        return true;
+                    cpu_relax();
+                }
+            }
+            if (mode_ == WaitMode::Spin)
+                return pred();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        parked_.fetch_add(1, std::memory_order_seq_cst);
+        bool ok = true;
+        if (deadline == std::chrono::steady_clock::time_point::max())
+            cv_.wait(lock, pred);
+        else
+            ok = cv_.wait_until(lock, deadline, pred);
+        parked_.fetch_sub(1, std::memory_order_seq_cst);
+        return ok;
+    }
+
+    WaitMode mode() const { return mode_; }
+
+private:
+    static void cpu_relax();
+
+    WaitMode mode_;
+    uint32_t spin_us_;
+    std::atomic<int> parked_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace mt5bridge
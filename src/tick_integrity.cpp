@@ -0,0 +1,131 @@
+/*
+ * tick_integrity.cpp
+ *
+ * Per-stream high-water-mark deduplication and sequencing.
+ */
+
+#include "tick_integrity.hpp"
+
+#include <cstring>
+
+namespace mt5bridge {
+namespace {
+
+// date_from is in seconds, so the next poll of a stream may start up to
+// a second before its newest tick.
+constexpr int64_t kPollSlackMs = 1000;
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    // splitmix64 finalizer over the running value.
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t bits(double d) {
+    uint64_t u;
+    std::memcpy(&u, &d, sizeof u);
+    return u;
+}
+
+uint64_t tick_key(const Tick &t) {
+    uint64_t h = mix(0, static_cast<uint64_t>(t.time_msc));
+    h = mix(h, bits(t.bid));
+    h = mix(h, bits(t.ask));
+    return mix(h, t.flags);
+}
+
+} // namespace
+
+TickIntegrity &TickIntegrity::instance() {
+    static TickIntegrity integrity;
+    return integrity;
+}
+
+void TickIntegrity::process(const std::string &stream, std::vector<Tick> &ticks,
+                            int64_t window_start_msc) {
+    const int64_t gap_ms = gap_ms_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream &s = streams_[stream];
+
+    // A window starting further back than that is a historical fetch,
+    // not the next poll: it passes through without dedup or sequencing.
+    if (window_start_msc >= 0 && s.hwm_msc >= 0 &&
+        window_start_msc < s.hwm_msc - kPollSlackMs) {
+        s.historical += ticks.size();
+        return;
+    }
+
+    // A window starting after the newest tick seen may have skipped ticks.
+    bool window_gap = s.hwm_msc >= 0 && window_start_msc > s.hwm_msc;
+
+    size_t out = 0;
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        Tick t = ticks[i];
+
+        if (t.time_msc < s.hwm_msc) {
+            ++s.duplicates;
+            continue;
+        }
+        const uint64_t key = tick_key(t);
+        if (t.time_msc == s.hwm_msc) {
+            const size_t held = s.same_ms_count < kSameMsSlots ? s.same_ms_count
+                                                               : kSameMsSlots;
+            bool seen = false;
+            for (size_t k = 0; k < held && !seen; ++k)
+                seen = s.same_ms[k] == key;
+            if (seen) {
+                ++s.duplicates;
+                continue;
+            }
+        } else {
+            if (gap_ms > 0 && s.hwm_msc >= 0 && t.time_msc - s.hwm_msc > gap_ms)
+                t.integrity |= kTickGapTime;
+            s.hwm_msc = t.time_msc;
+            s.same_ms_count = 0;
+        }
+        s.same_ms[s.same_ms_count % kSameMsSlots] = key;
+        ++s.same_ms_count;
+
+        if (window_gap) {
+            t.integrity |= kTickGapWindow;
+            window_gap = false;
+        }
+        if (t.integrity)
+            ++s.gaps;
+        t.seq = s.next_seq++;
+        ++s.accepted;
+        ticks[out++] = t;
+    }
+    ticks.resize(out);
+}
+
+void TickIntegrity::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.clear();
+}
+
+json_t *TickIntegrity::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json_t *root = json_object();
+    for (const auto &kv : streams_) {
+        const Stream &s = kv.second;
+        json_t *obj = json_object();
+        json_object_set_new(obj, "accepted", json_integer(static_cast<json_int_t>(s.accepted)));
+        json_object_set_new(obj, "duplicates", json_integer(static_cast<json_int_t>(s.duplicates)));
+        json_object_set_new(obj, "gaps", json_integer(static_cast<json_int_t>(s.gaps)));
+        json_object_set_new(obj, "historical",
+                            json_integer(static_cast<json_int_t>(s.historical)));
+        json_object_set_new(obj, "last_seq", json_integer(static_cast<json_int_t>(s.next_seq - 1)));
+        json_object_set_new(obj, "last_time_msc", json_integer(s.hwm_msc));
+        json_object_set_new(root, kv.first.c_str(), obj);
+    }
+    return root;
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,82 @@
+/*
+ * tick_integrity.hpp
+ *
+ * Deduplication, sequencing and gap detection for polled tick streams.
+ *
+ * Overlapping copy_ticks_* polls return ticks that were already
+ * delivered. Each stream (symbol plus COPY_TICKS_* filter) keeps a
+ * high-water mark: ticks older than it are duplicates; ticks in the same
+ * millisecond are told apart by a hash of (time_msc, bid, ask, flags)
+ * kept in a small fixed ring. Accepted ticks get consecutive sequence
+ * numbers. A tick is flagged as following a suspected gap when the poll
+ * window did not reach back to the last tick seen, or when the silence
+ * before it exceeds integrity.gap_ms. A window starting more than a
+ * second before the high-water mark is a historical fetch rather than
+ * the next poll; its ticks pass through unsequenced (seq 0) and leave
+ * the stream untouched. State per stream is constant size.
+ */
+
+#pragma once
+
+#include "market_data.hpp"
+
+#include <jansson.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+class TickIntegrity {
+public:
+    static TickIntegrity &instance();
+
+    /* Silence in ms after which the next tick is flagged; 0 disables. */
+    void set_gap_ms(int64_t gap_ms) { gap_ms_.store(gap_ms, std::memory_order_relaxed); }
+
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /* Removes duplicates from ticks (sorted by time_msc, as returned by
+     * the terminal) and stamps seq/integrity on the rest. window_start_msc
+     * is the first millisecond the poll asked for, or -1 if unknown.
+     */
+    void process(const std::string &stream, std::vector<Tick> &ticks,
+                 int64_t window_start_msc);
+
+    /* Forgets all streams. */
+    void reset();
+
+    /* Returns {"<stream>": {"accepted", "duplicates", "gaps",
+     * "historical", "last_seq", "last_time_msc"}, ...}; historical counts
+     * the ticks of historical fetches passed through.
+     */
+    json_t *to_json() const;
+
+private:
+    static constexpr size_t kSameMsSlots = 16;
+
+    struct Stream {
+        int64_t hwm_msc = -1;           // Newest time_msc accepted.
+        uint64_t same_ms[kSameMsSlots]; // Hashes of ticks at hwm_msc.
+        size_t same_ms_count = 0;
+        uint64_t next_seq = 1;
+        uint64_t accepted = 0;
+        uint64_t duplicates = 0;
+        uint64_t gaps = 0;
+        uint64_t historical = 0;
+    };
+
+    TickIntegrity() = default;
+
+    std::atomic<int64_t> gap_ms_{60000};
+    std::atomic<bool> enabled_{true};
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Stream> streams_;
+};
+
+} // namespace mt5bridge
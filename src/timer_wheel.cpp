@@ -0,0 +1,202 @@
+/*
+ * timer_wheel.cpp
+ *
+ * Slot placement, cascading and the timer thread.
+ */
+
+#include "timer_wheel.hpp"
+
+#include "clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace mt5bridge {
+namespace {
+
+constexpr uint64_t kSlotMask = 0xFF;
+constexpr uint64_t kSpan = uint64_t(1) << 32; // Ticks the four levels cover.
+
+/* Tick holding t_ns. */
+uint64_t tick_at(int64_t t_ns) { return static_cast<uint64_t>(t_ns / TimerWheel::kTickNs); }
+
+} // namespace
+
+TimerWheel &TimerWheel::instance() {
+    static TimerWheel wheel;
+    return wheel;
+}
+
+TimerWheel::~TimerWheel() { stop(); }
+
+void TimerWheel::place(uint64_t id, int64_t due_ns) {
+    uint64_t due = std::max(tick_at(due_ns), now_);
+    const uint64_t delta = due - now_;
+    if (delta >= kSpan)
+        due = now_ + kSpan - 1; // Placed again when the last level cascades.
+    int level = 0;
+    while (level < kLevels - 1 && (due - now_) >> (kSlotBits * (level + 1)))
+        ++level;
+    slots_[level][(due >> (kSlotBits * level)) & kSlotMask].push_back(id);
+}
+
+void TimerWheel::cascade(int level, uint64_t tick) {
+    std::vector<uint64_t> ids;
+    ids.swap(slots_[level][(tick >> (kSlotBits * level)) & kSlotMask]);
+    for (uint64_t id : ids) {
+        auto it = timers_.find(id);
+        if (it != timers_.end())
+            place(id, it->second.due_ns);
+    }
+}
+
+int64_t TimerWheel::next_wake() const {
+    // The earliest timer of the next occupied slot of level 0, or the
+    // next cascade.
+    const uint64_t boundary = (now_ | kSlotMask) + 1;
+    for (uint64_t t = now_; t < boundary; ++t) {
+        int64_t wake = INT64_MAX;
+        for (uint64_t id : slots_[0][t & kSlotMask]) {
+            auto it = timers_.find(id);
+            if (it != timers_.end())
+                wake = std::min(wake, it->second.due_ns);
+        }
+        if (wake != INT64_MAX)
+            return wake;
+    }
+    return static_cast<int64_t>(boundary) * kTickNs;
+}
+
+uint64_t TimerWheel::schedule(int64_t due_ns, int64_t period_ns, Task task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+        if (thread_.joinable())
+            thread_.join();
+        signal_.reset(new Signal(thread_policy(ThreadRole::Timer)));
+        stopping_.store(false);
+        now_ = cascaded_ = tick_at(now_ns());
+        running_ = true;
+        thread_ = start_thread(ThreadRole::Timer, [this] { run(); });
+    }
+    const uint64_t id = next_id_++;
+    timers_[id] = {due_ns, std::max<int64_t>(period_ns, 0),
+                   std::make_shared<Task>(std::move(task))};
+    place(id, due_ns);
+    woken_.store(true);
+    signal_->notify();
+    return id;
+}
+
+bool TimerWheel::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timers_.erase(id) != 0; // Its slot entry is skipped when reached.
+}
+
+void TimerWheel::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+        return;
+    running_ = false;
+    timers_.clear();
+    for (auto &level : slots_)
+        for (auto &slot : level)
+            slot.clear();
+    stopping_.store(true);
+    signal_->notify();
+    std::thread thread = std::move(thread_);
+    lock.unlock();
+    if (thread.joinable() && thread.get_id() != std::this_thread::get_id())
+        thread.join();
+    else if (thread.joinable())
+        thread.detach();
+}
+
+void TimerWheel::run() {
+    std::vector<std::pair<uint64_t, Timer>> due;
+    std::unique_lock<std::mutex> lock(mutex_);
+    Signal &signal = *signal_;
+    while (!stopping_.load()) {
+        // Past ticks are drained whole, the current one up to the clock.
+        const int64_t now = now_ns();
+        const uint64_t current = tick_at(now);
+        while (now_ <= current) {
+            const uint64_t t = now_;
+            if (cascaded_ != t) {
+                for (int level = 1; level < kLevels; ++level) {
+                    if (t & ((uint64_t(1) << (kSlotBits * level)) - 1))
+                        break;
+                    cascade(level, t);
+                }
+                cascaded_ = t;
+            }
+            std::vector<uint64_t> ids;
+            ids.swap(slots_[0][t & kSlotMask]);
+            for (uint64_t id : ids) {
+                auto it = timers_.find(id);
+                if (it == timers_.end())
+                    continue;
+                if (it->second.due_ns > now) {
+                    if (tick_at(it->second.due_ns) > t)
+                        place(id, it->second.due_ns); // Parked beyond the wheel's span.
+                    else
+                        slots_[0][t & kSlotMask].push_back(id);
+                    continue;
+                }
+                due.emplace_back(id, it->second);
+                if (it->second.period_ns <= 0)
+                    timers_.erase(it);
+            }
+            if (t == current)
+                break;
+            ++now_;
+        }
+
+        if (!due.empty()) {
+            lock.unlock();
+            for (auto &entry : due) {
+                const int64_t late = now_ns() - entry.second.due_ns;
+                (*entry.second.task)();
+                std::lock_guard<std::mutex> relock(mutex_);
+                ++fired_;
+                late_sum_ns_ += std::max<int64_t>(late, 0);
+                late_max_ns_ = std::max(late_max_ns_, late);
+                auto it = timers_.find(entry.first);
+                if (it == timers_.end() || it->second.period_ns <= 0)
+                    continue;
+                // Next period still ahead of the clock.
+                Timer &timer = it->second;
+                const int64_t now = now_ns();
+                timer.due_ns += timer.period_ns;
+                if (timer.due_ns <= now)
+                    timer.due_ns += ((now - timer.due_ns) / timer.period_ns + 1) * timer.period_ns;
+                place(it->first, timer.due_ns);
+            }
+            due.clear();
+            lock.lock();
+            continue;
+        }
+
+        const int64_t wake_ns =
+            timers_.empty() ? static_cast<int64_t>(now_ + kSpan) * kTickNs : next_wake();
+        woken_.store(false);
+        lock.unlock();
+        const auto deadline =
+            std::chrono::steady_clock::now() +
+            std::chrono::nanoseconds(std::min<int64_t>(wake_ns - now_ns(), 3600 * 1000000000LL));
+        signal.wait_until([this] { return woken_.load() || stopping_.load(); }, deadline);
+        lock.lock();
+    }
+}
+
+json_t *TimerWheel::to_json() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return json_pack("{s:I, s:I, s:f, s:f, s:I}", "timers",
+                     static_cast<json_int_t>(timers_.size()), "fired",
+                     static_cast<json_int_t>(fired_), "late_avg_us",
+                     fired_ ? late_sum_ns_ / 1e3 / static_cast<double>(fired_) : 0.0,
+                     "late_max_us", late_max_ns_ / 1e3, "tick_us",
+                     static_cast<json_int_t>(kTickNs / 1000));
+}
+
+} // namespace mt5bridge
@@ -0,0 +1,107 @@
+/*
+ * timer_wheel.hpp
+ *
+ * Hierarchical timer wheel run by the bridge's timer thread.
+ *
+ * Time is cut into 1 ms ticks of the bridge clock (now_ns()). Four levels
+ * of 256 slots cover 2^32 ticks (about 49 days): level l holds the timers
+ * due within 256^(l+1) ticks, in the slot of their due tick's l-th byte.
+ * When the lower byte of the current tick wraps, the next slot of the
+ * level above is cascaded down, so every timer moves at most three times
+ * and scheduling, cancelling and firing cost the same however many timers
+ * are pending. Timers further out than the wheel covers wait in the last
+ * level and are placed again when it cascades.
+ *
+ * The thread ("timer" role, see thread_config.hpp) starts with the first
+ * timer and sleeps until the earliest due time in the next occupied slot,
+ * or the next cascade, waiting as its thread policy says; a timer
+ * scheduled earlier wakes it. Tasks run on that thread one after the
+ * other, outside the wheel's lock, so a task may schedule or cancel
+ * timers. A timer fires once the clock reaches its due time; a periodic
+ * one is then due period_ns later, skipping periods that already passed.
+ */
+
+#pragma once
+
+#include "thread_config.hpp"
+
+#include <jansson.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mt5bridge {
+
+class TimerWheel {
+public:
+    using Task = std::function<void()>;
+
+    static constexpr int64_t kTickNs = 1000000;
+
+    static TimerWheel &instance();
+
+    /* Runs task at due_ns (bridge clock, UTC nanoseconds), then every
+     * period_ns if it is above zero. Returns the timer id.
+     */
+    uint64_t schedule(int64_t due_ns, int64_t period_ns, Task task);
+
+    /* Removes a timer; a task already running finishes. False for an
+     * unknown id.
+     */
+    bool cancel(uint64_t id);
+
+    /* Drops every timer and stops the thread; the next schedule() starts
+     * it again.
+     */
+    void stop();
+
+    /* Returns {"timers", "fired", "late_avg_us", "late_max_us",
+     * "tick_us"}; lateness is the firing time minus the due time.
+     */
+    json_t *to_json();
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr size_t kSlots = size_t(1) << kSlotBits;
+
+    struct Timer {
+        int64_t due_ns;
+        int64_t period_ns;
+        std::shared_ptr<Task> task;
+    };
+
+    TimerWheel() = default;
+    ~TimerWheel();
+
+    void run();
+
+    /* The rest run with mutex_ held. */
+    void place(uint64_t id, int64_t due_ns);
+    void cascade(int level, uint64_t tick);
+    int64_t next_wake() const;
+
+    std::mutex mutex_;
+    std::unique_ptr<Signal> signal_;    // Made with the thread, under its policy.
+    std::thread thread_;
+    bool running_ = false;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> woken_{false};    // An earlier timer or stop() arrived.
+    uint64_t now_ = 0;                  // Tick being processed.
+    uint64_t cascaded_ = 0;             // Last tick the upper levels were cascaded for.
+    uint64_t next_id_ = 1;
+    std::unordered_map<uint64_t, Timer> timers_;
+    std::array<std::array<std::vector<uint64_t>, kSlots>, kLevels> slots_;
+    uint64_t fired_ = 0;
+    int64_t late_sum_ns_ = 0;
+    int64_t late_max_ns_ = 0;
+};
+
+} // namespace mt5bridge